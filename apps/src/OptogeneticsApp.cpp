@@ -0,0 +1,119 @@
+
+/**
+ * @file
+ *
+ * Runs the optogenetics scenario of OptogeneticsScenario outside the test framework,
+ * configured from the command line and, optionally, a config file of "option = value"
+ * lines (options given on the command line take precedence).
+ *
+ * Startup is kept lean for batches of short runs: PETSc is not initialised, as vertex
+ * simulations run sequentially, no copyright or provenance is printed, machine info is
+ * only written on request, and the optional instrumentation of the scenario is only
+ * constructed when asked for.
+ *
+ * The exit code is 0 on success, 1 if the simulation threw a Chaste or standard library
+ * exception, and 2 for bad arguments.
+ */
+
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <boost/program_options.hpp>
+
+#include "ExecutableSupport.hpp"
+#include "Exception.hpp"
+#include "CommandLineArguments.hpp"
+#include "SimulationTime.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "CellPropertyRegistry.hpp"
+#include "CellId.hpp"
+#include "MatteoProfiler.hpp"
+#include "OptogeneticsScenario.hpp"
+
+namespace po = boost::program_options;
+
+int main(int argc, char *argv[])
+{
+    CommandLineArguments::Instance()->p_argc = &argc;
+    CommandLineArguments::Instance()->p_argv = &argv;
+
+    po::options_description description("Chaste Tissue Optogenetics Usage");
+    description.add_options()
+        ("help,h", "Display this help message")
+        ("config,c", po::value<std::string>(), "Read further options from this file, one 'option = value' per line")
+        ("machine-info", po::bool_switch(), "Write machine_info files to the output directory");
+    OptogeneticsScenario::AddOptions(description);
+
+    po::variables_map args;
+    try
+    {
+        // Values stored first win, so the command line overrides the config file
+        po::store(po::parse_command_line(argc, argv, description), args);
+        if (args.count("config"))
+        {
+            std::string config_path = args["config"].as<std::string>();
+            std::ifstream config_file(config_path.c_str());
+            if (!config_file)
+            {
+                ExecutableSupport::PrintError("Cannot open config file " + config_path);
+                return ExecutableSupport::EXIT_BAD_ARGUMENTS;
+            }
+            po::store(po::parse_config_file(config_file, description), args);
+        }
+        po::notify(args);
+    }
+    catch (const po::error& e)
+    {
+        ExecutableSupport::PrintError(std::string(e.what()) + " (see --help)");
+        return ExecutableSupport::EXIT_BAD_ARGUMENTS;
+    }
+
+    if (args.count("help"))
+    {
+        std::cout << description;
+        return ExecutableSupport::EXIT_OK;
+    }
+
+    int exit_code = ExecutableSupport::EXIT_OK;
+
+    // Set up the singletons as AbstractCellBasedTestSuite does
+    SimulationTime::Instance()->SetStartTime(0.0);
+    RandomNumberGenerator::Instance()->Reseed(0);
+    CellPropertyRegistry::Instance()->Clear();
+    CellId::ResetMaxCellId();
+
+    try
+    {
+        OptogeneticsScenario scenario(args);
+        double start_time = MatteoProfiler::GetWallTime();
+        scenario.Run();
+        double elapsed = MatteoProfiler::GetWallTime() - start_time;
+
+        std::cout << "Simulated " << scenario.GetNumCells() << " cells for " << scenario.GetNumTimeSteps()
+                  << " time steps in " << elapsed << " s; output in " << scenario.GetOutputDirectory() << std::endl;
+
+        if (args["machine-info"].as<bool>())
+        {
+            ExecutableSupport::SetOutputDirectory(scenario.GetOutputDirectory());
+            ExecutableSupport::WriteMachineInfoFile("machine_info");
+        }
+    }
+    catch (const Exception& e)
+    {
+        ExecutableSupport::PrintError(e.GetMessage());
+        exit_code = ExecutableSupport::EXIT_ERROR;
+    }
+    catch (const std::exception& e)
+    {
+        ExecutableSupport::PrintError(e.what());
+        exit_code = ExecutableSupport::EXIT_ERROR;
+    }
+
+    SimulationTime::Destroy();
+    RandomNumberGenerator::Destroy();
+    CellPropertyRegistry::Instance()->Clear();
+    MatteoProfiler::Destroy();
+
+    return exit_code;
+}
@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+"""
+End-to-end scaling benchmark for the TestOptogenetics and Testmatteo scenarios.
+
+Runs each scenario's test runner over a matrix of tissue sizes (--number), time steps
+and sampling multiples, with results output switched off and on, and records the wall
+time, time steps per second, cell time steps per second and peak resident set size of
+every run in a JSON file. If a baseline file from an earlier run is given, any
+configuration whose throughput has fallen by more than the tolerance is reported and
+the script exits with status 1.
+
+Example, after building the runners with scons or cmake:
+
+  scripts/scaling_benchmark.py \\
+      --optogenetics path/to/TestOptogeneticsRunner --matteo path/to/TestmatteoRunner \\
+      --numbers 16 32 64 --results scaling.json --baseline scaling_baseline.json
+"""
+
+import argparse
+import itertools
+import json
+import os
+import platform
+import subprocess
+import sys
+import tempfile
+import time
+
+
+def run_once(runner, number, dt, sample, end_time, output, env):
+    """Run one simulation, returning its wall time in seconds and peak RSS in MB."""
+    command = [runner,
+               "--number", str(number),
+               "--dt", repr(dt),
+               "--sample", str(sample),
+               "--time", repr(end_time),
+               "--output", "true" if output else "false"]
+    with tempfile.TemporaryFile() as stderr_file:
+        start = time.perf_counter()
+        process = subprocess.Popen(command, env=env, stdout=subprocess.DEVNULL, stderr=stderr_file)
+
+        # Wait for this child alone, so that its resource usage is not mixed with earlier runs
+        _, status, usage = os.wait4(process.pid, 0)
+        wall_time = time.perf_counter() - start
+        process.returncode = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -os.WTERMSIG(status)
+        if process.returncode != 0:
+            stderr_file.seek(0)
+            raise RuntimeError("%s failed with status %d:\n%s" % (" ".join(command), process.returncode,
+                                                                   stderr_file.read().decode(errors="replace")))
+
+    # ru_maxrss is in kilobytes on Linux and bytes on macOS
+    scale = 1024.0 * 1024.0 if sys.platform == "darwin" else 1024.0
+    return wall_time, usage.ru_maxrss / scale
+
+
+def configuration_key(record):
+    return "%s n=%d dt=%g sample=%d output=%s" % (record["scenario"], record["number"], record["dt"],
+                                                  record["sample"], record["output"])
+
+
+def git_revision():
+    try:
+        return subprocess.check_output(["git", "rev-parse", "HEAD"], cwd=os.path.dirname(os.path.abspath(__file__)),
+                                       stderr=subprocess.DEVNULL).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--optogenetics", help="path to the TestOptogenetics runner")
+    parser.add_argument("--matteo", help="path to the Testmatteo runner")
+    parser.add_argument("--numbers", type=int, nargs="+", default=[16, 32, 64, 128, 256, 512],
+                        help="values of --number, the square root of the number of cells")
+    parser.add_argument("--dts", type=float, nargs="+", default=[0.005], help="time steps")
+    parser.add_argument("--samples", type=int, nargs="+", default=[200], help="sampling time step multiples")
+    parser.add_argument("--end-time", type=float, default=1.0, help="simulated time of each run")
+    parser.add_argument("--output-modes", nargs="+", choices=["off", "on"], default=["off", "on"],
+                        help="whether to run with results output switched off, on, or both")
+    parser.add_argument("--repeats", type=int, default=1, help="runs of each configuration; the fastest is kept")
+    parser.add_argument("--results", default="scaling_results.json", help="file to write the results to")
+    parser.add_argument("--baseline", help="results file from an earlier run to compare against")
+    parser.add_argument("--tolerance", type=float, default=0.1,
+                        help="fractional drop in cell time steps per second reported as a regression")
+    parser.add_argument("--test-output", help="CHASTE_TEST_OUTPUT for the runs (defaults to a temporary directory)")
+    args = parser.parse_args()
+
+    scenarios = [(name, runner) for name, runner in (("TestOptogenetics", args.optogenetics),
+                                                     ("Testmatteo", args.matteo)) if runner]
+    if not scenarios:
+        parser.error("give the path to at least one runner")
+
+    env = dict(os.environ)
+    temporary_directory = None
+    if args.test_output:
+        env["CHASTE_TEST_OUTPUT"] = args.test_output
+    else:
+        temporary_directory = tempfile.TemporaryDirectory(prefix="scaling_benchmark_")
+        env["CHASTE_TEST_OUTPUT"] = temporary_directory.name
+
+    records = []
+    print("%-60s %10s %12s %16s %10s" % ("configuration", "wall (s)", "steps/s", "cell steps/s", "RSS (MB)"))
+    for (scenario, runner), number, dt, sample, output_mode in itertools.product(
+            scenarios, args.numbers, args.dts, args.samples, args.output_modes):
+        output = (output_mode == "on")
+        runs = [run_once(runner, number, dt, sample, args.end_time, output, env) for _ in range(args.repeats)]
+        wall_time = min(run[0] for run in runs)
+        peak_rss = max(run[1] for run in runs)
+        num_steps = int(round(args.end_time / dt))
+        num_cells = number * number
+        record = {
+            "scenario": scenario,
+            "number": number,
+            "cells": num_cells,
+            "dt": dt,
+            "sample": sample,
+            "end_time": args.end_time,
+            "output": output,
+            "steps": num_steps,
+            "wall_time": wall_time,
+            "steps_per_second": num_steps / wall_time,
+            "cell_steps_per_second": num_cells * num_steps / wall_time,
+            "peak_rss_mb": peak_rss,
+        }
+        records.append(record)
+        print("%-60s %10.3f %12.1f %16.4g %10.1f" % (configuration_key(record), wall_time,
+                                                    record["steps_per_second"], record["cell_steps_per_second"],
+                                                    peak_rss))
+        sys.stdout.flush()
+
+    with open(args.results, "w") as results_file:
+        json.dump({"host": platform.node(),
+                   "date": time.strftime("%Y-%m-%dT%H:%M:%S"),
+                   "revision": git_revision(),
+                   "runs": records}, results_file, indent=2)
+
+    if temporary_directory is not None:
+        temporary_directory.cleanup()
+
+    if not args.baseline:
+        return 0
+
+    with open(args.baseline) as baseline_file:
+        baseline = dict((configuration_key(record), record) for record in json.load(baseline_file)["runs"])
+
+    num_regressions = 0
+    print("\nComparison with %s (tolerance %g%%)" % (args.baseline, 100 * args.tolerance))
+    for record in records:
+        key = configuration_key(record)
+        if key not in baseline:
+            print("%-60s not in baseline" % key)
+            continue
+        ratio = record["cell_steps_per_second"] / baseline[key]["cell_steps_per_second"]
+        regressed = ratio < 1.0 - args.tolerance
+        num_regressions += regressed
+        print("%-60s %8.3fx %s" % (key, ratio, "REGRESSION" if regressed else "ok"))
+
+    return 1 if num_regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
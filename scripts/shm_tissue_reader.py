@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+"""
+Read the tissue state published by a SharedMemoryExportModifier.
+
+The simulation prints the path of its segment when it starts, by default
+/dev/shm/chaste-tissue-<pid>. read_state() returns a consistent copy of the state,
+retrying while the simulation is writing, as the seqlock in the segment header
+requires; it never blocks the simulation. Run as a script, it prints a summary of
+each new state until the simulation finishes.
+
+The reader relies on the ordering of loads and stores on x86-64, where the seqlock
+needs no extra fences on the reading side.
+
+Example:
+
+  scripts/shm_tissue_reader.py /dev/shm/chaste-tissue-12345 --interval 0.5
+
+or, from Python:
+
+  from shm_tissue_reader import SharedTissue
+  state = SharedTissue("/dev/shm/chaste-tissue-12345").read_state()
+  print(state["time"], len(state["notch"]))
+"""
+
+import argparse
+import array
+import mmap
+import os
+import struct
+import sys
+import time
+
+HEADER = struct.Struct("<8sIIQQQdIIIIQQQQQQQ")
+HEADER_FIELDS = ("magic", "version", "dimension", "sequence", "segment_size", "num_updates", "time",
+                 "num_nodes", "num_elements", "num_element_nodes", "finished",
+                 "node_locations_offset", "element_offsets_offset", "element_nodes_offset",
+                 "cell_types_offset", "notch_offset", "delta_offset", "fitness_offset")
+SEQUENCE = struct.Struct("<Q")
+SEQUENCE_OFFSET = 16
+MAGIC = b"CHSTTISS"
+LAYOUT_VERSION = 1
+
+
+def _array(typecode, buffer, offset, count):
+    values = array.array(typecode)
+    values.frombytes(buffer[offset:offset + count*values.itemsize])
+    return values
+
+
+class SharedTissue:
+    """A read-only view of a segment written by SharedMemoryExportModifier."""
+
+    def __init__(self, path):
+        self.path = path
+        self.file = open(path, "rb")
+        self.map = None
+        self._remap()
+
+    def _remap(self):
+        if self.map is not None:
+            self.map.close()
+        size = os.fstat(self.file.fileno()).st_size
+        self.map = mmap.mmap(self.file.fileno(), size, prot=mmap.PROT_READ)
+
+    def close(self):
+        self.map.close()
+        self.file.close()
+
+    def read_sequence(self):
+        return SEQUENCE.unpack_from(self.map, SEQUENCE_OFFSET)[0]
+
+    def read_state(self, max_attempts=100000):
+        """Return a consistent copy of the state as a dict of header fields and arrays."""
+        for _ in range(max_attempts):
+            sequence = self.read_sequence()
+            if sequence % 2 == 1:
+                time.sleep(0)
+                continue
+            header = dict(zip(HEADER_FIELDS, HEADER.unpack_from(self.map, 0)))
+            if header["magic"] != MAGIC:
+                raise ValueError("%s is not a tissue segment" % self.path)
+            if header["version"] != LAYOUT_VERSION:
+                raise ValueError("unsupported layout version %d" % header["version"])
+            if header["segment_size"] > len(self.map):
+                self._remap()
+                continue
+
+            buffer = self.map
+            num_elements = header["num_elements"]
+            state = dict(header)
+            state["node_locations"] = _array("d", buffer, header["node_locations_offset"],
+                                             header["dimension"]*header["num_nodes"])
+            state["element_offsets"] = _array("I", buffer, header["element_offsets_offset"], num_elements + 1)
+            state["element_nodes"] = _array("I", buffer, header["element_nodes_offset"], header["num_element_nodes"])
+            state["cell_types"] = _array("i", buffer, header["cell_types_offset"], num_elements)
+            state["notch"] = _array("d", buffer, header["notch_offset"], num_elements)
+            state["delta"] = _array("d", buffer, header["delta_offset"], num_elements)
+            state["fitness"] = _array("d", buffer, header["fitness_offset"], num_elements)
+
+            # The copy is only valid if no write started while it was being taken
+            if self.read_sequence() == sequence:
+                return state
+        raise RuntimeError("could not read a consistent state from %s" % self.path)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("segment", help="path of the segment, e.g. /dev/shm/chaste-tissue-<pid>")
+    parser.add_argument("--interval", type=float, default=1.0, help="seconds between polls")
+    parser.add_argument("--once", action="store_true", help="print the current state and exit")
+    args = parser.parse_args()
+
+    tissue = SharedTissue(args.segment)
+    last_update = None
+    try:
+        while True:
+            state = tissue.read_state()
+            if state["num_updates"] != last_update:
+                last_update = state["num_updates"]
+                notch = [x for x in state["notch"] if x == x]
+                mean_notch = sum(notch)/len(notch) if notch else float("nan")
+                print("time=%g nodes=%d cells=%d mean_notch=%g%s" %
+                      (state["time"], state["num_nodes"], state["num_elements"], mean_notch,
+                       " finished" if state["finished"] else ""), flush=True)
+            if args.once or state["finished"]:
+                return 0
+            time.sleep(args.interval)
+    except KeyboardInterrupt:
+        return 0
+    finally:
+        tissue.close()
+
+
+if __name__ == "__main__":
+    sys.exit(main())
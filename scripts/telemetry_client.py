@@ -0,0 +1,85 @@
+#!/usr/bin/env python3
+"""
+Follow the telemetry of a running simulation with a TelemetryModifier.
+
+Binds the Unix datagram socket the simulation publishes to (by default telemetry.sock
+in the simulation output directory; the path is printed when the simulation starts),
+and prints each message as it arrives, either as received or as JSON. If no message
+arrives for --stall seconds, a warning is printed to stderr, and with --exit-on-stall
+the client exits with status 2, so that a wrapper script can kill or requeue the run.
+The client exits with status 0 when the simulation reports that it has finished.
+
+Start the client before the simulation, or at any point during it; messages sent while
+no client is listening are dropped by the simulation without waiting.
+
+Example:
+
+  scripts/telemetry_client.py $CHASTE_TEST_OUTPUT/Optogenetics-l0.12-m0.12-x0-z0.05/telemetry.sock --stall 60
+"""
+
+import argparse
+import json
+import os
+import socket
+import sys
+
+
+def parse_message(text):
+    """Parse a line of key=value pairs, converting numeric values."""
+    fields = {}
+    for pair in text.split():
+        key, _, value = pair.partition("=")
+        try:
+            fields[key] = int(value)
+        except ValueError:
+            try:
+                fields[key] = float(value)
+            except ValueError:
+                fields[key] = value
+    return fields
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("socket", help="path of the socket the simulation publishes to")
+    parser.add_argument("--json", action="store_true", help="print each message as a JSON object")
+    parser.add_argument("--stall", type=float, default=0.0,
+                        help="warn if no message arrives for this many seconds (0 to never warn)")
+    parser.add_argument("--exit-on-stall", action="store_true", help="exit with status 2 on a stall")
+    args = parser.parse_args()
+
+    # A socket file left behind by an earlier client would stop us binding
+    if os.path.exists(args.socket):
+        os.unlink(args.socket)
+    sock = socket.socket(socket.AF_UNIX, socket.SOCK_DGRAM)
+    sock.bind(args.socket)
+    if args.stall > 0.0:
+        sock.settimeout(args.stall)
+
+    try:
+        while True:
+            try:
+                data = sock.recv(65536)
+            except socket.timeout:
+                print("no telemetry for %g s" % args.stall, file=sys.stderr, flush=True)
+                if args.exit_on_stall:
+                    return 2
+                continue
+
+            text = data.decode("utf-8", "replace").strip()
+            fields = parse_message(text)
+            if args.json:
+                print(json.dumps(fields), flush=True)
+            else:
+                print(text, flush=True)
+            if fields.get("status") == "finished":
+                return 0
+    except KeyboardInterrupt:
+        return 0
+    finally:
+        sock.close()
+        os.unlink(args.socket)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
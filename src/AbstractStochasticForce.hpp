@@ -0,0 +1,37 @@
+
+#ifndef ABSTRACTSTOCHASTICFORCE_HPP_
+#define ABSTRACTSTOCHASTICFORCE_HPP_
+
+/**
+ * Interface of a force which adds random motion to the nodes.
+ *
+ * A numerical method which draws the noise itself, such as
+ * AdaptiveForwardEulerNumericalMethod, switches the force's own noise off
+ * through this interface and scales its draws by the force's movement parameter.
+ * It has no state, so is not archived.
+ */
+class AbstractStochasticForce
+{
+public:
+
+    /**
+     * Destructor.
+     */
+    virtual ~AbstractStochasticForce()
+    {
+    }
+
+    /**
+     * @return the diffusion coefficient of the random motion, or zero for none
+     */
+    virtual double GetMovementParameter()=0;
+
+    /**
+     * Set whether the force adds its random motion.
+     *
+     * @param applyNoise whether to add the random motion
+     */
+    virtual void SetApplyNoise(bool applyNoise)=0;
+};
+
+#endif /*ABSTRACTSTOCHASTICFORCE_HPP_*/
@@ -0,0 +1,380 @@
+
+#include "AdaptiveForwardEulerNumericalMethod.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "AbstractStochasticForce.hpp"
+#include "ProfiledForce.hpp"
+#include "RandomNumberGenerator.hpp"
+
+#include <cfloat>
+#include <climits>
+#include <map>
+#include <utility>
+
+/** The later parts of rejected sub-steps, last first: the length of each and its Wiener increments, DIM per node. */
+typedef std::vector<std::pair<double, std::vector<double> > > LaterParts;
+
+/**
+ * Record the location of every node of a mesh.
+ *
+ * @param rMesh the mesh
+ * @param rLocations the locations, indexed by node
+ */
+template<unsigned DIM>
+static void RecordNodeLocations(AbstractMesh<DIM, DIM>& rMesh, std::vector<c_vector<double, DIM> >& rLocations)
+{
+    rLocations.resize(rMesh.GetNumNodes());
+    for (typename AbstractMesh<DIM, DIM>::NodeIterator node_iter = rMesh.GetNodeIteratorBegin();
+         node_iter != rMesh.GetNodeIteratorEnd();
+         ++node_iter)
+    {
+        rLocations[node_iter->GetIndex()] = node_iter->rGetLocation();
+    }
+}
+
+/**
+ * Carry the Wiener increments still to be used over a rearrangement check, which may renumber,
+ * remove or add nodes. Nodes new to the mesh get fresh increments.
+ *
+ * @param rMesh the mesh after the check
+ * @param rOldNodes the nodes of the mesh before the check, by their old indices
+ * @param rLaterParts the later parts of rejected sub-steps
+ */
+template<unsigned DIM>
+static void CarryIncrementsOverCheck(AbstractMesh<DIM, DIM>& rMesh,
+                                     const std::vector<Node<DIM>*>& rOldNodes,
+                                     LaterParts& rLaterParts)
+{
+    std::map<Node<DIM>*, unsigned> new_indices;
+    for (typename AbstractMesh<DIM, DIM>::NodeIterator node_iter = rMesh.GetNodeIteratorBegin();
+         node_iter != rMesh.GetNodeIteratorEnd();
+         ++node_iter)
+    {
+        new_indices[&(*node_iter)] = node_iter->GetIndex();
+    }
+
+    unsigned num_nodes = rMesh.GetNumNodes();
+    RandomNumberGenerator* p_gen = RandomNumberGenerator::Instance();
+    for (unsigned part=0; part<rLaterParts.size(); part++)
+    {
+        std::vector<double>& r_increments = rLaterParts[part].second;
+        std::vector<double> carried(DIM*num_nodes, DBL_MAX);
+        for (unsigned old_index=0; old_index<rOldNodes.size(); old_index++)
+        {
+            typename std::map<Node<DIM>*, unsigned>::iterator iter = new_indices.find(rOldNodes[old_index]);
+            if (iter != new_indices.end())
+            {
+                std::copy(r_increments.begin() + DIM*old_index, r_increments.begin() + DIM*(old_index + 1), carried.begin() + DIM*iter->second);
+            }
+        }
+        double standard_deviation = sqrt(rLaterParts[part].first);
+        for (unsigned j=0; j<carried.size(); j++)
+        {
+            if (carried[j] == DBL_MAX)
+            {
+                carried[j] = standard_deviation*p_gen->StandardNormalRandomDeviate();
+            }
+        }
+        r_increments.swap(carried);
+    }
+}
+
+template<unsigned DIM>
+AdaptiveForwardEulerNumericalMethod<DIM>::AdaptiveForwardEulerNumericalMethod()
+    : AbstractNumericalMethod<DIM, DIM>(),
+      mMaxDisplacementFraction(0.25),
+      mSubstepGrowthFactor(1.2),
+      mLimitNoise(false),
+      mSubstep(0.0),
+      mNumSubsteps(0),
+      mNumRejectedSubsteps(0),
+      mNumRearrangementChecks(0)
+{
+}
+
+template<unsigned DIM>
+AdaptiveForwardEulerNumericalMethod<DIM>::~AdaptiveForwardEulerNumericalMethod()
+{
+}
+
+template<unsigned DIM>
+double AdaptiveForwardEulerNumericalMethod<DIM>::GetMaxDisplacement()
+{
+    VertexBasedCellPopulation<DIM>* p_cell_population = dynamic_cast<VertexBasedCellPopulation<DIM>*>(this->mpCellPopulation);
+    if (p_cell_population != NULL)
+    {
+        return mMaxDisplacementFraction*p_cell_population->rGetMesh().GetCellRearrangementThreshold();
+    }
+    return mMaxDisplacementFraction*this->mpCellPopulation->GetAbsoluteMovementThreshold();
+}
+
+template<unsigned DIM>
+double AdaptiveForwardEulerNumericalMethod<DIM>::SetForcesApplyNoise(bool applyNoise)
+{
+    double movement_parameter = 0.0;
+    for (typename std::vector<boost::shared_ptr<AbstractForce<DIM, DIM> > >::iterator iter = this->mpForceCollection->begin();
+         iter != this->mpForceCollection->end();
+         ++iter)
+    {
+        boost::shared_ptr<AbstractStochasticForce> p_force = boost::dynamic_pointer_cast<AbstractStochasticForce>(ProfiledForce<DIM>::Unwrap(*iter));
+        if (p_force)
+        {
+            p_force->SetApplyNoise(applyNoise);
+            movement_parameter += p_force->GetMovementParameter();
+        }
+    }
+    return movement_parameter;
+}
+
+template<unsigned DIM>
+void AdaptiveForwardEulerNumericalMethod<DIM>::UpdateAllNodePositions(double dt)
+{
+    // The noise is drawn here, so that a rejected sub-step keeps its draw
+    double movement_parameter = SetForcesApplyNoise(false);
+    try
+    {
+        TakeSubsteps(dt, movement_parameter);
+    }
+    catch (const Exception&)
+    {
+        SetForcesApplyNoise(true);
+        throw;
+    }
+    SetForcesApplyNoise(true);
+}
+
+template<unsigned DIM>
+void AdaptiveForwardEulerNumericalMethod<DIM>::TakeSubsteps(double dt, double movementParameter)
+{
+    AbstractMesh<DIM, DIM>& r_mesh = this->mpCellPopulation->rGetMesh();
+    RandomNumberGenerator* p_gen = RandomNumberGenerator::Instance();
+    double max_displacement = GetMaxDisplacement();
+
+    // An edge can only collapse between rearrangement checks once its ends have closed in by the threshold
+    VertexBasedCellPopulation<DIM>* p_vertex_population = dynamic_cast<VertexBasedCellPopulation<DIM>*>(this->mpCellPopulation);
+    double check_distance = DBL_MAX;
+    std::vector<c_vector<double, DIM> > checked_locations;
+    if (p_vertex_population != NULL)
+    {
+        check_distance = 0.5*p_vertex_population->rGetMesh().GetCellRearrangementThreshold();
+        RecordNodeLocations(r_mesh, checked_locations);
+    }
+
+    std::vector<c_vector<double, DIM> > forces;
+    std::vector<double> noise_scalings;
+    bool forces_up_to_date = false;
+    std::vector<double> increments;
+    LaterParts later_parts;
+
+    double time_remaining = dt;
+    double substep = (mSubstep > 0.0) ? mSubstep : dt;
+    while (time_remaining > DBL_EPSILON*dt)
+    {
+        if (!forces_up_to_date)
+        {
+            forces = this->ComputeForcesIncludingDamping();
+            noise_scalings.resize(forces.size());
+            for (typename AbstractMesh<DIM, DIM>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+                 node_iter != r_mesh.GetNodeIteratorEnd();
+                 ++node_iter)
+            {
+                unsigned node_index = node_iter->GetIndex();
+                noise_scalings[node_index] = sqrt(2.0*movementParameter)/this->mpCellPopulation->GetDampingConstant(node_index);
+            }
+            forces_up_to_date = true;
+        }
+
+        // Either start a new sub-step, drawing its Wiener increments, or take the next part of a rejected one
+        bool new_substep = later_parts.empty();
+        double this_substep;
+        if (new_substep)
+        {
+            // Do not overshoot the end of the time step, and treat a tiny remainder as part of this sub-step
+            this_substep = (substep >= 0.999*time_remaining) ? time_remaining : substep;
+            increments.assign(DIM*forces.size(), 0.0);
+            if (movementParameter > 0.0)
+            {
+                double standard_deviation = sqrt(this_substep);
+                for (unsigned j=0; j<increments.size(); j++)
+                {
+                    increments[j] = standard_deviation*p_gen->StandardNormalRandomDeviate();
+                }
+            }
+        }
+        else
+        {
+            this_substep = later_parts.back().first;
+            increments.swap(later_parts.back().second);
+            later_parts.pop_back();
+        }
+
+        // Unless mLimitNoise is set only the drift counts towards the limit, as the noise over a sub-step is that of plain forward Euler
+        std::vector<c_vector<double, DIM> > displacements(forces.size());
+        double largest_step = 0.0;
+        for (unsigned node_index=0; node_index<forces.size(); node_index++)
+        {
+            displacements[node_index] = this_substep*forces[node_index];
+            if (!mLimitNoise)
+            {
+                largest_step = std::max(largest_step, norm_2(displacements[node_index]));
+            }
+            for (unsigned i=0; i<DIM; i++)
+            {
+                displacements[node_index][i] += noise_scalings[node_index]*increments[DIM*node_index + i];
+            }
+            if (mLimitNoise)
+            {
+                largest_step = std::max(largest_step, norm_2(displacements[node_index]));
+            }
+        }
+
+        if (largest_step > max_displacement)
+        {
+            // Split the sub-step, aiming a little short since any noise shrinks more slowly than the sub-step
+            double fraction = 0.8*max_displacement/largest_step;
+            double first_part = fraction*this_substep;
+            mNumRejectedSubsteps++;
+            if (first_part < DBL_EPSILON*dt)
+            {
+                EXCEPTION("Adaptive sub-step has become vanishingly small; the node velocities are too large");
+            }
+
+            // Keep the draw, sampling the Wiener process at the split from the Brownian bridge across the sub-step
+            std::vector<double> later_increments(increments.size(), 0.0);
+            if (movementParameter > 0.0)
+            {
+                double bridge_standard_deviation = sqrt(fraction*(1.0 - fraction)*this_substep);
+                for (unsigned j=0; j<increments.size(); j++)
+                {
+                    double first_increment = fraction*increments[j] + bridge_standard_deviation*p_gen->StandardNormalRandomDeviate();
+                    later_increments[j] = increments[j] - first_increment;
+                    increments[j] = first_increment;
+                }
+            }
+            later_parts.push_back(std::make_pair(this_substep - first_part, later_increments));
+            later_parts.push_back(std::make_pair(first_part, increments));
+
+            if (new_substep)
+            {
+                substep = first_part;
+            }
+            continue;
+        }
+
+        for (typename AbstractMesh<DIM, DIM>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+             node_iter != r_mesh.GetNodeIteratorEnd();
+             ++node_iter)
+        {
+            unsigned node_index = node_iter->GetIndex();
+            this->DetectStepSizeExceptions(node_index, displacements[node_index], this_substep);
+
+            c_vector<double, DIM> new_node_location = node_iter->rGetLocation() + displacements[node_index];
+            this->SafeNodePositionUpdate(node_index, new_node_location);
+        }
+        forces_up_to_date = false;
+
+        time_remaining -= this_substep;
+        mNumSubsteps++;
+
+        if (new_substep && largest_step < 0.5*max_displacement && this_substep == substep)
+        {
+            substep *= mSubstepGrowthFactor;
+        }
+
+        // Check for rearrangements before any node could take an edge through the threshold unseen
+        if (p_vertex_population != NULL && time_remaining > DBL_EPSILON*dt)
+        {
+            double largest_travel = 0.0;
+            for (typename AbstractMesh<DIM, DIM>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+                 node_iter != r_mesh.GetNodeIteratorEnd();
+                 ++node_iter)
+            {
+                c_vector<double, DIM> travel = r_mesh.GetVectorFromAtoB(checked_locations[node_iter->GetIndex()], node_iter->rGetLocation());
+                largest_travel = std::max(largest_travel, norm_2(travel));
+            }
+
+            /*
+             * This is the check OffLatticeSimulation runs at the start of each time step,
+             * brought forward; it only carries out T1 and T3 swaps and remaps the cells
+             * to their elements. Births, deaths and T2 swaps stay with the simulation, and
+             * modifiers and writers only see the population at the ends of time steps,
+             * so they cannot tell the checks within a step apart from those between steps.
+             * Leaving it to the simulation would mean the time step itself had to shrink.
+             */
+            if (largest_travel + max_displacement > check_distance)
+            {
+                std::vector<Node<DIM>*> old_nodes(r_mesh.GetNumNodes());
+                for (typename AbstractMesh<DIM, DIM>::NodeIterator node_iter = r_mesh.GetNodeIteratorBegin();
+                     node_iter != r_mesh.GetNodeIteratorEnd();
+                     ++node_iter)
+                {
+                    old_nodes[node_iter->GetIndex()] = &(*node_iter);
+                }
+
+                p_vertex_population->Update();
+                mNumRearrangementChecks++;
+                RecordNodeLocations(r_mesh, checked_locations);
+                CarryIncrementsOverCheck(r_mesh, old_nodes, later_parts);
+            }
+        }
+    }
+
+    mSubstep = substep;
+}
+
+template<unsigned DIM>
+unsigned AdaptiveForwardEulerNumericalMethod<DIM>::GetNumSubsteps()
+{
+    return mNumSubsteps;
+}
+
+template<unsigned DIM>
+unsigned AdaptiveForwardEulerNumericalMethod<DIM>::GetNumRejectedSubsteps()
+{
+    return mNumRejectedSubsteps;
+}
+
+template<unsigned DIM>
+unsigned AdaptiveForwardEulerNumericalMethod<DIM>::GetNumRearrangementChecks()
+{
+    return mNumRearrangementChecks;
+}
+
+template<unsigned DIM>
+void AdaptiveForwardEulerNumericalMethod<DIM>::SetMaxDisplacementFraction(double maxDisplacementFraction)
+{
+    assert(maxDisplacementFraction > 0.0);
+    mMaxDisplacementFraction = maxDisplacementFraction;
+}
+
+template<unsigned DIM>
+void AdaptiveForwardEulerNumericalMethod<DIM>::SetSubstepGrowthFactor(double substepGrowthFactor)
+{
+    assert(substepGrowthFactor >= 1.0);
+    mSubstepGrowthFactor = substepGrowthFactor;
+}
+
+template<unsigned DIM>
+void AdaptiveForwardEulerNumericalMethod<DIM>::SetLimitNoise(bool limitNoise)
+{
+    mLimitNoise = limitNoise;
+}
+
+template<unsigned DIM>
+void AdaptiveForwardEulerNumericalMethod<DIM>::OutputNumericalMethodParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<MaxDisplacementFraction>" << mMaxDisplacementFraction << "</MaxDisplacementFraction>\n";
+    *rParamsFile << "\t\t\t<SubstepGrowthFactor>" << mSubstepGrowthFactor << "</SubstepGrowthFactor>\n";
+    *rParamsFile << "\t\t\t<LimitNoise>" << mLimitNoise << "</LimitNoise>\n";
+
+    // Call method on direct parent class
+    AbstractNumericalMethod<DIM, DIM>::OutputNumericalMethodParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class AdaptiveForwardEulerNumericalMethod<1>;
+template class AdaptiveForwardEulerNumericalMethod<2>;
+template class AdaptiveForwardEulerNumericalMethod<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(AdaptiveForwardEulerNumericalMethod)
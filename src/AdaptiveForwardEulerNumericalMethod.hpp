@@ -0,0 +1,174 @@
+
+#ifndef ADAPTIVEFORWARDEULERNUMERICALMETHOD_HPP_
+#define ADAPTIVEFORWARDEULERNUMERICALMETHOD_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include "AbstractNumericalMethod.hpp"
+
+/**
+ * A forward Euler numerical method which covers each simulation time step with as
+ * many sub-steps as the motion of the nodes requires.
+ *
+ * The length of each sub-step is chosen so that no node drifts further than
+ * mMaxDisplacementFraction times the cell rearrangement threshold of the mesh (or
+ * the absolute movement threshold of the population, for non-vertex populations).
+ * A sub-step which would move a node too far is rejected and split; after a sub-step
+ * in which every node moved less than half the limit, the next one is lengthened by
+ * mSubstepGrowthFactor. The sub-step length carries over between simulation time
+ * steps, so in quiet phases each time step is a single forward Euler step.
+ *
+ * The random motion of any AbstractStochasticForce in the force collection is
+ * switched off in the force and drawn by the method instead, as a Wiener increment
+ * for each node over each sub-step, scaled by sqrt(2 D) over the node's damping
+ * constant. By default only the drift counts towards the limit: the noise over a
+ * sub-step is no larger than over the same interval of plain forward Euler, and
+ * limiting it would force sub-steps of order the limit squared over 2 D whatever
+ * the forces. With SetLimitNoise(true) the noise counts too. When a sub-step is
+ * rejected its increment is kept, and split between the two parts by sampling the
+ * Brownian bridge at the split, so that rejections do not favour small draws and
+ * the noise keeps its variance.
+ *
+ * In a vertex-based population, the method also runs the population's rearrangement
+ * check (VertexBasedCellPopulation::Update()) within a simulation time step once any
+ * node could otherwise move half the rearrangement threshold from where it was at the
+ * last check, so that the drift cannot collapse or invert an edge between checks
+ * however coarse the simulation time step (nor can the noise, with
+ * SetLimitNoise(true)). T2 swaps are still only found once per simulation time
+ * step, by T2SwapCellKiller. The simulation time step can therefore be chosen to suit
+ * the output grid, SRN models and modifiers, and the mechanics adapt beneath it.
+ */
+template<unsigned DIM>
+class AdaptiveForwardEulerNumericalMethod : public AbstractNumericalMethod<DIM, DIM>
+{
+private:
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractNumericalMethod<DIM, DIM> >(*this);
+        archive & mMaxDisplacementFraction;
+        archive & mSubstepGrowthFactor;
+        archive & mLimitNoise;
+        archive & mSubstep;
+    }
+
+    /** Largest node displacement in a sub-step, as a fraction of the rearrangement threshold. Defaults to 0.25. */
+    double mMaxDisplacementFraction;
+
+    /** Factor by which the sub-step is lengthened after a sub-step with little motion. Defaults to 1.2. */
+    double mSubstepGrowthFactor;
+
+    /** Whether the noise, as well as the drift, counts towards the sub-step limit. Defaults to false. */
+    bool mLimitNoise;
+
+    /** Length of the next sub-step, or zero if none has been taken yet. */
+    double mSubstep;
+
+    /** Total number of sub-steps accepted. */
+    unsigned mNumSubsteps;
+
+    /** Total number of sub-steps rejected. */
+    unsigned mNumRejectedSubsteps;
+
+    /** Total number of rearrangement checks run within simulation time steps. */
+    unsigned mNumRearrangementChecks;
+
+    /**
+     * @return the largest distance any node may move in a sub-step
+     */
+    double GetMaxDisplacement();
+
+    /**
+     * Switch the noise of every AbstractStochasticForce in the force collection on or off.
+     *
+     * @param applyNoise whether the forces add their noise
+     * @return the total movement parameter of those forces
+     */
+    double SetForcesApplyNoise(bool applyNoise);
+
+    /**
+     * Cover a simulation time step with sub-steps; UpdateAllNodePositions() switches the noise of the forces off around it.
+     *
+     * @param dt the simulation time step to cover
+     * @param movementParameter the total movement parameter of the forces' noise
+     */
+    void TakeSubsteps(double dt, double movementParameter);
+
+public:
+
+    /**
+     * Constructor.
+     */
+    AdaptiveForwardEulerNumericalMethod();
+
+    /**
+     * Destructor.
+     */
+    virtual ~AdaptiveForwardEulerNumericalMethod();
+
+    /**
+     * Overridden UpdateAllNodePositions() method.
+     *
+     * @param dt the simulation time step to cover
+     */
+    virtual void UpdateAllNodePositions(double dt);
+
+    /**
+     * @return the total number of sub-steps accepted
+     */
+    unsigned GetNumSubsteps();
+
+    /**
+     * @return the total number of sub-steps rejected
+     */
+    unsigned GetNumRejectedSubsteps();
+
+    /**
+     * @return the total number of rearrangement checks run within simulation time steps
+     */
+    unsigned GetNumRearrangementChecks();
+
+    /**
+     * Set mMaxDisplacementFraction.
+     *
+     * @param maxDisplacementFraction largest node displacement in a sub-step, as a fraction of the rearrangement threshold
+     */
+    void SetMaxDisplacementFraction(double maxDisplacementFraction);
+
+    /**
+     * Set mSubstepGrowthFactor.
+     *
+     * @param substepGrowthFactor factor by which the sub-step is lengthened after a sub-step with little motion
+     */
+    void SetSubstepGrowthFactor(double substepGrowthFactor);
+
+    /**
+     * Set mLimitNoise.
+     *
+     * @param limitNoise whether the noise, as well as the drift, counts towards the sub-step limit
+     */
+    void SetLimitNoise(bool limitNoise);
+
+    /**
+     * Overridden OutputNumericalMethodParameters() method.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    virtual void OutputNumericalMethodParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(AdaptiveForwardEulerNumericalMethod)
+
+#endif /*ADAPTIVEFORWARDEULERNUMERICALMETHOD_HPP_*/
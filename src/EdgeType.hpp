@@ -0,0 +1,122 @@
+
+#ifndef EDGETYPE_HPP_
+#define EDGETYPE_HPP_
+
+#include <algorithm>
+#include <climits>
+#include <iterator>
+#include <set>
+
+#include "VertexBasedCellPopulation.hpp"
+#include "PopulationConstants.hpp"
+
+/**
+ * Classification of the edges of a vertex mesh by the proliferative types of
+ * the cells either side of them. This is the classification used by
+ * MatteoForce to choose the line tension of an edge, so anything counting or
+ * measuring edges by type should go through GetEdgeType() to stay consistent.
+ */
+enum EdgeType
+{
+    WILD_WILD_EDGE = 0,
+    DIFF_DIFF_EDGE,
+    MIXED_EDGE,
+    WILD_BOUNDARY_EDGE,
+    DIFF_BOUNDARY_EDGE,
+    NUM_EDGE_TYPES
+};
+
+/**
+ * @param pCell a cell
+ * @return whether the cell has the wild type proliferative type
+ */
+inline bool IsWildType(CellPtr pCell)
+{
+    return pCell->GetCellProliferativeType() == p_wild_type;
+}
+
+/**
+ * Classify the edge between two neighbouring nodes of a vertex mesh.
+ *
+ * @param elemIndex the index of an element containing the edge
+ * @param pNodeA one node
+ * @param pNodeB the other node
+ * @param rVertexCellPopulation reference to the cell population
+ * @param pOtherElementIndex if not NULL, set to the index of the element on the
+ *     other side of the edge, or to UINT_MAX for a boundary edge
+ *
+ * @return the type of the edge
+ */
+template<unsigned DIM>
+EdgeType GetEdgeType(unsigned elemIndex,
+                     Node<DIM>* pNodeA,
+                     Node<DIM>* pNodeB,
+                     VertexBasedCellPopulation<DIM>& rVertexCellPopulation,
+                     unsigned* pOtherElementIndex=NULL)
+{
+    const std::set<unsigned>& r_elements_containing_nodeA = pNodeA->rGetContainingElementIndices();
+    const std::set<unsigned>& r_elements_containing_nodeB = pNodeB->rGetContainingElementIndices();
+
+    // Find common elements
+    std::set<unsigned> shared_elements;
+    std::set_intersection(r_elements_containing_nodeA.begin(),
+                          r_elements_containing_nodeA.end(),
+                          r_elements_containing_nodeB.begin(),
+                          r_elements_containing_nodeB.end(),
+                          std::inserter(shared_elements, shared_elements.begin()));
+
+    // Check that the nodes have a common edge
+    assert(!shared_elements.empty());
+    assert(shared_elements.size() <= 2);
+
+    std::set<unsigned>::iterator iter = shared_elements.begin();
+    bool first_is_wild = IsWildType(rVertexCellPopulation.GetCellUsingLocationIndex(*iter));
+
+    if (shared_elements.size() == 1)
+    {
+        if (pOtherElementIndex != NULL)
+        {
+            *pOtherElementIndex = UINT_MAX;
+        }
+        return first_is_wild ? WILD_BOUNDARY_EDGE : DIFF_BOUNDARY_EDGE;
+    }
+
+    unsigned first_index = *iter;
+    ++iter;
+    bool second_is_wild = IsWildType(rVertexCellPopulation.GetCellUsingLocationIndex(*iter));
+    if (pOtherElementIndex != NULL)
+    {
+        *pOtherElementIndex = (first_index == elemIndex) ? *iter : first_index;
+    }
+
+    if (first_is_wild && second_is_wild)
+    {
+        return WILD_WILD_EDGE;
+    }
+    else if (!first_is_wild && !second_is_wild)
+    {
+        return DIFF_DIFF_EDGE;
+    }
+    return MIXED_EDGE;
+}
+
+/**
+ * @param edgeType the type of an edge
+ * @return the (full) line tension of an edge of this type
+ */
+inline double GetLineTensionOfEdgeType(EdgeType edgeType)
+{
+    switch (edgeType)
+    {
+        case WILD_WILD_EDGE:
+        case WILD_BOUNDARY_EDGE:
+            return wild_type_lambda;
+        case DIFF_DIFF_EDGE:
+        case DIFF_BOUNDARY_EDGE:
+            return diff_type_lambda;
+        default:
+            return mixed_type_lambda;
+    }
+}
+
+#endif /*EDGETYPE_HPP_*/
@@ -0,0 +1,248 @@
+
+#include "FireEnergyMinimiser.hpp"
+#include "T2SwapCellKiller.hpp"
+
+/** FIRE parameters, as recommended by Bitzek et al. */
+static const unsigned FIRE_MIN_POSITIVE_STEPS = 5;
+static const double FIRE_TIME_STEP_INCREASE = 1.1;
+static const double FIRE_TIME_STEP_DECREASE = 0.5;
+static const double FIRE_INITIAL_MIXING = 0.1;
+static const double FIRE_MIXING_DECREASE = 0.99;
+
+template<unsigned DIM>
+FireEnergyMinimiser<DIM>::FireEnergyMinimiser(VertexBasedCellPopulation<DIM>& rCellPopulation,
+                                              boost::shared_ptr<MatteoForce<DIM> > pForce)
+    : mrCellPopulation(rCellPopulation),
+      mpForce(pForce),
+      mForceTolerance(1e-6),
+      mMaxStepLength(0.01),
+      mInitialTimeStep(0.01),
+      mMaxTimeStep(0.1),
+      mMaxIterationsPerRound(1000),
+      mMaxRounds(20),
+      mNumForceEvaluations(0),
+      mNumRounds(0),
+      mMaxForce(0.0)
+{
+}
+
+template<unsigned DIM>
+double FireEnergyMinimiser<DIM>::ComputeForces(std::vector<double>& rForces)
+{
+    unsigned num_nodes = mrCellPopulation.GetNumNodes();
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        mrCellPopulation.GetNode(node_index)->ClearAppliedForce();
+    }
+    mpForce->AddForceContribution(mrCellPopulation);
+    mNumForceEvaluations++;
+
+    rForces.resize(DIM*num_nodes);
+    double max_squared_force = 0.0;
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        const c_vector<double, DIM>& r_force = mrCellPopulation.GetNode(node_index)->rGetAppliedForce();
+        for (unsigned i=0; i<DIM; i++)
+        {
+            rForces[DIM*node_index + i] = r_force[i];
+        }
+        max_squared_force = std::max(max_squared_force, inner_prod(r_force, r_force));
+    }
+    return sqrt(max_squared_force);
+}
+
+template<unsigned DIM>
+bool FireEnergyMinimiser<DIM>::MinimiseAtFixedTopology()
+{
+    std::vector<double> forces;
+    std::vector<double> velocities(DIM*mrCellPopulation.GetNumNodes(), 0.0);
+    double time_step = mInitialTimeStep;
+    double mixing = FIRE_INITIAL_MIXING;
+    unsigned num_positive_steps = 0;
+
+    for (unsigned iteration=0; iteration<mMaxIterationsPerRound; iteration++)
+    {
+        mMaxForce = ComputeForces(forces);
+        if (mMaxForce < mForceTolerance)
+        {
+            return true;
+        }
+
+        double power = 0.0;
+        double squared_force_norm = 0.0;
+        double squared_velocity_norm = 0.0;
+        for (unsigned i=0; i<forces.size(); i++)
+        {
+            power += forces[i]*velocities[i];
+            squared_force_norm += forces[i]*forces[i];
+            squared_velocity_norm += velocities[i]*velocities[i];
+        }
+
+        // Starting from rest P is zero, which is not a step uphill, so the first iteration only lets the forces accelerate the nodes
+        if (iteration > 0 && power > 0.0)
+        {
+            // Steer the velocity towards the force, and speed up once going downhill steadily
+            double scale = mixing*sqrt(squared_velocity_norm/squared_force_norm);
+            for (unsigned i=0; i<velocities.size(); i++)
+            {
+                velocities[i] = (1.0 - mixing)*velocities[i] + scale*forces[i];
+            }
+            if (++num_positive_steps > FIRE_MIN_POSITIVE_STEPS)
+            {
+                time_step = std::min(time_step*FIRE_TIME_STEP_INCREASE, mMaxTimeStep);
+                mixing *= FIRE_MIXING_DECREASE;
+            }
+        }
+        else if (iteration > 0)
+        {
+            // Gone uphill, so stop and restart cautiously
+            std::fill(velocities.begin(), velocities.end(), 0.0);
+            time_step *= FIRE_TIME_STEP_DECREASE;
+            mixing = FIRE_INITIAL_MIXING;
+            num_positive_steps = 0;
+        }
+
+        // Semi-implicit Euler step with unit masses, limited so that no node moves too far
+        double max_squared_step = 0.0;
+        for (unsigned node_index=0; node_index<velocities.size()/DIM; node_index++)
+        {
+            double squared_step = 0.0;
+            for (unsigned i=0; i<DIM; i++)
+            {
+                velocities[DIM*node_index + i] += time_step*forces[DIM*node_index + i];
+                squared_step += time_step*time_step*velocities[DIM*node_index + i]*velocities[DIM*node_index + i];
+            }
+            max_squared_step = std::max(max_squared_step, squared_step);
+        }
+        double step_scale = (max_squared_step > mMaxStepLength*mMaxStepLength) ? mMaxStepLength/sqrt(max_squared_step) : 1.0;
+
+        // Move the nodes through the population, so that the mesh knows its geometry has changed
+        for (unsigned node_index=0; node_index<velocities.size()/DIM; node_index++)
+        {
+            c_vector<double, DIM> location = mrCellPopulation.GetNode(node_index)->rGetLocation();
+            for (unsigned i=0; i<DIM; i++)
+            {
+                location[i] += step_scale*time_step*velocities[DIM*node_index + i];
+            }
+            ChastePoint<DIM> new_location(location);
+            mrCellPopulation.SetNode(node_index, new_location);
+        }
+    }
+
+    mMaxForce = ComputeForces(forces);
+    return mMaxForce < mForceTolerance;
+}
+
+template<unsigned DIM>
+bool FireEnergyMinimiser<DIM>::Minimise()
+{
+    mNumForceEvaluations = 0;
+
+    // The descent must be deterministic, so switch off the force's random motion until it is done
+    double movement_parameter = mpForce->GetMovementParameter();
+    mpForce->SetMovementParameter(0.0);
+    bool converged = false;
+    try
+    {
+        converged = MinimiseInRounds();
+    }
+    catch (const Exception&)
+    {
+        mpForce->SetMovementParameter(movement_parameter);
+        throw;
+    }
+    mpForce->SetMovementParameter(movement_parameter);
+    return converged;
+}
+
+template<unsigned DIM>
+bool FireEnergyMinimiser<DIM>::MinimiseInRounds()
+{
+    T2SwapCellKiller<DIM> t2_swap_killer(&mrCellPopulation);
+    for (mNumRounds=1; mNumRounds<=mMaxRounds; mNumRounds++)
+    {
+        bool converged = MinimiseAtFixedTopology();
+
+        // Carry out any rearrangements the relaxation has brought about, T2 swaps included
+        unsigned num_nodes = mrCellPopulation.GetNumNodes();
+        unsigned num_elements = mrCellPopulation.GetNumElements();
+        t2_swap_killer.CheckAndLabelCellsForApoptosisOrDeath();
+        mrCellPopulation.RemoveDeadCells();
+        mrCellPopulation.Update();
+
+        if (converged
+            && mrCellPopulation.GetNumNodes() == num_nodes
+            && mrCellPopulation.GetNumElements() == num_elements)
+        {
+            std::vector<double> forces;
+            mMaxForce = ComputeForces(forces);
+            if (mMaxForce < mForceTolerance)
+            {
+                return true;
+            }
+        }
+    }
+    mNumRounds = mMaxRounds;
+    return false;
+}
+
+template<unsigned DIM>
+double FireEnergyMinimiser<DIM>::GetEnergy()
+{
+    return mpForce->GetTotalEnergy();
+}
+
+template<unsigned DIM>
+double FireEnergyMinimiser<DIM>::GetMaxForce()
+{
+    return mMaxForce;
+}
+
+template<unsigned DIM>
+unsigned FireEnergyMinimiser<DIM>::GetNumForceEvaluations()
+{
+    return mNumForceEvaluations;
+}
+
+template<unsigned DIM>
+unsigned FireEnergyMinimiser<DIM>::GetNumRounds()
+{
+    return mNumRounds;
+}
+
+template<unsigned DIM>
+void FireEnergyMinimiser<DIM>::SetForceTolerance(double forceTolerance)
+{
+    mForceTolerance = forceTolerance;
+}
+
+template<unsigned DIM>
+void FireEnergyMinimiser<DIM>::SetMaxStepLength(double maxStepLength)
+{
+    mMaxStepLength = maxStepLength;
+}
+
+template<unsigned DIM>
+void FireEnergyMinimiser<DIM>::SetTimeSteps(double initialTimeStep, double maxTimeStep)
+{
+    assert(initialTimeStep <= maxTimeStep);
+    mInitialTimeStep = initialTimeStep;
+    mMaxTimeStep = maxTimeStep;
+}
+
+template<unsigned DIM>
+void FireEnergyMinimiser<DIM>::SetMaxIterationsPerRound(unsigned maxIterationsPerRound)
+{
+    mMaxIterationsPerRound = maxIterationsPerRound;
+}
+
+template<unsigned DIM>
+void FireEnergyMinimiser<DIM>::SetMaxRounds(unsigned maxRounds)
+{
+    mMaxRounds = maxRounds;
+}
+
+// Explicit instantiation
+template class FireEnergyMinimiser<1>;
+template class FireEnergyMinimiser<2>;
+template class FireEnergyMinimiser<3>;
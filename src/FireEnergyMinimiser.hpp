@@ -0,0 +1,166 @@
+
+#ifndef FIREENERGYMINIMISER_HPP_
+#define FIREENERGYMINIMISER_HPP_
+
+#include <boost/shared_ptr.hpp>
+
+#include "VertexBasedCellPopulation.hpp"
+#include "MatteoForce.hpp"
+
+/**
+ * Drives a vertex-based cell population to a mechanical equilibrium (a local minimum
+ * of the MatteoForce energy) using the Fast Inertial Relaxation Engine of Bitzek et al,
+ * Phys. Rev. Lett., 2006, 97, 170201, instead of integrating the overdamped dynamics.
+ *
+ * The minimisation proceeds in rounds. Within a round the mesh topology is fixed and
+ * FIRE iterations move the nodes until the largest force on any node falls below
+ * mForceTolerance, or mMaxIterationsPerRound iterations have been taken. No node
+ * moves further than mMaxStepLength in an iteration, so that edges cannot shrink
+ * through the cell rearrangement threshold unnoticed. Between rounds, a T2SwapCellKiller
+ * kills any triangular cell smaller than the T2 threshold, as in OffLatticeSimulation,
+ * dead cells are removed and the population is updated, which carries out any T1 and
+ * T3 swaps. The minimiser stops once a round ends converged and the rearrangements that follow it
+ * leave the forces below tolerance.
+ *
+ * Each round starts with the nodes at rest, and the first iteration of a round always
+ * takes a step. The random motion of the MatteoForce is switched off while minimising,
+ * so that the descent is deterministic, and restored afterwards.
+ *
+ * Target areas are not updated during minimisation, so they must already have been
+ * set, for example by calling UpdateTargetAreas() on a ConstantTargetAreaModifier.
+ */
+template<unsigned DIM>
+class FireEnergyMinimiser
+{
+private:
+
+    /** The cell population to relax. */
+    VertexBasedCellPopulation<DIM>& mrCellPopulation;
+
+    /** The force whose energy is minimised. */
+    boost::shared_ptr<MatteoForce<DIM> > mpForce;
+
+    /** Convergence tolerance on the largest force on any node. Defaults to 1e-6. */
+    double mForceTolerance;
+
+    /** Largest distance any node may move in one iteration. Defaults to 0.01. */
+    double mMaxStepLength;
+
+    /** Initial FIRE time step of each round. Defaults to 0.01. */
+    double mInitialTimeStep;
+
+    /** Largest FIRE time step. Defaults to 0.1. */
+    double mMaxTimeStep;
+
+    /** Maximum number of FIRE iterations in a round. Defaults to 1000. */
+    unsigned mMaxIterationsPerRound;
+
+    /** Maximum number of rounds. Defaults to 20. */
+    unsigned mMaxRounds;
+
+    /** Number of force evaluations made by the last call to Minimise(). */
+    unsigned mNumForceEvaluations;
+
+    /** Number of rounds taken by the last call to Minimise(). */
+    unsigned mNumRounds;
+
+    /** Largest force on any node at the end of the last call to Minimise(). */
+    double mMaxForce;
+
+    /**
+     * Evaluate the force on every node into rForces, DIM entries per node.
+     *
+     * @param rForces the vector to fill
+     * @return the largest force on any node
+     */
+    double ComputeForces(std::vector<double>& rForces);
+
+    /**
+     * Carry out one round of FIRE iterations at fixed mesh topology.
+     *
+     * @return whether the round converged
+     */
+    bool MinimiseAtFixedTopology();
+
+    /**
+     * Carry out rounds of minimisation, with rearrangements in between, until converged.
+     *
+     * @return whether the minimiser converged within mMaxRounds rounds
+     */
+    bool MinimiseInRounds();
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param rCellPopulation the cell population to relax
+     * @param pForce the force whose energy is minimised
+     */
+    FireEnergyMinimiser(VertexBasedCellPopulation<DIM>& rCellPopulation, boost::shared_ptr<MatteoForce<DIM> > pForce);
+
+    /**
+     * Relax the population to a local energy minimum.
+     *
+     * @return whether the minimiser converged within mMaxRounds rounds
+     */
+    bool Minimise();
+
+    /**
+     * @return the energy of the population as of the last force evaluation
+     */
+    double GetEnergy();
+
+    /**
+     * @return the largest force on any node at the end of the last call to Minimise()
+     */
+    double GetMaxForce();
+
+    /**
+     * @return the number of force evaluations made by the last call to Minimise()
+     */
+    unsigned GetNumForceEvaluations();
+
+    /**
+     * @return the number of rounds taken by the last call to Minimise()
+     */
+    unsigned GetNumRounds();
+
+    /**
+     * Set mForceTolerance.
+     *
+     * @param forceTolerance convergence tolerance on the largest force on any node
+     */
+    void SetForceTolerance(double forceTolerance);
+
+    /**
+     * Set mMaxStepLength.
+     *
+     * @param maxStepLength largest distance any node may move in one iteration
+     */
+    void SetMaxStepLength(double maxStepLength);
+
+    /**
+     * Set mInitialTimeStep and mMaxTimeStep.
+     *
+     * @param initialTimeStep initial FIRE time step of each round
+     * @param maxTimeStep largest FIRE time step
+     */
+    void SetTimeSteps(double initialTimeStep, double maxTimeStep);
+
+    /**
+     * Set mMaxIterationsPerRound.
+     *
+     * @param maxIterationsPerRound maximum number of FIRE iterations in a round
+     */
+    void SetMaxIterationsPerRound(unsigned maxIterationsPerRound);
+
+    /**
+     * Set mMaxRounds.
+     *
+     * @param maxRounds maximum number of rounds
+     */
+    void SetMaxRounds(unsigned maxRounds);
+};
+
+#endif /*FIREENERGYMINIMISER_HPP_*/
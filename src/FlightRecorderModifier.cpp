@@ -0,0 +1,390 @@
+
+#include "FlightRecorderModifier.hpp"
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include "CellLabel.hpp"
+#include "OutputFileHandler.hpp"
+#include "PopulationConstants.hpp"
+
+template<unsigned DIM>
+volatile sig_atomic_t FlightRecorderModifier<DIM>::msSignalReceived = 0;
+
+template<unsigned DIM>
+FlightRecorderModifier<DIM>::FlightRecorderModifier()
+    : AbstractCellBasedSimulationModifier<DIM>(),
+      mNumFrames(100),
+      mRecordingInterval(1),
+      mNumFramesAfterTrigger(10),
+      mNextFrameIndex(0),
+      mNumStoredFrames(0),
+      mTriggerWasTrue(false),
+      mDumpPending(false),
+      mNumFramesUntilDump(0),
+      mPendingReason(""),
+      mTriggerTime(0.0),
+      mOutputDirectory(""),
+      mNumDumps(0)
+{
+}
+
+template<unsigned DIM>
+FlightRecorderModifier<DIM>::~FlightRecorderModifier()
+{
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::HandleSignal(int signal)
+{
+    msSignalReceived = 1;
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    if (dynamic_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation) == NULL)
+    {
+        EXCEPTION("FlightRecorderModifier is to be used with a VertexBasedCellPopulation only");
+    }
+    if (mNumFramesAfterTrigger >= mNumFrames)
+    {
+        EXCEPTION("FlightRecorderModifier must hold more frames than it records after a trigger");
+    }
+
+    mOutputDirectory = outputDirectory;
+    mFrames.resize(mNumFrames);
+    mNextFrameIndex = 0;
+    mNumStoredFrames = 0;
+    mTriggerWasTrue = false;
+    mDumpPending = false;
+
+    // The CellData keys are gathered from the cells as frames are recorded
+    mCellDataKeys.clear();
+
+    RecordFrame(*static_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation));
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (SimulationTime::Instance()->GetTimeStepsElapsed()%mRecordingInterval != 0)
+    {
+        return;
+    }
+
+    RecordFrame(*static_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation));
+
+    if (mDumpPending)
+    {
+        mNumFramesUntilDump--;
+        if (mNumFramesUntilDump == 0)
+        {
+            mDumpPending = false;
+            WriteDump(mPendingReason, mTriggerTime);
+        }
+    }
+
+    // The trigger is evaluated on every recorded step so that it only fires on a rising edge
+    bool trigger_is_true = mTrigger && mTrigger(rCellPopulation);
+    bool trigger_fired = trigger_is_true && !mTriggerWasTrue;
+    mTriggerWasTrue = trigger_is_true;
+
+    // A trigger or signal arriving while a dump is pending is covered by that dump
+    if (msSignalReceived)
+    {
+        msSignalReceived = 0;
+        if (!mDumpPending)
+        {
+            TriggerDump("signal");
+        }
+    }
+    else if (trigger_fired && !mDumpPending)
+    {
+        TriggerDump("trigger");
+    }
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (mDumpPending)
+    {
+        mDumpPending = false;
+        WriteDump(mPendingReason + " (end of simulation)", mTriggerTime);
+    }
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::TriggerDump(const std::string& rReason)
+{
+    double time = SimulationTime::Instance()->GetTime();
+    if (mNumFramesAfterTrigger == 0)
+    {
+        WriteDump(rReason, time);
+    }
+    else
+    {
+        mDumpPending = true;
+        mNumFramesUntilDump = mNumFramesAfterTrigger;
+        mPendingReason = rReason;
+        mTriggerTime = time;
+    }
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::RecordFrame(VertexBasedCellPopulation<DIM>& rCellPopulation)
+{
+    if (mFrames.empty())
+    {
+        return;
+    }
+
+    Frame& r_frame = mFrames[mNextFrameIndex];
+    MutableVertexMesh<DIM,DIM>& r_mesh = rCellPopulation.rGetMesh();
+
+    r_frame.mTime = SimulationTime::Instance()->GetTime();
+
+    unsigned num_nodes = r_mesh.GetNumNodes();
+    r_frame.mNodeLocations.resize(DIM*num_nodes);
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        const c_vector<double, DIM>& r_location = r_mesh.GetNode(node_index)->rGetLocation();
+        for (unsigned i=0; i<DIM; i++)
+        {
+            r_frame.mNodeLocations[DIM*node_index + i] = r_location[i];
+        }
+    }
+
+    unsigned num_elements = r_mesh.GetNumElements();
+    r_frame.mElementOffsets.resize(num_elements + 1);
+    r_frame.mElementNodes.clear();
+    r_frame.mIsWildType.resize(num_elements);
+    r_frame.mIsLabelled.resize(num_elements);
+
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        VertexElement<DIM,DIM>* p_element = r_mesh.GetElement(elem_index);
+        r_frame.mElementOffsets[elem_index] = r_frame.mElementNodes.size();
+        for (unsigned local_index=0; local_index<p_element->GetNumNodes(); local_index++)
+        {
+            r_frame.mElementNodes.push_back(p_element->GetNodeGlobalIndex(local_index));
+        }
+
+        CellPtr p_cell = rCellPopulation.GetCellUsingLocationIndex(elem_index);
+        r_frame.mIsWildType[elem_index] = (p_cell->GetCellProliferativeType() == p_wild_type);
+        r_frame.mIsLabelled[elem_index] = p_cell->template HasCellProperty<CellLabel>();
+    }
+    r_frame.mElementOffsets[num_elements] = r_frame.mElementNodes.size();
+
+    // Once any new keys have been added, a second pass records the items under them too
+    if (RecordCellData(r_frame, rCellPopulation))
+    {
+        RecordCellData(r_frame, rCellPopulation);
+    }
+
+    unsigned num_frames = mFrames.size();
+    mNextFrameIndex = (mNextFrameIndex + 1)%num_frames;
+    mNumStoredFrames = std::min(mNumStoredFrames + 1, num_frames);
+}
+
+template<unsigned DIM>
+bool FlightRecorderModifier<DIM>::RecordCellData(Frame& rFrame, VertexBasedCellPopulation<DIM>& rCellPopulation)
+{
+    unsigned num_elements = rCellPopulation.rGetMesh().GetNumElements();
+    unsigned num_keys = mCellDataKeys.size();
+    rFrame.mNumCellDataKeys = num_keys;
+    rFrame.mCellData.resize(num_keys*num_elements);
+
+    bool keys_added = false;
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        boost::shared_ptr<CellData> p_cell_data = rCellPopulation.GetCellUsingLocationIndex(elem_index)->GetCellData();
+        unsigned num_items_found = 0;
+        for (unsigned k=0; k<num_keys; k++)
+        {
+            double value = std::numeric_limits<double>::quiet_NaN();
+            if (p_cell_data->HasItem(mCellDataKeys[k]))
+            {
+                value = p_cell_data->GetItem(mCellDataKeys[k]);
+                num_items_found++;
+            }
+            rFrame.mCellData[num_keys*elem_index + k] = value;
+        }
+
+        // Any items not found are under keys not seen before
+        if (num_items_found < p_cell_data->GetNumItems())
+        {
+            std::vector<std::string> keys = p_cell_data->GetKeys();
+            for (unsigned i=0; i<keys.size(); i++)
+            {
+                if (std::find(mCellDataKeys.begin(), mCellDataKeys.end(), keys[i]) == mCellDataKeys.end())
+                {
+                    mCellDataKeys.push_back(keys[i]);
+                }
+            }
+            keys_added = true;
+        }
+    }
+    return keys_added;
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::DumpFrames(const std::string& rReason)
+{
+    mDumpPending = false;
+    WriteDump(rReason, SimulationTime::Instance()->GetTime());
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::WriteDump(const std::string& rReason, double eventTime)
+{
+    if (mNumStoredFrames == 0)
+    {
+        return;
+    }
+
+    OutputFileHandler output_file_handler(mOutputDirectory + "/flight_recorder/", false);
+    std::stringstream file_name;
+    file_name << "dump_" << mNumDumps << ".dat";
+    out_stream p_file = output_file_handler.OpenOutputFile(file_name.str());
+
+    *p_file << "# reason: " << rReason << "\n";
+    *p_file << "# event time: " << eventTime << "\n";
+    *p_file << "# frames: " << mNumStoredFrames << "\n";
+    *p_file << "# Each frame is a line 'frame time num_nodes num_elements', followed by one line per node\n";
+    *p_file << "# with its location, then one line per element: wild_type labelled num_nodes node_indices... cell_data...\n";
+    *p_file << "# cell_data:";
+    for (unsigned k=0; k<mCellDataKeys.size(); k++)
+    {
+        *p_file << " '" << mCellDataKeys[k] << "'";
+    }
+    *p_file << "\n";
+
+    // The oldest frame sits just after the most recent one once the buffer has wrapped around
+    unsigned num_frames = mFrames.size();
+    unsigned first_frame = (mNextFrameIndex + num_frames - mNumStoredFrames)%num_frames;
+    unsigned num_keys = mCellDataKeys.size();
+    for (unsigned f=0; f<mNumStoredFrames; f++)
+    {
+        const Frame& r_frame = mFrames[(first_frame + f)%num_frames];
+        unsigned num_nodes = r_frame.mNodeLocations.size()/DIM;
+        unsigned num_elements = r_frame.mIsWildType.size();
+        unsigned num_frame_keys = r_frame.mNumCellDataKeys;
+
+        *p_file << "frame " << r_frame.mTime << " " << num_nodes << " " << num_elements << "\n";
+        for (unsigned node_index=0; node_index<num_nodes; node_index++)
+        {
+            for (unsigned i=0; i<DIM; i++)
+            {
+                *p_file << r_frame.mNodeLocations[DIM*node_index + i] << (i+1 < DIM ? " " : "\n");
+            }
+        }
+        for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+        {
+            unsigned begin = r_frame.mElementOffsets[elem_index];
+            unsigned end = r_frame.mElementOffsets[elem_index + 1];
+            *p_file << r_frame.mIsWildType[elem_index] << " " << r_frame.mIsLabelled[elem_index] << " " << end - begin;
+            for (unsigned j=begin; j<end; j++)
+            {
+                *p_file << " " << r_frame.mElementNodes[j];
+            }
+            for (unsigned k=0; k<num_frame_keys; k++)
+            {
+                *p_file << " " << r_frame.mCellData[num_frame_keys*elem_index + k];
+            }
+
+            // Keys first seen after this frame was recorded
+            for (unsigned k=num_frame_keys; k<num_keys; k++)
+            {
+                *p_file << " " << std::numeric_limits<double>::quiet_NaN();
+            }
+            *p_file << "\n";
+        }
+    }
+    p_file->close();
+
+    mNumDumps++;
+    mNumStoredFrames = 0;
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::SetTrigger(TriggerFunction trigger)
+{
+    mTrigger = trigger;
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::EnableSignalTrigger(int signal)
+{
+    std::signal(signal, HandleSignal);
+}
+
+template<unsigned DIM>
+unsigned FlightRecorderModifier<DIM>::GetNumFrames()
+{
+    return mNumFrames;
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::SetNumFrames(unsigned numFrames)
+{
+    assert(numFrames > 0);
+    mNumFrames = numFrames;
+}
+
+template<unsigned DIM>
+unsigned FlightRecorderModifier<DIM>::GetRecordingInterval()
+{
+    return mRecordingInterval;
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::SetRecordingInterval(unsigned recordingInterval)
+{
+    assert(recordingInterval > 0);
+    mRecordingInterval = recordingInterval;
+}
+
+template<unsigned DIM>
+unsigned FlightRecorderModifier<DIM>::GetNumFramesAfterTrigger()
+{
+    return mNumFramesAfterTrigger;
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::SetNumFramesAfterTrigger(unsigned numFramesAfterTrigger)
+{
+    mNumFramesAfterTrigger = numFramesAfterTrigger;
+}
+
+template<unsigned DIM>
+unsigned FlightRecorderModifier<DIM>::GetNumStoredFrames()
+{
+    return mNumStoredFrames;
+}
+
+template<unsigned DIM>
+unsigned FlightRecorderModifier<DIM>::GetNumDumps()
+{
+    return mNumDumps;
+}
+
+template<unsigned DIM>
+void FlightRecorderModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<NumFrames>" << mNumFrames << "</NumFrames>\n";
+    *rParamsFile << "\t\t\t<RecordingInterval>" << mRecordingInterval << "</RecordingInterval>\n";
+    *rParamsFile << "\t\t\t<NumFramesAfterTrigger>" << mNumFramesAfterTrigger << "</NumFramesAfterTrigger>\n";
+
+    // Call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class FlightRecorderModifier<1>;
+template class FlightRecorderModifier<2>;
+template class FlightRecorderModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(FlightRecorderModifier)
@@ -0,0 +1,312 @@
+
+#ifndef FLIGHTRECORDERMODIFIER_HPP_
+#define FLIGHTRECORDERMODIFIER_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+#include <boost/function.hpp>
+#include <csignal>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+#include "VertexBasedCellPopulation.hpp"
+
+/**
+ * A modifier class which keeps the last few full state frames of a vertex-based
+ * simulation in an in-memory ring buffer, and only writes them to disk when a
+ * trigger fires. This lets us run with a coarse sampling timestep multiple while
+ * still getting fine resolution output around interesting events.
+ *
+ * A frame holds the node locations, the element connectivity and, for each cell,
+ * its proliferative type, label and all of its CellData items. The CellData keys are
+ * gathered from the cells as they are recorded, so a key first set partway through
+ * the simulation, or on only some cells, is recorded too; a cell without an item, or
+ * a frame recorded before its key appeared, is written as NaN.
+ *
+ * A dump is triggered when either of the following happens at the end of a recorded
+ * time step:
+ *  - the user-defined trigger (see SetTrigger()) becomes true, having been false at the
+ *    previous recorded step. The trigger re-arms once it returns false again, so a
+ *    condition which holds for many steps produces a single dump;
+ *  - a signal registered with EnableSignalTrigger() has been received.
+ * The dump is then written once a further SetNumFramesAfterTrigger() frames have been
+ * recorded, so that it brackets the event. A dump still pending at the end of the
+ * simulation is written by UpdateAtEndOfSolve(). DumpFrames() may also be called
+ * explicitly, e.g. from a catch block around Solve(), to write the buffer at once.
+ *
+ * Each dump is written to flight_recorder/dump_<n>.dat in the simulation output
+ * directory, oldest frame first.
+ */
+template<unsigned DIM>
+class FlightRecorderModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+public:
+
+    /** Type of the trigger predicate evaluated at the end of each recorded time step. */
+    typedef boost::function<bool (AbstractCellPopulation<DIM,DIM>&)> TriggerFunction;
+
+private:
+
+    /**
+     * One recorded state of the tissue. The vectors are reused between
+     * recordings so that, once the buffer is full, recording does not allocate.
+     */
+    struct Frame
+    {
+        /** Simulation time at which the frame was recorded. */
+        double mTime;
+
+        /** Node locations, DIM entries per node. */
+        std::vector<double> mNodeLocations;
+
+        /** Offset of the first node of each element in mElementNodes (one extra entry at the end). */
+        std::vector<unsigned> mElementOffsets;
+
+        /** Global node indices of each element, anticlockwise. */
+        std::vector<unsigned> mElementNodes;
+
+        /** Whether the cell in each element is of wild type. */
+        std::vector<bool> mIsWildType;
+
+        /** Whether the cell in each element has a CellLabel. */
+        std::vector<bool> mIsLabelled;
+
+        /** Number of the keys in mCellDataKeys when the frame was recorded. */
+        unsigned mNumCellDataKeys;
+
+        /** CellData items of each cell, in the order of the first mNumCellDataKeys keys of mCellDataKeys. */
+        std::vector<double> mCellData;
+    };
+
+    /** Number of frames held in memory. Defaults to 100. */
+    unsigned mNumFrames;
+
+    /** A frame is recorded every this many time steps. Defaults to 1. */
+    unsigned mRecordingInterval;
+
+    /** Number of frames recorded after a trigger before the dump is written. Defaults to 10. */
+    unsigned mNumFramesAfterTrigger;
+
+    /** The ring buffer of frames. */
+    std::vector<Frame> mFrames;
+
+    /** Index in mFrames at which the next frame will be recorded. */
+    unsigned mNextFrameIndex;
+
+    /** Number of valid frames currently held in mFrames. */
+    unsigned mNumStoredFrames;
+
+    /** The CellData keys recorded, in the order in which they were first seen on a cell. */
+    std::vector<std::string> mCellDataKeys;
+
+    /** The user-defined trigger, if any. */
+    TriggerFunction mTrigger;
+
+    /** Whether the trigger returned true at the previous recorded time step. */
+    bool mTriggerWasTrue;
+
+    /** Whether a dump has been triggered and is waiting for its remaining frames. */
+    bool mDumpPending;
+
+    /** Number of frames still to be recorded before the pending dump is written. */
+    unsigned mNumFramesUntilDump;
+
+    /** Why the pending dump was triggered. */
+    std::string mPendingReason;
+
+    /** Simulation time at which the pending dump was triggered. */
+    double mTriggerTime;
+
+    /** Output directory of the simulation, set in SetupSolve(). */
+    std::string mOutputDirectory;
+
+    /** Number of dumps written so far. */
+    unsigned mNumDumps;
+
+    /** Set by the signal handler installed by EnableSignalTrigger(). */
+    static volatile sig_atomic_t msSignalReceived;
+
+    /**
+     * Signal handler used by EnableSignalTrigger().
+     *
+     * @param signal the signal received
+     */
+    static void HandleSignal(int signal);
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables. The recorded frames
+     * and the trigger are not archived.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mNumFrames;
+        archive & mRecordingInterval;
+        archive & mNumFramesAfterTrigger;
+    }
+
+    /**
+     * Record the current state of the population into the next slot of the ring buffer.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void RecordFrame(VertexBasedCellPopulation<DIM>& rCellPopulation);
+
+    /**
+     * Record the CellData items of every cell into a frame under the keys in mCellDataKeys,
+     * with NaN for any key a cell does not carry, and add any keys not seen before to mCellDataKeys.
+     *
+     * @param rFrame the frame
+     * @param rCellPopulation reference to the cell population
+     * @return whether any keys were added, in which case the items under them have not been recorded
+     */
+    bool RecordCellData(Frame& rFrame, VertexBasedCellPopulation<DIM>& rCellPopulation);
+
+    /**
+     * Start a dump at the current time: write it at once if no frames are to be recorded
+     * after a trigger, otherwise mark it as pending.
+     *
+     * @param rReason a short description of why the dump happened
+     */
+    void TriggerDump(const std::string& rReason);
+
+    /**
+     * Write all frames currently held in memory to a new dump file, and empty the buffer.
+     * Does nothing if no frames are held.
+     *
+     * @param rReason a short description of why the dump happened, written to the file header
+     * @param eventTime the simulation time of the event, written to the file header
+     */
+    void WriteDump(const std::string& rReason, double eventTime);
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    FlightRecorderModifier();
+
+    /**
+     * Destructor.
+     */
+    virtual ~FlightRecorderModifier();
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Records a frame every mRecordingInterval time steps, then writes a pending dump
+     * once its last frame is recorded and checks the triggers.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.
+     *
+     * Writes a pending dump with whatever frames were recorded after its trigger.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Allocates the ring buffer, re-arms the trigger and records the initial state.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Write all frames currently held in memory to a new dump file at once, and empty
+     * the buffer. Any pending dump is cancelled. Does nothing if no frames are held.
+     *
+     * @param rReason a short description of why the dump happened, written to the file header
+     */
+    void DumpFrames(const std::string& rReason);
+
+    /**
+     * Set the trigger predicate. It is called at the end of every recorded time step and
+     * a dump is triggered whenever it becomes true.
+     *
+     * @param trigger the predicate
+     */
+    void SetTrigger(TriggerFunction trigger);
+
+    /**
+     * Install a handler so that receiving the given signal (e.g. from `kill -USR1 <pid>`)
+     * triggers a dump at the end of the current recorded time step.
+     *
+     * @param signal the signal to listen for (defaults to SIGUSR1)
+     */
+    void EnableSignalTrigger(int signal=SIGUSR1);
+
+    /**
+     * @return mNumFrames
+     */
+    unsigned GetNumFrames();
+
+    /**
+     * Set mNumFrames. Must be called before the simulation is set up.
+     *
+     * @param numFrames the number of frames to hold in memory
+     */
+    void SetNumFrames(unsigned numFrames);
+
+    /**
+     * @return mRecordingInterval
+     */
+    unsigned GetRecordingInterval();
+
+    /**
+     * Set mRecordingInterval.
+     *
+     * @param recordingInterval record a frame every this many time steps
+     */
+    void SetRecordingInterval(unsigned recordingInterval);
+
+    /**
+     * @return mNumFramesAfterTrigger
+     */
+    unsigned GetNumFramesAfterTrigger();
+
+    /**
+     * Set mNumFramesAfterTrigger. Must be less than the number of frames held in memory,
+     * so that the dump also holds frames from before the trigger.
+     *
+     * @param numFramesAfterTrigger the number of frames to record after a trigger
+     */
+    void SetNumFramesAfterTrigger(unsigned numFramesAfterTrigger);
+
+    /**
+     * @return the number of frames currently held in memory
+     */
+    unsigned GetNumStoredFrames();
+
+    /**
+     * @return the number of dumps written so far
+     */
+    unsigned GetNumDumps();
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(FlightRecorderModifier)
+
+#endif /*FLIGHTRECORDERMODIFIER_HPP_*/
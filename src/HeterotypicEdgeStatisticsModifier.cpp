@@ -0,0 +1,354 @@
+
+#include "HeterotypicEdgeStatisticsModifier.hpp"
+#include "MatteoMutableVertexMesh.hpp"
+#include "OutputFileHandler.hpp"
+
+#include <algorithm>
+
+template<unsigned DIM>
+HeterotypicEdgeStatisticsModifier<DIM>::HeterotypicEdgeStatisticsModifier()
+    : AbstractCellBasedSimulationModifier<DIM>(),
+      mSamplingInterval(1),
+      mpMesh(NULL),
+      mNumEdgesReclassified(0)
+{
+    for (unsigned type=0; type<NUM_EDGE_TYPES; type++)
+    {
+        mNumEdges[type] = 0;
+        mTotalLengths[type] = 0.0;
+    }
+}
+
+template<unsigned DIM>
+HeterotypicEdgeStatisticsModifier<DIM>::~HeterotypicEdgeStatisticsModifier()
+{
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    OutputFileHandler output_file_handler(outputDirectory + "/", false);
+    mpStatisticsFile = output_file_handler.OpenOutputFile("edge_statistics.dat");
+    *mpStatisticsFile << "# time, then number of edges and total edge length for each of"
+                      << " wild/wild diff/diff mixed wild/boundary diff/boundary\n";
+
+    // Start from scratch, in case the modifier is reused between simulations
+    mpMesh = NULL;
+    UpdateStatistics(rCellPopulation);
+    UpdateEdgeLengths(rCellPopulation);
+    WriteStatistics();
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    // Without stored edges, the counts come from the same single pass as the lengths
+    bool is_sampling_step = (SimulationTime::Instance()->GetTimeStepsElapsed()%mSamplingInterval == 0);
+    if (!is_sampling_step || (mpMesh != NULL))
+    {
+        UpdateStatistics(rCellPopulation);
+    }
+
+    if (is_sampling_step)
+    {
+        UpdateEdgeLengths(rCellPopulation);
+        WriteStatistics();
+    }
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (mpStatisticsFile)
+    {
+        mpStatisticsFile->close();
+    }
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::UpdateStatistics(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (dynamic_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation) == NULL)
+    {
+        EXCEPTION("HeterotypicEdgeStatisticsModifier is to be used with a VertexBasedCellPopulation only");
+    }
+    VertexBasedCellPopulation<DIM>* p_cell_population = static_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation);
+    MutableVertexMesh<DIM,DIM>& r_mesh = p_cell_population->rGetMesh();
+
+    // Only a MatteoMutableVertexMesh records its rearrangements, and not those which renumber it
+    MatteoMutableVertexMesh<DIM>* p_matteo_mesh = dynamic_cast<MatteoMutableVertexMesh<DIM>*>(&r_mesh);
+    if (p_matteo_mesh == NULL)
+    {
+        mpMesh = NULL;
+        CountEdgesInSinglePass(*p_cell_population, false);
+        return;
+    }
+    if ((&r_mesh != mpMesh) || p_matteo_mesh->HasUnrecordedRearrangements())
+    {
+        mpMesh = &r_mesh;
+        RebuildStatistics(*p_cell_population);
+        return;
+    }
+
+    // Only the edges incident to rearranged nodes can have been created, destroyed or have changed type
+    std::vector<unsigned> dirty_nodes(p_matteo_mesh->rGetRearrangedNodes());
+    p_matteo_mesh->ClearRearrangedNodes();
+
+    // A cell changing type changes the type of all of its edges; the elements added by
+    // divisions have all their nodes recorded by the mesh already
+    unsigned num_elements = r_mesh.GetNumElements();
+    unsigned num_classified_elements = mElementIsWild.size();
+    mElementIsWild.resize(num_elements);
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        bool is_wild = IsWildType(p_cell_population->GetCellUsingLocationIndex(elem_index));
+        if ((elem_index < num_classified_elements) && (is_wild != mElementIsWild[elem_index]))
+        {
+            VertexElement<DIM,DIM>* p_element = r_mesh.GetElement(elem_index);
+            for (unsigned local_index=0; local_index<p_element->GetNumNodes(); local_index++)
+            {
+                dirty_nodes.push_back(p_element->GetNodeGlobalIndex(local_index));
+            }
+        }
+        mElementIsWild[elem_index] = is_wild;
+    }
+
+    mNumEdgesReclassified = 0;
+    if (dirty_nodes.empty())
+    {
+        return;
+    }
+
+    std::sort(dirty_nodes.begin(), dirty_nodes.end());
+    dirty_nodes.erase(std::unique(dirty_nodes.begin(), dirty_nodes.end()), dirty_nodes.end());
+
+    // Divisions add nodes at the end
+    mNodeNeighbours.resize(r_mesh.GetNumNodes());
+
+    // Forget all edges around the dirty nodes before classifying them again, so that
+    // an edge joining two dirty nodes is only classified once
+    for (unsigned i=0; i<dirty_nodes.size(); i++)
+    {
+        RemoveEdgesOfNode(dirty_nodes[i]);
+    }
+    for (unsigned i=0; i<dirty_nodes.size(); i++)
+    {
+        Node<DIM>* p_node = r_mesh.GetNode(dirty_nodes[i]);
+        const std::set<unsigned>& r_containing_elements = p_node->rGetContainingElementIndices();
+        for (std::set<unsigned>::const_iterator iter = r_containing_elements.begin();
+             iter != r_containing_elements.end();
+             ++iter)
+        {
+            VertexElement<DIM,DIM>* p_element = r_mesh.GetElement(*iter);
+            unsigned num_nodes_elem = p_element->GetNumNodes();
+            unsigned local_index = p_element->GetNodeLocalIndex(dirty_nodes[i]);
+            AddEdge(*iter, p_node, p_element->GetNode((local_index + num_nodes_elem - 1)%num_nodes_elem), *p_cell_population);
+            AddEdge(*iter, p_node, p_element->GetNode((local_index + 1)%num_nodes_elem), *p_cell_population);
+        }
+    }
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::RebuildStatistics(VertexBasedCellPopulation<DIM>& rCellPopulation)
+{
+    MutableVertexMesh<DIM,DIM>& r_mesh = rCellPopulation.rGetMesh();
+
+    mEdgeTypes.clear();
+    mNodeNeighbours.assign(r_mesh.GetNumNodes(), std::vector<unsigned>());
+    for (unsigned type=0; type<NUM_EDGE_TYPES; type++)
+    {
+        mNumEdges[type] = 0;
+    }
+
+    mNumEdgesReclassified = 0;
+    mElementIsWild.resize(r_mesh.GetNumElements());
+    for (unsigned elem_index=0; elem_index<r_mesh.GetNumElements(); elem_index++)
+    {
+        mElementIsWild[elem_index] = IsWildType(rCellPopulation.GetCellUsingLocationIndex(elem_index));
+        VertexElement<DIM,DIM>* p_element = r_mesh.GetElement(elem_index);
+        unsigned num_nodes_elem = p_element->GetNumNodes();
+        for (unsigned local_index=0; local_index<num_nodes_elem; local_index++)
+        {
+            AddEdge(elem_index, p_element->GetNode(local_index), p_element->GetNode((local_index+1)%num_nodes_elem), rCellPopulation);
+        }
+    }
+
+    // Everything up to now is accounted for
+    MatteoMutableVertexMesh<DIM>* p_matteo_mesh = dynamic_cast<MatteoMutableVertexMesh<DIM>*>(&r_mesh);
+    if (p_matteo_mesh != NULL)
+    {
+        p_matteo_mesh->ClearRearrangedNodes();
+    }
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::CountEdgesInSinglePass(VertexBasedCellPopulation<DIM>& rCellPopulation, bool computeLengths)
+{
+    MutableVertexMesh<DIM,DIM>& r_mesh = rCellPopulation.rGetMesh();
+
+    mEdgeTypes.clear();
+    mNodeNeighbours.clear();
+    mElementIsWild.clear();
+    for (unsigned type=0; type<NUM_EDGE_TYPES; type++)
+    {
+        mNumEdges[type] = 0;
+        if (computeLengths)
+        {
+            mTotalLengths[type] = 0.0;
+        }
+    }
+
+    mNumEdgesReclassified = 0;
+    for (unsigned elem_index=0; elem_index<r_mesh.GetNumElements(); elem_index++)
+    {
+        VertexElement<DIM,DIM>* p_element = r_mesh.GetElement(elem_index);
+        unsigned num_nodes_elem = p_element->GetNumNodes();
+        for (unsigned local_index=0; local_index<num_nodes_elem; local_index++)
+        {
+            Node<DIM>* p_node_a = p_element->GetNode(local_index);
+            Node<DIM>* p_node_b = p_element->GetNode((local_index+1)%num_nodes_elem);
+            unsigned other_elem_index;
+            EdgeType edge_type = GetEdgeType(elem_index, p_node_a, p_node_b, rCellPopulation, &other_elem_index);
+
+            // An interior edge is seen from both of its elements, so only count it from the first
+            if ((other_elem_index != UINT_MAX) && (other_elem_index < elem_index))
+            {
+                continue;
+            }
+            mNumEdges[edge_type]++;
+            mNumEdgesReclassified++;
+            if (computeLengths)
+            {
+                mTotalLengths[edge_type] += norm_2(r_mesh.GetVectorFromAtoB(p_node_a->rGetLocation(), p_node_b->rGetLocation()));
+            }
+        }
+    }
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::AddEdge(unsigned elemIndex,
+                                                     Node<DIM>* pNodeA,
+                                                     Node<DIM>* pNodeB,
+                                                     VertexBasedCellPopulation<DIM>& rCellPopulation)
+{
+    unsigned index_a = pNodeA->GetIndex();
+    unsigned index_b = pNodeB->GetIndex();
+    EdgeKey key(std::min(index_a, index_b), std::max(index_a, index_b));
+
+    if (mEdgeTypes.find(key) == mEdgeTypes.end())
+    {
+        EdgeType edge_type = GetEdgeType(elemIndex, pNodeA, pNodeB, rCellPopulation);
+        mEdgeTypes[key] = edge_type;
+        mNumEdges[edge_type]++;
+        mNodeNeighbours[index_a].push_back(index_b);
+        mNodeNeighbours[index_b].push_back(index_a);
+        mNumEdgesReclassified++;
+    }
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::RemoveEdgesOfNode(unsigned nodeIndex)
+{
+    std::vector<unsigned>& r_neighbours = mNodeNeighbours[nodeIndex];
+    for (unsigned i=0; i<r_neighbours.size(); i++)
+    {
+        unsigned neighbour_index = r_neighbours[i];
+        EdgeKey key(std::min(nodeIndex, neighbour_index), std::max(nodeIndex, neighbour_index));
+
+        typename std::map<EdgeKey, EdgeType>::iterator edge_iter = mEdgeTypes.find(key);
+        assert(edge_iter != mEdgeTypes.end());
+        mNumEdges[edge_iter->second]--;
+        mEdgeTypes.erase(edge_iter);
+
+        std::vector<unsigned>& r_other_neighbours = mNodeNeighbours[neighbour_index];
+        r_other_neighbours.erase(std::find(r_other_neighbours.begin(), r_other_neighbours.end(), nodeIndex));
+    }
+    r_neighbours.clear();
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::UpdateEdgeLengths(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    VertexBasedCellPopulation<DIM>* p_cell_population = static_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation);
+    if (mpMesh == NULL)
+    {
+        CountEdgesInSinglePass(*p_cell_population, true);
+        return;
+    }
+    MutableVertexMesh<DIM,DIM>& r_mesh = p_cell_population->rGetMesh();
+
+    for (unsigned type=0; type<NUM_EDGE_TYPES; type++)
+    {
+        mTotalLengths[type] = 0.0;
+    }
+    for (typename std::map<EdgeKey, EdgeType>::iterator iter = mEdgeTypes.begin();
+         iter != mEdgeTypes.end();
+         ++iter)
+    {
+        const c_vector<double, DIM>& r_location_a = r_mesh.GetNode(iter->first.first)->rGetLocation();
+        const c_vector<double, DIM>& r_location_b = r_mesh.GetNode(iter->first.second)->rGetLocation();
+        mTotalLengths[iter->second] += norm_2(r_mesh.GetVectorFromAtoB(r_location_a, r_location_b));
+    }
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::WriteStatistics()
+{
+    *mpStatisticsFile << SimulationTime::Instance()->GetTime();
+    for (unsigned type=0; type<NUM_EDGE_TYPES; type++)
+    {
+        *mpStatisticsFile << " " << mNumEdges[type] << " " << mTotalLengths[type];
+    }
+    *mpStatisticsFile << "\n";
+}
+
+template<unsigned DIM>
+unsigned HeterotypicEdgeStatisticsModifier<DIM>::GetNumEdges(EdgeType edgeType)
+{
+    assert(edgeType < NUM_EDGE_TYPES);
+    return mNumEdges[edgeType];
+}
+
+template<unsigned DIM>
+double HeterotypicEdgeStatisticsModifier<DIM>::GetTotalLength(EdgeType edgeType)
+{
+    assert(edgeType < NUM_EDGE_TYPES);
+    return mTotalLengths[edgeType];
+}
+
+template<unsigned DIM>
+unsigned HeterotypicEdgeStatisticsModifier<DIM>::GetNumEdgesReclassified()
+{
+    return mNumEdgesReclassified;
+}
+
+template<unsigned DIM>
+unsigned HeterotypicEdgeStatisticsModifier<DIM>::GetSamplingInterval()
+{
+    return mSamplingInterval;
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::SetSamplingInterval(unsigned samplingInterval)
+{
+    assert(samplingInterval > 0);
+    mSamplingInterval = samplingInterval;
+}
+
+template<unsigned DIM>
+void HeterotypicEdgeStatisticsModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<SamplingInterval>" << mSamplingInterval << "</SamplingInterval>\n";
+
+    // Call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class HeterotypicEdgeStatisticsModifier<1>;
+template class HeterotypicEdgeStatisticsModifier<2>;
+template class HeterotypicEdgeStatisticsModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(HeterotypicEdgeStatisticsModifier)
@@ -0,0 +1,221 @@
+
+#ifndef HETEROTYPICEDGESTATISTICSMODIFIER_HPP_
+#define HETEROTYPICEDGESTATISTICSMODIFIER_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include <map>
+#include <utility>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "EdgeType.hpp"
+
+/**
+ * A modifier class which keeps count of the edges of each EdgeType (wild/wild,
+ * diff/diff, mixed and the two kinds of boundary edge) in a vertex-based
+ * simulation, using the same classification as MatteoForce.
+ *
+ * On a MatteoMutableVertexMesh, rather than reclassifying every edge at every time
+ * step, the modifier keeps the type of each edge and, at the end of each time step,
+ * only reclassifies the edges around the nodes affected by events since the last
+ * update: the nodes whose containing elements the mesh records as changed by T1 swaps
+ * and divisions, and the nodes of cells whose type differs from the one stored for
+ * their element. Deaths, T2 swaps and renumbering change the indices of the whole
+ * mesh, so when the mesh reports such a change the stored edges are rebuilt from scratch.
+ *
+ * Any other mesh keeps no record of its rearrangements, so there the edges are not
+ * stored at all: every update counts them in a single pass over the elements, as
+ * would be done without the modifier.
+ *
+ * Total edge lengths change whenever any node moves, so they are recomputed every
+ * mSamplingInterval time steps, from the stored edges or in the same single pass
+ * as the counts, when the counts and lengths are also written to edge_statistics.dat.
+ */
+template<unsigned DIM>
+class HeterotypicEdgeStatisticsModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mSamplingInterval;
+    }
+
+    /** Type of the key of an edge: the indices of its nodes, smallest first. */
+    typedef std::pair<unsigned, unsigned> EdgeKey;
+
+    /** Lengths are computed and output written every this many time steps. Defaults to 1. */
+    unsigned mSamplingInterval;
+
+    /** The type of each edge in the mesh. */
+    std::map<EdgeKey, EdgeType> mEdgeTypes;
+
+    /** The neighbours of each node along the edges in mEdgeTypes. */
+    std::vector<std::vector<unsigned> > mNodeNeighbours;
+
+    /** The mesh the stored edges belong to, or NULL if they are to be rebuilt or none are stored. */
+    MutableVertexMesh<DIM,DIM>* mpMesh;
+
+    /** Whether the cell of each element was wild type when its edges were last classified. */
+    std::vector<bool> mElementIsWild;
+
+    /** The number of edges of each type. */
+    unsigned mNumEdges[NUM_EDGE_TYPES];
+
+    /** The total length of the edges of each type, as of the last call to UpdateEdgeLengths(). */
+    double mTotalLengths[NUM_EDGE_TYPES];
+
+    /** The number of edges reclassified by the last call to UpdateStatistics(). */
+    unsigned mNumEdgesReclassified;
+
+    /** Output file for the edge statistics. */
+    out_stream mpStatisticsFile;
+
+    /**
+     * Classify every edge of the mesh from scratch.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void RebuildStatistics(VertexBasedCellPopulation<DIM>& rCellPopulation);
+
+    /**
+     * Count the edges of each type, and optionally their total lengths, in a single pass
+     * over the elements without storing them.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param computeLengths whether to compute the total lengths too
+     */
+    void CountEdgesInSinglePass(VertexBasedCellPopulation<DIM>& rCellPopulation, bool computeLengths);
+
+    /**
+     * Classify an edge, if it is not already known, and record it.
+     *
+     * @param elemIndex the index of an element containing the edge
+     * @param pNodeA one node of the edge
+     * @param pNodeB the other node of the edge
+     * @param rCellPopulation reference to the cell population
+     */
+    void AddEdge(unsigned elemIndex, Node<DIM>* pNodeA, Node<DIM>* pNodeB, VertexBasedCellPopulation<DIM>& rCellPopulation);
+
+    /**
+     * Forget all the edges incident to a node.
+     *
+     * @param nodeIndex the index of the node
+     */
+    void RemoveEdgesOfNode(unsigned nodeIndex);
+
+    /**
+     * Write the current counts and lengths to the output file.
+     */
+    void WriteStatistics();
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    HeterotypicEdgeStatisticsModifier();
+
+    /**
+     * Destructor.
+     */
+    virtual ~HeterotypicEdgeStatisticsModifier();
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Updates the counts and, every mSamplingInterval time steps, the lengths and the output file.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Classifies every edge and opens the output file.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.
+     *
+     * Closes the output file.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Bring the edge counts up to date with the population. On a MatteoMutableVertexMesh
+     * only the edges around the nodes affected by events since the last update are
+     * reclassified; on any other mesh every edge is counted again.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void UpdateStatistics(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Recompute the total length of the edges of each type. If no edges are stored,
+     * the counts are brought up to date in the same pass.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void UpdateEdgeLengths(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * @param edgeType a type of edge
+     * @return the number of edges of this type
+     */
+    unsigned GetNumEdges(EdgeType edgeType);
+
+    /**
+     * @param edgeType a type of edge
+     * @return the total length of the edges of this type, as of the last call to UpdateEdgeLengths()
+     */
+    double GetTotalLength(EdgeType edgeType);
+
+    /**
+     * @return the number of edges reclassified by the last update
+     */
+    unsigned GetNumEdgesReclassified();
+
+    /**
+     * @return mSamplingInterval
+     */
+    unsigned GetSamplingInterval();
+
+    /**
+     * Set mSamplingInterval.
+     *
+     * @param samplingInterval compute lengths and write output every this many time steps
+     */
+    void SetSamplingInterval(unsigned samplingInterval);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(HeterotypicEdgeStatisticsModifier)
+
+#endif /*HETEROTYPICEDGESTATISTICSMODIFIER_HPP_*/
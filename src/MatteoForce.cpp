@@ -1,10 +1,17 @@
 
 #include "MatteoForce.hpp"
-#include "PopulationConstants.hpp"
+#include "EdgeType.hpp"
+#include "VertexGeometryCache.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "MatteoProfiler.hpp"
 
 template<unsigned DIM>
 MatteoForce<DIM>::MatteoForce()
-   : FarhadifarForce<DIM>()
+   : FarhadifarForce<DIM>(),
+     mMovementParameter(0.0),
+     mApplyNoise(true),
+     mUseStructureOfArrays(false),
+     mTotalEnergy(0.0)
      {
 }
 
@@ -17,64 +24,313 @@ MatteoForce<DIM>::~MatteoForce()
 template<unsigned DIM>
 double MatteoForce<DIM>::GetLineTensionParameter(unsigned elem_index, Node<DIM>* pNodeA, Node<DIM>* pNodeB, VertexBasedCellPopulation<DIM>& rVertexCellPopulation)
 {
-    // Find the indices of the elements owned by each node
-    std::set<unsigned> elements_containing_nodeA = pNodeA->rGetContainingElementIndices();
-    std::set<unsigned> elements_containing_nodeB = pNodeB->rGetContainingElementIndices();
-
-    // Find common elements
-    std::set<unsigned> shared_elements;
-    std::set_intersection(elements_containing_nodeA.begin(),
-                          elements_containing_nodeA.end(),
-                          elements_containing_nodeB.begin(),
-                          elements_containing_nodeB.end(),
-                          std::inserter(shared_elements, shared_elements.begin()));
-
-    // Check that the nodes have a common edge
-    assert(!shared_elements.empty());
-
-    double tension;
-
-    if (shared_elements.size() == 1) {
-	CellPtr c = rVertexCellPopulation.GetCellUsingLocationIndex(elem_index);
-	if (c->GetCellProliferativeType() == p_wild_type) {
-	    tension = wild_type_lambda;
-	} else {
-	    tension = diff_type_lambda;
-	}
-    } else {
-	unsigned n_wild = 0, n_diff = 0;
-
-	for (std::set<unsigned>::iterator iter = shared_elements.begin(); iter != shared_elements.end(); ++iter) {
-	    unsigned i = *(iter);
-	    CellPtr c = rVertexCellPopulation.GetCellUsingLocationIndex(i);
-	    if (c->GetCellProliferativeType() == p_wild_type) {
-		n_wild++;
-	    } else {
-		n_diff++;
-	    }
-	}
-	
-	assert(n_wild + n_diff == 2);
-	if (n_wild == 2) {
-	    tension = wild_type_lambda;
-	} else if (n_diff == 2) {
-	    tension = diff_type_lambda;
-	} else {
-	    tension = mixed_type_lambda;
-	}
-
-	// If the edge corresponds to a single element, then the cell is on the boundary
-	// if not on the boundary it will be visited twice.
-	tension /= 2;
+    EdgeType edge_type = GetEdgeType(elem_index, pNodeA, pNodeB, rVertexCellPopulation);
+    double tension = GetLineTensionOfEdgeType(edge_type);
+
+    // If the edge corresponds to a single element, then the cell is on the boundary;
+    // if not on the boundary it will be visited twice.
+    if (edge_type != WILD_BOUNDARY_EDGE && edge_type != DIFF_BOUNDARY_EDGE)
+    {
+        tension /= 2;
     }
 
     return tension;
 }
 
+template<unsigned DIM>
+void MatteoForce<DIM>::AddForceContribution(AbstractCellPopulation<DIM>& rCellPopulation)
+{
+    MATTEO_PROFILE_SCOPE("MatteoForce::AddForceContribution");
+
+    // Throw an exception message if not using a VertexBasedCellPopulation
+    if (dynamic_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation) == NULL)
+    {
+        EXCEPTION("MatteoForce is to be used with a VertexBasedCellPopulation only");
+    }
+
+    // Define some helper variables
+    VertexBasedCellPopulation<DIM>* p_cell_population = static_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation);
+    MutableVertexMesh<DIM,DIM>& r_mesh = p_cell_population->rGetMesh();
+    unsigned num_elements = p_cell_population->GetNumElements();
+
+    // Begin by bringing the geometry of every element up to date, in one sweep shared
+    // through the mesh's cache with anything else that needs it this time step, and
+    // computing the area and perimeter terms of the energy of each element
+    VertexGeometryCache<DIM>* p_geometry = &VertexGeometryCache<DIM>::rGetCache(r_mesh, mGeometry);
+    p_geometry->Update(r_mesh);
+    std::vector<double> target_areas(num_elements);
+    mElementEnergies.assign(num_elements, 0.0);
+    for (typename VertexMesh<DIM,DIM>::VertexElementIterator elem_iter = r_mesh.GetElementIteratorBegin();
+         elem_iter != r_mesh.GetElementIteratorEnd();
+         ++elem_iter)
+    {
+        unsigned elem_index = elem_iter->GetIndex();
+        try
+        {
+            target_areas[elem_index] = p_cell_population->GetCellUsingLocationIndex(elem_index)->GetCellData()->GetItem("target area");
+        }
+        catch (Exception&)
+        {
+            EXCEPTION("You need to add an AbstractTargetAreaModifier to the simulation in order to use the MatteoForce");
+        }
+
+        double area_deviation = p_geometry->GetArea(elem_index) - target_areas[elem_index];
+        double perimeter = p_geometry->GetPerimeter(elem_index);
+        mElementEnergies[elem_index] = 0.5*this->GetAreaElasticityParameter()*area_deviation*area_deviation
+                                       + 0.5*this->GetPerimeterContractilityParameter()*perimeter*perimeter;
+    }
+
+    // Scaling of the random motion, as in RandomMotionForce
+    double noise_scaling = 0.0;
+    if (mMovementParameter > 0.0 && mApplyNoise)
+    {
+        double dt = SimulationTime::Instance()->GetTimeStep();
+        noise_scaling = sqrt(2.0*mMovementParameter*dt)/dt;
+    }
+
+    if (mUseStructureOfArrays)
+    {
+        AddForcesByElement(*p_cell_population, *p_geometry, target_areas, noise_scaling);
+    }
+    else
+    {
+        AddForcesByNode(*p_cell_population, *p_geometry, target_areas, noise_scaling);
+    }
+
+    mTotalEnergy = 0.0;
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        mTotalEnergy += mElementEnergies[elem_index];
+    }
+}
+
+template<unsigned DIM>
+void MatteoForce<DIM>::AddForcesByNode(VertexBasedCellPopulation<DIM>& rCellPopulation,
+                                       const VertexGeometryCache<DIM>& rGeometry,
+                                       const std::vector<double>& rTargetAreas,
+                                       double noiseScaling)
+{
+    MATTEO_PROFILE_SCOPE("MatteoForce::AddForcesByNode");
+
+    RandomNumberGenerator* p_gen = RandomNumberGenerator::Instance();
+    unsigned num_nodes = rCellPopulation.GetNumNodes();
+
+    // Iterate over vertices in the cell population
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        Node<DIM>* p_this_node = rCellPopulation.GetNode(node_index);
+
+        c_vector<double, DIM> area_elasticity_contribution = zero_vector<double>(DIM);
+        c_vector<double, DIM> perimeter_contractility_contribution = zero_vector<double>(DIM);
+        c_vector<double, DIM> line_tension_contribution = zero_vector<double>(DIM);
+
+        // Iterate over the elements containing this node
+        const std::set<unsigned>& containing_elem_indices = p_this_node->rGetContainingElementIndices();
+        for (std::set<unsigned>::const_iterator iter = containing_elem_indices.begin();
+             iter != containing_elem_indices.end();
+             ++iter)
+        {
+            VertexElement<DIM, DIM>* p_element = rCellPopulation.GetElement(*iter);
+            unsigned elem_index = p_element->GetIndex();
+            unsigned num_nodes_elem = p_element->GetNumNodes();
+            unsigned local_index = p_element->GetNodeLocalIndex(node_index);
+
+            // Add the force contribution from this cell's area elasticity (note the minus sign)
+            c_vector<double, DIM> element_area_gradient = rGeometry.GetAreaGradient(elem_index, local_index);
+            area_elasticity_contribution -= this->GetAreaElasticityParameter()*(rGeometry.GetArea(elem_index) -
+                    rTargetAreas[elem_index])*element_area_gradient;
+
+            // Get the previous and next nodes in this element
+            unsigned previous_node_local_index = (num_nodes_elem+local_index-1)%num_nodes_elem;
+            Node<DIM>* p_previous_node = p_element->GetNode(previous_node_local_index);
+            Node<DIM>* p_next_node = p_element->GetNode((local_index+1)%num_nodes_elem);
+
+            // The line tension parameters are half the actual values for internal edges, since these are visited twice
+            double previous_edge_line_tension_parameter = GetLineTensionParameter(elem_index, p_previous_node, p_this_node, rCellPopulation);
+            double next_edge_line_tension_parameter = GetLineTensionParameter(elem_index, p_this_node, p_next_node, rCellPopulation);
+
+            // Compute the gradient of each these edges, computed at the present node
+            c_vector<double, DIM> previous_edge_gradient = -rGeometry.GetNextEdgeGradient(elem_index, previous_node_local_index);
+            c_vector<double, DIM> next_edge_gradient = rGeometry.GetNextEdgeGradient(elem_index, local_index);
+
+            // Add the force contribution from cell-cell and cell-boundary line tension (note the minus sign)
+            line_tension_contribution -= previous_edge_line_tension_parameter*previous_edge_gradient +
+                    next_edge_line_tension_parameter*next_edge_gradient;
+
+            // Add the force contribution from this cell's perimeter contractility (note the minus sign)
+            c_vector<double, DIM> element_perimeter_gradient = previous_edge_gradient + next_edge_gradient;
+            perimeter_contractility_contribution -= this->GetPerimeterContractilityParameter()*rGeometry.GetPerimeter(elem_index)*
+                    element_perimeter_gradient;
+
+            // Each edge of the element is the next edge of exactly one of its nodes, so count its line tension energy there
+            mElementEnergies[elem_index] += next_edge_line_tension_parameter*rGeometry.GetEdgeLength(elem_index, local_index);
+        }
+
+        c_vector<double, DIM> force_on_node = area_elasticity_contribution + perimeter_contractility_contribution + line_tension_contribution;
+        if (noiseScaling > 0.0)
+        {
+            for (unsigned i=0; i<DIM; i++)
+            {
+                force_on_node[i] += noiseScaling*p_gen->StandardNormalRandomDeviate();
+            }
+        }
+        p_this_node->AddAppliedForceContribution(force_on_node);
+    }
+}
+
+template<unsigned DIM>
+void MatteoForce<DIM>::AddForcesByElement(VertexBasedCellPopulation<DIM>& rCellPopulation,
+                                          const VertexGeometryCache<DIM>& rGeometry,
+                                          const std::vector<double>& rTargetAreas,
+                                          double noiseScaling)
+{
+    MATTEO_PROFILE_SCOPE("MatteoForce::AddForcesByElement");
+
+    const std::vector<unsigned>& r_offsets = rGeometry.rGetElementOffsets();
+    const std::vector<unsigned>& r_node_indices = rGeometry.rGetElementNodeIndices();
+    const std::vector<unsigned>& r_next_node_indices = rGeometry.rGetNextNodeIndices();
+    const std::vector<double>& r_edge_lengths = rGeometry.rGetEdgeLengths();
+    unsigned num_slots = r_node_indices.size();
+    unsigned num_nodes = rCellPopulation.GetNumNodes();
+    if (num_slots == 0)
+    {
+        return;
+    }
+
+    /*
+     * First, a scalar pass over the slots of each element, working out the pressure
+     * K(A - A0) of the element and the total tension Gamma P + Lambda of the edge from
+     * each slot's node to the next. Both elements either side of an internal edge
+     * visit it, each with half the line tension, so every edge is visited once per
+     * element rather than twice per element as in the node-centric loop.
+     */
+    std::vector<double> slot_pressures(num_slots);
+    std::vector<double> slot_tensions(num_slots);
+    for (unsigned elem_index=0; elem_index+1<r_offsets.size(); elem_index++)
+    {
+        if (r_offsets[elem_index+1] == r_offsets[elem_index])
+        {
+            continue;
+        }
+        double pressure = this->GetAreaElasticityParameter()*(rGeometry.GetArea(elem_index) - rTargetAreas[elem_index]);
+        double perimeter_tension = this->GetPerimeterContractilityParameter()*rGeometry.GetPerimeter(elem_index);
+        for (unsigned slot=r_offsets[elem_index]; slot<r_offsets[elem_index+1]; slot++)
+        {
+            double line_tension = GetLineTensionParameter(elem_index,
+                                                          rCellPopulation.GetNode(r_node_indices[slot]),
+                                                          rCellPopulation.GetNode(r_next_node_indices[slot]),
+                                                          rCellPopulation);
+            mElementEnergies[elem_index] += line_tension*r_edge_lengths[slot];
+            slot_pressures[slot] = pressure;
+            slot_tensions[slot] = perimeter_tension + line_tension;
+        }
+    }
+
+    // Draw the random motion in the same order as the node-centric loop
+    std::vector<double> deviates;
+    if (noiseScaling > 0.0)
+    {
+        RandomNumberGenerator* p_gen = RandomNumberGenerator::Instance();
+        deviates.resize(DIM*num_nodes);
+        for (unsigned j=0; j<DIM*num_nodes; j++)
+        {
+            deviates[j] = p_gen->StandardNormalRandomDeviate();
+        }
+    }
+
+    /*
+     * Then, one component at a time, stream through the slot arrays computing the force
+     * each slot exerts on its own node and on the next node (branch-free, contiguous
+     * loops the compiler can vectorise), and scatter-add them into a contiguous force
+     * array. Each node's force is then written back to the node once.
+     */
+    std::vector<double> forces[DIM];
+    std::vector<double> own_forces(num_slots);
+    std::vector<double> next_forces(num_slots);
+    for (unsigned i=0; i<DIM; i++)
+    {
+        const double* p_area_gradients = &(rGeometry.rGetAreaGradients(i)[0]);
+        const double* p_edge_gradients = &(rGeometry.rGetEdgeGradients(i)[0]);
+        const double* p_pressures = &slot_pressures[0];
+        const double* p_tensions = &slot_tensions[0];
+        double* p_own_forces = &own_forces[0];
+        double* p_next_forces = &next_forces[0];
+        for (unsigned slot=0; slot<num_slots; slot++)
+        {
+            double edge_force = p_tensions[slot]*p_edge_gradients[slot];
+            p_own_forces[slot] = -p_pressures[slot]*p_area_gradients[slot] - edge_force;
+            p_next_forces[slot] = edge_force;
+        }
+
+        forces[i].assign(num_nodes, 0.0);
+        for (unsigned slot=0; slot<num_slots; slot++)
+        {
+            forces[i][r_node_indices[slot]] += own_forces[slot];
+            forces[i][r_next_node_indices[slot]] += next_forces[slot];
+        }
+
+        if (noiseScaling > 0.0)
+        {
+            for (unsigned node_index=0; node_index<num_nodes; node_index++)
+            {
+                forces[i][node_index] += noiseScaling*deviates[DIM*node_index + i];
+            }
+        }
+    }
+
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        c_vector<double, DIM> force_on_node;
+        for (unsigned i=0; i<DIM; i++)
+        {
+            force_on_node[i] = forces[i][node_index];
+        }
+        rCellPopulation.GetNode(node_index)->AddAppliedForceContribution(force_on_node);
+    }
+}
+
+template<unsigned DIM>
+double MatteoForce<DIM>::GetTotalEnergy()
+{
+    return mTotalEnergy;
+}
+
+template<unsigned DIM>
+const std::vector<double>& MatteoForce<DIM>::rGetElementEnergies()
+{
+    return mElementEnergies;
+}
+
+template<unsigned DIM>
+void MatteoForce<DIM>::SetMovementParameter(double movementParameter)
+{
+    assert(movementParameter >= 0.0);
+    mMovementParameter = movementParameter;
+}
+
+template<unsigned DIM>
+double MatteoForce<DIM>::GetMovementParameter()
+{
+    return mMovementParameter;
+}
+
+template<unsigned DIM>
+void MatteoForce<DIM>::SetApplyNoise(bool applyNoise)
+{
+    mApplyNoise = applyNoise;
+}
+
+template<unsigned DIM>
+void MatteoForce<DIM>::SetUseStructureOfArrays(bool useStructureOfArrays)
+{
+    mUseStructureOfArrays = useStructureOfArrays;
+}
 
 template<unsigned DIM>
 void MatteoForce<DIM>::OutputForceParameters(out_stream& rParamsFile)
 {
+    *rParamsFile << "\t\t\t<MovementParameter>" << mMovementParameter << "</MovementParameter>\n";
+
     // Call method on direct parent class
     FarhadifarForce<DIM>::OutputForceParameters(rParamsFile);
 }
@@ -7,18 +7,41 @@
 #include "Exception.hpp"
 
 #include "FarhadifarForce.hpp"
+#include "AbstractStochasticForce.hpp"
 #include "VertexBasedCellPopulation.hpp"
+#include "VertexGeometryCache.hpp"
 
 #include <iostream>
 
 /**
  * A force class for use in Vertex-based simulations. This force is based on the
  * Energy function proposed by Matteo et al in  Curr. Biol., 2007, 17, 2095-2104.
+ *
+ * As well as the forces, each call to AddForceContribution() evaluates the energy
+ * being minimised, from the same element areas, perimeters and edge tensions, so
+ * the energy of the configuration the forces were computed from is available
+ * from GetTotalEnergy() and rGetElementEnergies() at no extra traversal.
+ *
+ * If a movement parameter D has been set, the force also adds the same random
+ * motion as RandomMotionForce, sqrt(2 D dt)/dt times a standard normal deviate in
+ * each direction, in the same pass over the nodes, so that each node's force is
+ * written once. The deviates are drawn in the same order as RandomMotionForce draws
+ * them, so a MatteoForce with noise gives the same trajectories as a MatteoForce
+ * followed by a RandomMotionForce.
+ *
+ * By default the forces are accumulated node by node, as in FarhadifarForce. With
+ * SetUseStructureOfArrays(true) they are instead accumulated element by element:
+ * the per-slot geometry in the VertexGeometryCache is streamed through component by
+ * component in contiguous, branch-free loops, the results are scatter-added into
+ * contiguous force arrays, and each node's force is written back once. This visits
+ * each edge's line tension once per element rather than twice, and leaves the inner
+ * loops open to vectorisation, but sums the contributions in a different order, so
+ * results agree with the node-by-node loop only to rounding error.
  */
 
 
 template<unsigned DIM>
-class MatteoForce : public FarhadifarForce<DIM>
+class MatteoForce : public FarhadifarForce<DIM>, public AbstractStochasticForce
 {
 friend class TestForces;
 
@@ -36,8 +59,55 @@ private:
     void serialize(Archive & archive, const unsigned int version)
     {
         archive & boost::serialization::base_object<FarhadifarForce<DIM> >(*this);
+        archive & mMovementParameter;
+        archive & mUseStructureOfArrays;
     }
 
+    /** Diffusion coefficient of the random motion of the nodes; zero for none. Defaults to 0. */
+    double mMovementParameter;
+
+    /** Whether to add the random motion, if there is any. Cleared by numerical methods which draw it themselves. Not archived. */
+    bool mApplyNoise;
+
+    /** Whether to accumulate the forces element by element on flat arrays. Defaults to false. */
+    bool mUseStructureOfArrays;
+
+    /** The geometry of meshes which do not own a VertexGeometryCache, recomputed every call. Not archived. */
+    VertexGeometryCache<DIM> mGeometry;
+
+    /** The energy of each element, as of the last call to AddForceContribution(). */
+    std::vector<double> mElementEnergies;
+
+    /** The total energy of the tissue, as of the last call to AddForceContribution(). */
+    double mTotalEnergy;
+
+    /**
+     * Accumulate the forces on each node from the elements containing it, as in FarhadifarForce,
+     * and add the line tension terms of the element energies.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param rGeometry the up to date geometry of the mesh
+     * @param rTargetAreas the target area of each element
+     * @param noiseScaling the scaling of the random motion, or zero for none
+     */
+    void AddForcesByNode(VertexBasedCellPopulation<DIM>& rCellPopulation,
+                         const VertexGeometryCache<DIM>& rGeometry,
+                         const std::vector<double>& rTargetAreas,
+                         double noiseScaling);
+
+    /**
+     * Accumulate the forces element by element on flat arrays, and add the line tension
+     * terms of the element energies.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param rGeometry the up to date geometry of the mesh
+     * @param rTargetAreas the target area of each element
+     * @param noiseScaling the scaling of the random motion, or zero for none
+     */
+    void AddForcesByElement(VertexBasedCellPopulation<DIM>& rCellPopulation,
+                            const VertexGeometryCache<DIM>& rGeometry,
+                            const std::vector<double>& rTargetAreas,
+                            double noiseScaling);
 
 public:
 
@@ -62,6 +132,54 @@ public:
      */
     virtual double GetLineTensionParameter(unsigned elem_index, Node<DIM>* pNodeA, Node<DIM>* pNodeB, VertexBasedCellPopulation<DIM>& rVertexCellPopulation);
 
+    /**
+     * Overridden AddForceContribution() method.
+     *
+     * Computes the same forces as FarhadifarForce, and in the same sweep the energy
+     *   E_i = K/2 (A_i - A0_i)^2 + Gamma/2 P_i^2 + sum over the edges of i of Lambda_ij l_ij
+     * of each element i, where the line tension of internal edges is shared between
+     * the two elements either side.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void AddForceContribution(AbstractCellPopulation<DIM>& rCellPopulation);
+
+    /**
+     * @return the total energy of the tissue, as of the last call to AddForceContribution()
+     */
+    double GetTotalEnergy();
+
+    /**
+     * @return the energy of each element, indexed by element, as of the last call to AddForceContribution()
+     */
+    const std::vector<double>& rGetElementEnergies();
+
+    /**
+     * Set mMovementParameter.
+     *
+     * @param movementParameter diffusion coefficient of the random motion of the nodes, or zero for none
+     */
+    void SetMovementParameter(double movementParameter);
+
+    /**
+     * @return mMovementParameter
+     */
+    double GetMovementParameter();
+
+    /**
+     * Set whether the force adds its random motion.
+     *
+     * @param applyNoise whether to add the random motion
+     */
+    void SetApplyNoise(bool applyNoise);
+
+    /**
+     * Set mUseStructureOfArrays.
+     *
+     * @param useStructureOfArrays whether to accumulate the forces element by element on flat arrays
+     */
+    void SetUseStructureOfArrays(bool useStructureOfArrays);
+
     void OutputForceParameters(out_stream& rParamsFile);
 };
 
@@ -2,6 +2,7 @@
 #include "MatteoModifier.hpp"
 #include "RandomNumberGenerator.hpp"
 #include "CellLabel.hpp"
+#include "MatteoProfiler.hpp"
 #include "Debug.hpp"
 
 template<unsigned DIM>
@@ -27,6 +28,7 @@ void MatteoModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>&
         UpdateCellData(rCellPopulation);
 
         // Randomly pick one cell to divide
+        MATTEO_PROFILE_SCOPE("MatteoModifier::selection");
         std::map<CellPtr, double> map;
         double prev = rCellPopulation.Begin()->GetCellData()->GetItem("fitness");
         for (typename AbstractCellPopulation<DIM>::Iterator cell_iter = rCellPopulation.Begin();
@@ -82,6 +84,8 @@ void MatteoModifier<DIM>::UpdateCellData(AbstractCellPopulation<DIM,DIM>& rCellP
 double b = 10;
 double c = 5;
 double delta = 0.01;
+    MATTEO_PROFILE_SCOPE("MatteoModifier::UpdateCellData");
+
     // Iterate over cell population
     for (typename AbstractCellPopulation<DIM>::Iterator cell_iter = rCellPopulation.Begin();
          cell_iter != rCellPopulation.End();
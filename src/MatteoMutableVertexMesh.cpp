@@ -0,0 +1,452 @@
+
+#include "MatteoMutableVertexMesh.hpp"
+#include "MatteoProfiler.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <utility>
+
+/** Number of bits per coordinate of the Hilbert curve; the curve index fits in 32 bits. */
+static const unsigned HILBERT_ORDER = 15;
+
+/**
+ * Compute the distance along a Hilbert curve of a point on a square grid.
+ *
+ * @param x the column of the point
+ * @param y the row of the point
+ * @return the index of the point along the curve filling the 2^HILBERT_ORDER square
+ */
+static unsigned HilbertIndex(unsigned x, unsigned y)
+{
+    const unsigned n = 1u << HILBERT_ORDER;
+    unsigned index = 0;
+    for (unsigned s=n/2; s>0; s/=2)
+    {
+        unsigned rx = (x & s) > 0 ? 1 : 0;
+        unsigned ry = (y & s) > 0 ? 1 : 0;
+        index += s*s*((3*rx) ^ ry);
+
+        // Rotate the quadrant so that the curve within it has the standard orientation
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = n-1-x;
+                y = n-1-y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+template<unsigned DIM>
+unsigned long MatteoMutableVertexMesh<DIM>::msLastChangeStamp = 0;
+
+template<unsigned DIM>
+MatteoMutableVertexMesh<DIM>::MatteoMutableVertexMesh()
+    : MutableVertexMesh<DIM, DIM>(),
+      mRenumberingInterval(0),
+      mNumReMeshesSinceRenumbering(0),
+      mNumRenumberings(0),
+      mUseCandidateFiltering(false),
+      mFullCheckInterval(100),
+      mNumReMeshesSinceFullCheck(0),
+      mNumFullChecks(0),
+      mNumSkippedChecks(0),
+      mNumT1Swaps(0),
+      mNumT2Swaps(0),
+      mNumT3Swaps(0),
+      mChangeStamp(++msLastChangeStamp)
+{
+}
+
+template<unsigned DIM>
+MatteoMutableVertexMesh<DIM>::MatteoMutableVertexMesh(MutableVertexMesh<DIM, DIM>& rMesh)
+    : MutableVertexMesh<DIM, DIM>(),
+      mRenumberingInterval(0),
+      mNumReMeshesSinceRenumbering(0),
+      mNumRenumberings(0),
+      mUseCandidateFiltering(false),
+      mFullCheckInterval(100),
+      mNumReMeshesSinceFullCheck(0),
+      mNumFullChecks(0),
+      mNumSkippedChecks(0),
+      mNumT1Swaps(0),
+      mNumT2Swaps(0),
+      mNumT3Swaps(0),
+      mChangeStamp(++msLastChangeStamp)
+{
+    this->SetCellRearrangementThreshold(rMesh.GetCellRearrangementThreshold());
+    this->SetT2Threshold(rMesh.GetT2Threshold());
+    this->SetCellRearrangementRatio(rMesh.GetCellRearrangementRatio());
+    this->SetProtorosetteFormationProbability(rMesh.GetProtorosetteFormationProbability());
+    this->SetProtorosetteResolutionProbabilityPerTimestep(rMesh.GetProtorosetteResolutionProbabilityPerTimestep());
+    this->SetRosetteResolutionProbabilityPerTimestep(rMesh.GetRosetteResolutionProbabilityPerTimestep());
+    this->SetCheckForInternalIntersections(rMesh.GetCheckForInternalIntersections());
+    this->SetDistanceForT3SwapChecking(rMesh.GetDistanceForT3SwapChecking());
+
+    for (unsigned node_index=0; node_index<rMesh.GetNumNodes(); node_index++)
+    {
+        Node<DIM>* p_node = rMesh.GetNode(node_index);
+        this->mNodes.push_back(new Node<DIM>(node_index, p_node->rGetLocation(), p_node->IsBoundaryNode()));
+        if (p_node->IsBoundaryNode())
+        {
+            this->mBoundaryNodes.push_back(this->mNodes.back());
+        }
+    }
+
+    for (unsigned elem_index=0; elem_index<rMesh.GetNumElements(); elem_index++)
+    {
+        VertexElement<DIM, DIM>* p_element = rMesh.GetElement(elem_index);
+        std::vector<Node<DIM>*> element_nodes;
+        for (unsigned local_index=0; local_index<p_element->GetNumNodes(); local_index++)
+        {
+            element_nodes.push_back(this->mNodes[p_element->GetNodeGlobalIndex(local_index)]);
+        }
+        this->mElements.push_back(new VertexElement<DIM, DIM>(elem_index, element_nodes));
+    }
+}
+
+template<unsigned DIM>
+MatteoMutableVertexMesh<DIM>::MatteoMutableVertexMesh(std::vector<Node<DIM>*> nodes,
+                                                      std::vector<VertexElement<DIM, DIM>*> vertexElements)
+    : MutableVertexMesh<DIM, DIM>(nodes, vertexElements),
+      mRenumberingInterval(0),
+      mNumReMeshesSinceRenumbering(0),
+      mNumRenumberings(0),
+      mUseCandidateFiltering(false),
+      mFullCheckInterval(100),
+      mNumReMeshesSinceFullCheck(0),
+      mNumFullChecks(0),
+      mNumSkippedChecks(0),
+      mNumT1Swaps(0),
+      mNumT2Swaps(0),
+      mNumT3Swaps(0),
+      mChangeStamp(++msLastChangeStamp)
+{
+}
+
+template<unsigned DIM>
+MatteoMutableVertexMesh<DIM>::~MatteoMutableVertexMesh()
+{
+}
+
+template<unsigned DIM>
+void MatteoMutableVertexMesh<DIM>::ReMesh(VertexElementMap& rElementMap)
+{
+    MATTEO_PROFILE_SCOPE("MatteoMutableVertexMesh::ReMesh");
+
+    /*
+     * T2 swaps are carried out before ReMesh() by T2SwapCellKiller, and leave their triangle
+     * deleted with all three of its nodes merged into a new one. An element deleted with its
+     * cell keeps the nodes it shares with its neighbours, so is not counted.
+     */
+    for (unsigned i=0; i<this->mDeletedElementIndices.size(); i++)
+    {
+        VertexElement<DIM, DIM>* p_element = this->mElements[this->mDeletedElementIndices[i]];
+        if (p_element->GetNumNodes() == 3
+            && p_element->GetNode(0)->IsDeleted()
+            && p_element->GetNode(1)->IsDeleted()
+            && p_element->GetNode(2)->IsDeleted())
+        {
+            mNumT2Swaps++;
+        }
+    }
+
+    mRearrangementLog.RecordDivisions(*this);
+
+    if (mUseCandidateFiltering && CanSkipRearrangementCheck())
+    {
+        rElementMap.Resize(this->GetNumAllElements());
+        rElementMap.ResetToIdentity();
+        mNumReMeshesSinceFullCheck++;
+        mNumSkippedChecks++;
+    }
+    else
+    {
+        // T1 and T3 swaps each record their location as they are carried out
+        unsigned num_t1_locations = this->mLocationsOfT1Swaps.size();
+        unsigned num_t3_locations = this->mLocationsOfT3Swaps.size();
+        unsigned num_all_nodes = this->GetNumAllNodes();
+        unsigned num_all_elements = this->GetNumAllElements();
+        mRearrangementLog.NoteShortEdges(*this);
+
+        MutableVertexMesh<DIM, DIM>::ReMesh(rElementMap);
+        unsigned num_t1_swaps = this->mLocationsOfT1Swaps.size() - num_t1_locations;
+        unsigned num_t3_swaps = this->mLocationsOfT3Swaps.size() - num_t3_locations;
+        mNumT1Swaps += num_t1_swaps;
+        mNumT3Swaps += num_t3_swaps;
+        mRearrangementLog.RecordSwaps(*this, num_t1_swaps, num_t3_swaps, num_all_nodes, num_all_elements, rElementMap);
+
+        // Every other rearrangement adds or removes nodes, or removes elements
+        if (num_t1_swaps > 0 || num_t3_swaps > 0
+            || this->GetNumAllNodes() != num_all_nodes
+            || this->GetNumAllElements() != num_all_elements
+            || !rElementMap.IsIdentityMap())
+        {
+            MarkAsChanged();
+        }
+
+        mNumReMeshesSinceFullCheck = 0;
+        mNumFullChecks++;
+        mCandidateIndex.MarkOutOfDate();
+
+        if (mUseCandidateFiltering && DIM == 2)
+        {
+            mCandidateIndex.RecordBoundaryClearances(*this);
+        }
+    }
+
+    if (mRenumberingInterval > 0 && ++mNumReMeshesSinceRenumbering >= mRenumberingInterval)
+    {
+        // Wait for any deleted nodes or elements to be removed, so that indices are contiguous
+        if (this->GetNumAllElements() == this->GetNumElements() && this->GetNumAllNodes() == this->GetNumNodes())
+        {
+            RenumberAlongHilbertCurve(rElementMap);
+        }
+    }
+
+    if (mUseCandidateFiltering && mCandidateIndex.IsOutOfDate())
+    {
+        mCandidateIndex.Rebuild(*this);
+    }
+    mRearrangementLog.FinishReMesh(*this);
+}
+
+template<unsigned DIM>
+void MatteoMutableVertexMesh<DIM>::SetNode(unsigned nodeIndex, ChastePoint<DIM> point)
+{
+    MutableVertexMesh<DIM, DIM>::SetNode(nodeIndex, point);
+    MarkAsChanged();
+}
+
+template<unsigned DIM>
+void MatteoMutableVertexMesh<DIM>::MarkAsChanged()
+{
+    mChangeStamp = ++msLastChangeStamp;
+}
+
+template<unsigned DIM>
+unsigned long MatteoMutableVertexMesh<DIM>::GetChangeStamp() const
+{
+    return mChangeStamp;
+}
+
+template<unsigned DIM>
+VertexGeometryCache<DIM>& MatteoMutableVertexMesh<DIM>::rGetGeometryCache()
+{
+    return mGeometryCache;
+}
+
+template<unsigned DIM>
+const std::vector<unsigned>& MatteoMutableVertexMesh<DIM>::rGetRearrangedNodes() const
+{
+    return mRearrangementLog.rGetRearrangedNodes();
+}
+
+template<unsigned DIM>
+bool MatteoMutableVertexMesh<DIM>::HasUnrecordedRearrangements() const
+{
+    return mRearrangementLog.HasUnrecordedRearrangements();
+}
+
+template<unsigned DIM>
+void MatteoMutableVertexMesh<DIM>::ClearRearrangedNodes()
+{
+    mRearrangementLog.Clear(*this);
+}
+
+template<unsigned DIM>
+bool MatteoMutableVertexMesh<DIM>::CanSkipRearrangementCheck()
+{
+    if (this->GetCheckForInternalIntersections()
+        || (this->GetProtorosetteFormationProbability() > 0.0)
+        || (mFullCheckInterval > 0 && mNumReMeshesSinceFullCheck + 1 >= mFullCheckInterval))
+    {
+        return false;
+    }
+    return !mCandidateIndex.MayHaveRearrangements(*this);
+}
+
+template<unsigned DIM>
+void MatteoMutableVertexMesh<DIM>::Renumber(VertexElementMap& rElementMap)
+{
+    if (this->GetNumAllElements() != this->GetNumElements() || this->GetNumAllNodes() != this->GetNumNodes())
+    {
+        EXCEPTION("Cannot renumber a mesh containing deleted nodes or elements; call ReMesh() first");
+    }
+    rElementMap.Resize(this->GetNumElements());
+    rElementMap.ResetToIdentity();
+    RenumberAlongHilbertCurve(rElementMap);
+}
+
+template<unsigned DIM>
+void MatteoMutableVertexMesh<DIM>::RenumberAlongHilbertCurve(VertexElementMap& rElementMap)
+{
+    mNumReMeshesSinceRenumbering = 0;
+    if (DIM != 2)
+    {
+        return;
+    }
+
+    unsigned num_elements = this->GetNumElements();
+    unsigned num_nodes = this->GetNumNodes();
+    if (num_elements == 0)
+    {
+        return;
+    }
+
+    // Place the centroids on the Hilbert grid spanning their bounding box
+    std::vector<c_vector<double, DIM> > centroids(num_elements);
+    c_vector<double, DIM> lower = this->GetCentroidOfElement(0);
+    c_vector<double, DIM> upper = lower;
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        centroids[elem_index] = this->GetCentroidOfElement(elem_index);
+        for (unsigned i=0; i<DIM; i++)
+        {
+            lower[i] = std::min(lower[i], centroids[elem_index][i]);
+            upper[i] = std::max(upper[i], centroids[elem_index][i]);
+        }
+    }
+    double extent = std::max(std::max(upper[0] - lower[0], upper[1] - lower[1]), DBL_EPSILON);
+    double scale = ((1u << HILBERT_ORDER) - 1)/extent;
+
+    std::vector<std::pair<unsigned, unsigned> > curve_order(num_elements);
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        unsigned x = (unsigned)((centroids[elem_index][0] - lower[0])*scale);
+        unsigned y = (unsigned)((centroids[elem_index][1] - lower[1])*scale);
+        curve_order[elem_index] = std::make_pair(HilbertIndex(x, y), elem_index);
+    }
+    std::sort(curve_order.begin(), curve_order.end());
+
+    std::vector<unsigned> new_element_indices(num_elements);
+    std::vector<VertexElement<DIM, DIM>*> new_elements(num_elements);
+    for (unsigned k=0; k<num_elements; k++)
+    {
+        new_element_indices[curve_order[k].second] = k;
+        new_elements[k] = this->mElements[curve_order[k].second];
+    }
+
+    // Nodes are numbered in the order the renumbered elements first visit them
+    std::vector<unsigned> new_node_indices(num_nodes, UINT_MAX);
+    unsigned next_node_index = 0;
+    for (unsigned k=0; k<num_elements; k++)
+    {
+        for (unsigned local_index=0; local_index<new_elements[k]->GetNumNodes(); local_index++)
+        {
+            unsigned node_index = new_elements[k]->GetNodeGlobalIndex(local_index);
+            if (new_node_indices[node_index] == UINT_MAX)
+            {
+                new_node_indices[node_index] = next_node_index++;
+            }
+        }
+    }
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        if (new_node_indices[node_index] == UINT_MAX)
+        {
+            new_node_indices[node_index] = next_node_index++;
+        }
+    }
+
+    // Reset the element indices in two passes, so that no new index collides with an old one in a node's containing set
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        this->mElements[elem_index]->ResetIndex(num_elements + new_element_indices[elem_index]);
+    }
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        this->mElements[elem_index]->ResetIndex(new_element_indices[elem_index]);
+    }
+    this->mElements = new_elements;
+
+    std::vector<Node<DIM>*> new_nodes(num_nodes);
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        this->mNodes[node_index]->SetIndex(new_node_indices[node_index]);
+        new_nodes[new_node_indices[node_index]] = this->mNodes[node_index];
+    }
+    this->mNodes = new_nodes;
+
+    // Compose the renumbering with whatever the preceding ReMesh() did
+    for (unsigned old_index=0; old_index<rElementMap.Size(); old_index++)
+    {
+        if (!rElementMap.IsDeleted(old_index))
+        {
+            rElementMap.SetNewIndex(old_index, new_element_indices[rElementMap.GetNewIndex(old_index)]);
+        }
+    }
+
+    mNumRenumberings++;
+    mCandidateIndex.MarkOutOfDate();
+    mRearrangementLog.MarkUnrecorded();
+    MarkAsChanged();
+}
+
+template<unsigned DIM>
+void MatteoMutableVertexMesh<DIM>::SetRenumberingInterval(unsigned renumberingInterval)
+{
+    mRenumberingInterval = renumberingInterval;
+}
+
+template<unsigned DIM>
+unsigned MatteoMutableVertexMesh<DIM>::GetNumRenumberings() const
+{
+    return mNumRenumberings;
+}
+
+template<unsigned DIM>
+void MatteoMutableVertexMesh<DIM>::SetUseCandidateFiltering(bool useCandidateFiltering)
+{
+    mUseCandidateFiltering = useCandidateFiltering;
+    mCandidateIndex.MarkOutOfDate();
+}
+
+template<unsigned DIM>
+void MatteoMutableVertexMesh<DIM>::SetFullCheckInterval(unsigned fullCheckInterval)
+{
+    mFullCheckInterval = fullCheckInterval;
+}
+
+template<unsigned DIM>
+unsigned MatteoMutableVertexMesh<DIM>::GetNumFullChecks() const
+{
+    return mNumFullChecks;
+}
+
+template<unsigned DIM>
+unsigned MatteoMutableVertexMesh<DIM>::GetNumSkippedChecks() const
+{
+    return mNumSkippedChecks;
+}
+
+template<unsigned DIM>
+unsigned MatteoMutableVertexMesh<DIM>::GetNumT1Swaps() const
+{
+    return mNumT1Swaps;
+}
+
+template<unsigned DIM>
+unsigned MatteoMutableVertexMesh<DIM>::GetNumT2Swaps() const
+{
+    return mNumT2Swaps;
+}
+
+template<unsigned DIM>
+unsigned MatteoMutableVertexMesh<DIM>::GetNumT3Swaps() const
+{
+    return mNumT3Swaps;
+}
+
+// Explicit instantiation
+template class MatteoMutableVertexMesh<1>;
+template class MatteoMutableVertexMesh<2>;
+template class MatteoMutableVertexMesh<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(MatteoMutableVertexMesh)
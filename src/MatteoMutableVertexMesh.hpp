@@ -0,0 +1,260 @@
+
+#ifndef MATTEOMUTABLEVERTEXMESH_HPP_
+#define MATTEOMUTABLEVERTEXMESH_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include "MutableVertexMesh.hpp"
+#include "VertexGeometryCache.hpp"
+#include "VertexRearrangementCandidateIndex.hpp"
+#include "VertexRearrangementLog.hpp"
+
+/**
+ * A MutableVertexMesh which, every mRenumberingInterval calls to ReMesh(), renumbers
+ * its elements along a Hilbert curve through their centroids and its nodes in the
+ * order the renumbered elements first visit them, restoring the locality lost to T1
+ * swaps and divisions. The new element indices are composed into the VertexElementMap
+ * passed to ReMesh(), so that VertexBasedCellPopulation::Update() moves the cells.
+ * Renumbering is 2D only, and is postponed while the mesh holds deleted nodes or elements.
+ *
+ * With candidate filtering, ReMesh() skips the rearrangement checks whenever a
+ * VertexRearrangementCandidateIndex shows that none can be due. The mesh also counts its
+ * swaps, keeps a VertexRearrangementLog of the nodes they affect, and gives itself a new
+ * change stamp on every change made through SetNode() or ReMesh(), against which its
+ * VertexGeometryCache is validated; code which moves nodes directly must call MarkAsChanged().
+ */
+template<unsigned DIM>
+class MatteoMutableVertexMesh : public MutableVertexMesh<DIM, DIM>
+{
+private:
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<MutableVertexMesh<DIM, DIM> >(*this);
+        archive & mRenumberingInterval;
+        archive & mNumReMeshesSinceRenumbering;
+        archive & mNumRenumberings;
+        archive & mUseCandidateFiltering;
+        archive & mFullCheckInterval;
+        archive & mNumT1Swaps;
+        archive & mNumT2Swaps;
+        archive & mNumT3Swaps;
+    }
+
+    /** The mesh is renumbered every this many calls to ReMesh(); zero for never. Defaults to 0. */
+    unsigned mRenumberingInterval;
+
+    /** Number of calls to ReMesh() since the mesh was last renumbered. */
+    unsigned mNumReMeshesSinceRenumbering;
+
+    /** Number of times the mesh has been renumbered. */
+    unsigned mNumRenumberings;
+
+    /** Whether to skip the rearrangement checks when there are no candidates. Defaults to false. */
+    bool mUseCandidateFiltering;
+
+    /** The full rearrangement check runs at least every this many calls to ReMesh(); zero for no limit. Defaults to 100. */
+    unsigned mFullCheckInterval;
+
+    /** Number of calls to ReMesh() since the full rearrangement check last ran. */
+    unsigned mNumReMeshesSinceFullCheck;
+
+    /** Number of calls to ReMesh() which ran the full rearrangement check. */
+    unsigned mNumFullChecks;
+
+    /** Number of calls to ReMesh() which skipped the rearrangement check. */
+    unsigned mNumSkippedChecks;
+
+    /** Number of T1 swaps carried out since the mesh was created. */
+    unsigned mNumT1Swaps;
+
+    /** Number of T2 swaps whose elements have been removed since the mesh was created. */
+    unsigned mNumT2Swaps;
+
+    /** Number of T3 swaps carried out since the mesh was created. */
+    unsigned mNumT3Swaps;
+
+    /** The last change stamp handed out to any mesh of this dimension. */
+    static unsigned long msLastChangeStamp;
+
+    /** The change stamp of the current state of the mesh. */
+    unsigned long mChangeStamp;
+
+    /** The geometry of the mesh, shared by its consumers and validated by the change stamp. Not archived. */
+    VertexGeometryCache<DIM> mGeometryCache;
+
+    /** The index of the places where a rearrangement could next happen, used by candidate filtering. Not archived. */
+    VertexRearrangementCandidateIndex<DIM> mCandidateIndex;
+
+    /** The record of the nodes whose containing elements have changed. Not archived. */
+    VertexRearrangementLog<DIM> mRearrangementLog;
+
+    /**
+     * @return whether the candidate index shows that the full rearrangement check can be skipped
+     */
+    bool CanSkipRearrangementCheck();
+
+    /**
+     * Renumber the elements along a Hilbert curve and the nodes in order of first visit,
+     * composing the new element indices into an element map.
+     *
+     * @param rElementMap the element map from the preceding ReMesh()
+     */
+    void RenumberAlongHilbertCurve(VertexElementMap& rElementMap);
+
+public:
+
+    /**
+     * Default constructor, for archiving.
+     */
+    MatteoMutableVertexMesh();
+
+    /**
+     * Construct a deep copy of an existing mesh, such as one from HoneycombVertexMeshGenerator,
+     * with the same nodes, elements and rearrangement parameters.
+     *
+     * @param rMesh the mesh to copy
+     */
+    MatteoMutableVertexMesh(MutableVertexMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Construct a mesh from nodes and elements built elsewhere, such as by TissueFileReader,
+     * taking ownership of them. The rearrangement parameters take MutableVertexMesh's defaults.
+     *
+     * @param nodes the nodes, indexed from zero in order
+     * @param vertexElements the elements, indexed from zero in order
+     */
+    MatteoMutableVertexMesh(std::vector<Node<DIM>*> nodes, std::vector<VertexElement<DIM, DIM>*> vertexElements);
+
+    /**
+     * Destructor.
+     */
+    virtual ~MatteoMutableVertexMesh();
+
+    /** Bring the overload of ReMesh() without an element map into scope. */
+    using MutableVertexMesh<DIM, DIM>::ReMesh;
+
+    /**
+     * Overridden ReMesh() method. Carries out any rearrangements, unless candidate filtering
+     * shows there are none, then renumbers the mesh if it is due.
+     *
+     * @param rElementMap a VertexElementMap which associates the indices of VertexElements in the old mesh
+     *     with indices of VertexElements in the new mesh
+     */
+    virtual void ReMesh(VertexElementMap& rElementMap);
+
+    /**
+     * Overridden SetNode() method. Moves the node and gives the mesh a new change stamp.
+     *
+     * @param nodeIndex the index of the node to be moved
+     * @param point the new target location of the node
+     */
+    virtual void SetNode(unsigned nodeIndex, ChastePoint<DIM> point);
+
+    /**
+     * Give the mesh a new change stamp, after its nodes have been moved other than through SetNode().
+     */
+    void MarkAsChanged();
+
+    /**
+     * @return the change stamp of the current state of the mesh
+     */
+    unsigned long GetChangeStamp() const;
+
+    /**
+     * @return the cache of the geometry of the mesh; call VertexGeometryCache::Update() before reading it
+     */
+    VertexGeometryCache<DIM>& rGetGeometryCache();
+
+    /**
+     * @return the nodes whose containing elements have changed since ClearRearrangedNodes() was last
+     *     called, possibly repeated; complete only if HasUnrecordedRearrangements() is false
+     */
+    const std::vector<unsigned>& rGetRearrangedNodes() const;
+
+    /**
+     * @return whether the mesh has changed in a way not recorded by rGetRearrangedNodes() since
+     *     ClearRearrangedNodes() was last called, or has never been cleared; any stored indices are then stale
+     */
+    bool HasUnrecordedRearrangements() const;
+
+    /**
+     * Forget the recorded rearrangements, and record them from now on. The record has a single
+     * reader, which calls this once it has caught up with the mesh.
+     */
+    void ClearRearrangedNodes();
+
+    /**
+     * Renumber the mesh now, regardless of the interval.
+     *
+     * @param rElementMap an element map which will hold the new index of each element
+     */
+    void Renumber(VertexElementMap& rElementMap);
+
+    /**
+     * Set mRenumberingInterval.
+     *
+     * @param renumberingInterval renumber every this many calls to ReMesh(), or zero for never
+     */
+    void SetRenumberingInterval(unsigned renumberingInterval);
+
+    /**
+     * @return the number of times the mesh has been renumbered
+     */
+    unsigned GetNumRenumberings() const;
+
+    /**
+     * Set mUseCandidateFiltering.
+     *
+     * @param useCandidateFiltering whether to skip the rearrangement checks when there are no candidates
+     */
+    void SetUseCandidateFiltering(bool useCandidateFiltering);
+
+    /**
+     * Set mFullCheckInterval.
+     *
+     * @param fullCheckInterval run the full rearrangement check at least every this many calls to ReMesh(), or zero for no limit
+     */
+    void SetFullCheckInterval(unsigned fullCheckInterval);
+
+    /**
+     * @return the number of calls to ReMesh() which ran the full rearrangement check
+     */
+    unsigned GetNumFullChecks() const;
+
+    /**
+     * @return the number of calls to ReMesh() which skipped the rearrangement check
+     */
+    unsigned GetNumSkippedChecks() const;
+
+    /**
+     * @return the number of T1 swaps carried out since the mesh was created
+     */
+    unsigned GetNumT1Swaps() const;
+
+    /**
+     * @return the number of T2 swaps whose elements have been removed since the mesh was created
+     */
+    unsigned GetNumT2Swaps() const;
+
+    /**
+     * @return the number of T3 swaps carried out since the mesh was created
+     */
+    unsigned GetNumT3Swaps() const;
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(MatteoMutableVertexMesh)
+
+#endif /*MATTEOMUTABLEVERTEXMESH_HPP_*/
@@ -0,0 +1,220 @@
+
+#include "MatteoProfiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <time.h>
+#include "Warnings.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+MatteoProfiler* MatteoProfiler::mpInstance = NULL;
+
+MatteoProfiler::MatteoProfiler()
+    : mResetTime(GetWallTime())
+{
+    for (unsigned i=0; i<NUM_COUNTERS; i++)
+    {
+        mCounterFds[i] = -1;
+    }
+}
+
+MatteoProfiler* MatteoProfiler::Instance()
+{
+    if (mpInstance == NULL)
+    {
+        mpInstance = new MatteoProfiler;
+    }
+    return mpInstance;
+}
+
+void MatteoProfiler::Destroy()
+{
+    if (mpInstance != NULL)
+    {
+        mpInstance->DisableHardwareCounters();
+        delete mpInstance;
+        mpInstance = NULL;
+    }
+}
+
+double MatteoProfiler::GetWallTime()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + 1e-9*now.tv_nsec;
+}
+
+unsigned MatteoProfiler::GetTimerIndex(const std::string& rName)
+{
+    std::map<std::string, unsigned>::iterator iter = mIndices.find(rName);
+    if (iter != mIndices.end())
+    {
+        return iter->second;
+    }
+
+    unsigned index = mNames.size();
+    mIndices[rName] = index;
+    mNames.push_back(rName);
+    mNumCalls.push_back(0);
+    mTotalTimes.push_back(0.0);
+    mMaxTimes.push_back(0.0);
+    mCounterTotals.resize(NUM_COUNTERS*mNames.size(), 0);
+    return index;
+}
+
+void MatteoProfiler::Reset()
+{
+    std::fill(mNumCalls.begin(), mNumCalls.end(), 0);
+    std::fill(mTotalTimes.begin(), mTotalTimes.end(), 0.0);
+    std::fill(mMaxTimes.begin(), mMaxTimes.end(), 0.0);
+    std::fill(mCounterTotals.begin(), mCounterTotals.end(), 0);
+    mResetTime = GetWallTime();
+}
+
+unsigned long MatteoProfiler::GetNumCalls(const std::string& rName)
+{
+    std::map<std::string, unsigned>::iterator iter = mIndices.find(rName);
+    return (iter == mIndices.end()) ? 0 : mNumCalls[iter->second];
+}
+
+double MatteoProfiler::GetTotalTime(const std::string& rName)
+{
+    std::map<std::string, unsigned>::iterator iter = mIndices.find(rName);
+    return (iter == mIndices.end()) ? 0.0 : mTotalTimes[iter->second];
+}
+
+bool MatteoProfiler::EnableHardwareCounters()
+{
+    if (IsCountingHardwareEvents())
+    {
+        return true;
+    }
+
+#ifdef __linux__
+    // Every counter reads this process in user space only, which perf_event_paranoid
+    // allows up to level 2, and the counters form one group so that they are scheduled
+    // onto the hardware together and can be read with a single system call
+    const unsigned long long configs[NUM_COUNTERS] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES
+    };
+    for (unsigned i=0; i<NUM_COUNTERS; i++)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = configs[i];
+        attr.disabled = (i == 0) ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        mCounterFds[i] = syscall(__NR_perf_event_open, &attr, 0, -1, mCounterFds[0], 0);
+        if (mCounterFds[i] < 0)
+        {
+            DisableHardwareCounters();
+            WARNING("Hardware performance counters are not available (perf_event_open failed); only times will be profiled");
+            return false;
+        }
+    }
+    ioctl(mCounterFds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(mCounterFds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    return true;
+#else
+    WARNING("Hardware performance counters are only supported on Linux; only times will be profiled");
+    return false;
+#endif
+}
+
+void MatteoProfiler::DisableHardwareCounters()
+{
+#ifdef __linux__
+    for (unsigned i=0; i<NUM_COUNTERS; i++)
+    {
+        if (mCounterFds[i] >= 0)
+        {
+            close(mCounterFds[i]);
+        }
+        mCounterFds[i] = -1;
+    }
+#endif
+}
+
+void MatteoProfiler::ReadHardwareCounters(unsigned long long* pCounts)
+{
+#ifdef __linux__
+    // With PERF_FORMAT_GROUP the leader reads as the number of events followed by their values
+    unsigned long long buffer[1 + NUM_COUNTERS];
+    if (read(mCounterFds[0], buffer, sizeof(buffer)) == (ssize_t)sizeof(buffer))
+    {
+        memcpy(pCounts, buffer + 1, NUM_COUNTERS*sizeof(unsigned long long));
+        return;
+    }
+#endif
+    memset(pCounts, 0, NUM_COUNTERS*sizeof(unsigned long long));
+}
+
+unsigned long long MatteoProfiler::GetCounterTotal(const std::string& rName, Counter counter)
+{
+    std::map<std::string, unsigned>::iterator iter = mIndices.find(rName);
+    return (iter == mIndices.end()) ? 0 : mCounterTotals[NUM_COUNTERS*iter->second + counter];
+}
+
+void MatteoProfiler::WriteReport(std::ostream& rStream)
+{
+    double wall_time = GetWallTime() - mResetTime;
+
+    std::vector<std::pair<double, unsigned> > order;
+    bool any_counts = false;
+    for (unsigned index=0; index<mNames.size(); index++)
+    {
+        if (mNumCalls[index] > 0)
+        {
+            order.push_back(std::make_pair(-mTotalTimes[index], index));
+            any_counts = any_counts || (mCounterTotals[NUM_COUNTERS*index + CYCLES] > 0);
+        }
+    }
+    std::sort(order.begin(), order.end());
+
+    rStream << "# " << std::left << std::setw(48) << "timer" << std::right
+            << std::setw(12) << "calls" << std::setw(14) << "total (s)" << std::setw(14) << "mean (us)"
+            << std::setw(14) << "max (us)" << std::setw(10) << "% wall";
+    if (any_counts)
+    {
+        rStream << std::setw(8) << "IPC" << std::setw(14) << "cycles/call"
+                << std::setw(16) << "cache miss/call" << std::setw(16) << "branch miss/call";
+    }
+    rStream << "\n";
+    for (unsigned i=0; i<order.size(); i++)
+    {
+        unsigned index = order[i].second;
+        rStream << "  " << std::left << std::setw(48) << mNames[index] << std::right
+                << std::setw(12) << mNumCalls[index]
+                << std::setw(14) << std::setprecision(6) << mTotalTimes[index]
+                << std::setw(14) << 1e6*mTotalTimes[index]/mNumCalls[index]
+                << std::setw(14) << 1e6*mMaxTimes[index]
+                << std::setw(10) << std::setprecision(3) << 100.0*mTotalTimes[index]/wall_time;
+        if (any_counts)
+        {
+            const unsigned long long* p_counts = &mCounterTotals[NUM_COUNTERS*index];
+            double num_calls = mNumCalls[index];
+            rStream << std::setw(8) << std::setprecision(3) << (p_counts[CYCLES] > 0 ? double(p_counts[INSTRUCTIONS])/p_counts[CYCLES] : 0.0)
+                    << std::setw(14) << std::setprecision(6) << p_counts[CYCLES]/num_calls
+                    << std::setw(16) << p_counts[CACHE_MISSES]/num_calls
+                    << std::setw(16) << p_counts[BRANCH_MISSES]/num_calls;
+        }
+        rStream << "\n";
+    }
+    rStream << "# wall time since reset " << std::setprecision(6) << wall_time << " s\n";
+}
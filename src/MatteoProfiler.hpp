@@ -0,0 +1,276 @@
+
+#ifndef MATTEOPROFILER_HPP_
+#define MATTEOPROFILER_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <iostream>
+
+/**
+ * Named wall-clock timers for the project's hot paths.
+ *
+ * Each timer is registered once by name with GetTimerIndex(), and then accumulates
+ * the number of calls and the total and longest time of each call through AddTime(),
+ * usually from a MatteoScopedTimer. The profiler is a singleton, so that code anywhere
+ * in the project can add to it without it being passed around.
+ *
+ * The timers inside project classes (the SRN models, the mesh rearrangements, the
+ * geometry cache, the stages of MatteoForce) use the MATTEO_PROFILE_SCOPE macro, which
+ * compiles to nothing unless MATTEO_PROFILING is defined (the CMake option of the same
+ * name), so production builds pay nothing for them. ProfiledForce and
+ * ProfiledSimulationModifier time whole forces and modifiers in any build, and
+ * ProfileReportModifier writes the results to the simulation output directory.
+ *
+ * On Linux the profiler can also count hardware events with perf_event_open (see
+ * EnableHardwareCounters()): the cycles, instructions, cache misses and branch misses
+ * of each timed call are then accumulated alongside its time, and reported as
+ * instructions per cycle and misses per call. Reading the counters costs a system call
+ * at each end of every timed call, so they are off by default.
+ */
+class MatteoProfiler
+{
+public:
+
+    /** Number of hardware events counted: cycles, instructions, cache misses and branch misses. */
+    static const unsigned NUM_COUNTERS = 4;
+
+    /** Indices of the hardware events in the counter arrays. */
+    enum Counter
+    {
+        CYCLES = 0,
+        INSTRUCTIONS,
+        CACHE_MISSES,
+        BRANCH_MISSES
+    };
+
+private:
+
+    /** The single instance of the profiler. */
+    static MatteoProfiler* mpInstance;
+
+    /** Index of each timer by name. */
+    std::map<std::string, unsigned> mIndices;
+
+    /** The name of each timer. */
+    std::vector<std::string> mNames;
+
+    /** The number of calls timed by each timer since the last reset. */
+    std::vector<unsigned long> mNumCalls;
+
+    /** The total time, in seconds, of the calls timed by each timer since the last reset. */
+    std::vector<double> mTotalTimes;
+
+    /** The longest call, in seconds, timed by each timer since the last reset. */
+    std::vector<double> mMaxTimes;
+
+    /** The hardware events counted during the calls timed by each timer, NUM_COUNTERS per timer. */
+    std::vector<unsigned long long> mCounterTotals;
+
+    /** The wall time of the last reset. */
+    double mResetTime;
+
+    /** File descriptors of the perf event group, the leader first, or -1 when not counting. */
+    int mCounterFds[NUM_COUNTERS];
+
+    /**
+     * Default constructor. Use Instance() instead.
+     */
+    MatteoProfiler();
+
+public:
+
+    /**
+     * @return the single instance of the profiler
+     */
+    static MatteoProfiler* Instance();
+
+    /**
+     * Destroy the single instance of the profiler, closing any hardware counters. Only for
+     * use at exit, as the timer indices held by MATTEO_PROFILE_SCOPE would not be valid for
+     * a new instance.
+     */
+    static void Destroy();
+
+    /**
+     * @return the current wall-clock time in seconds, from a monotonic clock
+     */
+    static double GetWallTime();
+
+    /**
+     * Register a timer, if it is not already registered.
+     *
+     * @param rName the name of the timer
+     * @return the index of the timer, to pass to AddTime()
+     */
+    unsigned GetTimerIndex(const std::string& rName);
+
+    /**
+     * Record a timed call.
+     *
+     * @param timerIndex the index of the timer
+     * @param seconds the duration of the call
+     * @param pCounts the hardware events counted during the call, NUM_COUNTERS of them, or NULL if not counted
+     */
+    void AddTime(unsigned timerIndex, double seconds, const unsigned long long* pCounts=NULL)
+    {
+        mNumCalls[timerIndex]++;
+        mTotalTimes[timerIndex] += seconds;
+        if (seconds > mMaxTimes[timerIndex])
+        {
+            mMaxTimes[timerIndex] = seconds;
+        }
+        if (pCounts != NULL)
+        {
+            for (unsigned i=0; i<NUM_COUNTERS; i++)
+            {
+                mCounterTotals[NUM_COUNTERS*timerIndex + i] += pCounts[i];
+            }
+        }
+    }
+
+    /**
+     * Start counting hardware events for this process with perf_event_open. Fails, with
+     * a warning, on systems other than Linux, when the CPU or virtual machine has no
+     * performance counters, or when /proc/sys/kernel/perf_event_paranoid forbids them.
+     *
+     * @return whether the counters are now enabled
+     */
+    bool EnableHardwareCounters();
+
+    /**
+     * Stop counting hardware events and close the counters.
+     */
+    void DisableHardwareCounters();
+
+    /**
+     * @return whether hardware events are being counted
+     */
+    bool IsCountingHardwareEvents() const
+    {
+        return mCounterFds[0] >= 0;
+    }
+
+    /**
+     * Read the running totals of the hardware events. Must only be called while counting.
+     *
+     * @param pCounts array of NUM_COUNTERS values to fill in
+     */
+    void ReadHardwareCounters(unsigned long long* pCounts);
+
+    /**
+     * Zero every timer, keeping the registrations so that stored indices stay valid.
+     */
+    void Reset();
+
+    /**
+     * @param rName the name of a timer
+     * @return the number of calls timed by the timer since the last reset, or zero if it is not registered
+     */
+    unsigned long GetNumCalls(const std::string& rName);
+
+    /**
+     * @param rName the name of a timer
+     * @return the total time in seconds timed by the timer since the last reset, or zero if it is not registered
+     */
+    double GetTotalTime(const std::string& rName);
+
+    /**
+     * @param rName the name of a timer
+     * @param counter the hardware event
+     * @return the number of the events counted during the calls timed by the timer since the last reset
+     */
+    unsigned long long GetCounterTotal(const std::string& rName, Counter counter);
+
+    /**
+     * Write a table of every timer that has been called since the last reset, longest
+     * total first, with its calls, total, mean and longest call, and its share of the
+     * wall time since the reset. If any hardware events were counted, the instructions
+     * per cycle and the cycles, cache misses and branch misses per call follow.
+     *
+     * @param rStream the stream to write to
+     */
+    void WriteReport(std::ostream& rStream);
+};
+
+/**
+ * Adds the time between its construction and destruction to a MatteoProfiler timer.
+ */
+class MatteoScopedTimer
+{
+private:
+
+    /** The index of the timer. */
+    unsigned mTimerIndex;
+
+    /** The wall time at construction. */
+    double mStartTime;
+
+    /** Whether hardware events are being counted for this call. */
+    bool mCounting;
+
+    /** The hardware event counts at construction, if counting. */
+    unsigned long long mStartCounts[MatteoProfiler::NUM_COUNTERS];
+
+public:
+
+    /**
+     * Constructor. Starts timing.
+     *
+     * @param timerIndex the index of the timer, from MatteoProfiler::GetTimerIndex()
+     */
+    MatteoScopedTimer(unsigned timerIndex)
+        : mTimerIndex(timerIndex),
+          mCounting(MatteoProfiler::Instance()->IsCountingHardwareEvents())
+    {
+        if (mCounting)
+        {
+            MatteoProfiler::Instance()->ReadHardwareCounters(mStartCounts);
+        }
+        mStartTime = MatteoProfiler::GetWallTime();
+    }
+
+    /**
+     * Destructor. Records the time, and any hardware events, since construction.
+     */
+    ~MatteoScopedTimer()
+    {
+        double seconds = MatteoProfiler::GetWallTime() - mStartTime;
+        MatteoProfiler* p_profiler = MatteoProfiler::Instance();
+        if (mCounting && p_profiler->IsCountingHardwareEvents())
+        {
+            unsigned long long counts[MatteoProfiler::NUM_COUNTERS];
+            p_profiler->ReadHardwareCounters(counts);
+            for (unsigned i=0; i<MatteoProfiler::NUM_COUNTERS; i++)
+            {
+                counts[i] -= mStartCounts[i];
+            }
+            p_profiler->AddTime(mTimerIndex, seconds, counts);
+        }
+        else
+        {
+            p_profiler->AddTime(mTimerIndex, seconds);
+        }
+    }
+};
+
+/** Helpers for pasting the line number into the names of the MATTEO_PROFILE_SCOPE variables. */
+#define MATTEO_PROFILE_CONCAT_INNER(a, b) a ## b
+/** Helpers for pasting the line number into the names of the MATTEO_PROFILE_SCOPE variables. */
+#define MATTEO_PROFILE_CONCAT(a, b) MATTEO_PROFILE_CONCAT_INNER(a, b)
+
+#ifdef MATTEO_PROFILING
+/**
+ * Time the rest of the enclosing scope with the MatteoProfiler timer of the given name.
+ * The timer is looked up once, on first use. Compiles to nothing unless MATTEO_PROFILING
+ * is defined.
+ */
+#define MATTEO_PROFILE_SCOPE(name) \
+    static const unsigned MATTEO_PROFILE_CONCAT(matteo_timer_index_, __LINE__) = MatteoProfiler::Instance()->GetTimerIndex(name); \
+    MatteoScopedTimer MATTEO_PROFILE_CONCAT(matteo_scoped_timer_, __LINE__)(MATTEO_PROFILE_CONCAT(matteo_timer_index_, __LINE__))
+#else
+/** Compiles to nothing, as MATTEO_PROFILING is not defined. */
+#define MATTEO_PROFILE_SCOPE(name)
+#endif
+
+#endif /*MATTEOPROFILER_HPP_*/
@@ -34,24 +34,26 @@ OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
 #include "MatteoSrnModel.hpp"
+#include "MatteoProfiler.hpp"
 
 MatteoSrnModel::MatteoSrnModel(boost::shared_ptr<AbstractCellCycleModelOdeSolver> pOdeSolver)
     : AbstractOdeSrnModel(2, pOdeSolver)
 {
+    /*
+     * The solver is shared by every cell, and is only set up on the first call to
+     * SimulateToCurrentTime(), so that constructing the models of a large tissue
+     * costs no more than taking a reference to it.
+     */
     if (mpOdeSolver == boost::shared_ptr<AbstractCellCycleModelOdeSolver>())
     {
 #ifdef CHASTE_CVODE
         mpOdeSolver = CellCycleModelOdeSolver<MatteoSrnModel, CvodeAdaptor>::Instance();
-        mpOdeSolver->Initialise();
-        mpOdeSolver->SetMaxSteps(10000);
 #else
 #error "use a real ode solver"	
         mpOdeSolver = CellCycleModelOdeSolver<MatteoSrnModel, RungeKutta4IvpOdeSolver>::Instance();
-        mpOdeSolver->Initialise();
         SetDt(0.001);
 #endif //CHASTE_CVODE
     }
-    assert(mpOdeSolver->IsSetUp());
 }
 
 MatteoSrnModel::MatteoSrnModel(const MatteoSrnModel& rModel)
@@ -70,10 +72,15 @@ MatteoSrnModel::MatteoSrnModel(const MatteoSrnModel& rModel)
      *
      * Note 3: Only set the variables defined in this class. Variables defined
      * in parent classes will be defined there.
+     *
+     * A daughter needs its own ODE system, holding the parent's levels, but copies of a
+     * model that has not been initialised yet (for example a prototype copied for every
+     * cell of a tissue) are left without one, and Initialise() creates it.
      */
-
-    assert(rModel.GetOdeSystem());
-    SetOdeSystem(new DeltaNotchOdeSystem(rModel.GetOdeSystem()->rGetStateVariables()));
+    if (rModel.GetOdeSystem())
+    {
+        SetOdeSystem(new DeltaNotchOdeSystem(rModel.GetOdeSystem()->rGetStateVariables()));
+    }
 }
 
 AbstractSrnModel* MatteoSrnModel::CreateSrnModel()
@@ -83,6 +90,13 @@ AbstractSrnModel* MatteoSrnModel::CreateSrnModel()
 
 void MatteoSrnModel::SimulateToCurrentTime()
 {
+    MATTEO_PROFILE_SCOPE("MatteoSrnModel::SimulateToCurrentTime");
+
+    if (!mpOdeSolver->IsSetUp())
+    {
+        SetUpOdeSolver();
+    }
+
     // Custom behaviour
     UpdateMatteo();
 
@@ -90,6 +104,15 @@ void MatteoSrnModel::SimulateToCurrentTime()
     AbstractOdeSrnModel::SimulateToCurrentTime();
 }
 
+void MatteoSrnModel::SetUpOdeSolver()
+{
+    mpOdeSolver->Initialise();
+    if (mpOdeSolver->IsAdaptive())
+    {
+        mpOdeSolver->SetMaxSteps(10000);
+    }
+}
+
 void MatteoSrnModel::Initialise()
 {
     AbstractOdeSrnModel::Initialise(new DeltaNotchOdeSystem);
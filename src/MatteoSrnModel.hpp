@@ -65,6 +65,12 @@ private:
         archive & boost::serialization::base_object<AbstractOdeSrnModel>(*this);
     }
 
+    /**
+     * Set up the ODE solver, which is shared between cells, on its first use. For CVODE
+     * this also raises the maximum number of internal steps to 10000.
+     */
+    void SetUpOdeSolver();
+
 protected:
     /**
      * Protected copy-constructor for use by CreateSrnModel.  The only way for external code to create a copy of a SRN model
@@ -107,7 +113,8 @@ public:
     /**
      * Overridden SimulateToTime() method for custom behaviour.
      *
-     * \todo #2752 say what it does in this class
+     * Sets up the ODE solver if this is its first use, passes the current mean
+     * neighbouring Delta to the ODE system, and solves it up to the current time.
      */
     void SimulateToCurrentTime();
 
@@ -0,0 +1,311 @@
+
+#include "MemoryReportModifier.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include "VertexBasedCellPopulation.hpp"
+#include "MatteoMutableVertexMesh.hpp"
+#include "MatteoCellCycleModel.hpp"
+#include "NoCellCycleModel.hpp"
+#include "MatteoSrnModel.hpp"
+#include "DeltaNotchOdeSystem.hpp"
+#include "NodeAttributes.hpp"
+#include "OutputFileHandler.hpp"
+
+/** Bytes taken by the links and colour of a node of a std::map or std::set. */
+static const std::size_t TREE_NODE_OVERHEAD = 4*sizeof(void*);
+
+/** Bytes taken by the control block of a boost::shared_ptr created from a raw pointer. */
+static const std::size_t SHARED_PTR_CONTROL_BLOCK = 3*sizeof(void*);
+
+/**
+ * @param size the number of bytes requested
+ * @return an estimate of the bytes taken by a heap allocation of that size, including malloc's overhead
+ */
+static double GetHeapBytes(std::size_t size)
+{
+    // glibc adds a size word to each chunk and rounds up to 16 bytes, with a minimum chunk of 32
+    std::size_t chunk = (size + sizeof(std::size_t) + 15) & ~std::size_t(15);
+    return (chunk < 32) ? 32.0 : double(chunk);
+}
+
+/**
+ * @param rString a string
+ * @return an estimate of the heap bytes held by the string
+ */
+static double GetStringHeapBytes(const std::string& rString)
+{
+#if defined(_GLIBCXX_USE_CXX11_ABI) && _GLIBCXX_USE_CXX11_ABI
+    // Short strings are stored within the string object
+    return (rString.size() > 15) ? GetHeapBytes(rString.size() + 1) : 0.0;
+#else
+    // Reference-counted strings always allocate a header and the characters
+    return GetHeapBytes(3*sizeof(std::size_t) + rString.size() + 1);
+#endif
+}
+
+template<unsigned DIM>
+MemoryReportModifier<DIM>::MemoryReportModifier()
+    : AbstractCellBasedSimulationModifier<DIM>(),
+      mReportInterval(0),
+      mPeakEstimatedBytes(0.0)
+{
+}
+
+template<unsigned DIM>
+MemoryReportModifier<DIM>::~MemoryReportModifier()
+{
+}
+
+template<unsigned DIM>
+double MemoryReportModifier<DIM>::ReadProcessMemory(const std::string& rField)
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, rField.size() + 1, rField + ":") == 0)
+        {
+            std::istringstream value(line.substr(rField.size() + 1));
+            double kilobytes = 0.0;
+            value >> kilobytes;
+            return 1024.0*kilobytes;
+        }
+    }
+    return 0.0;
+}
+
+template<unsigned DIM>
+void MemoryReportModifier<DIM>::EstimateMemoryUsage(AbstractCellPopulation<DIM,DIM>& rCellPopulation,
+                                                    std::vector<std::string>& rNames,
+                                                    std::vector<double>& rBytes)
+{
+    double cell_bytes = 0.0;
+    double cell_data_bytes = 0.0;
+    double cell_cycle_bytes = 0.0;
+    double srn_bytes = 0.0;
+    unsigned num_cells = 0;
+
+    for (typename AbstractCellPopulation<DIM,DIM>::Iterator cell_iter = rCellPopulation.Begin();
+         cell_iter != rCellPopulation.End();
+         ++cell_iter)
+    {
+        num_cells++;
+
+        // The cell, the control block of its CellPtr and the set of its properties
+        cell_bytes += GetHeapBytes(sizeof(Cell)) + GetHeapBytes(SHARED_PTR_CONTROL_BLOCK);
+        cell_bytes += cell_iter->rGetCellPropertyCollection().GetSize()
+                      *GetHeapBytes(TREE_NODE_OVERHEAD + sizeof(boost::shared_ptr<AbstractCellProperty>));
+
+        // The CellData property, which each cell owns, and its map of items
+        boost::shared_ptr<CellData> p_cell_data = cell_iter->GetCellData();
+        cell_data_bytes += GetHeapBytes(sizeof(CellData)) + GetHeapBytes(SHARED_PTR_CONTROL_BLOCK);
+        std::vector<std::string> keys = p_cell_data->GetKeys();
+        for (unsigned i=0; i<keys.size(); i++)
+        {
+            cell_data_bytes += GetHeapBytes(TREE_NODE_OVERHEAD + sizeof(std::pair<const std::string, double>))
+                               + GetStringHeapBytes(keys[i]);
+        }
+
+        AbstractCellCycleModel* p_cell_cycle_model = cell_iter->GetCellCycleModel();
+        if (dynamic_cast<MatteoCellCycleModel*>(p_cell_cycle_model))
+        {
+            cell_cycle_bytes += GetHeapBytes(sizeof(MatteoCellCycleModel));
+        }
+        else if (dynamic_cast<NoCellCycleModel*>(p_cell_cycle_model))
+        {
+            cell_cycle_bytes += GetHeapBytes(sizeof(NoCellCycleModel));
+        }
+        else
+        {
+            cell_cycle_bytes += GetHeapBytes(sizeof(AbstractCellCycleModel));
+        }
+
+        AbstractSrnModel* p_srn_model = cell_iter->GetSrnModel();
+        AbstractOdeSrnModel* p_ode_srn_model = dynamic_cast<AbstractOdeSrnModel*>(p_srn_model);
+        if (dynamic_cast<MatteoSrnModel*>(p_srn_model))
+        {
+            srn_bytes += GetHeapBytes(sizeof(MatteoSrnModel));
+        }
+        else if (p_ode_srn_model)
+        {
+            srn_bytes += GetHeapBytes(sizeof(AbstractOdeSrnModel));
+        }
+        else
+        {
+            srn_bytes += GetHeapBytes(sizeof(AbstractSrnModel));
+        }
+        if (p_ode_srn_model && p_ode_srn_model->GetOdeSystem())
+        {
+            AbstractOdeSystem* p_ode_system = p_ode_srn_model->GetOdeSystem();
+            srn_bytes += GetHeapBytes(dynamic_cast<DeltaNotchOdeSystem*>(p_ode_system) ? sizeof(DeltaNotchOdeSystem) : sizeof(AbstractOdeSystem));
+
+            // The state variables of the system and the initial conditions kept by the model
+            srn_bytes += 2.0*GetHeapBytes(sizeof(double)*p_ode_system->GetNumberOfStateVariables());
+            if (p_ode_system->GetNumberOfParameters() > 0)
+            {
+                srn_bytes += GetHeapBytes(sizeof(double)*p_ode_system->GetNumberOfParameters());
+            }
+        }
+    }
+
+    rNames.clear();
+    rBytes.clear();
+    rNames.push_back("cells");
+    rBytes.push_back(cell_bytes);
+    rNames.push_back("cell data");
+    rBytes.push_back(cell_data_bytes);
+    rNames.push_back("cell-cycle models");
+    rBytes.push_back(cell_cycle_bytes);
+    rNames.push_back("SRN models and ODE systems");
+    rBytes.push_back(srn_bytes);
+
+    VertexBasedCellPopulation<DIM>* p_vertex_population = dynamic_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation);
+    if (p_vertex_population)
+    {
+        MutableVertexMesh<DIM,DIM>& r_mesh = p_vertex_population->rGetMesh();
+
+        double node_bytes = 0.0;
+        for (unsigned node_index=0; node_index<r_mesh.GetNumAllNodes(); node_index++)
+        {
+            Node<DIM>* p_node = r_mesh.GetNode(node_index);
+            node_bytes += sizeof(Node<DIM>*) + GetHeapBytes(sizeof(Node<DIM>));
+            node_bytes += p_node->GetNumContainingElements()*GetHeapBytes(TREE_NODE_OVERHEAD + sizeof(unsigned));
+            if (p_node->HasNodeAttributes())
+            {
+                node_bytes += GetHeapBytes(sizeof(NodeAttributes<DIM>));
+            }
+        }
+
+        double element_bytes = 0.0;
+        for (unsigned elem_index=0; elem_index<r_mesh.GetNumAllElements(); elem_index++)
+        {
+            VertexElement<DIM,DIM>* p_element = r_mesh.GetElement(elem_index);
+            element_bytes += sizeof(VertexElement<DIM,DIM>*) + GetHeapBytes(sizeof(VertexElement<DIM,DIM>));
+            element_bytes += GetHeapBytes(sizeof(Node<DIM>*)*p_element->GetNumNodes());
+        }
+
+        rNames.push_back("mesh nodes");
+        rBytes.push_back(node_bytes);
+        rNames.push_back("mesh elements");
+        rBytes.push_back(element_bytes);
+    }
+
+    // The population's list of cells and its maps from cells to locations and back
+    double map_bytes = num_cells*(GetHeapBytes(2*sizeof(void*) + sizeof(CellPtr))
+                                  + GetHeapBytes(TREE_NODE_OVERHEAD + sizeof(std::pair<Cell* const, unsigned>))
+                                  + GetHeapBytes(TREE_NODE_OVERHEAD + sizeof(std::pair<const unsigned, std::set<CellPtr> >))
+                                  + GetHeapBytes(TREE_NODE_OVERHEAD + sizeof(CellPtr)));
+    rNames.push_back("population maps");
+    rBytes.push_back(map_bytes);
+
+    // Only a MatteoMutableVertexMesh keeps its geometry between time steps
+    double geometry_bytes = 0.0;
+    MatteoMutableVertexMesh<DIM>* p_matteo_mesh = p_vertex_population ? dynamic_cast<MatteoMutableVertexMesh<DIM>*>(&(p_vertex_population->rGetMesh())) : NULL;
+    if (p_matteo_mesh)
+    {
+        geometry_bytes = p_matteo_mesh->rGetGeometryCache().GetMemoryUsage();
+    }
+    rNames.push_back("geometry cache");
+    rBytes.push_back(geometry_bytes);
+}
+
+template<unsigned DIM>
+void MemoryReportModifier<DIM>::WriteReport(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    std::vector<std::string> names;
+    std::vector<double> bytes;
+    EstimateMemoryUsage(rCellPopulation, names, bytes);
+
+    unsigned num_cells = rCellPopulation.GetNumRealCells();
+    double per_cell = (num_cells > 0) ? 1.0/num_cells : 0.0;
+
+    std::ios_base::fmtflags flags = mpReportFile->flags();
+    std::streamsize precision = mpReportFile->precision();
+    *mpReportFile << "# time " << SimulationTime::Instance()->GetTime() << " cells " << num_cells << "\n";
+    double total = 0.0;
+    for (unsigned i=0; i<names.size(); i++)
+    {
+        total += bytes[i];
+        *mpReportFile << "  " << std::left << std::setw(32) << names[i] << std::right
+                      << std::setw(16) << std::fixed << std::setprecision(0) << bytes[i]
+                      << std::setw(12) << std::setprecision(1) << bytes[i]*per_cell << "\n";
+    }
+    mPeakEstimatedBytes = std::max(mPeakEstimatedBytes, total);
+
+    double resident = ReadProcessMemory("VmRSS");
+    *mpReportFile << "  " << std::left << std::setw(32) << "estimated total" << std::right
+                  << std::setw(16) << std::setprecision(0) << total << std::setw(12) << std::setprecision(1) << total*per_cell << "\n"
+                  << "  " << std::left << std::setw(32) << "resident set size (VmRSS)" << std::right
+                  << std::setw(16) << std::setprecision(0) << resident << std::setw(12) << std::setprecision(1) << resident*per_cell << "\n"
+                  << "  " << std::left << std::setw(32) << "high-water mark (VmHWM)" << std::right
+                  << std::setw(16) << std::setprecision(0) << ReadProcessMemory("VmHWM") << "\n";
+    mpReportFile->flags(flags);
+    mpReportFile->precision(precision);
+    mpReportFile->flush();
+}
+
+template<unsigned DIM>
+void MemoryReportModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    OutputFileHandler output_file_handler(outputDirectory + "/", false);
+    mpReportFile = output_file_handler.OpenOutputFile("memory.dat");
+    *mpReportFile << "# Estimated memory by component: bytes, bytes per cell\n";
+    mPeakEstimatedBytes = 0.0;
+    WriteReport(rCellPopulation);
+}
+
+template<unsigned DIM>
+void MemoryReportModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (mReportInterval > 0 && SimulationTime::Instance()->GetTimeStepsElapsed()%mReportInterval == 0)
+    {
+        WriteReport(rCellPopulation);
+    }
+}
+
+template<unsigned DIM>
+void MemoryReportModifier<DIM>::UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    WriteReport(rCellPopulation);
+    *mpReportFile << "# peak estimated total " << std::fixed << std::setprecision(0) << mPeakEstimatedBytes
+                  << ", peak resident set size " << ReadProcessMemory("VmHWM") << "\n";
+    mpReportFile->close();
+}
+
+template<unsigned DIM>
+double MemoryReportModifier<DIM>::GetPeakEstimatedBytes()
+{
+    return mPeakEstimatedBytes;
+}
+
+template<unsigned DIM>
+unsigned MemoryReportModifier<DIM>::GetReportInterval()
+{
+    return mReportInterval;
+}
+
+template<unsigned DIM>
+void MemoryReportModifier<DIM>::SetReportInterval(unsigned reportInterval)
+{
+    mReportInterval = reportInterval;
+}
+
+template<unsigned DIM>
+void MemoryReportModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<ReportInterval>" << mReportInterval << "</ReportInterval>\n";
+
+    // Call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class MemoryReportModifier<1>;
+template class MemoryReportModifier<2>;
+template class MemoryReportModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(MemoryReportModifier)
@@ -0,0 +1,164 @@
+
+#ifndef MEMORYREPORTMODIFIER_HPP_
+#define MEMORYREPORTMODIFIER_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include <string>
+#include <vector>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+
+/**
+ * A modifier class which reports how much memory a simulation uses, by component
+ * and per cell, to memory.dat in the simulation output directory.
+ *
+ * A report is written when the simulation is set up, every mReportInterval time
+ * steps (if non-zero; set it to the sampling timestep multiple to report at the
+ * sampling times) and at the end of the solve. Each report lists the estimated
+ * bytes in total and per cell of:
+ *  - the Cell objects with their property collections;
+ *  - their CellData items;
+ *  - the cell-cycle models;
+ *  - the SRN models with their ODE systems;
+ *  - the nodes and elements of the mesh, for vertex-based populations;
+ *  - the maps between cells and locations kept by the population;
+ *  - the project's VertexGeometryCache;
+ * followed by the resident set size and its high-water mark from /proc/self/status.
+ * The difference between the resident set size and the estimated total covers
+ * everything else: the ODE solvers and their CVODE workspaces (which are shared by
+ * all cells), the writers, PETSc and the other libraries.
+ *
+ * The estimates are computed from the sizes of the objects and the numbers of items
+ * in their containers, with each heap allocation rounded up as glibc's malloc does,
+ * so they do not need any allocator hooks. Objects whose type is not known to the
+ * modifier, such as cell-cycle models other than the project's, are counted at the
+ * size of their base class.
+ */
+template<unsigned DIM>
+class MemoryReportModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+private:
+
+    /** A report is written every this many time steps, or only at the start and end if zero. Defaults to 0. */
+    unsigned mReportInterval;
+
+    /** The report file, open between SetupSolve() and UpdateAtEndOfSolve(). */
+    out_stream mpReportFile;
+
+    /** The largest estimated total reported so far, in bytes. */
+    double mPeakEstimatedBytes;
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mReportInterval;
+    }
+
+    /**
+     * Write a report for the current state of the population to the report file.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void WriteReport(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    MemoryReportModifier();
+
+    /**
+     * Destructor.
+     */
+    virtual ~MemoryReportModifier();
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Opens memory.dat and writes the first report.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Writes a report every mReportInterval time steps.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.
+     *
+     * Writes the last report, with the peaks over the run, and closes memory.dat.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Estimate the memory used by each component of a population.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param rNames filled in with the name of each component
+     * @param rBytes filled in with the estimated bytes used by each component
+     */
+    static void EstimateMemoryUsage(AbstractCellPopulation<DIM,DIM>& rCellPopulation,
+                                    std::vector<std::string>& rNames,
+                                    std::vector<double>& rBytes);
+
+    /**
+     * Read a memory field, such as VmRSS or VmHWM, from /proc/self/status.
+     *
+     * @param rField the name of the field
+     * @return its value in bytes, or zero if it cannot be read (for example on systems other than Linux)
+     */
+    static double ReadProcessMemory(const std::string& rField);
+
+    /**
+     * @return the largest estimated total reported so far, in bytes
+     */
+    double GetPeakEstimatedBytes();
+
+    /**
+     * @return mReportInterval
+     */
+    unsigned GetReportInterval();
+
+    /**
+     * Set mReportInterval.
+     *
+     * @param reportInterval write a report every this many time steps, or only at the start and end if zero
+     */
+    void SetReportInterval(unsigned reportInterval);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(MemoryReportModifier)
+
+#endif /*MEMORYREPORTMODIFIER_HPP_*/
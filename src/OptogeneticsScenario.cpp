@@ -0,0 +1,274 @@
+
+#include "OptogeneticsScenario.hpp"
+#include <climits>
+#include <boost/bind.hpp>
+#include <boost/format.hpp>
+#include <boost/scoped_ptr.hpp>
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "MatteoMutableVertexMesh.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "OffLatticeSimulation.hpp"
+#include "NoCellCycleModel.hpp"
+#include "MatteoSrnModel.hpp"
+#include "MatteoForce.hpp"
+#include "WildTypeCellMutationState.hpp"
+#include "CellProliferativeTypesWriter.hpp"
+#include "AdaptiveForwardEulerNumericalMethod.hpp"
+#include "ConstantTargetAreaModifier.hpp"
+#include "DeltaNotchTrackingModifier.hpp"
+#include "ProfiledForce.hpp"
+#include "ProfiledSimulationModifier.hpp"
+#include "ProfileReportModifier.hpp"
+#include "MatteoProfiler.hpp"
+#include "MemoryReportModifier.hpp"
+#include "TelemetryModifier.hpp"
+#include "SharedMemoryExportModifier.hpp"
+#include "TissueFileReader.hpp"
+#include "TissueFileWriter.hpp"
+#include "PopulationConstants.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "SimulationTime.hpp"
+#include "SmartPointers.hpp"
+
+namespace po = boost::program_options;
+
+/**
+ * Add a modifier to a simulation, wrapped in a ProfiledSimulationModifier when profiling.
+ *
+ * @param rSimulator the simulation
+ * @param pModifier the modifier
+ * @param rName the name of the modifier's timers
+ * @param profile whether to time the modifier
+ */
+static void AddModifier(OffLatticeSimulation<2>& rSimulator,
+                        boost::shared_ptr<AbstractCellBasedSimulationModifier<2,2> > pModifier,
+                        const std::string& rName,
+                        bool profile)
+{
+    if (profile)
+    {
+        MAKE_PTR_ARGS(ProfiledSimulationModifier<2>, p_profiled_modifier, (pModifier, rName));
+        rSimulator.AddSimulationModifier(p_profiled_modifier);
+    }
+    else
+    {
+        rSimulator.AddSimulationModifier(pModifier);
+    }
+}
+
+void OptogeneticsScenario::GenerateRandomCells(unsigned numCells, std::vector<CellPtr>& rCells)
+{
+    MAKE_PTR(WildTypeCellMutationState, p_state);
+    double proportion = mArgs["proportion"].as<double>();
+
+    rCells.reserve(numCells);
+    for (unsigned i=0; i<numCells; i++)
+    {
+        NoCellCycleModel* p_cc_model = new NoCellCycleModel();
+        p_cc_model->SetDimension(2);
+
+        // Initialise the concentrations to random levels in each cell
+        std::vector<double> initial_conditions;
+        initial_conditions.push_back(RandomNumberGenerator::Instance()->ranf());
+        initial_conditions.push_back(RandomNumberGenerator::Instance()->ranf());
+        MatteoSrnModel* p_srn_model = new MatteoSrnModel();
+        p_srn_model->SetInitialConditions(initial_conditions);
+
+        CellPtr p_cell(new Cell(p_state, p_cc_model, p_srn_model));
+        double birth_time = -RandomNumberGenerator::Instance()->ranf()*12.0;
+        p_cell->SetBirthTime(birth_time);
+
+        if (RandomNumberGenerator::Instance()->ranf() < proportion)
+        {
+            p_cell->SetCellProliferativeType(p_diff_type);
+        }
+        else
+        {
+            p_cell->SetCellProliferativeType(p_wild_type);
+        }
+
+        rCells.push_back(p_cell);
+    }
+}
+
+void OptogeneticsScenario::AddOptions(po::options_description& rDescription)
+{
+    rDescription.add_options()
+        ("lambda,l", po::value<double>()->default_value(0.12), "Rigidity of wild-type boundary")
+        ("diff,m", po::value<double>()->default_value(0.12), "Rigidity of differentiated boundary")
+        ("mixed,x", po::value<double>()->default_value(0.0), "Rigidity of mixed boundary")
+        ("proportion,p", po::value<double>()->default_value(0.1), "Proportion of population that is mutant")
+        ("number,n", po::value<unsigned>()->default_value(16), "sqrt(number of cells)")
+        ("input", po::value<std::string>(), "Start from the tissue in this file, written by --save-tissue, instead of a honeycomb; number and proportion are then ignored")
+        ("save-tissue", po::value<std::string>(), "Write the final tissue to this file, to start further runs from with --input")
+        ("noise,z", po::value<double>()->default_value(0.05), "Noise parameter")
+        ("dt,d", po::value<double>()->default_value(1.0/200.0), "Simulation time step")
+        ("sample,s", po::value<unsigned>()->default_value(200), "Sampling time step multiple")
+        ("seed", po::value<unsigned>(), "Reseed the random number generator before building the tissue")
+        ("adaptive,a", po::bool_switch(), "Subdivide each time step adaptively, so dt need only be small enough for the signalling")
+        ("soa", po::bool_switch(), "Accumulate vertex forces element by element on flat arrays")
+        ("renumber", po::value<unsigned>()->default_value(0), "Renumber the mesh along a Hilbert curve every this many remeshes (0 for never)")
+        ("candidates", po::bool_switch(), "Only run the rearrangement checks when an edge or element could be rearranged")
+        ("profile", po::value<unsigned>()->implicit_value(0), "Time each force and modifier and write profile.dat, printing a summary every this many steps if given")
+        ("counters", po::bool_switch(), "With --profile, also count cycles, instructions, cache misses and branch misses (Linux only)")
+        ("memory", po::value<unsigned>()->implicit_value(0), "Write memory.dat at the start and end, and every this many steps if given")
+        ("telemetry", po::value<unsigned>()->implicit_value(100), "Publish progress to telemetry.sock in the output directory every this many steps (see scripts/telemetry_client.py)")
+        ("shm", po::bool_switch(), "Publish the tissue to a shared-memory segment at each sample (see scripts/shm_tissue_reader.py)")
+        ("directory", po::value<std::string>(), "Output directory, relative to CHASTE_TEST_OUTPUT (defaults to one named after the rigidities and noise)")
+        ("output,o", po::value<bool>()->default_value(true), "Write results files; if false, only the initial state is written")
+        ("time,t", po::value<double>()->default_value(10.0), "Simulation end time");
+}
+
+OptogeneticsScenario::OptogeneticsScenario(const po::variables_map& rArgs)
+    : mArgs(rArgs),
+      mNumCells(0),
+      mNumTimeSteps(0)
+{
+    wild_type_lambda = mArgs["lambda"].as<double>();
+    diff_type_lambda = mArgs["diff"].as<double>();
+    mixed_type_lambda = mArgs["mixed"].as<double>();
+}
+
+std::string OptogeneticsScenario::GetOutputDirectory() const
+{
+    if (mArgs.count("directory"))
+    {
+        return mArgs["directory"].as<std::string>();
+    }
+    return boost::str(boost::format("Optogenetics-l%1%-m%2%-x%3%-z%4%")
+                      % wild_type_lambda % diff_type_lambda % mixed_type_lambda % mArgs["noise"].as<double>());
+}
+
+void OptogeneticsScenario::Run()
+{
+    if (mArgs.count("seed"))
+    {
+        RandomNumberGenerator::Instance()->Reseed(mArgs["seed"].as<unsigned>());
+    }
+
+    std::vector<CellPtr> cells;
+    MatteoMutableVertexMesh<2>* p_mesh;
+    boost::scoped_ptr<TissueFileReader<2> > p_reader;
+    boost::scoped_ptr<MatteoMutableVertexMesh<2> > p_honeycomb_mesh;
+    if (mArgs.count("input"))
+    {
+        // Start from a prepared tissue, built in bulk from the file
+        p_reader.reset(new TissueFileReader<2>(mArgs["input"].as<std::string>()));
+        p_mesh = p_reader->GetMesh();
+        p_reader->GenerateCells(cells);
+    }
+    else
+    {
+        // Otherwise create a regular vertex mesh, with random initial levels and types
+        HoneycombVertexMeshGenerator generator(mArgs["number"].as<unsigned>(), mArgs["number"].as<unsigned>());
+        p_honeycomb_mesh.reset(new MatteoMutableVertexMesh<2>(*generator.GetMesh()));
+        p_mesh = p_honeycomb_mesh.get();
+        GenerateRandomCells(p_mesh->GetNumElements(), cells);
+    }
+    p_mesh->SetCellRearrangementThreshold(0.1);
+    p_mesh->SetRenumberingInterval(mArgs["renumber"].as<unsigned>());
+    p_mesh->SetUseCandidateFiltering(mArgs["candidates"].as<bool>());
+
+    // Set a target area rather than using a growth modifier, which would give very long G1 phases
+    for (unsigned i=0; i<cells.size(); i++)
+    {
+        cells[i]->GetCellData()->SetItem("target area", 1.0);
+    }
+
+    VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+    cell_population.AddCellWriter<CellProliferativeTypesWriter>();
+
+    OffLatticeSimulation<2> simulator(cell_population);
+    simulator.SetOutputDirectory(GetOutputDirectory());
+    simulator.SetDt(mArgs["dt"].as<double>());
+    simulator.SetSamplingTimestepMultiple(mArgs["sample"].as<unsigned>());
+    simulator.SetEndTime(mArgs["time"].as<double>());
+    if (!mArgs["output"].as<bool>())
+    {
+        // Sample less often than once per run, for timing the simulation itself
+        simulator.SetSamplingTimestepMultiple(UINT_MAX);
+        cell_population.SetOutputResultsForChasteVisualizer(false);
+    }
+    if (mArgs["adaptive"].as<bool>())
+    {
+        MAKE_PTR(AdaptiveForwardEulerNumericalMethod<2>, p_numerical_method);
+        simulator.SetNumericalMethod(p_numerical_method);
+    }
+
+    bool profile = mArgs.count("profile") > 0;
+    if (profile)
+    {
+        MAKE_PTR(ProfileReportModifier<2>, p_report_modifier);
+        p_report_modifier->SetSummaryInterval(mArgs["profile"].as<unsigned>());
+        if (mArgs["counters"].as<bool>())
+        {
+            MatteoProfiler::Instance()->EnableHardwareCounters();
+        }
+        simulator.AddSimulationModifier(p_report_modifier);
+    }
+
+    if (mArgs.count("memory"))
+    {
+        MAKE_PTR(MemoryReportModifier<2>, p_memory_modifier);
+        p_memory_modifier->SetReportInterval(mArgs["memory"].as<unsigned>());
+        simulator.AddSimulationModifier(p_memory_modifier);
+    }
+
+    // The Delta-Notch modifier updates the levels of Delta and Notch in CellData
+    MAKE_PTR(DeltaNotchTrackingModifier<2>, p_modifier);
+    AddModifier(simulator, p_modifier, "DeltaNotchTrackingModifier", profile);
+
+    // Noise avoids local minima, and is computed in the same pass over the nodes as the mechanics
+    MAKE_PTR(MatteoForce<2>, p_force);
+    p_force->SetMovementParameter(mArgs["noise"].as<double>());
+    p_force->SetUseStructureOfArrays(mArgs["soa"].as<bool>());
+    if (profile)
+    {
+        MAKE_PTR_ARGS(ProfiledForce<2>, p_profiled_force, (p_force, "MatteoForce"));
+        simulator.AddForce(p_profiled_force);
+    }
+    else
+    {
+        simulator.AddForce(p_force);
+    }
+
+    // Assign the target areas required by the MatteoForce
+    MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+    AddModifier(simulator, p_growth_modifier, "ConstantTargetAreaModifier", profile);
+
+    // The telemetry goes after the Delta-Notch modifier, which sets up the levels it publishes
+    if (mArgs.count("telemetry"))
+    {
+        MAKE_PTR(TelemetryModifier<2>, p_telemetry_modifier);
+        p_telemetry_modifier->SetPublishInterval(mArgs["telemetry"].as<unsigned>());
+        p_telemetry_modifier->AddMetric("mean_notch", boost::bind(&TelemetryModifier<2>::GetMeanCellDataItem, _1, "notch"));
+        p_telemetry_modifier->AddMetric("mean_delta", boost::bind(&TelemetryModifier<2>::GetMeanCellDataItem, _1, "delta"));
+        simulator.AddSimulationModifier(p_telemetry_modifier);
+    }
+    if (mArgs["shm"].as<bool>())
+    {
+        MAKE_PTR(SharedMemoryExportModifier<2>, p_export_modifier);
+        p_export_modifier->SetExportInterval(mArgs["sample"].as<unsigned>());
+        simulator.AddSimulationModifier(p_export_modifier);
+    }
+
+    simulator.Solve();
+
+    if (mArgs.count("save-tissue"))
+    {
+        TissueFileWriter<2>::WriteTissueFile(cell_population, mArgs["save-tissue"].as<std::string>());
+    }
+
+    mNumCells = cell_population.GetNumRealCells();
+    mNumTimeSteps = SimulationTime::Instance()->GetTimeStepsElapsed();
+}
+
+unsigned OptogeneticsScenario::GetNumCells() const
+{
+    return mNumCells;
+}
+
+unsigned OptogeneticsScenario::GetNumTimeSteps() const
+{
+    return mNumTimeSteps;
+}
@@ -0,0 +1,91 @@
+
+#ifndef OPTOGENETICSSCENARIO_HPP_
+#define OPTOGENETICSSCENARIO_HPP_
+
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+
+#include "Cell.hpp"
+
+/**
+ * The optogenetics scenario: a honeycomb vertex monolayer of wild-type and
+ * differentiated cells, each running the Delta-Notch MatteoSrnModel, relaxed by
+ * the MatteoForce with random motion under constant target areas.
+ *
+ * The tissue is either a regular honeycomb with random initial levels, or one prepared
+ * earlier and loaded with TissueFileReader, for example an equilibrated tissue saved
+ * at the end of a previous run.
+ *
+ * The scenario is configured from a boost::program_options variables map, so that
+ * TestOptogenetics and OptogeneticsApp accept the same options. Optional
+ * instrumentation (profiling, hardware counters, memory reports, telemetry and
+ * the shared-memory export) is only constructed when its option is given.
+ *
+ * The caller is responsible for the singletons a cell-based simulation needs:
+ * SimulationTime must have its start time set, as AbstractCellBasedTestSuite does.
+ */
+class OptogeneticsScenario
+{
+private:
+
+    /** The options the scenario was configured with. */
+    boost::program_options::variables_map mArgs;
+
+    /** Number of cells at the end of the last call to Run(). */
+    unsigned mNumCells;
+
+    /** Number of time steps taken by the last call to Run(). */
+    unsigned mNumTimeSteps;
+
+    /**
+     * Create cells for a honeycomb tissue, with random initial Notch and Delta levels
+     * and birth times, a proportion of them differentiated.
+     *
+     * @param numCells the number of cells
+     * @param rCells the vector to add the cells to
+     */
+    void GenerateRandomCells(unsigned numCells, std::vector<CellPtr>& rCells);
+
+public:
+
+    /**
+     * Add the options of the scenario to a description, with their defaults.
+     *
+     * @param rDescription the description to add to
+     */
+    static void AddOptions(boost::program_options::options_description& rDescription);
+
+    /**
+     * Constructor. Sets the boundary rigidities in PopulationConstants from the
+     * lambda, diff and mixed options.
+     *
+     * @param rArgs options parsed against a description filled by AddOptions()
+     */
+    OptogeneticsScenario(const boost::program_options::variables_map& rArgs);
+
+    /**
+     * @return the output directory, relative to CHASTE_TEST_OUTPUT: the directory
+     * option if given, otherwise one named after the rigidities and the noise
+     */
+    std::string GetOutputDirectory() const;
+
+    /**
+     * Build the mesh, cells, population and simulation, and solve to the end time.
+     * If the seed option is given the random number generator is reseeded first, and
+     * if the save-tissue option is given the final tissue is written to that file.
+     */
+    void Run();
+
+    /**
+     * @return the number of cells at the end of the last call to Run()
+     */
+    unsigned GetNumCells() const;
+
+    /**
+     * @return the number of time steps taken by the last call to Run()
+     */
+    unsigned GetNumTimeSteps() const;
+};
+
+#endif /*OPTOGENETICSSCENARIO_HPP_*/
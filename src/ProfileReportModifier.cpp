@@ -0,0 +1,123 @@
+
+#include "ProfileReportModifier.hpp"
+#include <iomanip>
+#include "CellBasedEventHandler.hpp"
+#include "MatteoProfiler.hpp"
+#include "OutputFileHandler.hpp"
+
+/** Number of CellBasedEventHandler phases reported. */
+static const unsigned NUM_REPORTED_PHASES = 6;
+/** The CellBasedEventHandler phases reported. */
+static const unsigned REPORTED_PHASES[NUM_REPORTED_PHASES] =
+{
+    CellBasedEventHandler::DEATH,
+    CellBasedEventHandler::BIRTH,
+    CellBasedEventHandler::UPDATESIMULATION,
+    CellBasedEventHandler::FORCE,
+    CellBasedEventHandler::POSITION,
+    CellBasedEventHandler::OUTPUT
+};
+/** The names under which the phases are reported. */
+static const char* REPORTED_PHASE_NAMES[NUM_REPORTED_PHASES] =
+{
+    "cell death", "cell birth", "update (population and modifiers)", "forces", "positions", "output (writers)"
+};
+
+template<unsigned DIM>
+ProfileReportModifier<DIM>::ProfileReportModifier()
+    : AbstractCellBasedSimulationModifier<DIM>(),
+      mSummaryInterval(0),
+      mOutputDirectory("")
+{
+}
+
+template<unsigned DIM>
+ProfileReportModifier<DIM>::~ProfileReportModifier()
+{
+}
+
+template<unsigned DIM>
+std::vector<double> ProfileReportModifier<DIM>::GetPhaseTimes()
+{
+    std::vector<double> phase_times(NUM_REPORTED_PHASES);
+    for (unsigned i=0; i<NUM_REPORTED_PHASES; i++)
+    {
+        phase_times[i] = CellBasedEventHandler::GetElapsedTime(REPORTED_PHASES[i]);
+    }
+    return phase_times;
+}
+
+template<unsigned DIM>
+void ProfileReportModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    mOutputDirectory = outputDirectory;
+    MatteoProfiler::Instance()->Reset();
+
+    // The event handler is not reset by the simulation, so only report what happens from now on
+    mInitialPhaseTimes = GetPhaseTimes();
+}
+
+template<unsigned DIM>
+void ProfileReportModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (mSummaryInterval > 0 && SimulationTime::Instance()->GetTimeStepsElapsed()%mSummaryInterval == 0)
+    {
+        std::cout << "# profile at time " << SimulationTime::Instance()->GetTime() << "\n";
+        MatteoProfiler::Instance()->WriteReport(std::cout);
+        std::cout << std::flush;
+    }
+}
+
+template<unsigned DIM>
+void ProfileReportModifier<DIM>::UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    OutputFileHandler output_file_handler(mOutputDirectory + "/", false);
+    out_stream p_file = output_file_handler.OpenOutputFile("profile.dat");
+    WriteReport(*p_file);
+    p_file->close();
+}
+
+template<unsigned DIM>
+void ProfileReportModifier<DIM>::WriteReport(std::ostream& rStream)
+{
+    MatteoProfiler::Instance()->WriteReport(rStream);
+
+    std::vector<double> phase_times = GetPhaseTimes();
+    rStream << "# " << std::left << std::setw(48) << "phase" << std::right << std::setw(14) << "total (s)" << "\n";
+    for (unsigned i=0; i<NUM_REPORTED_PHASES; i++)
+    {
+        double initial_time = (i < mInitialPhaseTimes.size()) ? mInitialPhaseTimes[i] : 0.0;
+        rStream << "  " << std::left << std::setw(48) << REPORTED_PHASE_NAMES[i] << std::right
+                << std::setw(14) << std::setprecision(6) << 1e-3*(phase_times[i] - initial_time) << "\n";
+    }
+}
+
+template<unsigned DIM>
+unsigned ProfileReportModifier<DIM>::GetSummaryInterval()
+{
+    return mSummaryInterval;
+}
+
+template<unsigned DIM>
+void ProfileReportModifier<DIM>::SetSummaryInterval(unsigned summaryInterval)
+{
+    mSummaryInterval = summaryInterval;
+}
+
+template<unsigned DIM>
+void ProfileReportModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<SummaryInterval>" << mSummaryInterval << "</SummaryInterval>\n";
+
+    // Call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class ProfileReportModifier<1>;
+template class ProfileReportModifier<2>;
+template class ProfileReportModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(ProfileReportModifier)
@@ -0,0 +1,130 @@
+
+#ifndef PROFILEREPORTMODIFIER_HPP_
+#define PROFILEREPORTMODIFIER_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+
+/**
+ * A modifier class which reports the timers of the MatteoProfiler for a run.
+ *
+ * It resets the profiler when the simulation is set up, optionally prints a summary
+ * to standard output every few time steps, and at the end of the solve writes the
+ * profile table to profile.dat in the simulation output directory. The table is
+ * followed by the time spent in the phases of the simulation recorded by Chaste's
+ * CellBasedEventHandler, which covers what the project cannot time directly, such as
+ * the cell writers and the other output.
+ *
+ * For the forces and modifiers to appear in the table they must be wrapped in a
+ * ProfiledForce or ProfiledSimulationModifier; the timers within the project's own
+ * classes appear when it is built with MATTEO_PROFILING.
+ */
+template<unsigned DIM>
+class ProfileReportModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+private:
+
+    /** A summary is printed every this many time steps, or never if zero. Defaults to 0. */
+    unsigned mSummaryInterval;
+
+    /** Output directory of the simulation, set in SetupSolve(). */
+    std::string mOutputDirectory;
+
+    /** Elapsed time of each CellBasedEventHandler phase at set up, in milliseconds. */
+    std::vector<double> mInitialPhaseTimes;
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mSummaryInterval;
+    }
+
+    /**
+     * @return the elapsed time of each reported CellBasedEventHandler phase, in milliseconds
+     */
+    std::vector<double> GetPhaseTimes();
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    ProfileReportModifier();
+
+    /**
+     * Destructor.
+     */
+    virtual ~ProfileReportModifier();
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Resets the profiler.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Prints a summary every mSummaryInterval time steps.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.
+     *
+     * Writes profile.dat.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Write the profile table and the phase times.
+     *
+     * @param rStream the stream to write to
+     */
+    void WriteReport(std::ostream& rStream);
+
+    /**
+     * @return mSummaryInterval
+     */
+    unsigned GetSummaryInterval();
+
+    /**
+     * Set mSummaryInterval.
+     *
+     * @param summaryInterval print a summary every this many time steps, or never if zero
+     */
+    void SetSummaryInterval(unsigned summaryInterval);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(ProfileReportModifier)
+
+#endif /*PROFILEREPORTMODIFIER_HPP_*/
@@ -0,0 +1,81 @@
+
+#include "ProfiledForce.hpp"
+#include "MatteoProfiler.hpp"
+
+#include <climits>
+
+template<unsigned DIM>
+ProfiledForce<DIM>::ProfiledForce(boost::shared_ptr<AbstractForce<DIM> > pForce, const std::string& rName)
+    : AbstractForce<DIM>(),
+      mpForce(pForce),
+      mName(rName),
+      mTimerIndex(UINT_MAX)
+{
+}
+
+template<unsigned DIM>
+ProfiledForce<DIM>::~ProfiledForce()
+{
+}
+
+template<unsigned DIM>
+boost::shared_ptr<AbstractForce<DIM> > ProfiledForce<DIM>::GetForce()
+{
+    return mpForce;
+}
+
+template<unsigned DIM>
+boost::shared_ptr<AbstractForce<DIM> > ProfiledForce<DIM>::Unwrap(boost::shared_ptr<AbstractForce<DIM> > pForce)
+{
+    boost::shared_ptr<ProfiledForce<DIM> > p_profiled_force = boost::dynamic_pointer_cast<ProfiledForce<DIM> >(pForce);
+    while (p_profiled_force)
+    {
+        pForce = p_profiled_force->GetForce();
+        p_profiled_force = boost::dynamic_pointer_cast<ProfiledForce<DIM> >(pForce);
+    }
+    return pForce;
+}
+
+template<unsigned DIM>
+const std::string& ProfiledForce<DIM>::rGetName() const
+{
+    return mName;
+}
+
+template<unsigned DIM>
+void ProfiledForce<DIM>::AddForceContribution(AbstractCellPopulation<DIM>& rCellPopulation)
+{
+    if (!mpForce)
+    {
+        EXCEPTION("ProfiledForce has no force to apply");
+    }
+    if (mTimerIndex == UINT_MAX)
+    {
+        mTimerIndex = MatteoProfiler::Instance()->GetTimerIndex("force: " + mName);
+    }
+
+    MatteoScopedTimer timer(mTimerIndex);
+    mpForce->AddForceContribution(rCellPopulation);
+}
+
+template<unsigned DIM>
+void ProfiledForce<DIM>::OutputForceParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<Name>" << mName << "</Name>\n";
+    if (mpForce)
+    {
+        mpForce->OutputForceInfo(rParamsFile);
+    }
+
+    // Call direct parent class
+    AbstractForce<DIM>::OutputForceParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class ProfiledForce<1>;
+template class ProfiledForce<2>;
+template class ProfiledForce<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(ProfiledForce)
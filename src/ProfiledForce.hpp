@@ -0,0 +1,106 @@
+
+#ifndef PROFILEDFORCE_HPP_
+#define PROFILEDFORCE_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "AbstractForce.hpp"
+
+/**
+ * A force which applies another force and times it with the MatteoProfiler, under the
+ * timer "force: <name>". Wrapping each force of a simulation in one of these shows how
+ * the time spent on forces is split between them, without changing the forces themselves.
+ *
+ * Code that looks for a force of a particular class in a simulation's force collection
+ * must look through the wrapper with Unwrap(), or profiling would change what it finds.
+ */
+template<unsigned DIM>
+class ProfiledForce : public AbstractForce<DIM>
+{
+private:
+
+    /** The force being timed. */
+    boost::shared_ptr<AbstractForce<DIM> > mpForce;
+
+    /** The name under which the force is timed. */
+    std::string mName;
+
+    /** The index of the profiler timer, looked up on first use. Not archived. */
+    unsigned mTimerIndex;
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractForce<DIM> >(*this);
+        archive & mpForce;
+        archive & mName;
+    }
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param pForce the force to time (defaults to none, for archiving)
+     * @param rName the name under which to time it
+     */
+    ProfiledForce(boost::shared_ptr<AbstractForce<DIM> > pForce=boost::shared_ptr<AbstractForce<DIM> >(),
+                  const std::string& rName="");
+
+    /**
+     * Destructor.
+     */
+    virtual ~ProfiledForce();
+
+    /**
+     * @return the force being timed
+     */
+    boost::shared_ptr<AbstractForce<DIM> > GetForce();
+
+    /**
+     * @param pForce a force, possibly wrapped in one or more ProfiledForces
+     * @return the force with any ProfiledForce wrappers removed
+     */
+    static boost::shared_ptr<AbstractForce<DIM> > Unwrap(boost::shared_ptr<AbstractForce<DIM> > pForce);
+
+    /**
+     * @return the name under which the force is timed
+     */
+    const std::string& rGetName() const;
+
+    /**
+     * Overridden AddForceContribution() method.
+     *
+     * Applies the wrapped force, timing it.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void AddForceContribution(AbstractCellPopulation<DIM>& rCellPopulation);
+
+    /**
+     * Overridden OutputForceParameters() method.
+     *
+     * Outputs the name and the wrapped force.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputForceParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(ProfiledForce)
+
+#endif /*PROFILEDFORCE_HPP_*/
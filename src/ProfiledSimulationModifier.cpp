@@ -0,0 +1,86 @@
+
+#include "ProfiledSimulationModifier.hpp"
+#include "MatteoProfiler.hpp"
+
+#include <climits>
+
+template<unsigned DIM>
+ProfiledSimulationModifier<DIM>::ProfiledSimulationModifier(boost::shared_ptr<AbstractCellBasedSimulationModifier<DIM,DIM> > pModifier,
+                                                            const std::string& rName)
+    : AbstractCellBasedSimulationModifier<DIM,DIM>(),
+      mpModifier(pModifier),
+      mName(rName),
+      mTimerIndex(UINT_MAX)
+{
+}
+
+template<unsigned DIM>
+ProfiledSimulationModifier<DIM>::~ProfiledSimulationModifier()
+{
+}
+
+template<unsigned DIM>
+void ProfiledSimulationModifier<DIM>::CheckModifier()
+{
+    if (!mpModifier)
+    {
+        EXCEPTION("ProfiledSimulationModifier has no modifier to pass calls on to");
+    }
+}
+
+template<unsigned DIM>
+boost::shared_ptr<AbstractCellBasedSimulationModifier<DIM,DIM> > ProfiledSimulationModifier<DIM>::GetModifier()
+{
+    return mpModifier;
+}
+
+template<unsigned DIM>
+void ProfiledSimulationModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    CheckModifier();
+    if (mTimerIndex == UINT_MAX)
+    {
+        mTimerIndex = MatteoProfiler::Instance()->GetTimerIndex("modifier: " + mName);
+    }
+
+    MatteoScopedTimer timer(mTimerIndex);
+    mpModifier->UpdateAtEndOfTimeStep(rCellPopulation);
+}
+
+template<unsigned DIM>
+void ProfiledSimulationModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    CheckModifier();
+    MatteoScopedTimer timer(MatteoProfiler::Instance()->GetTimerIndex("modifier: " + mName + " (setup)"));
+    mpModifier->SetupSolve(rCellPopulation, outputDirectory);
+}
+
+template<unsigned DIM>
+void ProfiledSimulationModifier<DIM>::UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    CheckModifier();
+    MatteoScopedTimer timer(MatteoProfiler::Instance()->GetTimerIndex("modifier: " + mName + " (end)"));
+    mpModifier->UpdateAtEndOfSolve(rCellPopulation);
+}
+
+template<unsigned DIM>
+void ProfiledSimulationModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<Name>" << mName << "</Name>\n";
+    if (mpModifier)
+    {
+        mpModifier->OutputSimulationModifierInfo(rParamsFile);
+    }
+
+    // Call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM,DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class ProfiledSimulationModifier<1>;
+template class ProfiledSimulationModifier<2>;
+template class ProfiledSimulationModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(ProfiledSimulationModifier)
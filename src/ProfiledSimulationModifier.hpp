@@ -0,0 +1,111 @@
+
+#ifndef PROFILEDSIMULATIONMODIFIER_HPP_
+#define PROFILEDSIMULATIONMODIFIER_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/shared_ptr.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+
+/**
+ * A modifier which passes every call on to another modifier and times it with the
+ * MatteoProfiler, under the timers "modifier: <name>" for the calls at the end of
+ * each time step, and "modifier: <name> (setup)" and "modifier: <name> (end)" for the
+ * calls at the start and end of the solve.
+ */
+template<unsigned DIM>
+class ProfiledSimulationModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+private:
+
+    /** The modifier being timed. */
+    boost::shared_ptr<AbstractCellBasedSimulationModifier<DIM,DIM> > mpModifier;
+
+    /** The name under which the modifier is timed. */
+    std::string mName;
+
+    /** The index of the profiler timer of UpdateAtEndOfTimeStep(), looked up on first use. Not archived. */
+    unsigned mTimerIndex;
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mpModifier;
+        archive & mName;
+    }
+
+    /**
+     * Throw if there is no modifier to pass calls on to.
+     */
+    void CheckModifier();
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param pModifier the modifier to time (defaults to none, for archiving)
+     * @param rName the name under which to time it
+     */
+    ProfiledSimulationModifier(boost::shared_ptr<AbstractCellBasedSimulationModifier<DIM,DIM> > pModifier
+                                   =boost::shared_ptr<AbstractCellBasedSimulationModifier<DIM,DIM> >(),
+                               const std::string& rName="");
+
+    /**
+     * Destructor.
+     */
+    virtual ~ProfiledSimulationModifier();
+
+    /**
+     * @return the modifier being timed
+     */
+    boost::shared_ptr<AbstractCellBasedSimulationModifier<DIM,DIM> > GetModifier();
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Outputs the name and the wrapped modifier.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(ProfiledSimulationModifier)
+
+#endif /*PROFILEDSIMULATIONMODIFIER_HPP_*/
@@ -3,7 +3,8 @@
 template<unsigned DIM>
 RandomMotionForce<DIM>::RandomMotionForce()
     : AbstractForce<DIM>(),
-	  mMovementParameter(0.01)
+	  mMovementParameter(0.01),
+	  mApplyNoise(true)
 {
 }
 
@@ -25,9 +26,19 @@ double RandomMotionForce<DIM>::GetMovementParameter()
     return mMovementParameter;
 }
 
+template<unsigned DIM>
+void RandomMotionForce<DIM>::SetApplyNoise(bool applyNoise)
+{
+    mApplyNoise = applyNoise;
+}
+
 template<unsigned DIM>
 void RandomMotionForce<DIM>::AddForceContribution(AbstractCellPopulation<DIM>& rCellPopulation)
 {
+    if (!mApplyNoise)
+    {
+        return;
+    }
     double dt = SimulationTime::Instance()->GetTimeStep();
 
     // Iterate over the nodes
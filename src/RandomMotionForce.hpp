@@ -5,6 +5,7 @@
 #include <boost/serialization/base_object.hpp>
 
 #include "AbstractForce.hpp"
+#include "AbstractStochasticForce.hpp"
 #include "AbstractOffLatticeCellPopulation.hpp"
 #include "RandomNumberGenerator.hpp"
 
@@ -12,7 +13,7 @@
  * A force class to model random cell movement.
  */
 template<unsigned DIM>
-class RandomMotionForce : public AbstractForce<DIM>
+class RandomMotionForce : public AbstractForce<DIM>, public AbstractStochasticForce
 {
 private :
 
@@ -21,6 +22,12 @@ private :
      */
     double mMovementParameter;
 
+    /**
+     * Whether the force adds its noise. Cleared by adaptive numerical methods which
+     * draw the noise themselves, to subdivide it consistently. Not archived.
+     */
+    bool mApplyNoise;
+
     /**
      * Archiving.
      */
@@ -65,6 +72,13 @@ public :
      */
     double GetMovementParameter();
 
+    /**
+     * Set whether the force adds its noise; if not, it adds nothing.
+     *
+     * @param applyNoise whether to add the noise
+     */
+    void SetApplyNoise(bool applyNoise);
+
     /**
      * Overridden AddForceContribution() method.
      *
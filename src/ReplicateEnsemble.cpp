@@ -0,0 +1,460 @@
+
+#include "ReplicateEnsemble.hpp"
+#include "AbstractOdeSrnModel.hpp"
+#include "RandomNumberGenerator.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <boost/random/normal_distribution.hpp>
+#include <boost/random/uniform_01.hpp>
+
+template<unsigned DIM>
+ReplicateEnsemble<DIM>::ReplicateEnsemble(VertexBasedCellPopulation<DIM>& rCellPopulation,
+                                          boost::shared_ptr<MatteoForce<DIM> > pForce,
+                                          unsigned numReplicates)
+    : mrCellPopulation(rCellPopulation),
+      mpForce(pForce),
+      mNumReplicates(numReplicates),
+      mNumNodes(rCellPopulation.GetNumNodes()),
+      mNumElements(rCellPopulation.GetNumElements())
+{
+    if (DIM != 2)
+    {
+        EXCEPTION("ReplicateEnsemble is only implemented in 2D");
+    }
+    if (numReplicates == 0)
+    {
+        EXCEPTION("A ReplicateEnsemble needs at least one replicate");
+    }
+    MutableVertexMesh<DIM,DIM>& r_mesh = rCellPopulation.rGetMesh();
+    if (r_mesh.GetNumAllNodes() != mNumNodes || r_mesh.GetNumAllElements() != mNumElements)
+    {
+        EXCEPTION("The template population must not contain deleted nodes or elements");
+    }
+
+    // The topology, and everything that depends only on it, is shared by all replicates
+    mElementOffsets.push_back(0);
+    mTargetAreas.resize(mNumElements);
+    mNeighbourOffsets.push_back(0);
+    for (unsigned elem_index=0; elem_index<mNumElements; elem_index++)
+    {
+        VertexElement<DIM,DIM>* p_element = r_mesh.GetElement(elem_index);
+        unsigned num_nodes_in_element = p_element->GetNumNodes();
+        for (unsigned local_index=0; local_index<num_nodes_in_element; local_index++)
+        {
+            Node<DIM>* p_node = p_element->GetNode(local_index);
+            Node<DIM>* p_next_node = p_element->GetNode((local_index + 1)%num_nodes_in_element);
+            mSlotNodes.push_back(p_node->GetIndex());
+            mSlotNextNodes.push_back(p_next_node->GetIndex());
+            mSlotPreviousNodes.push_back(p_element->GetNodeGlobalIndex((local_index + num_nodes_in_element - 1)%num_nodes_in_element));
+            mSlotLineTensions.push_back(pForce->GetLineTensionParameter(elem_index, p_node, p_next_node, rCellPopulation));
+        }
+        mElementOffsets.push_back(mSlotNodes.size());
+
+        CellPtr p_cell = rCellPopulation.GetCellUsingLocationIndex(elem_index);
+        try
+        {
+            mTargetAreas[elem_index] = p_cell->GetCellData()->GetItem("target area");
+        }
+        catch (Exception&)
+        {
+            EXCEPTION("The target areas of the template population must be set before creating a ReplicateEnsemble");
+        }
+
+        std::set<unsigned> neighbours = rCellPopulation.GetNeighbouringLocationIndices(p_cell);
+        mNeighbours.insert(mNeighbours.end(), neighbours.begin(), neighbours.end());
+        mNeighbourOffsets.push_back(mNeighbours.size());
+    }
+
+    // Every replicate starts as a copy of the template
+    mLocations.resize(DIM*mNumNodes*mNumReplicates);
+    for (unsigned node_index=0; node_index<mNumNodes; node_index++)
+    {
+        const c_vector<double, DIM>& r_location = r_mesh.GetNode(node_index)->rGetLocation();
+        for (unsigned i=0; i<DIM; i++)
+        {
+            std::fill(mLocations.begin() + (DIM*node_index + i)*mNumReplicates,
+                      mLocations.begin() + (DIM*node_index + i + 1)*mNumReplicates,
+                      r_location[i]);
+        }
+    }
+
+    mSrnStates.assign(2*mNumElements*mNumReplicates, 0.0);
+    for (unsigned elem_index=0; elem_index<mNumElements; elem_index++)
+    {
+        CellPtr p_cell = rCellPopulation.GetCellUsingLocationIndex(elem_index);
+        AbstractOdeSrnModel* p_srn_model = dynamic_cast<AbstractOdeSrnModel*>(p_cell->GetSrnModel());
+        if (p_srn_model == NULL)
+        {
+            EXCEPTION("The cells of the template population must have an ODE-based Delta-Notch SRN model");
+        }
+        if (p_srn_model->GetOdeSystem() == NULL)
+        {
+            // As the simulation would do on construction
+            p_cell->InitialiseSrnModel();
+        }
+        if (dynamic_cast<DeltaNotchOdeSystem*>(p_srn_model->GetOdeSystem()) == NULL)
+        {
+            EXCEPTION("The cells of the template population must have an ODE-based Delta-Notch SRN model");
+        }
+        const std::vector<double>& r_state = p_srn_model->GetOdeSystem()->rGetStateVariables();
+        for (unsigned k=0; k<2; k++)
+        {
+            std::fill(mSrnStates.begin() + (2*elem_index + k)*mNumReplicates,
+                      mSrnStates.begin() + (2*elem_index + k + 1)*mNumReplicates,
+                      r_state[k]);
+        }
+    }
+
+    mForces.resize(mLocations.size());
+    mMeanDeltas.resize(mNumElements*mNumReplicates);
+    mAreas.resize(mNumElements*mNumReplicates);
+    mPerimeters.resize(mNumElements*mNumReplicates);
+    mEdgeLengths.resize(mSlotNodes.size()*mNumReplicates);
+    mActive.assign(mNumReplicates, 1.0);
+    mNumTimeStepsTaken.assign(mNumReplicates, 0);
+
+    RandomNumberGenerator* p_gen = RandomNumberGenerator::Instance();
+    mGenerators.resize(mNumReplicates);
+    for (unsigned r=0; r<mNumReplicates; r++)
+    {
+        mGenerators[r].seed(p_gen->randMod(UINT_MAX));
+    }
+    mMeanDeltaIndex = mOdeSystem.GetParameterIndex("Mean Delta");
+}
+
+template<unsigned DIM>
+void ReplicateEnsemble<DIM>::RandomiseSrnStates()
+{
+    const unsigned R = mNumReplicates;
+    boost::uniform_01<double> uniform;
+    for (unsigned j=0; j<2*mNumElements; j++)
+    {
+        for (unsigned r=0; r<R; r++)
+        {
+            mSrnStates[j*R + r] = uniform(mGenerators[r]);
+        }
+    }
+}
+
+template<unsigned DIM>
+void ReplicateEnsemble<DIM>::Advance(double dt, unsigned numTimeSteps)
+{
+    const unsigned R = mNumReplicates;
+    double damping_constant = mrCellPopulation.GetDampingConstantNormal();
+
+    for (unsigned step=0; step<numTimeSteps && GetNumActiveReplicates() > 0; step++)
+    {
+        ComputeGeometry();
+        SplitOffRearrangingReplicates();
+        ComputeForces(dt);
+
+        // Split-off replicates are masked out rather than skipped, to keep the loops branch-free
+        for (unsigned j=0; j<DIM*mNumNodes; j++)
+        {
+            double* p_locations = &mLocations[j*R];
+            const double* p_forces = &mForces[j*R];
+            for (unsigned r=0; r<R; r++)
+            {
+                p_locations[r] += mActive[r]*dt*p_forces[r]/damping_constant;
+            }
+        }
+
+        UpdateSrnStates(dt);
+
+        for (unsigned r=0; r<R; r++)
+        {
+            mNumTimeStepsTaken[r] += (unsigned)mActive[r];
+        }
+    }
+}
+
+template<unsigned DIM>
+void ReplicateEnsemble<DIM>::ComputeGeometry()
+{
+    const unsigned R = mNumReplicates;
+    std::fill(mAreas.begin(), mAreas.end(), 0.0);
+    std::fill(mPerimeters.begin(), mPerimeters.end(), 0.0);
+
+    for (unsigned elem_index=0; elem_index<mNumElements; elem_index++)
+    {
+        double* p_area = &mAreas[elem_index*R];
+        double* p_perimeter = &mPerimeters[elem_index*R];
+        for (unsigned slot=mElementOffsets[elem_index]; slot<mElementOffsets[elem_index+1]; slot++)
+        {
+            const double* p_x = &mLocations[(DIM*mSlotNodes[slot])*R];
+            const double* p_y = &mLocations[(DIM*mSlotNodes[slot] + 1)*R];
+            const double* p_next_x = &mLocations[(DIM*mSlotNextNodes[slot])*R];
+            const double* p_next_y = &mLocations[(DIM*mSlotNextNodes[slot] + 1)*R];
+            double* p_length = &mEdgeLengths[slot*R];
+            for (unsigned r=0; r<R; r++)
+            {
+                double dx = p_next_x[r] - p_x[r];
+                double dy = p_next_y[r] - p_y[r];
+                p_length[r] = sqrt(dx*dx + dy*dy);
+                p_perimeter[r] += p_length[r];
+                p_area[r] += 0.5*(p_x[r]*p_next_y[r] - p_next_x[r]*p_y[r]);
+            }
+        }
+    }
+}
+
+template<unsigned DIM>
+void ReplicateEnsemble<DIM>::SplitOffRearrangingReplicates()
+{
+    const unsigned R = mNumReplicates;
+    MutableVertexMesh<DIM,DIM>& r_mesh = mrCellPopulation.rGetMesh();
+    double rearrangement_threshold = r_mesh.GetCellRearrangementThreshold();
+    double t2_threshold = r_mesh.GetT2Threshold();
+
+    for (unsigned slot=0; slot<mSlotNodes.size(); slot++)
+    {
+        const double* p_length = &mEdgeLengths[slot*R];
+        for (unsigned r=0; r<R; r++)
+        {
+            if (p_length[r] < rearrangement_threshold)
+            {
+                mActive[r] = 0.0;
+            }
+        }
+    }
+
+    for (unsigned elem_index=0; elem_index<mNumElements; elem_index++)
+    {
+        if (mElementOffsets[elem_index+1] - mElementOffsets[elem_index] == 3)
+        {
+            for (unsigned r=0; r<R; r++)
+            {
+                if (mAreas[elem_index*R + r] < t2_threshold)
+                {
+                    mActive[r] = 0.0;
+                }
+            }
+        }
+    }
+}
+
+template<unsigned DIM>
+void ReplicateEnsemble<DIM>::ComputeForces(double dt)
+{
+    const unsigned R = mNumReplicates;
+    double area_elasticity = mpForce->GetAreaElasticityParameter();
+    double perimeter_contractility = mpForce->GetPerimeterContractilityParameter();
+    std::fill(mForces.begin(), mForces.end(), 0.0);
+
+    // Each slot pulls on its own node and the next one, as in MatteoForce's element-by-element accumulation
+    std::vector<double> pressures(R);
+    std::vector<double> perimeter_tensions(R);
+    for (unsigned elem_index=0; elem_index<mNumElements; elem_index++)
+    {
+        for (unsigned r=0; r<R; r++)
+        {
+            pressures[r] = area_elasticity*(mAreas[elem_index*R + r] - mTargetAreas[elem_index]);
+            perimeter_tensions[r] = perimeter_contractility*mPerimeters[elem_index*R + r];
+        }
+
+        for (unsigned slot=mElementOffsets[elem_index]; slot<mElementOffsets[elem_index+1]; slot++)
+        {
+            unsigned node = mSlotNodes[slot];
+            unsigned next_node = mSlotNextNodes[slot];
+            unsigned previous_node = mSlotPreviousNodes[slot];
+            const double* p_x = &mLocations[(DIM*node)*R];
+            const double* p_y = &mLocations[(DIM*node + 1)*R];
+            const double* p_next_x = &mLocations[(DIM*next_node)*R];
+            const double* p_next_y = &mLocations[(DIM*next_node + 1)*R];
+            const double* p_previous_x = &mLocations[(DIM*previous_node)*R];
+            const double* p_previous_y = &mLocations[(DIM*previous_node + 1)*R];
+            const double* p_length = &mEdgeLengths[slot*R];
+            double* p_force_x = &mForces[(DIM*node)*R];
+            double* p_force_y = &mForces[(DIM*node + 1)*R];
+            double* p_next_force_x = &mForces[(DIM*next_node)*R];
+            double* p_next_force_y = &mForces[(DIM*next_node + 1)*R];
+            double line_tension = mSlotLineTensions[slot];
+
+            for (unsigned r=0; r<R; r++)
+            {
+                double area_gradient_x = 0.5*(p_next_y[r] - p_previous_y[r]);
+                double area_gradient_y = -0.5*(p_next_x[r] - p_previous_x[r]);
+                double tension = (perimeter_tensions[r] + line_tension)/p_length[r];
+                double edge_force_x = tension*(p_x[r] - p_next_x[r]);
+                double edge_force_y = tension*(p_y[r] - p_next_y[r]);
+
+                p_force_x[r] -= pressures[r]*area_gradient_x + edge_force_x;
+                p_force_y[r] -= pressures[r]*area_gradient_y + edge_force_y;
+                p_next_force_x[r] += edge_force_x;
+                p_next_force_y[r] += edge_force_y;
+            }
+        }
+    }
+
+    // The random motion, with the scaling of RandomMotionForce
+    double movement_parameter = mpForce->GetMovementParameter();
+    if (movement_parameter > 0.0)
+    {
+        double noise_scaling = sqrt(2.0*movement_parameter*dt)/dt;
+        std::vector<boost::normal_distribution<double> > normals(R);
+        for (unsigned j=0; j<DIM*mNumNodes; j++)
+        {
+            double* p_forces = &mForces[j*R];
+            for (unsigned r=0; r<R; r++)
+            {
+                p_forces[r] += noise_scaling*normals[r](mGenerators[r]);
+            }
+        }
+    }
+}
+
+template<unsigned DIM>
+void ReplicateEnsemble<DIM>::UpdateSrnStates(double dt)
+{
+    const unsigned R = mNumReplicates;
+
+    // Mean Delta of the neighbours of each cell, from the states at the start of the step
+    std::fill(mMeanDeltas.begin(), mMeanDeltas.end(), 0.0);
+    for (unsigned elem_index=0; elem_index<mNumElements; elem_index++)
+    {
+        double* p_mean_delta = &mMeanDeltas[elem_index*R];
+        unsigned num_neighbours = mNeighbourOffsets[elem_index+1] - mNeighbourOffsets[elem_index];
+        if (num_neighbours == 0)
+        {
+            continue;
+        }
+        for (unsigned n=mNeighbourOffsets[elem_index]; n<mNeighbourOffsets[elem_index+1]; n++)
+        {
+            const double* p_delta = &mSrnStates[(2*mNeighbours[n] + 1)*R];
+            for (unsigned r=0; r<R; r++)
+            {
+                p_mean_delta[r] += p_delta[r];
+            }
+        }
+        for (unsigned r=0; r<R; r++)
+        {
+            p_mean_delta[r] /= num_neighbours;
+        }
+    }
+
+    /*
+     * One RK4 step of mOdeSystem per cell, with the mean neighbouring Delta held fixed
+     * over the step, as it is between updates of DeltaNotchTrackingModifier. Time is
+     * measured from the start of the ensemble.
+     */
+    std::vector<double> y(2), stage(2), k1(2), k2(2), k3(2), k4(2);
+    for (unsigned elem_index=0; elem_index<mNumElements; elem_index++)
+    {
+        double* p_notch = &mSrnStates[(2*elem_index)*R];
+        double* p_delta = &mSrnStates[(2*elem_index + 1)*R];
+        const double* p_mean_delta = &mMeanDeltas[elem_index*R];
+        for (unsigned r=0; r<R; r++)
+        {
+            if (mActive[r] == 0.0)
+            {
+                continue;
+            }
+            double time = mNumTimeStepsTaken[r]*dt;
+            mOdeSystem.SetParameter(mMeanDeltaIndex, p_mean_delta[r]);
+            y[0] = p_notch[r];
+            y[1] = p_delta[r];
+
+            mOdeSystem.EvaluateYDerivatives(time, y, k1);
+            for (unsigned k=0; k<2; k++)
+            {
+                stage[k] = y[k] + 0.5*dt*k1[k];
+            }
+            mOdeSystem.EvaluateYDerivatives(time + 0.5*dt, stage, k2);
+            for (unsigned k=0; k<2; k++)
+            {
+                stage[k] = y[k] + 0.5*dt*k2[k];
+            }
+            mOdeSystem.EvaluateYDerivatives(time + 0.5*dt, stage, k3);
+            for (unsigned k=0; k<2; k++)
+            {
+                stage[k] = y[k] + dt*k3[k];
+            }
+            mOdeSystem.EvaluateYDerivatives(time + dt, stage, k4);
+
+            p_notch[r] += dt*(k1[0] + 2.0*k2[0] + 2.0*k3[0] + k4[0])/6.0;
+            p_delta[r] += dt*(k1[1] + 2.0*k2[1] + 2.0*k3[1] + k4[1])/6.0;
+        }
+    }
+}
+
+template<unsigned DIM>
+void ReplicateEnsemble<DIM>::WriteReplicateToPopulation(unsigned replicate)
+{
+    assert(replicate < mNumReplicates);
+    for (unsigned node_index=0; node_index<mNumNodes; node_index++)
+    {
+        ChastePoint<DIM> location(GetNodeLocation(replicate, node_index));
+        mrCellPopulation.SetNode(node_index, location);
+    }
+
+    for (unsigned elem_index=0; elem_index<mNumElements; elem_index++)
+    {
+        CellPtr p_cell = mrCellPopulation.GetCellUsingLocationIndex(elem_index);
+        std::vector<double> state(2);
+        state[0] = GetNotch(replicate, elem_index);
+        state[1] = GetDelta(replicate, elem_index);
+        static_cast<AbstractOdeSrnModel*>(p_cell->GetSrnModel())->GetOdeSystem()->SetStateVariables(state);
+
+        // As DeltaNotchTrackingModifier would record them
+        p_cell->GetCellData()->SetItem("notch", state[0]);
+        p_cell->GetCellData()->SetItem("delta", state[1]);
+    }
+}
+
+template<unsigned DIM>
+c_vector<double, DIM> ReplicateEnsemble<DIM>::GetNodeLocation(unsigned replicate, unsigned nodeIndex)
+{
+    c_vector<double, DIM> location;
+    for (unsigned i=0; i<DIM; i++)
+    {
+        location[i] = mLocations[(DIM*nodeIndex + i)*mNumReplicates + replicate];
+    }
+    return location;
+}
+
+template<unsigned DIM>
+double ReplicateEnsemble<DIM>::GetNotch(unsigned replicate, unsigned elemIndex)
+{
+    return mSrnStates[(2*elemIndex)*mNumReplicates + replicate];
+}
+
+template<unsigned DIM>
+double ReplicateEnsemble<DIM>::GetDelta(unsigned replicate, unsigned elemIndex)
+{
+    return mSrnStates[(2*elemIndex + 1)*mNumReplicates + replicate];
+}
+
+template<unsigned DIM>
+bool ReplicateEnsemble<DIM>::IsReplicateActive(unsigned replicate)
+{
+    return mActive[replicate] > 0.0;
+}
+
+template<unsigned DIM>
+unsigned ReplicateEnsemble<DIM>::GetNumActiveReplicates()
+{
+    unsigned num_active = 0;
+    for (unsigned r=0; r<mNumReplicates; r++)
+    {
+        num_active += (unsigned)mActive[r];
+    }
+    return num_active;
+}
+
+template<unsigned DIM>
+unsigned ReplicateEnsemble<DIM>::GetNumReplicates()
+{
+    return mNumReplicates;
+}
+
+template<unsigned DIM>
+unsigned ReplicateEnsemble<DIM>::GetNumTimeSteps(unsigned replicate)
+{
+    return mNumTimeStepsTaken[replicate];
+}
+
+// Explicit instantiation
+template class ReplicateEnsemble<1>;
+template class ReplicateEnsemble<2>;
+template class ReplicateEnsemble<3>;
@@ -0,0 +1,230 @@
+
+#ifndef REPLICATEENSEMBLE_HPP_
+#define REPLICATEENSEMBLE_HPP_
+
+#include <boost/shared_ptr.hpp>
+#include <boost/random/mersenne_twister.hpp>
+
+#include "VertexBasedCellPopulation.hpp"
+#include "MatteoForce.hpp"
+#include "DeltaNotchOdeSystem.hpp"
+
+/**
+ * Advances several replicates of the same vertex-based tissue in lockstep, as a
+ * cheaper alternative to running each replicate as a separate simulation.
+ *
+ * The replicates share the mesh topology, cell types, target areas and line tensions
+ * of a template population, and differ in their node locations, Delta-Notch states
+ * and random motion. Node locations and SRN states are stored replicate-innermost,
+ * so that every loop of the force and geometry kernels runs over the replicates in
+ * contiguous memory with the same control flow, and vectorises across them.
+ *
+ * Each time step applies the MatteoForce (with its random motion) by forward Euler,
+ * with the overdamped dynamics of OffLatticeSimulation, then advances the Delta-Notch
+ * system of each cell by one fixed RK4 step, with the mean neighbouring Delta computed
+ * as DeltaNotchTrackingModifier does. The right-hand side is evaluated by a
+ * DeltaNotchOdeSystem, the system MatteoSrnModel solves, so the two cannot drift apart.
+ *
+ * Each replicate draws its random motion and random initial states from its own
+ * generator, seeded from RandomNumberGenerator on construction. A replicate therefore
+ * follows the same path whatever the number of replicates alongside it, and
+ * replicates do not share a stream.
+ *
+ * The replicates cannot rearrange, as they would then no longer share a topology.
+ * Before each step the ensemble checks for edges shorter than the rearrangement
+ * threshold and triangular elements smaller than the T2 threshold of the template
+ * mesh; a replicate with either is split off. It is frozen from then on, and can be
+ * written back to a population with WriteReplicateToPopulation() and continued as an
+ * ordinary simulation.
+ *
+ * Only implemented in 2D.
+ */
+template<unsigned DIM>
+class ReplicateEnsemble
+{
+private:
+
+    /** The population the replicates are copies of. */
+    VertexBasedCellPopulation<DIM>& mrCellPopulation;
+
+    /** The force applied to every replicate. */
+    boost::shared_ptr<MatteoForce<DIM> > mpForce;
+
+    /** Number of replicates. */
+    unsigned mNumReplicates;
+
+    /** Number of nodes in each replicate. */
+    unsigned mNumNodes;
+
+    /** Number of elements in each replicate. */
+    unsigned mNumElements;
+
+    /** Offset of each element's slots in the slot arrays (one extra entry at the end). */
+    std::vector<unsigned> mElementOffsets;
+
+    /** Global index of the node at each slot. */
+    std::vector<unsigned> mSlotNodes;
+
+    /** Global index of the node at the next slot of the same element. */
+    std::vector<unsigned> mSlotNextNodes;
+
+    /** Global index of the node at the previous slot of the same element. */
+    std::vector<unsigned> mSlotPreviousNodes;
+
+    /** Line tension of the edge from each slot's node to the next, halved for internal edges. */
+    std::vector<double> mSlotLineTensions;
+
+    /** Target area of each element. */
+    std::vector<double> mTargetAreas;
+
+    /** Offset of each element's neighbours in mNeighbours (one extra entry at the end). */
+    std::vector<unsigned> mNeighbourOffsets;
+
+    /** The neighbouring elements of each element, as used for the mean Delta. */
+    std::vector<unsigned> mNeighbours;
+
+    /** Node locations, indexed by ((DIM*node + i)*mNumReplicates + replicate). */
+    std::vector<double> mLocations;
+
+    /** Forces on the nodes, laid out as mLocations. */
+    std::vector<double> mForces;
+
+    /** Notch and Delta of each cell, indexed by ((2*element + k)*mNumReplicates + replicate). */
+    std::vector<double> mSrnStates;
+
+    /** Mean neighbouring Delta of each cell, indexed by (element*mNumReplicates + replicate). */
+    std::vector<double> mMeanDeltas;
+
+    /** Area of each element, laid out as mMeanDeltas. */
+    std::vector<double> mAreas;
+
+    /** Perimeter of each element, laid out as mMeanDeltas. */
+    std::vector<double> mPerimeters;
+
+    /** Length of the edge from each slot's node to the next, indexed by (slot*mNumReplicates + replicate). */
+    std::vector<double> mEdgeLengths;
+
+    /** One for each replicate still being advanced, zero for each replicate that has been split off. */
+    std::vector<double> mActive;
+
+    /** Number of time steps each replicate has taken, which stops growing when it is split off. */
+    std::vector<unsigned> mNumTimeStepsTaken;
+
+    /** The random number generator of each replicate. */
+    std::vector<boost::mt19937> mGenerators;
+
+    /** The Delta-Notch system whose right-hand side every cell of every replicate is advanced by. */
+    DeltaNotchOdeSystem mOdeSystem;
+
+    /** Index of the mean Delta parameter of mOdeSystem. */
+    unsigned mMeanDeltaIndex;
+
+    /**
+     * Compute the areas, perimeters and edge lengths of every replicate.
+     */
+    void ComputeGeometry();
+
+    /**
+     * Split off any replicate in which a T1 or T2 swap is due.
+     */
+    void SplitOffRearrangingReplicates();
+
+    /**
+     * Compute the forces on the nodes of every replicate, including the random motion.
+     *
+     * @param dt the time step
+     */
+    void ComputeForces(double dt);
+
+    /**
+     * Advance the Delta-Notch system of every cell of every replicate by one RK4 step
+     * of mOdeSystem.
+     *
+     * @param dt the time step
+     */
+    void UpdateSrnStates(double dt);
+
+public:
+
+    /**
+     * Constructor. Every replicate starts from the node locations and SRN states of the
+     * template population, whose target areas must already have been set, for example
+     * by calling UpdateTargetAreas() on a ConstantTargetAreaModifier. The generator of
+     * each replicate is seeded by a draw from RandomNumberGenerator, in replicate order.
+     *
+     * @param rCellPopulation the template population
+     * @param pForce the force to apply
+     * @param numReplicates the number of replicates
+     */
+    ReplicateEnsemble(VertexBasedCellPopulation<DIM>& rCellPopulation,
+                      boost::shared_ptr<MatteoForce<DIM> > pForce,
+                      unsigned numReplicates);
+
+    /**
+     * Draw fresh random initial Notch and Delta levels in (0, 1) for every cell of every
+     * replicate, as TestOptogenetics does for a single simulation, from the generator
+     * of each replicate.
+     */
+    void RandomiseSrnStates();
+
+    /**
+     * Advance every active replicate by a number of time steps.
+     *
+     * @param dt the time step
+     * @param numTimeSteps the number of time steps to take
+     */
+    void Advance(double dt, unsigned numTimeSteps);
+
+    /**
+     * Copy the node locations and SRN states of a replicate to the template population,
+     * for output or to continue the replicate as an ordinary simulation.
+     *
+     * @param replicate the replicate
+     */
+    void WriteReplicateToPopulation(unsigned replicate);
+
+    /**
+     * @param replicate the replicate
+     * @param nodeIndex the global index of a node
+     * @return the location of the node in the replicate
+     */
+    c_vector<double, DIM> GetNodeLocation(unsigned replicate, unsigned nodeIndex);
+
+    /**
+     * @param replicate the replicate
+     * @param elemIndex the index of an element
+     * @return the Notch level of the cell in the replicate
+     */
+    double GetNotch(unsigned replicate, unsigned elemIndex);
+
+    /**
+     * @param replicate the replicate
+     * @param elemIndex the index of an element
+     * @return the Delta level of the cell in the replicate
+     */
+    double GetDelta(unsigned replicate, unsigned elemIndex);
+
+    /**
+     * @param replicate the replicate
+     * @return whether the replicate is still being advanced
+     */
+    bool IsReplicateActive(unsigned replicate);
+
+    /**
+     * @return the number of replicates still being advanced
+     */
+    unsigned GetNumActiveReplicates();
+
+    /**
+     * @return the number of replicates
+     */
+    unsigned GetNumReplicates();
+
+    /**
+     * @param replicate the replicate
+     * @return the number of time steps the replicate has taken
+     */
+    unsigned GetNumTimeSteps(unsigned replicate);
+};
+
+#endif /*REPLICATEENSEMBLE_HPP_*/
@@ -0,0 +1,258 @@
+
+#include "SemiImplicitEulerNumericalMethod.hpp"
+#include "ReplicatableVector.hpp"
+#include "PetscTools.hpp"
+#include "ProfiledForce.hpp"
+
+template<unsigned DIM>
+SemiImplicitEulerNumericalMethod<DIM>::SemiImplicitEulerNumericalMethod()
+    : AbstractNumericalMethod<DIM, DIM>(),
+      mLinearSolverTolerance(1e-8)
+{
+}
+
+template<unsigned DIM>
+SemiImplicitEulerNumericalMethod<DIM>::~SemiImplicitEulerNumericalMethod()
+{
+}
+
+template<unsigned DIM>
+boost::shared_ptr<FarhadifarForce<DIM> > SemiImplicitEulerNumericalMethod<DIM>::GetFarhadifarForce()
+{
+    for (typename std::vector<boost::shared_ptr<AbstractForce<DIM, DIM> > >::iterator iter = this->mpForceCollection->begin();
+         iter != this->mpForceCollection->end();
+         ++iter)
+    {
+        boost::shared_ptr<FarhadifarForce<DIM> > p_force = boost::dynamic_pointer_cast<FarhadifarForce<DIM> >(ProfiledForce<DIM>::Unwrap(*iter));
+        if (p_force)
+        {
+            return p_force;
+        }
+    }
+    return boost::shared_ptr<FarhadifarForce<DIM> >();
+}
+
+template<unsigned DIM>
+void SemiImplicitEulerNumericalMethod<DIM>::AddEnergyHessian(LinearSystem& rLinearSystem,
+                                                             FarhadifarForce<DIM>& rForce,
+                                                             VertexBasedCellPopulation<DIM>& rCellPopulation)
+{
+    MutableVertexMesh<DIM,DIM>& r_mesh = rCellPopulation.rGetMesh();
+    double area_elasticity = rForce.GetAreaElasticityParameter();
+    double perimeter_contractility = rForce.GetPerimeterContractilityParameter();
+
+    for (typename VertexMesh<DIM,DIM>::VertexElementIterator elem_iter = r_mesh.GetElementIteratorBegin();
+         elem_iter != r_mesh.GetElementIteratorEnd();
+         ++elem_iter)
+    {
+        unsigned elem_index = elem_iter->GetIndex();
+        unsigned num_nodes_elem = elem_iter->GetNumNodes();
+        unsigned size = 2*num_nodes_elem;
+        double target_area = rCellPopulation.GetCellUsingLocationIndex(elem_index)->GetCellData()->GetItem("target area");
+
+        // Gather the element's nodes, and the inverse damping constant of each row of its block
+        std::vector<Node<DIM>*> nodes(num_nodes_elem);
+        std::vector<unsigned> rows(size);
+        std::vector<double> row_scales(size);
+        for (unsigned k=0; k<num_nodes_elem; k++)
+        {
+            nodes[k] = elem_iter->GetNode(k);
+            unsigned node_index = nodes[k]->GetIndex();
+            double inverse_damping = 1.0/rCellPopulation.GetDampingConstant(node_index);
+            for (unsigned d=0; d<2; d++)
+            {
+                rows[2*k + d] = 2*node_index + d;
+                row_scales[2*k + d] = inverse_damping;
+            }
+        }
+
+        // Area, perimeter and their gradients; the orientation sign makes the area positive
+        double signed_area = 0.0;
+        for (unsigned k=0; k<num_nodes_elem; k++)
+        {
+            const c_vector<double, DIM>& r_this = nodes[k]->rGetLocation();
+            const c_vector<double, DIM>& r_next = nodes[(k+1)%num_nodes_elem]->rGetLocation();
+            signed_area += 0.5*(r_this[0]*r_next[1] - r_next[0]*r_this[1]);
+        }
+        double orientation = (signed_area > 0.0) ? 1.0 : -1.0;
+        double area = orientation*signed_area;
+
+        std::vector<double> area_gradient(size);
+        std::vector<double> perimeter_gradient(size, 0.0);
+        std::vector<c_vector<double, 2> > edge_directions(num_nodes_elem);
+        std::vector<double> edge_lengths(num_nodes_elem);
+        double perimeter = 0.0;
+        for (unsigned k=0; k<num_nodes_elem; k++)
+        {
+            unsigned next = (k+1)%num_nodes_elem;
+            const c_vector<double, DIM>& r_previous = nodes[(k+num_nodes_elem-1)%num_nodes_elem]->rGetLocation();
+            const c_vector<double, DIM>& r_this = nodes[k]->rGetLocation();
+            const c_vector<double, DIM>& r_next = nodes[next]->rGetLocation();
+            area_gradient[2*k] = 0.5*orientation*(r_next[1] - r_previous[1]);
+            area_gradient[2*k+1] = 0.5*orientation*(r_previous[0] - r_next[0]);
+
+            c_vector<double, 2> edge;
+            edge[0] = r_this[0] - r_next[0];
+            edge[1] = r_this[1] - r_next[1];
+            edge_lengths[k] = norm_2(edge);
+            edge_directions[k] = edge/edge_lengths[k];
+            perimeter += edge_lengths[k];
+            for (unsigned d=0; d<2; d++)
+            {
+                perimeter_gradient[2*k + d] += edge_directions[k][d];
+                perimeter_gradient[2*next + d] -= edge_directions[k][d];
+            }
+        }
+
+        // Rank-one terms from the area elasticity and perimeter contractility
+        for (unsigned a=0; a<size; a++)
+        {
+            for (unsigned b=0; b<size; b++)
+            {
+                double value = area_elasticity*area_gradient[a]*area_gradient[b]
+                               + perimeter_contractility*perimeter_gradient[a]*perimeter_gradient[b];
+                rLinearSystem.AddToMatrixElement(rows[a], rows[b], row_scales[a]*value);
+            }
+        }
+
+        // Curvature of the area: d2A/dx_k dy_{k+1} = 1/2 and d2A/dx_k dy_{k-1} = -1/2
+        double area_coefficient = 0.5*orientation*area_elasticity*(area - target_area);
+        for (unsigned k=0; k<num_nodes_elem; k++)
+        {
+            unsigned x_k = 2*k;
+            unsigned y_next = 2*((k+1)%num_nodes_elem) + 1;
+            unsigned y_previous = 2*((k+num_nodes_elem-1)%num_nodes_elem) + 1;
+            rLinearSystem.AddToMatrixElement(rows[x_k], rows[y_next], row_scales[x_k]*area_coefficient);
+            rLinearSystem.AddToMatrixElement(rows[y_next], rows[x_k], row_scales[y_next]*area_coefficient);
+            rLinearSystem.AddToMatrixElement(rows[x_k], rows[y_previous], -row_scales[x_k]*area_coefficient);
+            rLinearSystem.AddToMatrixElement(rows[y_previous], rows[x_k], -row_scales[y_previous]*area_coefficient);
+        }
+
+        // Curvature of each edge length, weighted by the perimeter contractility and the edge's line tension
+        for (unsigned k=0; k<num_nodes_elem; k++)
+        {
+            unsigned next = (k+1)%num_nodes_elem;
+            double tension = perimeter_contractility*perimeter
+                             + rForce.GetLineTensionParameter(elem_index, nodes[k], nodes[next], rCellPopulation);
+            for (unsigned d=0; d<2; d++)
+            {
+                for (unsigned e=0; e<2; e++)
+                {
+                    double value = tension*((d == e ? 1.0 : 0.0) - edge_directions[k][d]*edge_directions[k][e])/edge_lengths[k];
+                    rLinearSystem.AddToMatrixElement(rows[2*k + d], rows[2*k + e], row_scales[2*k + d]*value);
+                    rLinearSystem.AddToMatrixElement(rows[2*next + d], rows[2*next + e], row_scales[2*next + d]*value);
+                    rLinearSystem.AddToMatrixElement(rows[2*k + d], rows[2*next + e], -row_scales[2*k + d]*value);
+                    rLinearSystem.AddToMatrixElement(rows[2*next + d], rows[2*k + e], -row_scales[2*next + d]*value);
+                }
+            }
+        }
+    }
+}
+
+template<unsigned DIM>
+void SemiImplicitEulerNumericalMethod<DIM>::UpdateAllNodePositions(double dt)
+{
+    if (DIM != 2)
+    {
+        EXCEPTION("SemiImplicitEulerNumericalMethod is only implemented in 2D");
+    }
+    VertexBasedCellPopulation<DIM>* p_cell_population = dynamic_cast<VertexBasedCellPopulation<DIM>*>(this->mpCellPopulation);
+    if (p_cell_population == NULL)
+    {
+        EXCEPTION("SemiImplicitEulerNumericalMethod is to be used with a VertexBasedCellPopulation only");
+    }
+
+    // The right-hand side is the damped force from every force in the collection
+    std::vector<c_vector<double, DIM> > forces = this->ComputeForcesIncludingDamping();
+    unsigned num_nodes = p_cell_population->GetNumNodes();
+
+    std::vector<double> displacements(DIM*num_nodes);
+    boost::shared_ptr<FarhadifarForce<DIM> > p_force = GetFarhadifarForce();
+    if (!p_force)
+    {
+        for (unsigned node_index=0; node_index<num_nodes; node_index++)
+        {
+            for (unsigned d=0; d<DIM; d++)
+            {
+                displacements[DIM*node_index + d] = dt*forces[node_index][d];
+            }
+        }
+    }
+    else
+    {
+        // Each row couples a node to the nodes of the elements containing it
+        unsigned row_preallocation = 0;
+        for (unsigned node_index=0; node_index<num_nodes; node_index++)
+        {
+            const std::set<unsigned>& r_elements = p_cell_population->GetNode(node_index)->rGetContainingElementIndices();
+            unsigned num_coupled = 0;
+            for (std::set<unsigned>::const_iterator iter = r_elements.begin(); iter != r_elements.end(); ++iter)
+            {
+                num_coupled += p_cell_population->GetElement(*iter)->GetNumNodes();
+            }
+            row_preallocation = std::max(row_preallocation, DIM*num_coupled);
+        }
+
+        LinearSystem linear_system(DIM*num_nodes, row_preallocation);
+        linear_system.SetKspType("gmres");
+        linear_system.SetPcType("jacobi");
+        linear_system.SetRelativeTolerance(mLinearSolverTolerance);
+
+        for (unsigned node_index=0; node_index<num_nodes; node_index++)
+        {
+            for (unsigned d=0; d<DIM; d++)
+            {
+                linear_system.AddToMatrixElement(DIM*node_index + d, DIM*node_index + d, 1.0/dt);
+                linear_system.SetRhsVectorElement(DIM*node_index + d, forces[node_index][d]);
+            }
+        }
+        AddEnergyHessian(linear_system, *p_force, *p_cell_population);
+        linear_system.AssembleFinalLinearSystem();
+
+        Vec solution = linear_system.Solve();
+        ReplicatableVector replicated_solution(solution);
+        PetscTools::Destroy(solution);
+        for (unsigned i=0; i<DIM*num_nodes; i++)
+        {
+            displacements[i] = replicated_solution[i];
+        }
+    }
+
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        c_vector<double, DIM> displacement;
+        for (unsigned d=0; d<DIM; d++)
+        {
+            displacement[d] = displacements[DIM*node_index + d];
+        }
+        this->DetectStepSizeExceptions(node_index, displacement, dt);
+
+        c_vector<double, DIM> new_node_location = p_cell_population->GetNode(node_index)->rGetLocation() + displacement;
+        this->SafeNodePositionUpdate(node_index, new_node_location);
+    }
+}
+
+template<unsigned DIM>
+void SemiImplicitEulerNumericalMethod<DIM>::SetLinearSolverTolerance(double linearSolverTolerance)
+{
+    assert(linearSolverTolerance > 0.0);
+    mLinearSolverTolerance = linearSolverTolerance;
+}
+
+template<unsigned DIM>
+void SemiImplicitEulerNumericalMethod<DIM>::OutputNumericalMethodParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<LinearSolverTolerance>" << mLinearSolverTolerance << "</LinearSolverTolerance>\n";
+
+    // Call method on direct parent class
+    AbstractNumericalMethod<DIM, DIM>::OutputNumericalMethodParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class SemiImplicitEulerNumericalMethod<1>;
+template class SemiImplicitEulerNumericalMethod<2>;
+template class SemiImplicitEulerNumericalMethod<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(SemiImplicitEulerNumericalMethod)
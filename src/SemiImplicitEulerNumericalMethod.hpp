@@ -0,0 +1,112 @@
+
+#ifndef SEMIIMPLICITEULERNUMERICALMETHOD_HPP_
+#define SEMIIMPLICITEULERNUMERICALMETHOD_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include "AbstractNumericalMethod.hpp"
+#include "FarhadifarForce.hpp"
+#include "LinearSystem.hpp"
+#include "VertexBasedCellPopulation.hpp"
+
+/**
+ * A linearised backward Euler numerical method for 2D vertex-based simulations
+ * using a FarhadifarForce (or MatteoForce).
+ *
+ * The overdamped equation of motion eta_i dx_i/dt = F_i(x) is linearised about
+ * the current positions, and the update dx solves
+ *   (I/dt + D^{-1} H) dx = D^{-1} F(x),
+ * where D holds the node damping constants and H is the Hessian of the Farhadifar
+ * energy, assembled analytically element by element. The stiff area elasticity
+ * and perimeter contractility are thus treated implicitly, allowing much larger
+ * time steps than forward Euler. All other forces in the force collection, such as
+ * RandomMotionForce, only enter through F and so are treated explicitly.
+ *
+ * The system is sparse, with one 2x2 block per pair of nodes sharing an element,
+ * and is solved with PETSc GMRES. The Hessian is not positive definite away from
+ * minima, so the method remains only linearly implicit; the step should still be
+ * small enough that the tissue does not rearrange much within it.
+ *
+ * If no FarhadifarForce has been added to the simulation, the method reduces to
+ * forward Euler.
+ */
+template<unsigned DIM>
+class SemiImplicitEulerNumericalMethod : public AbstractNumericalMethod<DIM, DIM>
+{
+private:
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractNumericalMethod<DIM, DIM> >(*this);
+        archive & mLinearSolverTolerance;
+    }
+
+    /** Relative tolerance of the linear solver. Defaults to 1e-8. */
+    double mLinearSolverTolerance;
+
+    /**
+     * @return the first FarhadifarForce in the force collection, or an empty pointer if there is none
+     */
+    boost::shared_ptr<FarhadifarForce<DIM> > GetFarhadifarForce();
+
+    /**
+     * Add the Hessian of the energy of each element, scaled row by row by the inverse
+     * node damping constants, to the matrix of a linear system.
+     *
+     * @param rLinearSystem the linear system
+     * @param rForce the force whose energy is differentiated
+     * @param rCellPopulation the cell population
+     */
+    void AddEnergyHessian(LinearSystem& rLinearSystem,
+                          FarhadifarForce<DIM>& rForce,
+                          VertexBasedCellPopulation<DIM>& rCellPopulation);
+
+public:
+
+    /**
+     * Constructor.
+     */
+    SemiImplicitEulerNumericalMethod();
+
+    /**
+     * Destructor.
+     */
+    virtual ~SemiImplicitEulerNumericalMethod();
+
+    /**
+     * Overridden UpdateAllNodePositions() method.
+     *
+     * @param dt the time step
+     */
+    virtual void UpdateAllNodePositions(double dt);
+
+    /**
+     * Set mLinearSolverTolerance.
+     *
+     * @param linearSolverTolerance relative tolerance of the linear solver
+     */
+    void SetLinearSolverTolerance(double linearSolverTolerance);
+
+    /**
+     * Overridden OutputNumericalMethodParameters() method.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    virtual void OutputNumericalMethodParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(SemiImplicitEulerNumericalMethod)
+
+#endif /*SEMIIMPLICITEULERNUMERICALMETHOD_HPP_*/
@@ -0,0 +1,295 @@
+
+#include "SharedMemoryExportModifier.hpp"
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "CellLabel.hpp"
+#include "PopulationConstants.hpp"
+
+/**
+ * @param offset an offset in bytes
+ * @return the offset rounded up to a multiple of 8, so that doubles are aligned
+ */
+static uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + 7) & ~uint64_t(7);
+}
+
+template<unsigned DIM>
+const uint32_t SharedMemoryExportModifier<DIM>::LAYOUT_VERSION;
+
+template<unsigned DIM>
+SharedMemoryExportModifier<DIM>::SharedMemoryExportModifier()
+    : AbstractCellBasedSimulationModifier<DIM>(),
+      mExportInterval(1),
+      mSegmentName(""),
+      mSegmentPath(""),
+      mRemoveSegmentAtExit(true),
+      mSegmentFd(-1),
+      mpSegment(NULL),
+      mSegmentSize(0)
+{
+}
+
+template<unsigned DIM>
+SharedMemoryExportModifier<DIM>::~SharedMemoryExportModifier()
+{
+    CloseSegment();
+}
+
+template<unsigned DIM>
+void SharedMemoryExportModifier<DIM>::CloseSegment()
+{
+    if (mpSegment != NULL)
+    {
+        munmap(mpSegment, mSegmentSize);
+        mpSegment = NULL;
+        mSegmentSize = 0;
+    }
+    if (mSegmentFd >= 0)
+    {
+        close(mSegmentFd);
+        mSegmentFd = -1;
+        if (mRemoveSegmentAtExit)
+        {
+            unlink(mSegmentPath.c_str());
+        }
+    }
+}
+
+template<unsigned DIM>
+void SharedMemoryExportModifier<DIM>::ReserveSegment(std::size_t size)
+{
+    if (size <= mSegmentSize)
+    {
+        return;
+    }
+
+    // Grow by half as much again, in whole pages, so that a growing tissue rarely remaps
+    std::size_t page_size = sysconf(_SC_PAGESIZE);
+    std::size_t new_size = ((size + size/2 + page_size - 1)/page_size)*page_size;
+    if (ftruncate(mSegmentFd, new_size) != 0)
+    {
+        EXCEPTION("Could not resize the shared memory segment " << mSegmentPath << ": " << strerror(errno));
+    }
+    if (mpSegment != NULL)
+    {
+        munmap(mpSegment, mSegmentSize);
+    }
+    void* p_mapping = mmap(NULL, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, mSegmentFd, 0);
+    if (p_mapping == MAP_FAILED)
+    {
+        mpSegment = NULL;
+        mSegmentSize = 0;
+        EXCEPTION("Could not map the shared memory segment " << mSegmentPath << ": " << strerror(errno));
+    }
+    mpSegment = static_cast<char*>(p_mapping);
+    mSegmentSize = new_size;
+    reinterpret_cast<SharedTissueHeader*>(mpSegment)->mSegmentSize = new_size;
+}
+
+template<unsigned DIM>
+void SharedMemoryExportModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    if (dynamic_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation) == NULL)
+    {
+        EXCEPTION("SharedMemoryExportModifier is to be used with a VertexBasedCellPopulation only");
+    }
+
+    CloseSegment();
+    std::string name = mSegmentName;
+    if (name.empty())
+    {
+        std::stringstream default_name;
+        default_name << "chaste-tissue-" << getpid();
+        name = default_name.str();
+    }
+    mSegmentPath = "/dev/shm/" + name;
+
+    mSegmentFd = open(mSegmentPath.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (mSegmentFd < 0)
+    {
+        EXCEPTION("Could not create the shared memory segment " << mSegmentPath << ": " << strerror(errno));
+    }
+    ReserveSegment(sizeof(SharedTissueHeader));
+
+    SharedTissueHeader* p_header = reinterpret_cast<SharedTissueHeader*>(mpSegment);
+    memcpy(p_header->mMagic, "CHSTTISS", 8);
+    p_header->mVersion = LAYOUT_VERSION;
+    p_header->mDimension = DIM;
+    p_header->mSequence = 0;
+    p_header->mNumUpdates = 0;
+    std::cout << "Exporting the tissue to " << mSegmentPath << "\n" << std::flush;
+
+    Export(*static_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation), false);
+}
+
+template<unsigned DIM>
+void SharedMemoryExportModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (mExportInterval > 0 && SimulationTime::Instance()->GetTimeStepsElapsed()%mExportInterval == 0)
+    {
+        Export(*static_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation), false);
+    }
+}
+
+template<unsigned DIM>
+void SharedMemoryExportModifier<DIM>::UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    Export(*static_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation), true);
+}
+
+template<unsigned DIM>
+void SharedMemoryExportModifier<DIM>::Export(VertexBasedCellPopulation<DIM>& rCellPopulation, bool finished)
+{
+    if (mpSegment == NULL)
+    {
+        return;
+    }
+
+    MutableVertexMesh<DIM,DIM>& r_mesh = rCellPopulation.rGetMesh();
+    unsigned num_nodes = r_mesh.GetNumNodes();
+    unsigned num_elements = r_mesh.GetNumElements();
+    unsigned num_element_nodes = 0;
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        num_element_nodes += r_mesh.GetElement(elem_index)->GetNumNodes();
+    }
+
+    uint64_t node_locations_offset = AlignOffset(sizeof(SharedTissueHeader));
+    uint64_t element_offsets_offset = node_locations_offset + sizeof(double)*DIM*num_nodes;
+    uint64_t element_nodes_offset = element_offsets_offset + sizeof(uint32_t)*(num_elements + 1);
+    uint64_t cell_types_offset = AlignOffset(element_nodes_offset + sizeof(uint32_t)*num_element_nodes);
+    uint64_t notch_offset = AlignOffset(cell_types_offset + sizeof(int32_t)*num_elements);
+    uint64_t delta_offset = notch_offset + sizeof(double)*num_elements;
+    uint64_t fitness_offset = delta_offset + sizeof(double)*num_elements;
+    uint64_t size = fitness_offset + sizeof(double)*num_elements;
+
+    // Take the seqlock: an odd sequence number tells readers a write is in progress
+    uint64_t sequence = reinterpret_cast<SharedTissueHeader*>(mpSegment)->mSequence;
+    __atomic_store_n(&reinterpret_cast<SharedTissueHeader*>(mpSegment)->mSequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    ReserveSegment(size);
+    SharedTissueHeader* p_header = reinterpret_cast<SharedTissueHeader*>(mpSegment);
+    p_header->mTime = SimulationTime::Instance()->GetTime();
+    p_header->mNumNodes = num_nodes;
+    p_header->mNumElements = num_elements;
+    p_header->mNumElementNodes = num_element_nodes;
+    p_header->mFinished = finished ? 1 : 0;
+    p_header->mNodeLocationsOffset = node_locations_offset;
+    p_header->mElementOffsetsOffset = element_offsets_offset;
+    p_header->mElementNodesOffset = element_nodes_offset;
+    p_header->mCellTypesOffset = cell_types_offset;
+    p_header->mNotchOffset = notch_offset;
+    p_header->mDeltaOffset = delta_offset;
+    p_header->mFitnessOffset = fitness_offset;
+
+    double* p_locations = reinterpret_cast<double*>(mpSegment + node_locations_offset);
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        const c_vector<double, DIM>& r_location = r_mesh.GetNode(node_index)->rGetLocation();
+        for (unsigned i=0; i<DIM; i++)
+        {
+            p_locations[DIM*node_index + i] = r_location[i];
+        }
+    }
+
+    uint32_t* p_element_offsets = reinterpret_cast<uint32_t*>(mpSegment + element_offsets_offset);
+    uint32_t* p_element_nodes = reinterpret_cast<uint32_t*>(mpSegment + element_nodes_offset);
+    int32_t* p_cell_types = reinterpret_cast<int32_t*>(mpSegment + cell_types_offset);
+    double* p_notch = reinterpret_cast<double*>(mpSegment + notch_offset);
+    double* p_delta = reinterpret_cast<double*>(mpSegment + delta_offset);
+    double* p_fitness = reinterpret_cast<double*>(mpSegment + fitness_offset);
+    const double missing = std::numeric_limits<double>::quiet_NaN();
+    unsigned slot = 0;
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        VertexElement<DIM,DIM>* p_element = r_mesh.GetElement(elem_index);
+        p_element_offsets[elem_index] = slot;
+        for (unsigned local_index=0; local_index<p_element->GetNumNodes(); local_index++)
+        {
+            p_element_nodes[slot++] = p_element->GetNodeGlobalIndex(local_index);
+        }
+
+        CellPtr p_cell = rCellPopulation.GetCellUsingLocationIndex(elem_index);
+        p_cell_types[elem_index] = ((p_cell->GetCellProliferativeType() == p_wild_type) ? 0 : 1)
+                                   + (p_cell->template HasCellProperty<CellLabel>() ? 2 : 0);
+
+        // Cells need not all carry the same CellData items, so a missing item is NaN for that cell only
+        boost::shared_ptr<CellData> p_cell_data = p_cell->GetCellData();
+        p_notch[elem_index] = p_cell_data->HasItem("notch") ? p_cell_data->GetItem("notch") : missing;
+        p_delta[elem_index] = p_cell_data->HasItem("delta") ? p_cell_data->GetItem("delta") : missing;
+        p_fitness[elem_index] = p_cell_data->HasItem("fitness") ? p_cell_data->GetItem("fitness") : missing;
+    }
+    p_element_offsets[num_elements] = slot;
+
+    // Release the seqlock, making everything written above visible first
+    p_header->mNumUpdates++;
+    __atomic_store_n(&p_header->mSequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+template<unsigned DIM>
+const SharedTissueHeader* SharedMemoryExportModifier<DIM>::GetHeader() const
+{
+    return reinterpret_cast<const SharedTissueHeader*>(mpSegment);
+}
+
+template<unsigned DIM>
+const std::string& SharedMemoryExportModifier<DIM>::rGetSegmentPath() const
+{
+    return mSegmentPath;
+}
+
+template<unsigned DIM>
+unsigned SharedMemoryExportModifier<DIM>::GetExportInterval()
+{
+    return mExportInterval;
+}
+
+template<unsigned DIM>
+void SharedMemoryExportModifier<DIM>::SetExportInterval(unsigned exportInterval)
+{
+    mExportInterval = exportInterval;
+}
+
+template<unsigned DIM>
+void SharedMemoryExportModifier<DIM>::SetSegmentName(const std::string& rSegmentName)
+{
+    if (rSegmentName.find('/') != std::string::npos)
+    {
+        EXCEPTION("The shared memory segment name must not contain '/'");
+    }
+    mSegmentName = rSegmentName;
+}
+
+template<unsigned DIM>
+void SharedMemoryExportModifier<DIM>::SetRemoveSegmentAtExit(bool removeSegmentAtExit)
+{
+    mRemoveSegmentAtExit = removeSegmentAtExit;
+}
+
+template<unsigned DIM>
+void SharedMemoryExportModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<ExportInterval>" << mExportInterval << "</ExportInterval>\n";
+    *rParamsFile << "\t\t\t<SegmentName>" << mSegmentName << "</SegmentName>\n";
+    *rParamsFile << "\t\t\t<RemoveSegmentAtExit>" << mRemoveSegmentAtExit << "</RemoveSegmentAtExit>\n";
+
+    // Call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class SharedMemoryExportModifier<1>;
+template class SharedMemoryExportModifier<2>;
+template class SharedMemoryExportModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(SharedMemoryExportModifier)
@@ -0,0 +1,254 @@
+
+#ifndef SHAREDMEMORYEXPORTMODIFIER_HPP_
+#define SHAREDMEMORYEXPORTMODIFIER_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/string.hpp>
+
+#include <stdint.h>
+#include <string>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+#include "VertexBasedCellPopulation.hpp"
+
+/**
+ * Layout of the header at the start of the segment written by
+ * SharedMemoryExportModifier. All integers are little-endian, as on the machines we
+ * run on, and every offset is in bytes from the start of the segment.
+ */
+struct SharedTissueHeader
+{
+    /** "CHSTTISS", identifying the segment. */
+    char mMagic[8];
+
+    /** Version of the layout, SharedMemoryExportModifier's LAYOUT_VERSION. */
+    uint32_t mVersion;
+
+    /** Spatial dimension. */
+    uint32_t mDimension;
+
+    /** Sequence number of the seqlock: odd while the segment is being written. */
+    uint64_t mSequence;
+
+    /** Size of the segment, which grows when the tissue does; readers must remap if it exceeds their mapping. */
+    uint64_t mSegmentSize;
+
+    /** Number of completed updates. */
+    uint64_t mNumUpdates;
+
+    /** Simulation time of the state. */
+    double mTime;
+
+    /** Number of nodes. */
+    uint32_t mNumNodes;
+
+    /** Number of elements, and cells, one per element. */
+    uint32_t mNumElements;
+
+    /** Total number of node indices in the connectivity. */
+    uint32_t mNumElementNodes;
+
+    /** 1 once the simulation has finished, else 0. */
+    uint32_t mFinished;
+
+    /** Offset of the node locations, mDimension doubles per node. */
+    uint64_t mNodeLocationsOffset;
+
+    /** Offset of the offset of each element's nodes in the connectivity, mNumElements+1 uint32s. */
+    uint64_t mElementOffsetsOffset;
+
+    /** Offset of the connectivity, mNumElementNodes uint32 node indices, anticlockwise by element. */
+    uint64_t mElementNodesOffset;
+
+    /** Offset of the cell type of each element, int32: 0 for wild type, 1 otherwise, plus 2 if labelled. */
+    uint64_t mCellTypesOffset;
+
+    /** Offset of the Notch level of each element's cell, doubles, NaN if the cell has none. */
+    uint64_t mNotchOffset;
+
+    /** Offset of the Delta level of each element's cell, as mNotchOffset. */
+    uint64_t mDeltaOffset;
+
+    /** Offset of the fitness of each element's cell, as mNotchOffset. */
+    uint64_t mFitnessOffset;
+};
+
+/**
+ * A modifier class which publishes the state of a vertex-based simulation into a
+ * shared-memory segment, so that a viewer or analysis script on the same machine can
+ * attach to the running simulation without any file I/O. scripts/shm_tissue_reader.py
+ * reads the segment.
+ *
+ * The segment is a file in /dev/shm, named /dev/shm/chaste-tissue-<pid> unless set
+ * with SetSegmentName(). It starts with a SharedTissueHeader, followed by the node
+ * locations, the element connectivity and, for each element, the type, Notch, Delta
+ * and fitness of its cell. It is updated when the simulation is set up, every
+ * mExportInterval time steps (set it to the sampling timestep multiple to update at
+ * each sample) and at the end of the solve.
+ *
+ * Updates are guarded by a seqlock: the writer makes the sequence number odd, writes,
+ * then makes it even again. A reader copies what it needs between two reads of the
+ * sequence number and retries if the number was odd or changed, so readers never
+ * block the simulation, and never see a half-written state.
+ */
+template<unsigned DIM>
+class SharedMemoryExportModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+public:
+
+    /** Version of the segment layout, incremented whenever SharedTissueHeader or the arrays change. */
+    static const uint32_t LAYOUT_VERSION = 1;
+
+private:
+
+    /** The segment is updated every this many time steps. Defaults to 1. */
+    unsigned mExportInterval;
+
+    /** Name of the segment in /dev/shm, or empty for the default. */
+    std::string mSegmentName;
+
+    /** Path of the segment in use, set in SetupSolve(). */
+    std::string mSegmentPath;
+
+    /** Whether to remove the segment when the modifier is destroyed. Defaults to true. */
+    bool mRemoveSegmentAtExit;
+
+    /** File descriptor of the segment, or -1 if it is not open. */
+    int mSegmentFd;
+
+    /** The mapped segment, or NULL. */
+    char* mpSegment;
+
+    /** Size of the mapping. */
+    std::size_t mSegmentSize;
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mExportInterval;
+        archive & mSegmentName;
+        archive & mRemoveSegmentAtExit;
+    }
+
+    /**
+     * Grow the segment, if needed, so that it holds at least the given number of bytes.
+     * Must be called with the seqlock held.
+     *
+     * @param size the number of bytes needed
+     */
+    void ReserveSegment(std::size_t size);
+
+    /**
+     * Write the current state of the population into the segment.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param finished whether the simulation has finished
+     */
+    void Export(VertexBasedCellPopulation<DIM>& rCellPopulation, bool finished);
+
+    /**
+     * Unmap and close the segment, removing it if mRemoveSegmentAtExit is set.
+     */
+    void CloseSegment();
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    SharedMemoryExportModifier();
+
+    /**
+     * Destructor. Closes the segment.
+     */
+    virtual ~SharedMemoryExportModifier();
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Creates the segment and publishes the initial state.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Publishes the state every mExportInterval time steps.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.
+     *
+     * Publishes the final state and marks the segment finished. The segment stays in
+     * place until the modifier is destroyed, so readers can still pick up the final state.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * @return the header of the segment, or NULL if it is not open
+     */
+    const SharedTissueHeader* GetHeader() const;
+
+    /**
+     * @return the path of the segment, once the simulation has been set up
+     */
+    const std::string& rGetSegmentPath() const;
+
+    /**
+     * @return mExportInterval
+     */
+    unsigned GetExportInterval();
+
+    /**
+     * Set mExportInterval.
+     *
+     * @param exportInterval update the segment every this many time steps
+     */
+    void SetExportInterval(unsigned exportInterval);
+
+    /**
+     * Set the name of the segment in /dev/shm. Must be called before the simulation is set up.
+     *
+     * @param rSegmentName the name, without any directory
+     */
+    void SetSegmentName(const std::string& rSegmentName);
+
+    /**
+     * Set mRemoveSegmentAtExit.
+     *
+     * @param removeSegmentAtExit whether to remove the segment when the modifier is destroyed
+     */
+    void SetRemoveSegmentAtExit(bool removeSegmentAtExit);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(SharedMemoryExportModifier)
+
+#endif /*SHAREDMEMORYEXPORTMODIFIER_HPP_*/
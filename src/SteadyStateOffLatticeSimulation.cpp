@@ -0,0 +1,222 @@
+
+#include "SteadyStateOffLatticeSimulation.hpp"
+#include "AbstractOdeSrnModel.hpp"
+#include "OutputFileHandler.hpp"
+#include "ProfiledForce.hpp"
+
+template<unsigned DIM>
+SteadyStateOffLatticeSimulation<DIM>::SteadyStateOffLatticeSimulation(AbstractCellPopulation<DIM>& rCellPopulation,
+                                                                      bool deleteCellPopulationInDestructor,
+                                                                      bool initialiseCells)
+    : OffLatticeSimulation<DIM>(rCellPopulation, deleteCellPopulationInDestructor, initialiseCells),
+      mCheckInterval(10),
+      mWindowSize(5),
+      mDisplacementTolerance(1e-4),
+      mEnergyTolerance(1e-4),
+      mSrnStateTolerance(1e-4),
+      mSteadyStateReached(false),
+      mStoppingTime(0.0),
+      mNumChecksPassed(0),
+      mHavePreviousState(false),
+      mPreviousEnergy(0.0)
+{
+}
+
+template<unsigned DIM>
+void SteadyStateOffLatticeSimulation<DIM>::SetupSolve()
+{
+    if (!FindMatteoForce())
+    {
+        EXCEPTION("SteadyStateOffLatticeSimulation needs a MatteoForce to compute the mechanical energy");
+    }
+
+    OffLatticeSimulation<DIM>::SetupSolve();
+}
+
+template<unsigned DIM>
+bool SteadyStateOffLatticeSimulation<DIM>::StoppingEventHasOccurred()
+{
+    if (mSteadyStateReached)
+    {
+        return true;
+    }
+    if (SimulationTime::Instance()->GetTimeStepsElapsed()%mCheckInterval != 0)
+    {
+        return false;
+    }
+
+    std::vector<double> node_locations;
+    GetNodeLocations(node_locations);
+    std::vector<double> srn_states;
+    GetSrnStates(srn_states);
+    double energy = CalculateMechanicalEnergy();
+
+    bool criteria_hold = false;
+    if (mHavePreviousState
+        && node_locations.size() == mPreviousNodeLocations.size()
+        && srn_states.size() == mPreviousSrnStates.size())
+    {
+        double max_squared_displacement = 0.0;
+        for (unsigned node_index=0; node_index<node_locations.size()/DIM; node_index++)
+        {
+            double squared_displacement = 0.0;
+            for (unsigned i=0; i<DIM; i++)
+            {
+                double difference = node_locations[DIM*node_index + i] - mPreviousNodeLocations[DIM*node_index + i];
+                squared_displacement += difference*difference;
+            }
+            max_squared_displacement = std::max(max_squared_displacement, squared_displacement);
+        }
+
+        double max_srn_change = 0.0;
+        for (unsigned i=0; i<srn_states.size(); i++)
+        {
+            max_srn_change = std::max(max_srn_change, fabs(srn_states[i] - mPreviousSrnStates[i]));
+        }
+
+        criteria_hold = (sqrt(max_squared_displacement) < mDisplacementTolerance)
+                        && (fabs(energy - mPreviousEnergy) < mEnergyTolerance)
+                        && (max_srn_change < mSrnStateTolerance);
+    }
+
+    mNumChecksPassed = criteria_hold ? mNumChecksPassed + 1 : 0;
+    mPreviousNodeLocations.swap(node_locations);
+    mPreviousSrnStates.swap(srn_states);
+    mPreviousEnergy = energy;
+    mHavePreviousState = true;
+
+    if (mNumChecksPassed >= mWindowSize)
+    {
+        mSteadyStateReached = true;
+        mStoppingTime = SimulationTime::Instance()->GetTime();
+
+        OutputFileHandler output_file_handler(this->mSimulationOutputDirectory + "/", false);
+        out_stream p_file = output_file_handler.OpenOutputFile("steady_state.dat");
+        *p_file << "# time at which a steady state was detected, and the energy at the start of the last time step\n";
+        *p_file << mStoppingTime << " " << energy << "\n";
+        p_file->close();
+    }
+    return mSteadyStateReached;
+}
+
+template<unsigned DIM>
+void SteadyStateOffLatticeSimulation<DIM>::GetNodeLocations(std::vector<double>& rLocations)
+{
+    unsigned num_nodes = this->mrCellPopulation.GetNumNodes();
+    rLocations.resize(DIM*num_nodes);
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        const c_vector<double, DIM>& r_location = this->mrCellPopulation.GetNode(node_index)->rGetLocation();
+        for (unsigned i=0; i<DIM; i++)
+        {
+            rLocations[DIM*node_index + i] = r_location[i];
+        }
+    }
+}
+
+template<unsigned DIM>
+void SteadyStateOffLatticeSimulation<DIM>::GetSrnStates(std::vector<double>& rStates)
+{
+    rStates.clear();
+    for (typename AbstractCellPopulation<DIM>::Iterator cell_iter = this->mrCellPopulation.Begin();
+         cell_iter != this->mrCellPopulation.End();
+         ++cell_iter)
+    {
+        AbstractOdeSrnModel* p_srn_model = dynamic_cast<AbstractOdeSrnModel*>(cell_iter->GetSrnModel());
+        if (p_srn_model != NULL && p_srn_model->GetOdeSystem() != NULL)
+        {
+            const std::vector<double>& r_state = p_srn_model->GetOdeSystem()->rGetStateVariables();
+            rStates.insert(rStates.end(), r_state.begin(), r_state.end());
+        }
+    }
+}
+
+template<unsigned DIM>
+boost::shared_ptr<MatteoForce<DIM> > SteadyStateOffLatticeSimulation<DIM>::FindMatteoForce()
+{
+    boost::shared_ptr<MatteoForce<DIM> > p_force;
+    for (typename std::vector<boost::shared_ptr<AbstractForce<DIM, DIM> > >::iterator iter = this->mForceCollection.begin();
+         iter != this->mForceCollection.end() && !p_force;
+         ++iter)
+    {
+        p_force = boost::dynamic_pointer_cast<MatteoForce<DIM> >(ProfiledForce<DIM>::Unwrap(*iter));
+    }
+    return p_force;
+}
+
+template<unsigned DIM>
+double SteadyStateOffLatticeSimulation<DIM>::CalculateMechanicalEnergy()
+{
+    // The force evaluates the energy in the same sweep as the forces, at the start of the last time
+    // step; evaluating it again here would redraw the force's noise, so it lags by one time step
+    return FindMatteoForce()->GetTotalEnergy();
+}
+
+template<unsigned DIM>
+double SteadyStateOffLatticeSimulation<DIM>::GetStoppingTime()
+{
+    return mStoppingTime;
+}
+
+template<unsigned DIM>
+bool SteadyStateOffLatticeSimulation<DIM>::HasReachedSteadyState()
+{
+    return mSteadyStateReached;
+}
+
+template<unsigned DIM>
+void SteadyStateOffLatticeSimulation<DIM>::SetCheckInterval(unsigned checkInterval)
+{
+    assert(checkInterval > 0);
+    mCheckInterval = checkInterval;
+}
+
+template<unsigned DIM>
+void SteadyStateOffLatticeSimulation<DIM>::SetWindowSize(unsigned windowSize)
+{
+    if (windowSize == 0)
+    {
+        EXCEPTION("The window size must be positive");
+    }
+    mWindowSize = windowSize;
+}
+
+template<unsigned DIM>
+void SteadyStateOffLatticeSimulation<DIM>::SetDisplacementTolerance(double displacementTolerance)
+{
+    mDisplacementTolerance = displacementTolerance;
+}
+
+template<unsigned DIM>
+void SteadyStateOffLatticeSimulation<DIM>::SetEnergyTolerance(double energyTolerance)
+{
+    mEnergyTolerance = energyTolerance;
+}
+
+template<unsigned DIM>
+void SteadyStateOffLatticeSimulation<DIM>::SetSrnStateTolerance(double srnStateTolerance)
+{
+    mSrnStateTolerance = srnStateTolerance;
+}
+
+template<unsigned DIM>
+void SteadyStateOffLatticeSimulation<DIM>::OutputSimulationParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t<CheckInterval>" << mCheckInterval << "</CheckInterval>\n";
+    *rParamsFile << "\t\t<WindowSize>" << mWindowSize << "</WindowSize>\n";
+    *rParamsFile << "\t\t<DisplacementTolerance>" << mDisplacementTolerance << "</DisplacementTolerance>\n";
+    *rParamsFile << "\t\t<EnergyTolerance>" << mEnergyTolerance << "</EnergyTolerance>\n";
+    *rParamsFile << "\t\t<SrnStateTolerance>" << mSrnStateTolerance << "</SrnStateTolerance>\n";
+
+    // Call method on direct parent class
+    OffLatticeSimulation<DIM>::OutputSimulationParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class SteadyStateOffLatticeSimulation<1>;
+template class SteadyStateOffLatticeSimulation<2>;
+template class SteadyStateOffLatticeSimulation<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(SteadyStateOffLatticeSimulation)
@@ -0,0 +1,243 @@
+
+#ifndef STEADYSTATEOFFLATTICESIMULATION_HPP_
+#define STEADYSTATEOFFLATTICESIMULATION_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include "OffLatticeSimulation.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "MatteoForce.hpp"
+
+/**
+ * An OffLatticeSimulation which stops early once the tissue has reached a steady
+ * state, instead of always integrating to the end time.
+ *
+ * Every mCheckInterval time steps the simulation compares the current state with
+ * that at the previous check, using three criteria:
+ *  - the largest displacement of any node;
+ *  - the change in total mechanical energy, as computed by the MatteoForce;
+ *  - the largest change in any state variable of any cell's ODE-based SRN model.
+ * Once all three have stayed below their tolerances for mWindowSize consecutive
+ * checks, Solve() returns. The stopping time is available from GetStoppingTime()
+ * and is also written to steady_state.dat in the simulation output directory.
+ *
+ * A MatteoForce must have been added. Rather than evaluate the energy again, which
+ * would draw the force's noise a second time, the simulation reads the energy the
+ * force computed along with the forces, at the start of the time step just taken.
+ * The energy is therefore one time step behind the other criteria, at every check
+ * alike, so the changes between checks are compared over the same interval.
+ *
+ * Any change in the numbers of nodes or cells restarts the window.
+ */
+template<unsigned DIM>
+class SteadyStateOffLatticeSimulation : public OffLatticeSimulation<DIM>
+{
+private:
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<OffLatticeSimulation<DIM> >(*this);
+        archive & mCheckInterval;
+        archive & mWindowSize;
+        archive & mDisplacementTolerance;
+        archive & mEnergyTolerance;
+        archive & mSrnStateTolerance;
+        archive & mSteadyStateReached;
+        archive & mStoppingTime;
+    }
+
+    /** The criteria are checked every this many time steps. Defaults to 10. */
+    unsigned mCheckInterval;
+
+    /** Number of consecutive checks for which the criteria must hold. Defaults to 5. */
+    unsigned mWindowSize;
+
+    /** Tolerance on the largest node displacement between checks. Defaults to 1e-4. */
+    double mDisplacementTolerance;
+
+    /** Tolerance on the change in total mechanical energy between checks. Defaults to 1e-4. */
+    double mEnergyTolerance;
+
+    /** Tolerance on the largest change in an SRN state variable between checks. Defaults to 1e-4. */
+    double mSrnStateTolerance;
+
+    /** Whether a steady state has been detected. */
+    bool mSteadyStateReached;
+
+    /** The time at which a steady state was detected, if it has been. */
+    double mStoppingTime;
+
+    /** Number of consecutive checks for which the criteria have held. */
+    unsigned mNumChecksPassed;
+
+    /** Whether the state at the previous check has been stored. */
+    bool mHavePreviousState;
+
+    /** Node locations at the previous check, DIM entries per node. */
+    std::vector<double> mPreviousNodeLocations;
+
+    /** Total mechanical energy at the previous check. */
+    double mPreviousEnergy;
+
+    /** SRN state variables of all cells, in population order, at the previous check. */
+    std::vector<double> mPreviousSrnStates;
+
+    /**
+     * @return the first MatteoForce in the force collection, seen through any ProfiledForce,
+     *     or an empty pointer if there is none
+     */
+    boost::shared_ptr<MatteoForce<DIM> > FindMatteoForce();
+
+    /**
+     * @return the total mechanical energy of the tissue, as computed by the first MatteoForce
+     * in the force collection at the start of the last time step
+     */
+    double CalculateMechanicalEnergy();
+
+    /**
+     * Store the current node locations in rLocations.
+     *
+     * @param rLocations the vector to fill
+     */
+    void GetNodeLocations(std::vector<double>& rLocations);
+
+    /**
+     * Store the current SRN state variables of all cells in rStates.
+     *
+     * @param rStates the vector to fill
+     */
+    void GetSrnStates(std::vector<double>& rStates);
+
+protected:
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Checks that a MatteoForce has been added, as the energy criterion needs one.
+     */
+    virtual void SetupSolve();
+
+    /**
+     * Overridden StoppingEventHasOccurred() method.
+     *
+     * @return whether a steady state has been reached
+     */
+    virtual bool StoppingEventHasOccurred();
+
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param rCellPopulation Reference to a cell population object
+     * @param deleteCellPopulationInDestructor Whether to delete the cell population on destruction to
+     *     free up memory (defaults to false)
+     * @param initialiseCells Whether to initialise cells (defaults to true, set to false when loading
+     *     from an archive)
+     */
+    SteadyStateOffLatticeSimulation(AbstractCellPopulation<DIM>& rCellPopulation,
+                                    bool deleteCellPopulationInDestructor=false,
+                                    bool initialiseCells=true);
+
+    /**
+     * @return the time at which a steady state was detected. Only meaningful if
+     * HasReachedSteadyState() returns true.
+     */
+    double GetStoppingTime();
+
+    /**
+     * @return whether the simulation stopped early because a steady state was reached.
+     */
+    bool HasReachedSteadyState();
+
+    /**
+     * Set mCheckInterval.
+     *
+     * @param checkInterval check the criteria every this many time steps
+     */
+    void SetCheckInterval(unsigned checkInterval);
+
+    /**
+     * Set mWindowSize.
+     *
+     * @param windowSize number of consecutive checks for which the criteria must hold; must be positive
+     */
+    void SetWindowSize(unsigned windowSize);
+
+    /**
+     * Set mDisplacementTolerance.
+     *
+     * @param displacementTolerance tolerance on the largest node displacement between checks
+     */
+    void SetDisplacementTolerance(double displacementTolerance);
+
+    /**
+     * Set mEnergyTolerance.
+     *
+     * @param energyTolerance tolerance on the change in total mechanical energy between checks
+     */
+    void SetEnergyTolerance(double energyTolerance);
+
+    /**
+     * Set mSrnStateTolerance.
+     *
+     * @param srnStateTolerance tolerance on the largest change in an SRN state variable between checks
+     */
+    void SetSrnStateTolerance(double srnStateTolerance);
+
+    /**
+     * Overridden OutputSimulationParameters() method.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(SteadyStateOffLatticeSimulation)
+
+namespace boost
+{
+namespace serialization
+{
+/**
+ * Serialize information required to construct a SteadyStateOffLatticeSimulation.
+ */
+template<class Archive, unsigned DIM>
+inline void save_construct_data(
+    Archive & ar, const SteadyStateOffLatticeSimulation<DIM> * t, const unsigned int file_version)
+{
+    // Save data required to construct instance
+    const AbstractCellPopulation<DIM>* p_cell_population = &(t->rGetCellPopulation());
+    ar & p_cell_population;
+}
+
+/**
+ * De-serialize constructor parameters and initialise a SteadyStateOffLatticeSimulation.
+ */
+template<class Archive, unsigned DIM>
+inline void load_construct_data(
+    Archive & ar, SteadyStateOffLatticeSimulation<DIM> * t, const unsigned int file_version)
+{
+    // Retrieve data from archive required to construct new instance
+    AbstractCellPopulation<DIM>* p_cell_population;
+    ar >> p_cell_population;
+
+    // Invoke inplace constructor to initialise instance
+    ::new(t)SteadyStateOffLatticeSimulation<DIM>(*p_cell_population, true, false);
+}
+}
+} // namespace
+
+#endif /*STEADYSTATEOFFLATTICESIMULATION_HPP_*/
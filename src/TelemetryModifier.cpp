@@ -0,0 +1,226 @@
+
+#include "TelemetryModifier.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "MatteoMutableVertexMesh.hpp"
+#include "MatteoProfiler.hpp"
+#include "OutputFileHandler.hpp"
+#include "VertexBasedCellPopulation.hpp"
+
+template<unsigned DIM>
+TelemetryModifier<DIM>::TelemetryModifier()
+    : AbstractCellBasedSimulationModifier<DIM>(),
+      mPublishInterval(100),
+      mSocketPath(""),
+      mActiveSocketPath(""),
+      mSocket(-1),
+      mNumMessagesSent(0),
+      mNumMessagesDropped(0),
+      mLastMessageWallTime(0.0),
+      mLastMessageTimeStep(0)
+{
+}
+
+template<unsigned DIM>
+TelemetryModifier<DIM>::~TelemetryModifier()
+{
+    CloseSocket();
+}
+
+template<unsigned DIM>
+void TelemetryModifier<DIM>::CloseSocket()
+{
+    if (mSocket >= 0)
+    {
+        close(mSocket);
+        mSocket = -1;
+    }
+}
+
+template<unsigned DIM>
+void TelemetryModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    mActiveSocketPath = mSocketPath;
+    if (mActiveSocketPath.empty())
+    {
+        OutputFileHandler output_file_handler(outputDirectory + "/", false);
+        mActiveSocketPath = output_file_handler.GetOutputDirectoryFullPath() + "telemetry.sock";
+    }
+    if (mActiveSocketPath.size() >= sizeof(((sockaddr_un*)NULL)->sun_path))
+    {
+        std::stringstream path;
+        path << "/tmp/chaste-telemetry-" << getpid() << ".sock";
+        mActiveSocketPath = path.str();
+    }
+
+    CloseSocket();
+    mSocket = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (mSocket < 0)
+    {
+        EXCEPTION("TelemetryModifier could not create a socket: " << strerror(errno));
+    }
+    std::cout << "Publishing telemetry to " << mActiveSocketPath << "\n" << std::flush;
+
+    mNumMessagesSent = 0;
+    mNumMessagesDropped = 0;
+    mLastMessageWallTime = MatteoProfiler::GetWallTime();
+    mLastMessageTimeStep = SimulationTime::Instance()->GetTimeStepsElapsed();
+    Publish(rCellPopulation, "running");
+}
+
+template<unsigned DIM>
+void TelemetryModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (mPublishInterval > 0 && SimulationTime::Instance()->GetTimeStepsElapsed()%mPublishInterval == 0)
+    {
+        Publish(rCellPopulation, "running");
+    }
+}
+
+template<unsigned DIM>
+void TelemetryModifier<DIM>::UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    Publish(rCellPopulation, "finished");
+    CloseSocket();
+}
+
+template<unsigned DIM>
+void TelemetryModifier<DIM>::Publish(AbstractCellPopulation<DIM,DIM>& rCellPopulation, const std::string& rStatus)
+{
+    if (mSocket < 0)
+    {
+        return;
+    }
+
+    SimulationTime* p_time = SimulationTime::Instance();
+    double wall_time = MatteoProfiler::GetWallTime();
+    unsigned time_step = p_time->GetTimeStepsElapsed();
+    double steps_per_second = (wall_time > mLastMessageWallTime) ? (time_step - mLastMessageTimeStep)/(wall_time - mLastMessageWallTime) : 0.0;
+    mLastMessageWallTime = wall_time;
+    mLastMessageTimeStep = time_step;
+
+    std::stringstream message;
+    message << "status=" << rStatus
+            << " time=" << p_time->GetTime()
+            << " step=" << time_step
+            << " end_time=" << p_time->GetEndTime()
+            << " steps_per_s=" << steps_per_second
+            << " cells=" << rCellPopulation.GetNumRealCells();
+    VertexBasedCellPopulation<DIM>* p_vertex_population = dynamic_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation);
+    if (p_vertex_population)
+    {
+        MatteoMutableVertexMesh<DIM>* p_mesh = dynamic_cast<MatteoMutableVertexMesh<DIM>*>(&(p_vertex_population->rGetMesh()));
+        if (p_mesh)
+        {
+            message << " t1_swaps=" << p_mesh->GetNumT1Swaps()
+                    << " t2_swaps=" << p_mesh->GetNumT2Swaps()
+                    << " t3_swaps=" << p_mesh->GetNumT3Swaps();
+        }
+    }
+    for (unsigned i=0; i<mMetrics.size(); i++)
+    {
+        message << " " << mMetricNames[i] << "=" << mMetrics[i](rCellPopulation);
+    }
+    message << "\n";
+
+    sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, mActiveSocketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    // Never wait for the listener: with none bound, or its queue full, the message is dropped
+    std::string text = message.str();
+    if (sendto(mSocket, text.c_str(), text.size(), MSG_DONTWAIT, (sockaddr*)&address, sizeof(address)) < 0)
+    {
+        mNumMessagesDropped++;
+    }
+    else
+    {
+        mNumMessagesSent++;
+    }
+}
+
+template<unsigned DIM>
+void TelemetryModifier<DIM>::AddMetric(const std::string& rName, MetricFunction metric)
+{
+    if (rName.empty() || rName.find_first_of(" =\n") != std::string::npos)
+    {
+        EXCEPTION("Telemetry metric names must be non-empty and contain no spaces or '='");
+    }
+    mMetricNames.push_back(rName);
+    mMetrics.push_back(metric);
+}
+
+template<unsigned DIM>
+double TelemetryModifier<DIM>::GetMeanCellDataItem(AbstractCellPopulation<DIM,DIM>& rCellPopulation, const std::string& rItem)
+{
+    double sum = 0.0;
+    unsigned num_cells = 0;
+    for (typename AbstractCellPopulation<DIM,DIM>::Iterator cell_iter = rCellPopulation.Begin();
+         cell_iter != rCellPopulation.End();
+         ++cell_iter)
+    {
+        sum += cell_iter->GetCellData()->GetItem(rItem);
+        num_cells++;
+    }
+    return (num_cells > 0) ? sum/num_cells : 0.0;
+}
+
+template<unsigned DIM>
+unsigned TelemetryModifier<DIM>::GetPublishInterval()
+{
+    return mPublishInterval;
+}
+
+template<unsigned DIM>
+void TelemetryModifier<DIM>::SetPublishInterval(unsigned publishInterval)
+{
+    mPublishInterval = publishInterval;
+}
+
+template<unsigned DIM>
+void TelemetryModifier<DIM>::SetSocketPath(const std::string& rSocketPath)
+{
+    mSocketPath = rSocketPath;
+}
+
+template<unsigned DIM>
+const std::string& TelemetryModifier<DIM>::rGetSocketPath() const
+{
+    return mActiveSocketPath;
+}
+
+template<unsigned DIM>
+unsigned TelemetryModifier<DIM>::GetNumMessagesSent()
+{
+    return mNumMessagesSent;
+}
+
+template<unsigned DIM>
+unsigned TelemetryModifier<DIM>::GetNumMessagesDropped()
+{
+    return mNumMessagesDropped;
+}
+
+template<unsigned DIM>
+void TelemetryModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<PublishInterval>" << mPublishInterval << "</PublishInterval>\n";
+    *rParamsFile << "\t\t\t<SocketPath>" << mSocketPath << "</SocketPath>\n";
+
+    // Call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class TelemetryModifier<1>;
+template class TelemetryModifier<2>;
+template class TelemetryModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(TelemetryModifier)
@@ -0,0 +1,211 @@
+
+#ifndef TELEMETRYMODIFIER_HPP_
+#define TELEMETRYMODIFIER_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/function.hpp>
+
+#include <string>
+#include <vector>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+
+/**
+ * A modifier class which publishes the progress of a running simulation as datagrams
+ * on a Unix domain socket, so that it can be followed, or found to have stalled,
+ * without polling the output directory. scripts/telemetry_client.py listens on the
+ * socket and prints what it receives.
+ *
+ * Every mPublishInterval time steps, and at the start and end of the solve, the
+ * modifier sends one line of space-separated key=value pairs:
+ *  - status: running, or finished at the end of the solve;
+ *  - time, step and end_time: the simulation time, time steps taken and end time;
+ *  - steps_per_s: time steps per second of wall time since the last message;
+ *  - cells: the number of cells;
+ *  - t1_swaps, t2_swaps and t3_swaps: the numbers of each type of swap so far, as
+ *    counted by the mesh, for vertex-based populations on a MatteoMutableVertexMesh;
+ *  - any metrics added with AddMetric(), under their names.
+ *
+ * The listener binds the socket, and the simulation sends to it without blocking, so
+ * a simulation with no listener, or with a listener that has fallen behind, just drops
+ * the messages and carries on. The socket path defaults to telemetry.sock in the
+ * simulation output directory, or to /tmp/chaste-telemetry-<pid>.sock if that path is
+ * too long for a Unix socket address.
+ */
+template<unsigned DIM>
+class TelemetryModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+public:
+
+    /** Type of a metric published with each message. */
+    typedef boost::function<double (AbstractCellPopulation<DIM,DIM>&)> MetricFunction;
+
+private:
+
+    /** A message is published every this many time steps. Defaults to 100. */
+    unsigned mPublishInterval;
+
+    /** Path of the socket to send to, or empty for the default. */
+    std::string mSocketPath;
+
+    /** The path actually used, set in SetupSolve(). */
+    std::string mActiveSocketPath;
+
+    /** The names of the metrics. */
+    std::vector<std::string> mMetricNames;
+
+    /** The metrics. Not archived. */
+    std::vector<MetricFunction> mMetrics;
+
+    /** File descriptor of the sending socket, or -1 if it is not open. */
+    int mSocket;
+
+    /** Number of messages sent. */
+    unsigned mNumMessagesSent;
+
+    /** Number of messages dropped, because no listener was bound or its queue was full. */
+    unsigned mNumMessagesDropped;
+
+    /** Wall time of the last message. */
+    double mLastMessageWallTime;
+
+    /** Time steps elapsed at the last message. */
+    unsigned mLastMessageTimeStep;
+
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables. The metrics are not archived.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mPublishInterval;
+        archive & mSocketPath;
+    }
+
+    /**
+     * Publish one message.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param rStatus the status to report
+     */
+    void Publish(AbstractCellPopulation<DIM,DIM>& rCellPopulation, const std::string& rStatus);
+
+    /**
+     * Close the socket, if it is open.
+     */
+    void CloseSocket();
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    TelemetryModifier();
+
+    /**
+     * Destructor. Closes the socket.
+     */
+    virtual ~TelemetryModifier();
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Opens the socket and publishes the first message.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Publishes a message every mPublishInterval time steps.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.
+     *
+     * Publishes a last message, with status finished, and closes the socket.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Add a metric to publish with each message. Names must not contain spaces or '='.
+     *
+     * @param rName the name of the metric
+     * @param metric the function computing it
+     */
+    void AddMetric(const std::string& rName, MetricFunction metric);
+
+    /**
+     * Compute the mean of a CellData item over the cells, as a metric.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param rItem the name of the CellData item
+     * @return the mean, or zero if there are no cells
+     */
+    static double GetMeanCellDataItem(AbstractCellPopulation<DIM,DIM>& rCellPopulation, const std::string& rItem);
+
+    /**
+     * @return mPublishInterval
+     */
+    unsigned GetPublishInterval();
+
+    /**
+     * Set mPublishInterval.
+     *
+     * @param publishInterval publish a message every this many time steps
+     */
+    void SetPublishInterval(unsigned publishInterval);
+
+    /**
+     * Set the path of the socket to send to, instead of the default. Must be called
+     * before the simulation is set up.
+     *
+     * @param rSocketPath the path
+     */
+    void SetSocketPath(const std::string& rSocketPath);
+
+    /**
+     * @return the path of the socket messages are sent to, once the simulation has been set up
+     */
+    const std::string& rGetSocketPath() const;
+
+    /**
+     * @return the number of messages sent
+     */
+    unsigned GetNumMessagesSent();
+
+    /**
+     * @return the number of messages dropped
+     */
+    unsigned GetNumMessagesDropped();
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(TelemetryModifier)
+
+#endif /*TELEMETRYMODIFIER_HPP_*/
@@ -0,0 +1,67 @@
+
+#ifndef TISSUEFILEHEADER_HPP_
+#define TISSUEFILEHEADER_HPP_
+
+#include <stdint.h>
+
+/** Version of the tissue file layout, incremented whenever TissueFileHeader or the arrays change. */
+const uint32_t TISSUE_FILE_VERSION = 1;
+
+/**
+ * Layout of the header at the start of a tissue file, written by TissueFileWriter and
+ * read by TissueFileReader. The header is followed by arrays at the given offsets, each
+ * aligned to 8 bytes. All integers are little-endian, as on the machines we run on, and
+ * every offset is in bytes from the start of the file.
+ *
+ * The node and element indices are contiguous from zero, and there is one cell per
+ * element, in element order.
+ */
+struct TissueFileHeader
+{
+    /** "CHSTTFIL", identifying the file. */
+    char mMagic[8];
+
+    /** Version of the layout, TISSUE_FILE_VERSION. */
+    uint32_t mVersion;
+
+    /** Spatial dimension. */
+    uint32_t mDimension;
+
+    /** Number of nodes. */
+    uint32_t mNumNodes;
+
+    /** Number of elements, and cells. */
+    uint32_t mNumElements;
+
+    /** Total number of node indices in the connectivity. */
+    uint32_t mNumElementNodes;
+
+    /** Number of SRN state variables stored for each cell, 0 if none are. */
+    uint32_t mNumSrnVariables;
+
+    /** Offset of the node locations, mDimension doubles per node. */
+    uint64_t mNodeLocationsOffset;
+
+    /** Offset of the birth time of each cell, doubles. */
+    uint64_t mBirthTimesOffset;
+
+    /** Offset of the SRN states, mNumSrnVariables doubles per cell; NaN for a cell whose model keeps its defaults. */
+    uint64_t mSrnStatesOffset;
+
+    /** Offset of the offset of each element's nodes in the connectivity, mNumElements+1 uint32s. */
+    uint64_t mElementOffsetsOffset;
+
+    /** Offset of the connectivity, mNumElementNodes uint32 node indices, anticlockwise by element. */
+    uint64_t mElementNodesOffset;
+
+    /** Offset of the cell type of each element, int32: 0 for wild type, 1 otherwise, plus 2 if labelled. */
+    uint64_t mCellTypesOffset;
+
+    /** Offset of the boundary flag of each node, uint8: 1 for a boundary node, else 0. */
+    uint64_t mBoundaryNodesOffset;
+
+    /** Size of the file. */
+    uint64_t mFileSize;
+};
+
+#endif /*TISSUEFILEHEADER_HPP_*/
@@ -0,0 +1,246 @@
+
+#include "TissueFileReader.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <boost/math/special_functions/fpclassify.hpp>
+#include "CellLabel.hpp"
+#include "CellPropertyRegistry.hpp"
+#include "MatteoSrnModel.hpp"
+#include "NoCellCycleModel.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "WildTypeCellMutationState.hpp"
+
+template<unsigned DIM>
+TissueFileReader<DIM>::TissueFileReader(const std::string& rPath)
+    : mPath(rPath),
+      mpFile(NULL),
+      mFileSize(0),
+      mpMesh(NULL)
+{
+    if (DIM != 2)
+    {
+        EXCEPTION("TissueFileReader is only implemented in 2D");
+    }
+
+    int fd = open(mPath.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        EXCEPTION("Could not open the tissue file " << mPath << ": " << strerror(errno));
+    }
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0 || file_status.st_size < (off_t)sizeof(TissueFileHeader))
+    {
+        close(fd);
+        EXCEPTION("The tissue file " << mPath << " is too short to be one");
+    }
+    mFileSize = file_status.st_size;
+
+    // The mapping stays valid once the file is closed
+    void* p_mapping = mmap(NULL, mFileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p_mapping == MAP_FAILED)
+    {
+        mFileSize = 0;
+        EXCEPTION("Could not map the tissue file " << mPath << ": " << strerror(errno));
+    }
+    madvise(p_mapping, mFileSize, MADV_SEQUENTIAL);
+    mpFile = static_cast<const char*>(p_mapping);
+
+    // Validate the header and every array, so that building the tissue cannot read out of bounds
+    try
+    {
+        const TissueFileHeader& r_header = rGetHeader();
+        if (memcmp(r_header.mMagic, "CHSTTFIL", 8) != 0)
+        {
+            EXCEPTION("The file " << mPath << " is not a tissue file");
+        }
+        if (r_header.mVersion != TISSUE_FILE_VERSION)
+        {
+            EXCEPTION("The tissue file " << mPath << " has layout version " << r_header.mVersion
+                      << ", but version " << TISSUE_FILE_VERSION << " is expected");
+        }
+        if (r_header.mDimension != DIM)
+        {
+            EXCEPTION("The tissue file " << mPath << " is of a " << r_header.mDimension << "D tissue");
+        }
+        if (r_header.mFileSize != mFileSize)
+        {
+            EXCEPTION("The tissue file " << mPath << " is truncated");
+        }
+        if (r_header.mNumSrnVariables != 0 && r_header.mNumSrnVariables != 2)
+        {
+            EXCEPTION("The tissue file " << mPath << " has " << r_header.mNumSrnVariables
+                      << " SRN state variables per cell, but MatteoSrnModel has 2");
+        }
+
+        uint64_t num_nodes = r_header.mNumNodes;
+        uint64_t num_elements = r_header.mNumElements;
+        CheckArray(r_header.mNodeLocationsOffset, sizeof(double)*DIM*num_nodes, "node locations");
+        CheckArray(r_header.mBirthTimesOffset, sizeof(double)*num_elements, "birth times");
+        CheckArray(r_header.mSrnStatesOffset, sizeof(double)*r_header.mNumSrnVariables*num_elements, "SRN states");
+        CheckArray(r_header.mElementOffsetsOffset, sizeof(uint32_t)*(num_elements + 1), "element offsets");
+        CheckArray(r_header.mElementNodesOffset, sizeof(uint32_t)*r_header.mNumElementNodes, "connectivity");
+        CheckArray(r_header.mCellTypesOffset, sizeof(int32_t)*num_elements, "cell types");
+        CheckArray(r_header.mBoundaryNodesOffset, sizeof(uint8_t)*num_nodes, "boundary flags");
+
+        const uint32_t* p_element_offsets = reinterpret_cast<const uint32_t*>(mpFile + r_header.mElementOffsetsOffset);
+        const uint32_t* p_element_nodes = reinterpret_cast<const uint32_t*>(mpFile + r_header.mElementNodesOffset);
+        if (p_element_offsets[0] != 0 || p_element_offsets[num_elements] != r_header.mNumElementNodes)
+        {
+            EXCEPTION("The element offsets of the tissue file " << mPath << " do not cover its connectivity");
+        }
+        // With the offsets non-decreasing from 0 to the last, every element lies within the connectivity
+        for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+        {
+            if (p_element_offsets[elem_index + 1] < p_element_offsets[elem_index])
+            {
+                EXCEPTION("The element offsets of the tissue file " << mPath << " decrease at element " << elem_index);
+            }
+            if (p_element_offsets[elem_index + 1] - p_element_offsets[elem_index] < 3)
+            {
+                EXCEPTION("Element " << elem_index << " of the tissue file " << mPath << " has fewer than 3 nodes");
+            }
+        }
+        for (unsigned slot=0; slot<r_header.mNumElementNodes; slot++)
+        {
+            if (p_element_nodes[slot] >= num_nodes)
+            {
+                EXCEPTION("The connectivity of the tissue file " << mPath << " refers to a node that does not exist");
+            }
+        }
+    }
+    catch (const Exception&)
+    {
+        munmap(const_cast<char*>(mpFile), mFileSize);
+        mpFile = NULL;
+        mFileSize = 0;
+        throw;
+    }
+}
+
+template<unsigned DIM>
+TissueFileReader<DIM>::~TissueFileReader()
+{
+    delete mpMesh;
+    if (mpFile != NULL)
+    {
+        munmap(const_cast<char*>(mpFile), mFileSize);
+    }
+}
+
+template<unsigned DIM>
+const TissueFileHeader& TissueFileReader<DIM>::rGetHeader() const
+{
+    return *reinterpret_cast<const TissueFileHeader*>(mpFile);
+}
+
+template<unsigned DIM>
+void TissueFileReader<DIM>::CheckArray(uint64_t offset, uint64_t size, const std::string& rName) const
+{
+    if (offset%8 != 0 || offset < sizeof(TissueFileHeader) || offset > mFileSize || size > mFileSize - offset)
+    {
+        EXCEPTION("The " << rName << " of the tissue file " << mPath << " do not lie within it");
+    }
+}
+
+template<unsigned DIM>
+MatteoMutableVertexMesh<DIM>* TissueFileReader<DIM>::GetMesh()
+{
+    if (mpMesh == NULL)
+    {
+        const TissueFileHeader& r_header = rGetHeader();
+        const double* p_locations = reinterpret_cast<const double*>(mpFile + r_header.mNodeLocationsOffset);
+        const uint8_t* p_boundary_nodes = reinterpret_cast<const uint8_t*>(mpFile + r_header.mBoundaryNodesOffset);
+        const uint32_t* p_element_offsets = reinterpret_cast<const uint32_t*>(mpFile + r_header.mElementOffsetsOffset);
+        const uint32_t* p_element_nodes = reinterpret_cast<const uint32_t*>(mpFile + r_header.mElementNodesOffset);
+
+        std::vector<Node<DIM>*> nodes;
+        nodes.reserve(r_header.mNumNodes);
+        for (unsigned node_index=0; node_index<r_header.mNumNodes; node_index++)
+        {
+            c_vector<double, DIM> location;
+            for (unsigned i=0; i<DIM; i++)
+            {
+                location[i] = p_locations[DIM*node_index + i];
+            }
+            nodes.push_back(new Node<DIM>(node_index, location, p_boundary_nodes[node_index] != 0));
+        }
+
+        std::vector<VertexElement<DIM,DIM>*> elements;
+        elements.reserve(r_header.mNumElements);
+        std::vector<Node<DIM>*> element_nodes;
+        for (unsigned elem_index=0; elem_index<r_header.mNumElements; elem_index++)
+        {
+            element_nodes.clear();
+            for (unsigned slot=p_element_offsets[elem_index]; slot<p_element_offsets[elem_index + 1]; slot++)
+            {
+                element_nodes.push_back(nodes[p_element_nodes[slot]]);
+            }
+            elements.push_back(new VertexElement<DIM,DIM>(elem_index, element_nodes));
+        }
+
+        mpMesh = new MatteoMutableVertexMesh<DIM>(nodes, elements);
+    }
+    return mpMesh;
+}
+
+template<unsigned DIM>
+void TissueFileReader<DIM>::GenerateCells(std::vector<CellPtr>& rCells)
+{
+    const TissueFileHeader& r_header = rGetHeader();
+    const double* p_birth_times = reinterpret_cast<const double*>(mpFile + r_header.mBirthTimesOffset);
+    const double* p_srn_states = reinterpret_cast<const double*>(mpFile + r_header.mSrnStatesOffset);
+    const int32_t* p_cell_types = reinterpret_cast<const int32_t*>(mpFile + r_header.mCellTypesOffset);
+    unsigned num_srn_variables = r_header.mNumSrnVariables;
+
+    MAKE_PTR(WildTypeCellMutationState, p_mutation_state);
+    boost::shared_ptr<AbstractCellProperty> p_label(CellPropertyRegistry::Instance()->Get<CellLabel>());
+
+    rCells.clear();
+    rCells.reserve(r_header.mNumElements);
+    for (unsigned elem_index=0; elem_index<r_header.mNumElements; elem_index++)
+    {
+        NoCellCycleModel* p_cc_model = new NoCellCycleModel();
+        p_cc_model->SetDimension(DIM);
+
+        // A cell whose state was not stored keeps the model's default initial conditions
+        MatteoSrnModel* p_srn_model = new MatteoSrnModel();
+        const double* p_state = p_srn_states + num_srn_variables*elem_index;
+        if (num_srn_variables > 0 && !(boost::math::isnan)(p_state[0]))
+        {
+            p_srn_model->SetInitialConditions(std::vector<double>(p_state, p_state + num_srn_variables));
+        }
+
+        CellPtr p_cell(new Cell(p_mutation_state, p_cc_model, p_srn_model));
+        p_cell->SetBirthTime(p_birth_times[elem_index]);
+        if (p_cell_types[elem_index] & 1)
+        {
+            p_cell->SetCellProliferativeType(p_diff_type);
+        }
+        else
+        {
+            p_cell->SetCellProliferativeType(p_wild_type);
+        }
+        if (p_cell_types[elem_index] & 2)
+        {
+            p_cell->AddCellProperty(p_label);
+        }
+        rCells.push_back(p_cell);
+    }
+}
+
+template<unsigned DIM>
+unsigned TissueFileReader<DIM>::GetNumCells() const
+{
+    return rGetHeader().mNumElements;
+}
+
+// Explicit instantiation
+template class TissueFileReader<1>;
+template class TissueFileReader<2>;
+template class TissueFileReader<3>;
@@ -0,0 +1,96 @@
+
+#ifndef TISSUEFILEREADER_HPP_
+#define TISSUEFILEREADER_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Cell.hpp"
+#include "MatteoMutableVertexMesh.hpp"
+#include "TissueFileHeader.hpp"
+
+/**
+ * Loads a tissue file written by TissueFileWriter (see TissueFileHeader), to start a
+ * simulation from a prepared tissue instead of a regular honeycomb.
+ *
+ * The file is memory-mapped read-only and validated when the reader is constructed.
+ * GetMesh() builds the mesh in one pass over the node and element arrays, and
+ * GenerateCells() builds one cell per element in another, each with a NoCellCycleModel
+ * and a MatteoSrnModel starting from the stored state, as TestOptogenetics sets up.
+ * A population is then made from the two as usual, for example
+ *
+ *     TissueFileReader<2> reader("tissue.bin");
+ *     std::vector<CellPtr> cells;
+ *     reader.GenerateCells(cells);
+ *     VertexBasedCellPopulation<2> cell_population(*reader.GetMesh(), cells);
+ *
+ * Like the mesh generators, the reader owns the mesh, so must outlive the population.
+ *
+ * Only implemented in 2D.
+ */
+template<unsigned DIM>
+class TissueFileReader
+{
+private:
+
+    /** Path of the file. */
+    std::string mPath;
+
+    /** The mapped file. */
+    const char* mpFile;
+
+    /** Size of the mapping. */
+    std::size_t mFileSize;
+
+    /** The mesh, once built by GetMesh(). */
+    MatteoMutableVertexMesh<DIM>* mpMesh;
+
+    /**
+     * @return the header at the start of the file
+     */
+    const TissueFileHeader& rGetHeader() const;
+
+    /**
+     * Check that an array lies within the file and is aligned.
+     *
+     * @param offset the offset of the array
+     * @param size the size of the array in bytes
+     * @param rName the name of the array, for the error message
+     */
+    void CheckArray(uint64_t offset, uint64_t size, const std::string& rName) const;
+
+public:
+
+    /**
+     * Constructor. Maps and validates the file.
+     *
+     * @param rPath the path of the file, absolute or relative to the working directory
+     */
+    TissueFileReader(const std::string& rPath);
+
+    /**
+     * Destructor. Unmaps the file and deletes the mesh.
+     */
+    ~TissueFileReader();
+
+    /**
+     * @return the mesh, built on the first call
+     */
+    MatteoMutableVertexMesh<DIM>* GetMesh();
+
+    /**
+     * Replace the contents of a vector with one new cell per element of the mesh, in
+     * element order.
+     *
+     * @param rCells the vector of cells to fill
+     */
+    void GenerateCells(std::vector<CellPtr>& rCells);
+
+    /**
+     * @return the number of cells in the file
+     */
+    unsigned GetNumCells() const;
+};
+
+#endif /*TISSUEFILEREADER_HPP_*/
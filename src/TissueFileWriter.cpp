@@ -0,0 +1,158 @@
+
+#include "TissueFileWriter.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include "AbstractOdeSrnModel.hpp"
+#include "CellLabel.hpp"
+#include "PopulationConstants.hpp"
+
+/**
+ * @param offset an offset in bytes
+ * @return the offset rounded up to a multiple of 8, so that doubles are aligned
+ */
+static uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + 7) & ~uint64_t(7);
+}
+
+template<unsigned DIM>
+void TissueFileWriter<DIM>::WriteTissueFile(VertexBasedCellPopulation<DIM>& rCellPopulation, const std::string& rPath)
+{
+    if (DIM != 2)
+    {
+        EXCEPTION("TissueFileWriter is only implemented in 2D");
+    }
+
+    // Number the remaining nodes and elements contiguously, skipping any deleted ones
+    MutableVertexMesh<DIM,DIM>& r_mesh = rCellPopulation.rGetMesh();
+    const unsigned unnumbered = std::numeric_limits<unsigned>::max();
+    std::vector<unsigned> new_node_indices(r_mesh.GetNumAllNodes(), unnumbered);
+    std::vector<Node<DIM>*> nodes;
+    for (unsigned node_index=0; node_index<r_mesh.GetNumAllNodes(); node_index++)
+    {
+        Node<DIM>* p_node = r_mesh.GetNode(node_index);
+        if (!p_node->IsDeleted())
+        {
+            new_node_indices[node_index] = nodes.size();
+            nodes.push_back(p_node);
+        }
+    }
+    std::vector<VertexElement<DIM,DIM>*> elements;
+    unsigned num_element_nodes = 0;
+    for (unsigned elem_index=0; elem_index<r_mesh.GetNumAllElements(); elem_index++)
+    {
+        VertexElement<DIM,DIM>* p_element = r_mesh.GetElement(elem_index);
+        if (!p_element->IsDeleted())
+        {
+            elements.push_back(p_element);
+            num_element_nodes += p_element->GetNumNodes();
+        }
+    }
+
+    // The SRN states stored are those of the first initialised ODE-based SRN model
+    unsigned num_srn_variables = 0;
+    for (unsigned i=0; i<elements.size() && num_srn_variables==0; i++)
+    {
+        AbstractOdeSrnModel* p_srn_model = dynamic_cast<AbstractOdeSrnModel*>(
+            rCellPopulation.GetCellUsingLocationIndex(elements[i]->GetIndex())->GetSrnModel());
+        if (p_srn_model != NULL && p_srn_model->GetOdeSystem() != NULL)
+        {
+            num_srn_variables = p_srn_model->GetOdeSystem()->GetNumberOfStateVariables();
+        }
+    }
+
+    unsigned num_nodes = nodes.size();
+    unsigned num_elements = elements.size();
+    uint64_t node_locations_offset = AlignOffset(sizeof(TissueFileHeader));
+    uint64_t birth_times_offset = node_locations_offset + sizeof(double)*DIM*num_nodes;
+    uint64_t srn_states_offset = birth_times_offset + sizeof(double)*num_elements;
+    uint64_t element_offsets_offset = srn_states_offset + sizeof(double)*num_srn_variables*num_elements;
+    uint64_t element_nodes_offset = AlignOffset(element_offsets_offset + sizeof(uint32_t)*(num_elements + 1));
+    uint64_t cell_types_offset = AlignOffset(element_nodes_offset + sizeof(uint32_t)*num_element_nodes);
+    uint64_t boundary_nodes_offset = AlignOffset(cell_types_offset + sizeof(int32_t)*num_elements);
+    uint64_t size = boundary_nodes_offset + sizeof(uint8_t)*num_nodes;
+
+    std::vector<char> buffer(size, 0);
+    TissueFileHeader* p_header = reinterpret_cast<TissueFileHeader*>(&buffer[0]);
+    memcpy(p_header->mMagic, "CHSTTFIL", 8);
+    p_header->mVersion = TISSUE_FILE_VERSION;
+    p_header->mDimension = DIM;
+    p_header->mNumNodes = num_nodes;
+    p_header->mNumElements = num_elements;
+    p_header->mNumElementNodes = num_element_nodes;
+    p_header->mNumSrnVariables = num_srn_variables;
+    p_header->mNodeLocationsOffset = node_locations_offset;
+    p_header->mBirthTimesOffset = birth_times_offset;
+    p_header->mSrnStatesOffset = srn_states_offset;
+    p_header->mElementOffsetsOffset = element_offsets_offset;
+    p_header->mElementNodesOffset = element_nodes_offset;
+    p_header->mCellTypesOffset = cell_types_offset;
+    p_header->mBoundaryNodesOffset = boundary_nodes_offset;
+    p_header->mFileSize = size;
+
+    double* p_locations = reinterpret_cast<double*>(&buffer[node_locations_offset]);
+    uint8_t* p_boundary_nodes = reinterpret_cast<uint8_t*>(&buffer[boundary_nodes_offset]);
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        const c_vector<double, DIM>& r_location = nodes[node_index]->rGetLocation();
+        for (unsigned i=0; i<DIM; i++)
+        {
+            p_locations[DIM*node_index + i] = r_location[i];
+        }
+        p_boundary_nodes[node_index] = nodes[node_index]->IsBoundaryNode() ? 1 : 0;
+    }
+
+    double* p_birth_times = reinterpret_cast<double*>(&buffer[birth_times_offset]);
+    double* p_srn_states = reinterpret_cast<double*>(&buffer[srn_states_offset]);
+    uint32_t* p_element_offsets = reinterpret_cast<uint32_t*>(&buffer[element_offsets_offset]);
+    uint32_t* p_element_nodes = reinterpret_cast<uint32_t*>(&buffer[element_nodes_offset]);
+    int32_t* p_cell_types = reinterpret_cast<int32_t*>(&buffer[cell_types_offset]);
+    const double missing = std::numeric_limits<double>::quiet_NaN();
+    unsigned slot = 0;
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        VertexElement<DIM,DIM>* p_element = elements[elem_index];
+        p_element_offsets[elem_index] = slot;
+        for (unsigned local_index=0; local_index<p_element->GetNumNodes(); local_index++)
+        {
+            p_element_nodes[slot++] = new_node_indices[p_element->GetNodeGlobalIndex(local_index)];
+        }
+
+        CellPtr p_cell = rCellPopulation.GetCellUsingLocationIndex(p_element->GetIndex());
+        p_cell_types[elem_index] = ((p_cell->GetCellProliferativeType() == p_wild_type) ? 0 : 1)
+                                   + (p_cell->template HasCellProperty<CellLabel>() ? 2 : 0);
+        p_birth_times[elem_index] = p_cell->GetBirthTime();
+
+        AbstractOdeSrnModel* p_srn_model = dynamic_cast<AbstractOdeSrnModel*>(p_cell->GetSrnModel());
+        double* p_state = p_srn_states + num_srn_variables*elem_index;
+        if (p_srn_model != NULL && p_srn_model->GetOdeSystem() != NULL)
+        {
+            const std::vector<double>& r_state = p_srn_model->GetOdeSystem()->rGetStateVariables();
+            if (r_state.size() != num_srn_variables)
+            {
+                EXCEPTION("Cannot write a tissue file of cells with different numbers of SRN state variables");
+            }
+            std::copy(r_state.begin(), r_state.end(), p_state);
+        }
+        else
+        {
+            std::fill(p_state, p_state + num_srn_variables, missing);
+        }
+    }
+    p_element_offsets[num_elements] = slot;
+
+    std::ofstream file(rPath.c_str(), std::ios::binary | std::ios::trunc);
+    file.write(&buffer[0], size);
+    file.close();
+    if (!file)
+    {
+        EXCEPTION("Could not write the tissue file " << rPath);
+    }
+}
+
+// Explicit instantiation
+template class TissueFileWriter<1>;
+template class TissueFileWriter<2>;
+template class TissueFileWriter<3>;
@@ -0,0 +1,37 @@
+
+#ifndef TISSUEFILEWRITER_HPP_
+#define TISSUEFILEWRITER_HPP_
+
+#include <string>
+
+#include "VertexBasedCellPopulation.hpp"
+#include "TissueFileHeader.hpp"
+
+/**
+ * Writes the state of a vertex-based cell population to a compact binary tissue file
+ * (see TissueFileHeader), which TissueFileReader can load in bulk to start further
+ * simulations from it, for example from an equilibrated tissue.
+ *
+ * The file holds the node locations and boundary flags, the element connectivity and,
+ * for each cell, its type (wild type or not, as for SharedMemoryExportModifier), whether
+ * it is labelled, its birth time, and the state of its ODE-based SRN model, if it has one
+ * that has been initialised. Deleted nodes and elements are skipped, and the rest
+ * renumbered contiguously.
+ *
+ * Only implemented in 2D.
+ */
+template<unsigned DIM>
+class TissueFileWriter
+{
+public:
+
+    /**
+     * Write a population to a tissue file, replacing any existing file.
+     *
+     * @param rCellPopulation the population
+     * @param rPath the path of the file, absolute or relative to the working directory
+     */
+    static void WriteTissueFile(VertexBasedCellPopulation<DIM>& rCellPopulation, const std::string& rPath);
+};
+
+#endif /*TISSUEFILEWRITER_HPP_*/
@@ -0,0 +1,241 @@
+
+#include "TissueSortingModifier.hpp"
+#include "EdgeType.hpp"
+#include "VertexGeometryCache.hpp"
+#include "OutputFileHandler.hpp"
+
+#include <algorithm>
+#include <functional>
+
+/**
+ * Find the root of an element in the union-find forest, halving the path on the way.
+ *
+ * @param rParents the parent of each element in the forest
+ * @param index the element
+ * @return the root of the element's tree
+ */
+static unsigned FindClusterRoot(std::vector<unsigned>& rParents, unsigned index)
+{
+    while (rParents[index] != index)
+    {
+        rParents[index] = rParents[rParents[index]];
+        index = rParents[index];
+    }
+    return index;
+}
+
+template<unsigned DIM>
+TissueSortingModifier<DIM>::TissueSortingModifier()
+    : AbstractCellBasedSimulationModifier<DIM>(),
+      mSamplingInterval(1),
+      mHeterotypicBoundaryLength(0.0)
+{
+    mMeanClusterRadius[0] = 0.0;
+    mMeanClusterRadius[1] = 0.0;
+}
+
+template<unsigned DIM>
+TissueSortingModifier<DIM>::~TissueSortingModifier()
+{
+}
+
+template<unsigned DIM>
+void TissueSortingModifier<DIM>::SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory)
+{
+    OutputFileHandler output_file_handler(outputDirectory + "/", false);
+    mpSortingFile = output_file_handler.OpenOutputFile("sorting.dat");
+    *mpSortingFile << "# time heterotypic_boundary_length"
+                   << " wild_clusters wild_mean_size wild_largest wild_mean_radius"
+                   << " diff_clusters diff_mean_size diff_largest diff_mean_radius\n";
+    mpClusterSizesFile = output_file_handler.OpenOutputFile("cluster_sizes.dat");
+    *mpClusterSizesFile << "# time type(0=wild,1=diff) cluster sizes, largest first\n";
+
+    ComputeSortingMetrics(rCellPopulation);
+    WriteMetrics();
+}
+
+template<unsigned DIM>
+void TissueSortingModifier<DIM>::UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (SimulationTime::Instance()->GetTimeStepsElapsed()%mSamplingInterval == 0)
+    {
+        ComputeSortingMetrics(rCellPopulation);
+        WriteMetrics();
+    }
+}
+
+template<unsigned DIM>
+void TissueSortingModifier<DIM>::UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (mpSortingFile)
+    {
+        mpSortingFile->close();
+        mpClusterSizesFile->close();
+    }
+}
+
+template<unsigned DIM>
+void TissueSortingModifier<DIM>::ComputeSortingMetrics(AbstractCellPopulation<DIM,DIM>& rCellPopulation)
+{
+    if (dynamic_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation) == NULL)
+    {
+        EXCEPTION("TissueSortingModifier is to be used with a VertexBasedCellPopulation only");
+    }
+    VertexBasedCellPopulation<DIM>* p_cell_population = static_cast<VertexBasedCellPopulation<DIM>*>(&rCellPopulation);
+    MutableVertexMesh<DIM,DIM>& r_mesh = p_cell_population->rGetMesh();
+    unsigned num_elements = r_mesh.GetNumElements();
+    VertexGeometryCache<DIM>* p_geometry = &VertexGeometryCache<DIM>::rGetCache(r_mesh, mGeometry);
+    p_geometry->Update(r_mesh);
+
+    std::vector<unsigned> parents(num_elements);
+    std::vector<bool> is_wild(num_elements);
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        parents[elem_index] = elem_index;
+        is_wild[elem_index] = IsWildType(p_cell_population->GetCellUsingLocationIndex(elem_index));
+    }
+
+    // Visit each internal edge once, from the element with the smaller index, measuring
+    // heterotypic edges and joining the clusters either side of homotypic ones
+    mHeterotypicBoundaryLength = 0.0;
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        VertexElement<DIM,DIM>* p_element = r_mesh.GetElement(elem_index);
+        unsigned num_nodes_elem = p_element->GetNumNodes();
+        for (unsigned local_index=0; local_index<num_nodes_elem; local_index++)
+        {
+            Node<DIM>* p_this_node = p_element->GetNode(local_index);
+            Node<DIM>* p_next_node = p_element->GetNode((local_index+1)%num_nodes_elem);
+
+            unsigned other_index;
+            EdgeType edge_type = GetEdgeType(elem_index, p_this_node, p_next_node, *p_cell_population, &other_index);
+            if (other_index == UINT_MAX || other_index < elem_index)
+            {
+                continue;
+            }
+
+            if (edge_type == MIXED_EDGE)
+            {
+                mHeterotypicBoundaryLength += p_geometry->GetEdgeLength(elem_index, local_index);
+            }
+            else
+            {
+                parents[FindClusterRoot(parents, other_index)] = FindClusterRoot(parents, elem_index);
+            }
+        }
+    }
+
+    // Accumulate the size and centroid moments of each cluster at its root
+    std::vector<unsigned> sizes(num_elements, 0);
+    std::vector<c_vector<double, DIM> > centroid_sums(num_elements, zero_vector<double>(DIM));
+    std::vector<double> squared_centroid_sums(num_elements, 0.0);
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        unsigned root = FindClusterRoot(parents, elem_index);
+        c_vector<double, DIM> centroid = p_geometry->GetCentroid(elem_index);
+        sizes[root]++;
+        centroid_sums[root] += centroid;
+        squared_centroid_sums[root] += inner_prod(centroid, centroid);
+    }
+
+    double radius_sums[2] = {0.0, 0.0};
+    mClusterSizes[0].clear();
+    mClusterSizes[1].clear();
+    for (unsigned root=0; root<num_elements; root++)
+    {
+        if (sizes[root] == 0)
+        {
+            continue;
+        }
+        unsigned type = is_wild[root] ? 0 : 1;
+        mClusterSizes[type].push_back(sizes[root]);
+
+        c_vector<double, DIM> mean_centroid = centroid_sums[root]/sizes[root];
+        double squared_radius = squared_centroid_sums[root]/sizes[root] - inner_prod(mean_centroid, mean_centroid);
+        radius_sums[type] += sqrt(std::max(squared_radius, 0.0));
+    }
+
+    for (unsigned type=0; type<2; type++)
+    {
+        std::sort(mClusterSizes[type].begin(), mClusterSizes[type].end(), std::greater<unsigned>());
+        mMeanClusterRadius[type] = mClusterSizes[type].empty() ? 0.0 : radius_sums[type]/mClusterSizes[type].size();
+    }
+}
+
+template<unsigned DIM>
+void TissueSortingModifier<DIM>::WriteMetrics()
+{
+    double time = SimulationTime::Instance()->GetTime();
+
+    *mpSortingFile << time << " " << mHeterotypicBoundaryLength;
+    for (unsigned type=0; type<2; type++)
+    {
+        unsigned num_clusters = mClusterSizes[type].size();
+        unsigned num_cells = 0;
+        for (unsigned i=0; i<num_clusters; i++)
+        {
+            num_cells += mClusterSizes[type][i];
+        }
+        double mean_size = (num_clusters == 0) ? 0.0 : (double)num_cells/num_clusters;
+        unsigned largest = (num_clusters == 0) ? 0 : mClusterSizes[type][0];
+
+        *mpSortingFile << " " << num_clusters << " " << mean_size << " " << largest << " " << mMeanClusterRadius[type];
+
+        *mpClusterSizesFile << time << " " << type;
+        for (unsigned i=0; i<num_clusters; i++)
+        {
+            *mpClusterSizesFile << " " << mClusterSizes[type][i];
+        }
+        *mpClusterSizesFile << "\n";
+    }
+    *mpSortingFile << "\n";
+}
+
+template<unsigned DIM>
+double TissueSortingModifier<DIM>::GetHeterotypicBoundaryLength()
+{
+    return mHeterotypicBoundaryLength;
+}
+
+template<unsigned DIM>
+const std::vector<unsigned>& TissueSortingModifier<DIM>::rGetClusterSizes(bool wildType)
+{
+    return mClusterSizes[wildType ? 0 : 1];
+}
+
+template<unsigned DIM>
+double TissueSortingModifier<DIM>::GetMeanClusterRadius(bool wildType)
+{
+    return mMeanClusterRadius[wildType ? 0 : 1];
+}
+
+template<unsigned DIM>
+unsigned TissueSortingModifier<DIM>::GetSamplingInterval()
+{
+    return mSamplingInterval;
+}
+
+template<unsigned DIM>
+void TissueSortingModifier<DIM>::SetSamplingInterval(unsigned samplingInterval)
+{
+    assert(samplingInterval > 0);
+    mSamplingInterval = samplingInterval;
+}
+
+template<unsigned DIM>
+void TissueSortingModifier<DIM>::OutputSimulationModifierParameters(out_stream& rParamsFile)
+{
+    *rParamsFile << "\t\t\t<SamplingInterval>" << mSamplingInterval << "</SamplingInterval>\n";
+
+    // Call method on direct parent class
+    AbstractCellBasedSimulationModifier<DIM>::OutputSimulationModifierParameters(rParamsFile);
+}
+
+// Explicit instantiation
+template class TissueSortingModifier<1>;
+template class TissueSortingModifier<2>;
+template class TissueSortingModifier<3>;
+
+// Serialization for Boost >= 1.36
+#include "SerializationExportWrapperForCpp.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(TissueSortingModifier)
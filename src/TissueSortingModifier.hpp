@@ -0,0 +1,162 @@
+
+#ifndef TISSUESORTINGMODIFIER_HPP_
+#define TISSUESORTINGMODIFIER_HPP_
+
+#include "ChasteSerialization.hpp"
+#include <boost/serialization/base_object.hpp>
+
+#include "AbstractCellBasedSimulationModifier.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "VertexGeometryCache.hpp"
+
+/**
+ * A modifier class which computes tissue sorting metrics during the simulation,
+ * so that sweeps do not need full mesh output to tell whether wild-type and
+ * differentiated cells sort.
+ *
+ * Every mSamplingInterval time steps it computes
+ *  - the heterotypic boundary length, i.e. the total length of edges between a
+ *    wild-type and a differentiated cell;
+ *  - the same-type clusters of each cell type, found by union-find over the
+ *    elements sharing an edge;
+ *  - for each cell type, the number of clusters, the mean and largest cluster size
+ *    and the mean cluster radius of gyration (from element centroids).
+ *
+ * One line per sample is written to sorting.dat, and the full cluster size
+ * distribution to cluster_sizes.dat, in the simulation output directory.
+ */
+template<unsigned DIM>
+class TissueSortingModifier : public AbstractCellBasedSimulationModifier<DIM,DIM>
+{
+    /** Needed for serialization. */
+    friend class boost::serialization::access;
+    /**
+     * Boost Serialization method for archiving/checkpointing.
+     * Archives the object and its member variables.
+     *
+     * @param archive  The boost archive.
+     * @param version  The current version of this class.
+     */
+    template<class Archive>
+    void serialize(Archive & archive, const unsigned int version)
+    {
+        archive & boost::serialization::base_object<AbstractCellBasedSimulationModifier<DIM,DIM> >(*this);
+        archive & mSamplingInterval;
+    }
+
+    /** Metrics are computed every this many time steps. Defaults to 1. */
+    unsigned mSamplingInterval;
+
+    /** The heterotypic boundary length at the last computation. */
+    double mHeterotypicBoundaryLength;
+
+    /** Sizes of the clusters of wild-type (index 0) and differentiated (index 1) cells, largest first. */
+    std::vector<unsigned> mClusterSizes[2];
+
+    /** Mean radius of gyration of the clusters of wild-type (index 0) and differentiated (index 1) cells. */
+    double mMeanClusterRadius[2];
+
+    /** The geometry of meshes which do not own a VertexGeometryCache, recomputed every sample. Not archived. */
+    VertexGeometryCache<DIM> mGeometry;
+
+    /** Output file for the time series of sorting metrics. */
+    out_stream mpSortingFile;
+
+    /** Output file for the cluster size distributions. */
+    out_stream mpClusterSizesFile;
+
+    /**
+     * Write the most recently computed metrics to the output files.
+     */
+    void WriteMetrics();
+
+public:
+
+    /**
+     * Default constructor.
+     */
+    TissueSortingModifier();
+
+    /**
+     * Destructor.
+     */
+    virtual ~TissueSortingModifier();
+
+    /**
+     * Overridden UpdateAtEndOfTimeStep() method.
+     *
+     * Computes and writes the metrics every mSamplingInterval time steps.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfTimeStep(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Overridden SetupSolve() method.
+     *
+     * Opens the output files and writes the metrics of the initial configuration.
+     *
+     * @param rCellPopulation reference to the cell population
+     * @param outputDirectory the output directory, relative to where Chaste output is stored
+     */
+    virtual void SetupSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation, std::string outputDirectory);
+
+    /**
+     * Overridden UpdateAtEndOfSolve() method.
+     *
+     * Closes the output files.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    virtual void UpdateAtEndOfSolve(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * Compute the sorting metrics of the current configuration. Called automatically
+     * during a simulation, but may also be called directly.
+     *
+     * @param rCellPopulation reference to the cell population
+     */
+    void ComputeSortingMetrics(AbstractCellPopulation<DIM,DIM>& rCellPopulation);
+
+    /**
+     * @return the heterotypic boundary length at the last computation
+     */
+    double GetHeterotypicBoundaryLength();
+
+    /**
+     * @param wildType whether to return the clusters of wild-type or of differentiated cells
+     * @return the sizes of the clusters of the given type at the last computation, largest first
+     */
+    const std::vector<unsigned>& rGetClusterSizes(bool wildType);
+
+    /**
+     * @param wildType whether to return the radius for wild-type or for differentiated cells
+     * @return the mean radius of gyration of the clusters of the given type at the last computation
+     */
+    double GetMeanClusterRadius(bool wildType);
+
+    /**
+     * @return mSamplingInterval
+     */
+    unsigned GetSamplingInterval();
+
+    /**
+     * Set mSamplingInterval.
+     *
+     * @param samplingInterval compute the metrics every this many time steps
+     */
+    void SetSamplingInterval(unsigned samplingInterval);
+
+    /**
+     * Overridden OutputSimulationModifierParameters() method.
+     * Output any simulation modifier parameters to file.
+     *
+     * @param rParamsFile the file stream to which the parameters are output
+     */
+    void OutputSimulationModifierParameters(out_stream& rParamsFile);
+};
+
+#include "SerializationExportWrapper.hpp"
+EXPORT_TEMPLATE_CLASS_SAME_DIMS(TissueSortingModifier)
+
+#endif /*TISSUESORTINGMODIFIER_HPP_*/
@@ -0,0 +1,208 @@
+
+#include "VertexGeometryCache.hpp"
+#include "MatteoMutableVertexMesh.hpp"
+#include "MatteoProfiler.hpp"
+
+template<unsigned DIM>
+VertexGeometryCache<DIM>::VertexGeometryCache()
+    : mChangeStamp(0),
+      mNumNodes(0),
+      mNumRecomputations(0)
+{
+}
+
+template<unsigned DIM>
+VertexGeometryCache<DIM>& VertexGeometryCache<DIM>::rGetCache(MutableVertexMesh<DIM,DIM>& rMesh, VertexGeometryCache<DIM>& rOwnCache)
+{
+    MatteoMutableVertexMesh<DIM>* p_matteo_mesh = dynamic_cast<MatteoMutableVertexMesh<DIM>*>(&rMesh);
+    if (p_matteo_mesh != NULL)
+    {
+        return p_matteo_mesh->rGetGeometryCache();
+    }
+    return rOwnCache;
+}
+
+template<unsigned DIM>
+void VertexGeometryCache<DIM>::Recompute(MutableVertexMesh<DIM,DIM>& rMesh)
+{
+    MatteoMutableVertexMesh<DIM>* p_matteo_mesh = dynamic_cast<MatteoMutableVertexMesh<DIM>*>(&rMesh);
+    mChangeStamp = (p_matteo_mesh != NULL) ? p_matteo_mesh->GetChangeStamp() : 0;
+    mNumNodes = rMesh.GetNumAllNodes();
+    mNumRecomputations++;
+
+    unsigned num_elements = rMesh.GetNumAllElements();
+    mElementOffsets.resize(num_elements + 1);
+    mElementNodeIndices.clear();
+    mNextNodeIndices.clear();
+    mElementOffsets[0] = 0;
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        VertexElement<DIM,DIM>* p_element = rMesh.GetElement(elem_index);
+        unsigned num_nodes_elem = p_element->IsDeleted() ? 0 : p_element->GetNumNodes();
+        for (unsigned local_index=0; local_index<num_nodes_elem; local_index++)
+        {
+            mElementNodeIndices.push_back(p_element->GetNodeGlobalIndex(local_index));
+            mNextNodeIndices.push_back(p_element->GetNodeGlobalIndex((local_index+1)%num_nodes_elem));
+        }
+        mElementOffsets[elem_index+1] = mElementNodeIndices.size();
+    }
+
+    unsigned num_slots = mElementNodeIndices.size();
+    mAreas.assign(num_elements, 0.0);
+    mPerimeters.assign(num_elements, 0.0);
+    mEdgeLengths.assign(num_slots, 0.0);
+    for (unsigned i=0; i<DIM; i++)
+    {
+        mCentroids[i].assign(num_elements, 0.0);
+        mEdgeGradients[i].assign(num_slots, 0.0);
+        mAreaGradients[i].assign(num_slots, 0.0);
+    }
+
+    std::vector<c_vector<double, DIM> > relative_locations;
+    for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+    {
+        unsigned offset = mElementOffsets[elem_index];
+        unsigned num_nodes_elem = mElementOffsets[elem_index+1] - offset;
+        if (num_nodes_elem == 0)
+        {
+            continue;
+        }
+
+        // Node locations relative to the first node, so that periodic meshes are handled as by the mesh itself
+        const c_vector<double, DIM>& r_first_location = rMesh.GetNode(mElementNodeIndices[offset])->rGetLocation();
+        relative_locations.resize(num_nodes_elem);
+        for (unsigned local_index=0; local_index<num_nodes_elem; local_index++)
+        {
+            relative_locations[local_index] = rMesh.GetVectorFromAtoB(r_first_location,
+                                                                      rMesh.GetNode(mElementNodeIndices[offset + local_index])->rGetLocation());
+        }
+
+        for (unsigned local_index=0; local_index<num_nodes_elem; local_index++)
+        {
+            unsigned slot = offset + local_index;
+            c_vector<double, DIM> edge = relative_locations[(local_index+1)%num_nodes_elem] - relative_locations[local_index];
+            double length = norm_2(edge);
+            mEdgeLengths[slot] = length;
+            mPerimeters[elem_index] += length;
+            for (unsigned i=0; i<DIM; i++)
+            {
+                mEdgeGradients[i][slot] = -edge[i]/length;
+            }
+        }
+
+        if (DIM == 2)
+        {
+            double signed_area = 0.0;
+            c_vector<double, DIM> centroid_sum = zero_vector<double>(DIM);
+            for (unsigned local_index=0; local_index<num_nodes_elem; local_index++)
+            {
+                unsigned slot = offset + local_index;
+                const c_vector<double, DIM>& r_this = relative_locations[local_index];
+                const c_vector<double, DIM>& r_next = relative_locations[(local_index+1)%num_nodes_elem];
+                const c_vector<double, DIM>& r_previous = relative_locations[(local_index+num_nodes_elem-1)%num_nodes_elem];
+
+                double cross = r_this[0]*r_next[1] - r_next[0]*r_this[1];
+                signed_area += 0.5*cross;
+                centroid_sum += (r_this + r_next)*cross;
+
+                mAreaGradients[0][slot] = 0.5*(r_next[1] - r_previous[1]);
+                mAreaGradients[1][slot] = 0.5*(r_previous[0] - r_next[0]);
+            }
+            mAreas[elem_index] = fabs(signed_area);
+            for (unsigned i=0; i<DIM; i++)
+            {
+                mCentroids[i][elem_index] = r_first_location[i] + centroid_sum[i]/(6.0*signed_area);
+            }
+        }
+        else
+        {
+            mAreas[elem_index] = rMesh.GetVolumeOfElement(elem_index);
+            mPerimeters[elem_index] = rMesh.GetSurfaceAreaOfElement(elem_index);
+            c_vector<double, DIM> centroid = rMesh.GetCentroidOfElement(elem_index);
+            for (unsigned i=0; i<DIM; i++)
+            {
+                mCentroids[i][elem_index] = centroid[i];
+            }
+        }
+    }
+}
+
+template<unsigned DIM>
+void VertexGeometryCache<DIM>::Update(MutableVertexMesh<DIM,DIM>& rMesh)
+{
+    // Only a stamped mesh can be shown not to have changed; a division changes its numbers of nodes and elements
+    MatteoMutableVertexMesh<DIM>* p_matteo_mesh = dynamic_cast<MatteoMutableVertexMesh<DIM>*>(&rMesh);
+    if (p_matteo_mesh == NULL
+        || p_matteo_mesh->GetChangeStamp() != mChangeStamp
+        || mElementOffsets.size() != rMesh.GetNumAllElements() + 1
+        || mNumNodes != rMesh.GetNumAllNodes())
+    {
+        MATTEO_PROFILE_SCOPE("VertexGeometryCache::Recompute");
+        Recompute(rMesh);
+    }
+}
+
+template<unsigned DIM>
+void VertexGeometryCache<DIM>::Reset()
+{
+    mChangeStamp = 0;
+    mElementOffsets.clear();
+}
+
+template<unsigned DIM>
+c_vector<double, DIM> VertexGeometryCache<DIM>::GetCentroid(unsigned elemIndex) const
+{
+    c_vector<double, DIM> centroid;
+    for (unsigned i=0; i<DIM; i++)
+    {
+        centroid[i] = mCentroids[i][elemIndex];
+    }
+    return centroid;
+}
+
+template<unsigned DIM>
+c_vector<double, DIM> VertexGeometryCache<DIM>::GetNextEdgeGradient(unsigned elemIndex, unsigned localIndex) const
+{
+    unsigned slot = mElementOffsets[elemIndex] + localIndex;
+    c_vector<double, DIM> gradient;
+    for (unsigned i=0; i<DIM; i++)
+    {
+        gradient[i] = mEdgeGradients[i][slot];
+    }
+    return gradient;
+}
+
+template<unsigned DIM>
+c_vector<double, DIM> VertexGeometryCache<DIM>::GetAreaGradient(unsigned elemIndex, unsigned localIndex) const
+{
+    unsigned slot = mElementOffsets[elemIndex] + localIndex;
+    c_vector<double, DIM> gradient;
+    for (unsigned i=0; i<DIM; i++)
+    {
+        gradient[i] = mAreaGradients[i][slot];
+    }
+    return gradient;
+}
+
+template<unsigned DIM>
+unsigned VertexGeometryCache<DIM>::GetNumRecomputations() const
+{
+    return mNumRecomputations;
+}
+
+template<unsigned DIM>
+std::size_t VertexGeometryCache<DIM>::GetMemoryUsage() const
+{
+    std::size_t num_bytes = sizeof(unsigned)*(mElementOffsets.capacity() + mElementNodeIndices.capacity() + mNextNodeIndices.capacity())
+                            + sizeof(double)*(mAreas.capacity() + mPerimeters.capacity() + mEdgeLengths.capacity());
+    for (unsigned i=0; i<DIM; i++)
+    {
+        num_bytes += sizeof(double)*(mCentroids[i].capacity() + mEdgeGradients[i].capacity() + mAreaGradients[i].capacity());
+    }
+    return num_bytes;
+}
+
+// Explicit instantiation
+template class VertexGeometryCache<1>;
+template class VertexGeometryCache<2>;
+template class VertexGeometryCache<3>;
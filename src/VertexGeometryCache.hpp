@@ -0,0 +1,215 @@
+
+#ifndef VERTEXGEOMETRYCACHE_HPP_
+#define VERTEXGEOMETRYCACHE_HPP_
+
+#include <vector>
+
+#include "MutableVertexMesh.hpp"
+
+/**
+ * A cache of the geometry of the elements of a vertex mesh: the area, perimeter and
+ * centroid of each element, and the length and gradients of each of its edges.
+ *
+ * Everything is computed in a single sweep over the elements into flat arrays, one
+ * entry per element or per (element, local node) slot, with one array per spatial
+ * component for vector quantities. MatteoForce, the sorting modifiers and anything
+ * else that needs the geometry within the same time step can share one evaluation
+ * rather than each asking the mesh again, and kernels can stream through the arrays
+ * directly.
+ *
+ * A MatteoMutableVertexMesh owns a cache of its own, validated by the mesh's change stamp
+ * and its numbers of nodes and elements, so Update() recomputes only if the mesh has changed
+ * since the cache was computed from it and its consumers need not know whether another has
+ * already brought it up to date. The stamps are unique among all meshes, so a cache cannot
+ * mistake a new mesh for the one it was computed from. Other meshes carry no stamp, so
+ * consumers keep a cache of their own for them, which Update() always recomputes; see
+ * rGetCache().
+ */
+template<unsigned DIM>
+class VertexGeometryCache
+{
+private:
+
+    /** The change stamp of the mesh when the cache was computed, if it is a MatteoMutableVertexMesh. */
+    unsigned long mChangeStamp;
+
+    /** Number of nodes of the mesh when the cache was computed. */
+    unsigned mNumNodes;
+
+    /** Offset of each element's slots in the per-slot arrays (one extra entry at the end). */
+    std::vector<unsigned> mElementOffsets;
+
+    /** The global index of the node in each slot. */
+    std::vector<unsigned> mElementNodeIndices;
+
+    /** The global index of the next node of the element in each slot. */
+    std::vector<unsigned> mNextNodeIndices;
+
+    /** The area (volume in 3D) of each element. */
+    std::vector<double> mAreas;
+
+    /** The perimeter (surface area in 3D) of each element. */
+    std::vector<double> mPerimeters;
+
+    /** Each component of the centroid of each element. */
+    std::vector<double> mCentroids[DIM];
+
+    /** The length of the edge from each slot's node to the next node of its element. */
+    std::vector<double> mEdgeLengths;
+
+    /** Each component of the gradient of that edge length at each slot's node. */
+    std::vector<double> mEdgeGradients[DIM];
+
+    /** Each component of the gradient of the element area at each slot's node. */
+    std::vector<double> mAreaGradients[DIM];
+
+    /** Number of times the geometry has been recomputed. */
+    unsigned mNumRecomputations;
+
+    /**
+     * Recompute the geometry of every element of the mesh.
+     *
+     * @param rMesh the mesh
+     */
+    void Recompute(MutableVertexMesh<DIM,DIM>& rMesh);
+
+public:
+
+    /**
+     * Constructor. The cache is empty until the first call to Update().
+     */
+    VertexGeometryCache();
+
+    /**
+     * @param rMesh the mesh
+     * @param rOwnCache a cache kept by the caller, used if the mesh has none
+     * @return the cache owned by the mesh if it is a MatteoMutableVertexMesh, shared by all
+     *     its consumers, or otherwise rOwnCache
+     */
+    static VertexGeometryCache& rGetCache(MutableVertexMesh<DIM,DIM>& rMesh, VertexGeometryCache& rOwnCache);
+
+    /**
+     * Bring the cache up to date with a mesh. The geometry is recomputed unless the mesh is a
+     * MatteoMutableVertexMesh which has not changed since the cache was computed from it.
+     *
+     * @param rMesh the mesh
+     */
+    void Update(MutableVertexMesh<DIM,DIM>& rMesh);
+
+    /**
+     * Forget the cached geometry, so that the next Update() recomputes it.
+     */
+    void Reset();
+
+    /**
+     * @param elemIndex global index of an element
+     * @return the area of the element
+     */
+    double GetArea(unsigned elemIndex) const
+    {
+        return mAreas[elemIndex];
+    }
+
+    /**
+     * @param elemIndex global index of an element
+     * @return the perimeter of the element
+     */
+    double GetPerimeter(unsigned elemIndex) const
+    {
+        return mPerimeters[elemIndex];
+    }
+
+    /**
+     * @param elemIndex global index of an element
+     * @return the centroid of the element
+     */
+    c_vector<double, DIM> GetCentroid(unsigned elemIndex) const;
+
+    /**
+     * @param elemIndex global index of an element
+     * @param localIndex local index of a node in the element
+     * @return the length of the edge from that node to the next node of the element
+     */
+    double GetEdgeLength(unsigned elemIndex, unsigned localIndex) const
+    {
+        return mEdgeLengths[mElementOffsets[elemIndex] + localIndex];
+    }
+
+    /**
+     * @param elemIndex global index of an element
+     * @param localIndex local index of a node in the element
+     * @return the gradient, at that node, of the length of the edge to the next node, as
+     *     given by MutableVertexMesh::GetNextEdgeGradientOfElementAtNode()
+     */
+    c_vector<double, DIM> GetNextEdgeGradient(unsigned elemIndex, unsigned localIndex) const;
+
+    /**
+     * @param elemIndex global index of an element
+     * @param localIndex local index of a node in the element
+     * @return the gradient of the element's area at that node, as given by
+     *     MutableVertexMesh::GetAreaGradientOfElementAtNode()
+     */
+    c_vector<double, DIM> GetAreaGradient(unsigned elemIndex, unsigned localIndex) const;
+
+    /**
+     * @return the offset of each element's slots in the per-slot arrays, with one extra entry at the end
+     */
+    const std::vector<unsigned>& rGetElementOffsets() const
+    {
+        return mElementOffsets;
+    }
+
+    /**
+     * @return the global index of the node in each slot
+     */
+    const std::vector<unsigned>& rGetElementNodeIndices() const
+    {
+        return mElementNodeIndices;
+    }
+
+    /**
+     * @return the global index of the next node of the element in each slot
+     */
+    const std::vector<unsigned>& rGetNextNodeIndices() const
+    {
+        return mNextNodeIndices;
+    }
+
+    /**
+     * @return the length of the edge from each slot's node to the next
+     */
+    const std::vector<double>& rGetEdgeLengths() const
+    {
+        return mEdgeLengths;
+    }
+
+    /**
+     * @param component a spatial direction
+     * @return that component of the edge length gradient at each slot's node
+     */
+    const std::vector<double>& rGetEdgeGradients(unsigned component) const
+    {
+        return mEdgeGradients[component];
+    }
+
+    /**
+     * @param component a spatial direction
+     * @return that component of the element area gradient at each slot's node
+     */
+    const std::vector<double>& rGetAreaGradients(unsigned component) const
+    {
+        return mAreaGradients[component];
+    }
+
+    /**
+     * @return the number of times the geometry has been recomputed
+     */
+    unsigned GetNumRecomputations() const;
+
+    /**
+     * @return the number of bytes allocated for the cached geometry
+     */
+    std::size_t GetMemoryUsage() const;
+};
+
+#endif /*VERTEXGEOMETRYCACHE_HPP_*/
@@ -0,0 +1,315 @@
+
+#include "VertexRearrangementCandidateIndex.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <set>
+
+template<unsigned DIM>
+VertexRearrangementCandidateIndex<DIM>::VertexRearrangementCandidateIndex()
+    : mOutOfDate(true),
+      mNumIndexedElements(0)
+{
+}
+
+template<unsigned DIM>
+void VertexRearrangementCandidateIndex<DIM>::MarkOutOfDate()
+{
+    mOutOfDate = true;
+}
+
+template<unsigned DIM>
+bool VertexRearrangementCandidateIndex<DIM>::IsOutOfDate() const
+{
+    return mOutOfDate;
+}
+
+template<unsigned DIM>
+void VertexRearrangementCandidateIndex<DIM>::Rebuild(MutableVertexMesh<DIM, DIM>& rMesh)
+{
+    double threshold = rMesh.GetCellRearrangementThreshold();
+    double bucket_width = threshold/NUM_EDGE_BUCKETS;
+
+    for (unsigned bucket=0; bucket<NUM_EDGE_BUCKETS; bucket++)
+    {
+        mEdgeBuckets[bucket].clear();
+    }
+    mTriangularElements.clear();
+
+    mIndexedLocations.resize(rMesh.GetNumNodes());
+    for (unsigned node_index=0; node_index<rMesh.GetNumNodes(); node_index++)
+    {
+        mIndexedLocations[node_index] = rMesh.GetNode(node_index)->rGetLocation();
+    }
+
+    mNumIndexedElements = rMesh.GetNumElements();
+    for (unsigned elem_index=0; elem_index<mNumIndexedElements; elem_index++)
+    {
+        VertexElement<DIM, DIM>* p_element = rMesh.GetElement(elem_index);
+        unsigned num_nodes_in_element = p_element->GetNumNodes();
+        if (num_nodes_in_element == 3)
+        {
+            mTriangularElements.push_back(elem_index);
+        }
+
+        for (unsigned local_index=0; local_index<num_nodes_in_element; local_index++)
+        {
+            Node<DIM>* p_node_a = p_element->GetNode(local_index);
+            Node<DIM>* p_node_b = p_element->GetNode((local_index + 1)%num_nodes_in_element);
+
+            // Interior edges are visited once from each side, so keep one orientation
+            unsigned node_a = p_node_a->GetIndex();
+            unsigned node_b = p_node_b->GetIndex();
+            if (node_a > node_b && !(p_node_a->IsBoundaryNode() && p_node_b->IsBoundaryNode()))
+            {
+                continue;
+            }
+
+            // Edges with a slack of a whole threshold are dropped, as the index is rebuilt before any node can move that far
+            double slack = rMesh.GetDistanceBetweenNodes(node_a, node_b) - threshold;
+            unsigned bucket = (slack <= 0.0) ? 0 : (unsigned)(slack/bucket_width);
+            if (bucket < NUM_EDGE_BUCKETS)
+            {
+                mEdgeBuckets[bucket].push_back(node_a);
+                mEdgeBuckets[bucket].push_back(node_b);
+            }
+        }
+    }
+    mOutOfDate = false;
+}
+
+template<unsigned DIM>
+void VertexRearrangementCandidateIndex<DIM>::RecordBoundaryClearances(MutableVertexMesh<DIM, DIM>& rMesh)
+{
+    unsigned num_nodes = rMesh.GetNumNodes();
+    mFullCheckLocations.resize(num_nodes);
+    mBoundaryNodeIndices.clear();
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        mFullCheckLocations[node_index] = rMesh.GetNode(node_index)->rGetLocation();
+        if (rMesh.GetNode(node_index)->IsBoundaryNode())
+        {
+            mBoundaryNodeIndices.push_back(node_index);
+        }
+    }
+
+    // MutableVertexMesh only looks for T3 swaps of boundary nodes into boundary elements
+    std::vector<unsigned> boundary_elements;
+    std::vector<c_vector<double, DIM> > centres;
+    std::vector<double> radii;
+    double max_radius = 0.0;
+    for (unsigned elem_index=0; elem_index<rMesh.GetNumElements(); elem_index++)
+    {
+        VertexElement<DIM, DIM>* p_element = rMesh.GetElement(elem_index);
+        if (!p_element->IsElementOnBoundary())
+        {
+            continue;
+        }
+        c_vector<double, DIM> centre = p_element->GetNode(0)->rGetLocation();
+        double radius = 0.0;
+        for (unsigned local_index=1; local_index<p_element->GetNumNodes(); local_index++)
+        {
+            radius = std::max(radius, norm_2(rMesh.GetVectorFromAtoB(centre, p_element->GetNode(local_index)->rGetLocation())));
+        }
+        boundary_elements.push_back(elem_index);
+        centres.push_back(centre);
+        radii.push_back(radius);
+        max_radius = std::max(max_radius, radius);
+    }
+
+    if (boundary_elements.empty() || max_radius <= 0.0)
+    {
+        mBoundaryNodeClearances.assign(mBoundaryNodeIndices.size(), DBL_MAX);
+        return;
+    }
+
+    /*
+     * A clearance as large as the largest element is never used up before the next full check
+     * would find the move anyway, so clearances are only measured up to that size. Each element
+     * lies within its radius of its first node, so bin the elements by the squares of that size
+     * which their bounding boxes overlap; only the elements in the squares around a node's own
+     * can then be any closer to it.
+     */
+    double spacing = max_radius;
+    c_vector<double, 2> lower;
+    c_vector<double, 2> upper;
+    for (unsigned i=0; i<2; i++)
+    {
+        lower[i] = DBL_MAX;
+        upper[i] = -DBL_MAX;
+    }
+    for (unsigned k=0; k<boundary_elements.size(); k++)
+    {
+        for (unsigned i=0; i<2; i++)
+        {
+            lower[i] = std::min(lower[i], centres[k][i] - radii[k]);
+            upper[i] = std::max(upper[i], centres[k][i] + radii[k]);
+        }
+    }
+    for (unsigned i=0; i<mBoundaryNodeIndices.size(); i++)
+    {
+        const c_vector<double, DIM>& r_location = rMesh.GetNode(mBoundaryNodeIndices[i])->rGetLocation();
+        for (unsigned j=0; j<2; j++)
+        {
+            lower[j] = std::min(lower[j], r_location[j]);
+            upper[j] = std::max(upper[j], r_location[j]);
+        }
+    }
+    unsigned num_squares_x = (unsigned)((upper[0] - lower[0])/spacing) + 1;
+    unsigned num_squares_y = (unsigned)((upper[1] - lower[1])/spacing) + 1;
+
+    std::vector<std::vector<unsigned> > squares(num_squares_x*num_squares_y);
+    for (unsigned k=0; k<boundary_elements.size(); k++)
+    {
+        unsigned min_x = (unsigned)((centres[k][0] - radii[k] - lower[0])/spacing);
+        unsigned max_x = std::min(num_squares_x - 1, (unsigned)((centres[k][0] + radii[k] - lower[0])/spacing));
+        unsigned min_y = (unsigned)((centres[k][1] - radii[k] - lower[1])/spacing);
+        unsigned max_y = std::min(num_squares_y - 1, (unsigned)((centres[k][1] + radii[k] - lower[1])/spacing));
+        for (unsigned y=min_y; y<=max_y; y++)
+        {
+            for (unsigned x=min_x; x<=max_x; x++)
+            {
+                squares[x + num_squares_x*y].push_back(k);
+            }
+        }
+    }
+
+    // An element may be binned in several of the squares around a node, but is measured once
+    std::vector<unsigned> last_measured_for(boundary_elements.size(), UINT_MAX);
+    mBoundaryNodeClearances.assign(mBoundaryNodeIndices.size(), spacing);
+    for (unsigned i=0; i<mBoundaryNodeIndices.size(); i++)
+    {
+        Node<DIM>* p_node = rMesh.GetNode(mBoundaryNodeIndices[i]);
+        const c_vector<double, DIM>& r_location = p_node->rGetLocation();
+        const std::set<unsigned>& r_containing_elements = p_node->rGetContainingElementIndices();
+        double& r_clearance = mBoundaryNodeClearances[i];
+
+        unsigned node_x = (unsigned)((r_location[0] - lower[0])/spacing);
+        unsigned node_y = (unsigned)((r_location[1] - lower[1])/spacing);
+        for (unsigned y=(node_y > 0 ? node_y - 1 : 0); y<=std::min(num_squares_y - 1, node_y + 1); y++)
+        {
+            for (unsigned x=(node_x > 0 ? node_x - 1 : 0); x<=std::min(num_squares_x - 1, node_x + 1); x++)
+            {
+                const std::vector<unsigned>& r_square = squares[x + num_squares_x*y];
+                for (unsigned j=0; j<r_square.size(); j++)
+                {
+                    unsigned k = r_square[j];
+                    if (last_measured_for[k] == i)
+                    {
+                        continue;
+                    }
+                    last_measured_for[k] = i;
+
+                    // Most elements are ruled out by their radius alone
+                    if (norm_2(rMesh.GetVectorFromAtoB(centres[k], r_location)) - radii[k] >= r_clearance
+                        || r_containing_elements.find(boundary_elements[k]) != r_containing_elements.end())
+                    {
+                        continue;
+                    }
+
+                    VertexElement<DIM, DIM>* p_element = rMesh.GetElement(boundary_elements[k]);
+                    unsigned num_nodes_in_element = p_element->GetNumNodes();
+                    for (unsigned local_index=0; local_index<num_nodes_in_element; local_index++)
+                    {
+                        c_vector<double, DIM> to_start = rMesh.GetVectorFromAtoB(r_location, p_element->GetNode(local_index)->rGetLocation());
+                        c_vector<double, DIM> edge = rMesh.GetVectorFromAtoB(p_element->GetNode(local_index)->rGetLocation(),
+                                                                             p_element->GetNode((local_index + 1)%num_nodes_in_element)->rGetLocation());
+                        double edge_squared_length = inner_prod(edge, edge);
+                        double fraction = (edge_squared_length > 0.0) ? -inner_prod(to_start, edge)/edge_squared_length : 0.0;
+                        fraction = std::max(0.0, std::min(1.0, fraction));
+                        r_clearance = std::min(r_clearance, norm_2(to_start + fraction*edge));
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<unsigned DIM>
+bool VertexRearrangementCandidateIndex<DIM>::MayHaveRearrangements(MutableVertexMesh<DIM, DIM>& rMesh)
+{
+    if ((DIM != 2) || mOutOfDate)
+    {
+        return true;
+    }
+
+    // Divisions and deaths change the topology outside ReMesh()
+    unsigned num_nodes = rMesh.GetNumNodes();
+    if ((rMesh.GetNumAllNodes() != num_nodes)
+        || (rMesh.GetNumAllElements() != rMesh.GetNumElements())
+        || (mIndexedLocations.size() != num_nodes)
+        || (mFullCheckLocations.size() != num_nodes)
+        || (mNumIndexedElements != rMesh.GetNumElements()))
+    {
+        return true;
+    }
+
+    double threshold = rMesh.GetCellRearrangementThreshold();
+
+    double max_squared_displacement = 0.0;
+    double max_squared_displacement_since_full_check = 0.0;
+    for (unsigned node_index=0; node_index<num_nodes; node_index++)
+    {
+        const c_vector<double, DIM>& r_location = rMesh.GetNode(node_index)->rGetLocation();
+        double squared_displacement = 0.0;
+        double squared_displacement_since_full_check = 0.0;
+        for (unsigned i=0; i<DIM; i++)
+        {
+            double difference = r_location[i] - mIndexedLocations[node_index][i];
+            squared_displacement += difference*difference;
+            difference = r_location[i] - mFullCheckLocations[node_index][i];
+            squared_displacement_since_full_check += difference*difference;
+        }
+        max_squared_displacement = std::max(max_squared_displacement, squared_displacement);
+        max_squared_displacement_since_full_check = std::max(max_squared_displacement_since_full_check, squared_displacement_since_full_check);
+    }
+    double max_displacement = sqrt(max_squared_displacement);
+    double max_displacement_since_full_check = sqrt(max_squared_displacement_since_full_check);
+
+    // A boundary node may have crossed into an element it is not part of if it and that element have closed the gap between them
+    for (unsigned i=0; i<mBoundaryNodeIndices.size(); i++)
+    {
+        unsigned node_index = mBoundaryNodeIndices[i];
+        double displacement = norm_2(rMesh.GetNode(node_index)->rGetLocation() - mFullCheckLocations[node_index]);
+        if (displacement + max_displacement_since_full_check >= mBoundaryNodeClearances[i])
+        {
+            return true;
+        }
+    }
+
+    // Buckets beyond half the threshold only cover displacements up to half the threshold
+    if (max_displacement >= 0.5*threshold)
+    {
+        Rebuild(rMesh);
+        max_displacement = 0.0;
+    }
+
+    // An edge can only have shrunk by the displacements of both of its endpoints
+    double bucket_width = threshold/NUM_EDGE_BUCKETS;
+    for (unsigned bucket=0; bucket<NUM_EDGE_BUCKETS && bucket*bucket_width <= 2.0*max_displacement; bucket++)
+    {
+        const std::vector<unsigned>& r_edges = mEdgeBuckets[bucket];
+        for (unsigned i=0; i<r_edges.size(); i+=2)
+        {
+            if (rMesh.GetDistanceBetweenNodes(r_edges[i], r_edges[i+1]) < threshold)
+            {
+                return true;
+            }
+        }
+    }
+
+    for (unsigned i=0; i<mTriangularElements.size(); i++)
+    {
+        if (rMesh.GetVolumeOfElement(mTriangularElements[i]) < rMesh.GetT2Threshold())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Explicit instantiation
+template class VertexRearrangementCandidateIndex<1>;
+template class VertexRearrangementCandidateIndex<2>;
+template class VertexRearrangementCandidateIndex<3>;
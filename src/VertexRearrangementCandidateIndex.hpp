@@ -0,0 +1,101 @@
+
+#ifndef VERTEXREARRANGEMENTCANDIDATEINDEX_HPP_
+#define VERTEXREARRANGEMENTCANDIDATEINDEX_HPP_
+
+#include <vector>
+
+#include "MutableVertexMesh.hpp"
+
+/**
+ * An index of the places in a vertex mesh where a rearrangement could next happen, used by
+ * MatteoMutableVertexMesh to skip the rearrangement checks of MutableVertexMesh::ReMesh()
+ * when none is possible.
+ *
+ * Edges are bucketed by their slack, the amount by which they exceed the rearrangement
+ * threshold, as of the last time the index was built; an edge can only have become short if
+ * its endpoints have moved by more than its slack in total, so only the buckets below twice
+ * the largest node displacement are measured, along with the triangular elements that could
+ * undergo a T2 swap. For T3 swaps, RecordBoundaryClearances() records the clearance of every
+ * boundary node after each full check: its distance to the nearest boundary element which does
+ * not contain it, up to the size of the largest boundary element. A boundary node can only have
+ * entered such an element once its own displacement, plus the largest displacement of any node,
+ * has reached its clearance.
+ *
+ * The index is 2D only. It is not archived, and starts out of date.
+ */
+template<unsigned DIM>
+class VertexRearrangementCandidateIndex
+{
+private:
+
+    /** Number of slack buckets; together they span the rearrangement threshold. */
+    static const unsigned NUM_EDGE_BUCKETS = 4;
+
+    /** Whether the index must be rebuilt before it can be used. */
+    bool mOutOfDate;
+
+    /** Node locations when the index was built. */
+    std::vector<c_vector<double, DIM> > mIndexedLocations;
+
+    /** Number of elements when the index was built. */
+    unsigned mNumIndexedElements;
+
+    /** Pairs of node indices of the edges in each slack bucket, bucket b holding slacks below (b+1)/NUM_EDGE_BUCKETS of the threshold. */
+    std::vector<unsigned> mEdgeBuckets[NUM_EDGE_BUCKETS];
+
+    /** Indices of the triangular elements, the only ones which can undergo a T2 swap. */
+    std::vector<unsigned> mTriangularElements;
+
+    /** Node locations as of the last full check. */
+    std::vector<c_vector<double, DIM> > mFullCheckLocations;
+
+    /** Indices of the boundary nodes as of the last full check. */
+    std::vector<unsigned> mBoundaryNodeIndices;
+
+    /** Distance from each boundary node to the nearest boundary element not containing it, as of the last full check. */
+    std::vector<double> mBoundaryNodeClearances;
+
+public:
+
+    /**
+     * Constructor.
+     */
+    VertexRearrangementCandidateIndex();
+
+    /**
+     * Mark the index as out of date, after the topology of the mesh has changed.
+     */
+    void MarkOutOfDate();
+
+    /**
+     * @return whether the index must be rebuilt before it can be used
+     */
+    bool IsOutOfDate() const;
+
+    /**
+     * Rebuild the edge buckets and the list of triangular elements from the current state of the mesh.
+     *
+     * @param rMesh the mesh
+     */
+    void Rebuild(MutableVertexMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Record the node locations and the clearance of each boundary node, after a full check.
+     * The boundary elements are binned in a grid of squares as large as the largest of them,
+     * and each node is only measured against those in the squares around its own.
+     *
+     * @param rMesh the mesh
+     */
+    void RecordBoundaryClearances(MutableVertexMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Look for candidates for a rearrangement, rebuilding the edge buckets if the nodes have
+     * moved too far for them.
+     *
+     * @param rMesh the mesh
+     * @return whether a rearrangement may be due, so that the full check must run
+     */
+    bool MayHaveRearrangements(MutableVertexMesh<DIM, DIM>& rMesh);
+};
+
+#endif /*VERTEXREARRANGEMENTCANDIDATEINDEX_HPP_*/
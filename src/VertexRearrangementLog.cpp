@@ -0,0 +1,190 @@
+
+#include "VertexRearrangementLog.hpp"
+
+#include <algorithm>
+
+template<unsigned DIM>
+VertexRearrangementLog<DIM>::VertexRearrangementLog()
+    : mRearrangementsUnrecorded(true),
+      mNumRecordedNodes(0),
+      mNumRecordedElements(0)
+{
+}
+
+template<unsigned DIM>
+void VertexRearrangementLog<DIM>::RecordDivisions(MutableVertexMesh<DIM, DIM>& rMesh)
+{
+    if (mRearrangementsUnrecorded)
+    {
+        return;
+    }
+
+    // Deaths and T2 swaps leave deleted nodes and elements, and removing them renumbers the mesh
+    unsigned num_nodes = rMesh.GetNumAllNodes();
+    unsigned num_elements = rMesh.GetNumAllElements();
+    if ((num_nodes != rMesh.GetNumNodes())
+        || (num_elements != rMesh.GetNumElements())
+        || (num_nodes < mNumRecordedNodes)
+        || (num_elements < mNumRecordedElements))
+    {
+        mRearrangementsUnrecorded = true;
+        return;
+    }
+
+    // A division splits an edge of its neighbours at each new node, so the ends of that edge lose it
+    for (unsigned node_index=mNumRecordedNodes; node_index<num_nodes; node_index++)
+    {
+        mRearrangedNodes.push_back(node_index);
+        const std::set<unsigned>& r_containing_elements = rMesh.GetNode(node_index)->rGetContainingElementIndices();
+        for (std::set<unsigned>::const_iterator iter = r_containing_elements.begin();
+             iter != r_containing_elements.end();
+             ++iter)
+        {
+            VertexElement<DIM, DIM>* p_element = rMesh.GetElement(*iter);
+            unsigned num_nodes_in_element = p_element->GetNumNodes();
+            unsigned local_index = p_element->GetNodeLocalIndex(node_index);
+            mRearrangedNodes.push_back(p_element->GetNodeGlobalIndex((local_index + num_nodes_in_element - 1)%num_nodes_in_element));
+            mRearrangedNodes.push_back(p_element->GetNodeGlobalIndex((local_index + 1)%num_nodes_in_element));
+        }
+    }
+
+    // The edges handed from the parent to the new element now border a different cell
+    for (unsigned elem_index=mNumRecordedElements; elem_index<num_elements; elem_index++)
+    {
+        VertexElement<DIM, DIM>* p_element = rMesh.GetElement(elem_index);
+        for (unsigned local_index=0; local_index<p_element->GetNumNodes(); local_index++)
+        {
+            mRearrangedNodes.push_back(p_element->GetNodeGlobalIndex(local_index));
+        }
+    }
+}
+
+template<unsigned DIM>
+void VertexRearrangementLog<DIM>::NoteShortEdges(MutableVertexMesh<DIM, DIM>& rMesh)
+{
+    mShortEdges.clear();
+    mContainingElements.clear();
+    if (mRearrangementsUnrecorded)
+    {
+        return;
+    }
+
+    double threshold = rMesh.GetCellRearrangementThreshold();
+    for (unsigned elem_index=0; elem_index<rMesh.GetNumAllElements(); elem_index++)
+    {
+        VertexElement<DIM, DIM>* p_element = rMesh.GetElement(elem_index);
+        unsigned num_nodes_in_element = p_element->GetNumNodes();
+        for (unsigned local_index=0; local_index<num_nodes_in_element; local_index++)
+        {
+            unsigned node_a = p_element->GetNodeGlobalIndex(local_index);
+            unsigned node_b = p_element->GetNodeGlobalIndex((local_index + 1)%num_nodes_in_element);
+            if (rMesh.GetDistanceBetweenNodes(node_a, node_b) < threshold)
+            {
+                mShortEdges.push_back(std::make_pair(std::min(node_a, node_b), std::max(node_a, node_b)));
+            }
+        }
+    }
+    std::sort(mShortEdges.begin(), mShortEdges.end());
+    mShortEdges.erase(std::unique(mShortEdges.begin(), mShortEdges.end()), mShortEdges.end());
+    for (unsigned i=0; i<mShortEdges.size(); i++)
+    {
+        mContainingElements.push_back(rMesh.GetNode(mShortEdges[i].first)->rGetContainingElementIndices());
+        mContainingElements.push_back(rMesh.GetNode(mShortEdges[i].second)->rGetContainingElementIndices());
+    }
+}
+
+template<unsigned DIM>
+void VertexRearrangementLog<DIM>::RecordSwaps(MutableVertexMesh<DIM, DIM>& rMesh,
+                                              unsigned numT1Swaps,
+                                              unsigned numT3Swaps,
+                                              unsigned numAllNodes,
+                                              unsigned numAllElements,
+                                              VertexElementMap& rElementMap)
+{
+    if (mRearrangementsUnrecorded)
+    {
+        return;
+    }
+
+    // T3 swaps add nodes to elements anywhere along the boundary, and merges and void removals renumber the nodes
+    mRearrangementsUnrecorded = (numT3Swaps > 0)
+                                || (rMesh.GetNumAllNodes() != numAllNodes)
+                                || (rMesh.GetNumAllElements() != numAllElements)
+                                || !rElementMap.IsIdentityMap();
+
+    unsigned num_swapped_edges = 0;
+    for (unsigned i=0; i<mShortEdges.size() && !mRearrangementsUnrecorded; i++)
+    {
+        bool a_changed = (rMesh.GetNode(mShortEdges[i].first)->rGetContainingElementIndices() != mContainingElements[2*i]);
+        bool b_changed = (rMesh.GetNode(mShortEdges[i].second)->rGetContainingElementIndices() != mContainingElements[2*i + 1]);
+        if (a_changed)
+        {
+            mRearrangedNodes.push_back(mShortEdges[i].first);
+        }
+        if (b_changed)
+        {
+            mRearrangedNodes.push_back(mShortEdges[i].second);
+        }
+        if (a_changed && b_changed)
+        {
+            num_swapped_edges++;
+        }
+    }
+
+    // An edge which only became short during ReMesh(), moved by an earlier swap, was not noted
+    if (num_swapped_edges < numT1Swaps)
+    {
+        mRearrangementsUnrecorded = true;
+    }
+}
+
+template<unsigned DIM>
+void VertexRearrangementLog<DIM>::MarkUnrecorded()
+{
+    mRearrangementsUnrecorded = true;
+    mRearrangedNodes.clear();
+}
+
+template<unsigned DIM>
+void VertexRearrangementLog<DIM>::FinishReMesh(MutableVertexMesh<DIM, DIM>& rMesh)
+{
+    // A record nobody reads is given up once it is no shorter than rebuilding from scratch
+    if (mRearrangedNodes.size() > rMesh.GetNumNodes())
+    {
+        mRearrangementsUnrecorded = true;
+    }
+    if (mRearrangementsUnrecorded)
+    {
+        mRearrangedNodes.clear();
+    }
+    mShortEdges.clear();
+    mContainingElements.clear();
+    mNumRecordedNodes = rMesh.GetNumAllNodes();
+    mNumRecordedElements = rMesh.GetNumAllElements();
+}
+
+template<unsigned DIM>
+const std::vector<unsigned>& VertexRearrangementLog<DIM>::rGetRearrangedNodes() const
+{
+    return mRearrangedNodes;
+}
+
+template<unsigned DIM>
+bool VertexRearrangementLog<DIM>::HasUnrecordedRearrangements() const
+{
+    return mRearrangementsUnrecorded;
+}
+
+template<unsigned DIM>
+void VertexRearrangementLog<DIM>::Clear(MutableVertexMesh<DIM, DIM>& rMesh)
+{
+    mRearrangedNodes.clear();
+    mRearrangementsUnrecorded = false;
+    mNumRecordedNodes = rMesh.GetNumAllNodes();
+    mNumRecordedElements = rMesh.GetNumAllElements();
+}
+
+// Explicit instantiation
+template class VertexRearrangementLog<1>;
+template class VertexRearrangementLog<2>;
+template class VertexRearrangementLog<3>;
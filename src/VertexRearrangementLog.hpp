@@ -0,0 +1,121 @@
+
+#ifndef VERTEXREARRANGEMENTLOG_HPP_
+#define VERTEXREARRANGEMENTLOG_HPP_
+
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "MutableVertexMesh.hpp"
+#include "VertexElementMap.hpp"
+
+/**
+ * A record of the nodes of a vertex mesh whose containing elements have changed, kept by
+ * MatteoMutableVertexMesh so that HeterotypicEdgeStatisticsModifier only revisits the edges
+ * around them.
+ *
+ * Recording starts once Clear() has been called. T1 swaps can only act on edges shorter than
+ * the threshold, so NoteShortEdges() notes the containing elements of their nodes before the
+ * rearrangement checks and RecordSwaps() compares them afterwards; divisions are found by
+ * RecordDivisions() as nodes and elements beyond those already recorded. Deaths, T2 and T3
+ * swaps, node merges and renumbering change or compact the indices, and are only flagged
+ * through HasUnrecordedRearrangements().
+ *
+ * The log is not archived, and starts with its rearrangements unrecorded.
+ */
+template<unsigned DIM>
+class VertexRearrangementLog
+{
+private:
+
+    /** Nodes whose containing elements have changed since Clear() was last called, possibly repeated. */
+    std::vector<unsigned> mRearrangedNodes;
+
+    /** Whether the mesh has changed in a way not recorded in mRearrangedNodes since Clear() was last called. */
+    bool mRearrangementsUnrecorded;
+
+    /** Number of nodes when mRearrangedNodes was last brought up to date; any beyond it were added by divisions. */
+    unsigned mNumRecordedNodes;
+
+    /** Number of elements when mRearrangedNodes was last brought up to date; any beyond it were added by divisions. */
+    unsigned mNumRecordedElements;
+
+    /** Node index pairs of the edges shorter than the threshold, as noted by NoteShortEdges(). */
+    std::vector<std::pair<unsigned, unsigned> > mShortEdges;
+
+    /** Containing element indices of the two nodes of each edge in mShortEdges, as noted by NoteShortEdges(). */
+    std::vector<std::set<unsigned> > mContainingElements;
+
+public:
+
+    /**
+     * Constructor.
+     */
+    VertexRearrangementLog();
+
+    /**
+     * Record the nodes affected by divisions since the last call to FinishReMesh(), at the start of ReMesh().
+     *
+     * @param rMesh the mesh
+     */
+    void RecordDivisions(MutableVertexMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Note the edges shorter than the threshold and the containing elements of their nodes,
+     * before the rearrangement checks.
+     *
+     * @param rMesh the mesh
+     */
+    void NoteShortEdges(MutableVertexMesh<DIM, DIM>& rMesh);
+
+    /**
+     * Record the nodes of the noted edges whose containing elements have changed, after the
+     * rearrangement checks.
+     *
+     * @param rMesh the mesh
+     * @param numT1Swaps the number of T1 swaps carried out by the checks
+     * @param numT3Swaps the number of T3 swaps carried out by the checks
+     * @param numAllNodes the number of nodes, including deleted ones, before the checks
+     * @param numAllElements the number of elements, including deleted ones, before the checks
+     * @param rElementMap the element map filled in by the checks
+     */
+    void RecordSwaps(MutableVertexMesh<DIM, DIM>& rMesh,
+                     unsigned numT1Swaps,
+                     unsigned numT3Swaps,
+                     unsigned numAllNodes,
+                     unsigned numAllElements,
+                     VertexElementMap& rElementMap);
+
+    /**
+     * Flag the mesh as changed in a way which is not recorded, such as by renumbering.
+     */
+    void MarkUnrecorded();
+
+    /**
+     * Bring the log up to date with the mesh at the end of ReMesh(), giving up the record
+     * once it is no shorter than rebuilding from scratch.
+     *
+     * @param rMesh the mesh
+     */
+    void FinishReMesh(MutableVertexMesh<DIM, DIM>& rMesh);
+
+    /**
+     * @return the nodes whose containing elements have changed since Clear() was last called, possibly repeated
+     */
+    const std::vector<unsigned>& rGetRearrangedNodes() const;
+
+    /**
+     * @return whether the mesh has changed in a way not recorded by rGetRearrangedNodes() since
+     *     Clear() was last called, or Clear() has never been called
+     */
+    bool HasUnrecordedRearrangements() const;
+
+    /**
+     * Forget the recorded rearrangements, and record them from now on.
+     *
+     * @param rMesh the mesh
+     */
+    void Clear(MutableVertexMesh<DIM, DIM>& rMesh);
+};
+
+#endif /*VERTEXREARRANGEMENTLOG_HPP_*/
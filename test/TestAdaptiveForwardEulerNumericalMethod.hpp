@@ -0,0 +1,141 @@
+
+#ifndef TESTADAPTIVEFORWARDEULERNUMERICALMETHOD_HPP_
+#define TESTADAPTIVEFORWARDEULERNUMERICALMETHOD_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "NodesOnlyMesh.hpp"
+#include "NodeBasedCellPopulation.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "OffLatticeSimulation.hpp"
+#include "AdaptiveForwardEulerNumericalMethod.hpp"
+#include "MatteoForce.hpp"
+#include "RandomMotionForce.hpp"
+#include "ProfiledForce.hpp"
+#include "ConstantTargetAreaModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestAdaptiveForwardEulerNumericalMethod : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestSubstepsWithinCoarseTimeSteps() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(4, 4);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        p_mesh->SetCellRearrangementThreshold(0.1);
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        for (unsigned i=0; i<cells.size(); i+=3)
+        {
+            cells[i]->SetCellProliferativeType(p_diff_type);
+        }
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        // A time step far too coarse for plain forward Euler with this noise
+        OffLatticeSimulation<2> simulator(cell_population);
+        simulator.SetOutputDirectory("TestAdaptiveForwardEulerNumericalMethod");
+        simulator.SetDt(0.1);
+        simulator.SetSamplingTimestepMultiple(5);
+        simulator.SetEndTime(2.0);
+
+        // Limit the noise too, so that no edge can pass through the threshold within a sub-step
+        MAKE_PTR(AdaptiveForwardEulerNumericalMethod<2>, p_numerical_method);
+        p_numerical_method->SetLimitNoise(true);
+        simulator.SetNumericalMethod(p_numerical_method);
+
+        MAKE_PTR(MatteoForce<2>, p_force);
+        simulator.AddForce(p_force);
+        MAKE_PTR(RandomMotionForce<2>, p_random_force);
+        p_random_force->SetMovementParameter(0.05);
+        simulator.AddForce(p_random_force);
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        simulator.AddSimulationModifier(p_growth_modifier);
+
+        TS_ASSERT_THROWS_NOTHING(simulator.Solve());
+
+        // Output stays on the fixed grid while the mechanics took more, smaller steps
+        TS_ASSERT_DELTA(SimulationTime::Instance()->GetTime(), 2.0, 1e-9);
+        TS_ASSERT_EQUALS(SimulationTime::Instance()->GetTimeStepsElapsed(), 20u);
+        TS_ASSERT_LESS_THAN(20u, p_numerical_method->GetNumSubsteps());
+
+        // Nodes moved far enough within a time step for rearrangements to be checked in between
+        TS_ASSERT_LESS_THAN(0u, p_numerical_method->GetNumRearrangementChecks());
+    }
+
+    void TestRejectedSubstepsKeepTheNoiseVariance() throw (Exception)
+    {
+        // Freely diffusing nodes, far enough apart not to interact
+        std::vector<Node<2>*> nodes;
+        for (unsigned i=0; i<1000; i++)
+        {
+            nodes.push_back(new Node<2>(i, false, 10.0*(i%40), 10.0*(i/40)));
+        }
+        NodesOnlyMesh<2> mesh;
+        mesh.ConstructNodesWithoutMesh(nodes, 1.5);
+        for (unsigned i=0; i<nodes.size(); i++)
+        {
+            delete nodes[i];
+        }
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, mesh.GetNumNodes(), std::vector<unsigned>(), p_wild_type);
+        NodeBasedCellPopulation<2> cell_population(mesh, cells);
+        cell_population.SetAbsoluteMovementThreshold(1.0);
+
+        MAKE_PTR(RandomMotionForce<2>, p_random_force);
+        p_random_force->SetMovementParameter(0.5);
+
+        // Wrapped for profiling, as the scenario does with --profile, which must not change the noise
+        MAKE_PTR_ARGS(ProfiledForce<2>, p_profiled_force, (p_random_force, "RandomMotionForce"));
+        std::vector<boost::shared_ptr<AbstractForce<2,2> > > forces;
+        forces.push_back(p_profiled_force);
+
+        // Only the drift counts towards the limit by default, so free diffusion takes whole steps
+        MAKE_PTR(RandomMotionForce<2>, p_weak_random_force);
+        p_weak_random_force->SetMovementParameter(0.005);
+        std::vector<boost::shared_ptr<AbstractForce<2,2> > > weak_forces;
+        weak_forces.push_back(p_weak_random_force);
+        AdaptiveForwardEulerNumericalMethod<2> drift_limited_method;
+        drift_limited_method.SetCellPopulation(&cell_population);
+        drift_limited_method.SetForceCollection(&weak_forces);
+        drift_limited_method.UpdateAllNodePositions(1.0);
+        TS_ASSERT_EQUALS(drift_limited_method.GetNumSubsteps(), 1u);
+        TS_ASSERT_EQUALS(drift_limited_method.GetNumRejectedSubsteps(), 0u);
+
+        MAKE_PTR(AdaptiveForwardEulerNumericalMethod<2>, p_numerical_method);
+        p_numerical_method->SetLimitNoise(true);
+        p_numerical_method->SetCellPopulation(&cell_population);
+        p_numerical_method->SetForceCollection(&forces);
+
+        std::vector<c_vector<double, 2> > old_locations;
+        for (unsigned i=0; i<mesh.GetNumNodes(); i++)
+        {
+            old_locations.push_back(mesh.GetNode(i)->rGetLocation());
+        }
+
+        // The whole step is far longer than the sub-step limit allows, so it is split many times
+        p_numerical_method->UpdateAllNodePositions(1.0);
+        TS_ASSERT_LESS_THAN(0u, p_numerical_method->GetNumRejectedSubsteps());
+
+        // Each displacement component still has variance 2 D dt, rather than favouring the small draws
+        double sum_of_squares = 0.0;
+        for (unsigned i=0; i<mesh.GetNumNodes(); i++)
+        {
+            c_vector<double, 2> displacement = mesh.GetNode(i)->rGetLocation() - old_locations[i];
+            sum_of_squares += inner_prod(displacement, displacement);
+        }
+        TS_ASSERT_DELTA(sum_of_squares/(2.0*mesh.GetNumNodes()), 1.0, 0.15);
+    }
+};
+
+#endif /*TESTADAPTIVEFORWARDEULERNUMERICALMETHOD_HPP_*/
@@ -0,0 +1,184 @@
+
+#ifndef TESTFIREENERGYMINIMISER_HPP_
+#define TESTFIREENERGYMINIMISER_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <climits>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "MutableVertexMesh.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "ConstantTargetAreaModifier.hpp"
+#include "FireEnergyMinimiser.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestFireEnergyMinimiser : public AbstractCellBasedTestSuite
+{
+private:
+
+    /* Create cells for a mixed tissue, with every third cell differentiated. */
+    void CreateMixedCells(unsigned numCells, std::vector<CellPtr>& rCells)
+    {
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(rCells, numCells, std::vector<unsigned>(), p_wild_type);
+        for (unsigned i=0; i<rCells.size(); i+=3)
+        {
+            rCells[i]->SetCellProliferativeType(p_diff_type);
+        }
+    }
+
+public:
+
+    void TestMinimiseMixedTissue() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(4, 4);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        p_mesh->SetCellRearrangementThreshold(0.1);
+
+        std::vector<CellPtr> cells;
+        CreateMixedCells(p_mesh->GetNumElements(), cells);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        p_growth_modifier->UpdateTargetAreas(cell_population);
+
+        MAKE_PTR(MatteoForce<2>, p_force);
+        p_force->AddForceContribution(cell_population);
+        double initial_energy = p_force->GetTotalEnergy();
+
+        FireEnergyMinimiser<2> minimiser(cell_population, p_force);
+        minimiser.SetForceTolerance(1e-6);
+        TS_ASSERT(minimiser.Minimise());
+
+        TS_ASSERT_LESS_THAN(minimiser.GetMaxForce(), 1e-6);
+        TS_ASSERT_LESS_THAN(minimiser.GetEnergy(), initial_energy);
+        TS_ASSERT_LESS_THAN(0u, minimiser.GetNumForceEvaluations());
+        TS_ASSERT_LESS_THAN_EQUALS(minimiser.GetNumRounds(), 20u);
+    }
+
+    void TestRandomMotionIsSwitchedOff() throw (Exception)
+    {
+        // Relax two copies of the same tissue, one with a noisy force, for a few iterations
+        HoneycombVertexMeshGenerator generator(3, 3);
+        HoneycombVertexMeshGenerator noisy_generator(3, 3);
+        std::vector<CellPtr> cells;
+        std::vector<CellPtr> noisy_cells;
+        CreateMixedCells(9, cells);
+        CreateMixedCells(9, noisy_cells);
+        VertexBasedCellPopulation<2> cell_population(*generator.GetMesh(), cells);
+        VertexBasedCellPopulation<2> noisy_population(*noisy_generator.GetMesh(), noisy_cells);
+
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        p_growth_modifier->UpdateTargetAreas(cell_population);
+        p_growth_modifier->UpdateTargetAreas(noisy_population);
+
+        MAKE_PTR(MatteoForce<2>, p_force);
+        MAKE_PTR(MatteoForce<2>, p_noisy_force);
+        p_noisy_force->SetMovementParameter(0.05);
+
+        FireEnergyMinimiser<2> minimiser(cell_population, p_force);
+        FireEnergyMinimiser<2> noisy_minimiser(noisy_population, p_noisy_force);
+        minimiser.SetMaxRounds(1);
+        minimiser.SetMaxIterationsPerRound(20);
+        noisy_minimiser.SetMaxRounds(1);
+        noisy_minimiser.SetMaxIterationsPerRound(20);
+        minimiser.Minimise();
+        noisy_minimiser.Minimise();
+
+        // The descents are identical, and the noise is restored afterwards
+        for (unsigned node_index=0; node_index<cell_population.GetNumNodes(); node_index++)
+        {
+            c_vector<double, 2> location = cell_population.GetNode(node_index)->rGetLocation();
+            c_vector<double, 2> noisy_location = noisy_population.GetNode(node_index)->rGetLocation();
+            TS_ASSERT_DELTA(noisy_location[0], location[0], 1e-12);
+            TS_ASSERT_DELTA(noisy_location[1], location[1], 1e-12);
+        }
+        TS_ASSERT_DELTA(p_noisy_force->GetMovementParameter(), 0.05, 1e-12);
+    }
+
+    void TestSmallTriangularCellsAreRemoved() throw (Exception)
+    {
+        // A tiny triangular cell, below the T2 threshold, surrounded by three others
+        std::vector<Node<2>*> nodes;
+        nodes.push_back(new Node<2>(0, true, 0.0, 0.0));
+        nodes.push_back(new Node<2>(1, true, 1.0, 0.0));
+        nodes.push_back(new Node<2>(2, true, 0.5, 1.0));
+        nodes.push_back(new Node<2>(3, false, 0.49, 0.3));
+        nodes.push_back(new Node<2>(4, false, 0.51, 0.3));
+        nodes.push_back(new Node<2>(5, false, 0.5, 0.31));
+
+        unsigned element_nodes[4][4] = {{0, 1, 4, 3}, {1, 2, 5, 4}, {2, 0, 3, 5}, {3, 4, 5, UINT_MAX}};
+        std::vector<VertexElement<2,2>*> elements;
+        for (unsigned elem_index=0; elem_index<4; elem_index++)
+        {
+            std::vector<Node<2>*> nodes_of_element;
+            for (unsigned local_index=0; local_index<4 && element_nodes[elem_index][local_index] != UINT_MAX; local_index++)
+            {
+                nodes_of_element.push_back(nodes[element_nodes[elem_index][local_index]]);
+            }
+            elements.push_back(new VertexElement<2,2>(elem_index, nodes_of_element));
+        }
+        MutableVertexMesh<2,2> mesh(nodes, elements, 0.01, 0.001);
+        TS_ASSERT_LESS_THAN(mesh.GetVolumeOfElement(3), mesh.GetT2Threshold());
+
+        std::vector<CellPtr> cells;
+        CreateMixedCells(4, cells);
+        VertexBasedCellPopulation<2> cell_population(mesh, cells);
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        p_growth_modifier->UpdateTargetAreas(cell_population);
+
+        // A single short round, which leaves the triangle below the threshold for the swap between rounds
+        MAKE_PTR(MatteoForce<2>, p_force);
+        FireEnergyMinimiser<2> minimiser(cell_population, p_force);
+        minimiser.SetMaxStepLength(1e-4);
+        minimiser.SetMaxIterationsPerRound(1);
+        minimiser.SetMaxRounds(1);
+        minimiser.Minimise();
+
+        TS_ASSERT_EQUALS(mesh.GetNumElements(), 3u);
+        TS_ASSERT_EQUALS(cell_population.GetNumRealCells(), 3u);
+        TS_ASSERT_EQUALS(mesh.GetNumNodes(), 4u);
+    }
+
+    void TestFirstIterationStartsFromRest() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        std::vector<CellPtr> cells;
+        CreateMixedCells(9, cells);
+        VertexBasedCellPopulation<2> cell_population(*generator.GetMesh(), cells);
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        p_growth_modifier->UpdateTargetAreas(cell_population);
+
+        MAKE_PTR(MatteoForce<2>, p_force);
+        p_force->AddForceContribution(cell_population);
+        unsigned num_nodes = cell_population.GetNumNodes();
+        std::vector<c_vector<double, 2> > initial_locations(num_nodes);
+        std::vector<c_vector<double, 2> > initial_forces(num_nodes);
+        for (unsigned node_index=0; node_index<num_nodes; node_index++)
+        {
+            initial_locations[node_index] = cell_population.GetNode(node_index)->rGetLocation();
+            initial_forces[node_index] = cell_population.GetNode(node_index)->rGetAppliedForce();
+        }
+
+        // A single iteration takes a full step of the initial time step from rest, without halving it first
+        FireEnergyMinimiser<2> minimiser(cell_population, p_force);
+        minimiser.SetTimeSteps(0.01, 0.1);
+        minimiser.SetMaxStepLength(1.0);
+        minimiser.SetMaxIterationsPerRound(1);
+        minimiser.SetMaxRounds(1);
+        minimiser.Minimise();
+        for (unsigned node_index=0; node_index<num_nodes; node_index++)
+        {
+            c_vector<double, 2> displacement = cell_population.GetNode(node_index)->rGetLocation() - initial_locations[node_index];
+            TS_ASSERT_DELTA(displacement[0], 1e-4*initial_forces[node_index][0], 1e-12);
+            TS_ASSERT_DELTA(displacement[1], 1e-4*initial_forces[node_index][1], 1e-12);
+        }
+    }
+};
+
+#endif /*TESTFIREENERGYMINIMISER_HPP_*/
@@ -0,0 +1,332 @@
+#ifndef TESTFLIGHTRECORDERMODIFIER_HPP_
+#define TESTFLIGHTRECORDERMODIFIER_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "FlightRecorderModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "FileFinder.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestFlightRecorderModifier : public AbstractCellBasedTestSuite
+{
+private:
+
+    /* A trigger which holds for a while around time 5, then again from time 12. */
+    static bool EventTrigger(AbstractCellPopulation<2,2>& rCellPopulation)
+    {
+        double time = SimulationTime::Instance()->GetTime();
+        return (time > 4.5 && time < 6.5) || time > 11.5;
+    }
+
+    /* Set the "time" CellData item of every cell to the current time, so that each frame can be identified. */
+    void StampCells(AbstractCellPopulation<2,2>& rCellPopulation)
+    {
+        for (AbstractCellPopulation<2,2>::Iterator cell_iter = rCellPopulation.Begin();
+             cell_iter != rCellPopulation.End();
+             ++cell_iter)
+        {
+            cell_iter->GetCellData()->SetItem("time", SimulationTime::Instance()->GetTime());
+        }
+    }
+
+    /*
+     * Read a dump file, check that every frame holds the mesh of the population and that
+     * each cell's data matches the frame time, and return the frame times in file order.
+     */
+    std::vector<double> ReadDump(const std::string& rFileName, VertexBasedCellPopulation<2>& rCellPopulation, double& rEventTime)
+    {
+        FileFinder dump_file("TestFlightRecorderModifier/flight_recorder/" + rFileName, RelativeTo::ChasteTestOutput);
+        TS_ASSERT(dump_file.IsFile());
+        std::ifstream file(dump_file.GetAbsolutePath().c_str());
+
+        std::vector<double> times;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.find("# event time: ") == 0)
+            {
+                rEventTime = atof(line.substr(14).c_str());
+            }
+            if (line.find("frame ") != 0)
+            {
+                continue;
+            }
+
+            std::stringstream frame_line(line.substr(6));
+            double time;
+            unsigned num_nodes, num_elements;
+            frame_line >> time >> num_nodes >> num_elements;
+            times.push_back(time);
+            TS_ASSERT_EQUALS(num_nodes, rCellPopulation.GetNumNodes());
+            TS_ASSERT_EQUALS(num_elements, rCellPopulation.GetNumElements());
+
+            for (unsigned node_index=0; node_index<num_nodes; node_index++)
+            {
+                std::getline(file, line);
+                std::stringstream node_line(line);
+                double x, y;
+                node_line >> x >> y;
+                TS_ASSERT_DELTA(x, rCellPopulation.GetNode(node_index)->rGetLocation()[0], 1e-4);
+                TS_ASSERT_DELTA(y, rCellPopulation.GetNode(node_index)->rGetLocation()[1], 1e-4);
+            }
+            for (unsigned elem_index=0; elem_index<num_elements; elem_index++)
+            {
+                std::getline(file, line);
+                std::stringstream element_line(line);
+                unsigned is_wild_type, is_labelled, num_element_nodes;
+                element_line >> is_wild_type >> is_labelled >> num_element_nodes;
+                TS_ASSERT_EQUALS(is_wild_type, 0u);
+                TS_ASSERT_EQUALS(num_element_nodes, rCellPopulation.GetElement(elem_index)->GetNumNodes());
+                for (unsigned local_index=0; local_index<num_element_nodes; local_index++)
+                {
+                    unsigned node_index;
+                    element_line >> node_index;
+                    TS_ASSERT_EQUALS(node_index, rCellPopulation.GetElement(elem_index)->GetNodeGlobalIndex(local_index));
+                }
+                double target_area, cell_time;
+                element_line >> target_area >> cell_time;
+                TS_ASSERT_DELTA(target_area, 1.0, 1e-12);
+                TS_ASSERT_DELTA(cell_time, time, 1e-12);
+            }
+        }
+        return times;
+    }
+
+public:
+
+    void TestRingBufferAndTriggeredDumps() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_diff_type);
+        for (unsigned i=0; i<cells.size(); i++)
+        {
+            cells[i]->GetCellData()->SetItem("target area", 1.0);
+        }
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(20.0, 20);
+
+        MAKE_PTR(FlightRecorderModifier<2>, p_recorder);
+        TS_ASSERT_EQUALS(p_recorder->GetNumFramesAfterTrigger(), 10u);
+
+        // The buffer must be able to hold frames from before the trigger
+        p_recorder->SetNumFrames(4);
+        p_recorder->SetNumFramesAfterTrigger(4);
+        TS_ASSERT_THROWS_THIS(p_recorder->SetupSolve(cell_population, "TestFlightRecorderModifier"),
+                              "FlightRecorderModifier must hold more frames than it records after a trigger");
+
+        p_recorder->SetNumFramesAfterTrigger(1);
+        p_recorder->SetRecordingInterval(2);
+        StampCells(cell_population);
+        p_recorder->SetupSolve(cell_population, "TestFlightRecorderModifier");
+
+        // The initial state is recorded at setup
+        TS_ASSERT_EQUALS(p_recorder->GetNumStoredFrames(), 1u);
+
+        // Frames are only recorded on every second step, and the buffer holds at most four
+        for (unsigned i=0; i<3; i++)
+        {
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            StampCells(cell_population);
+            p_recorder->UpdateAtEndOfTimeStep(cell_population);
+        }
+        TS_ASSERT_EQUALS(p_recorder->GetNumStoredFrames(), 2u);
+        TS_ASSERT_EQUALS(p_recorder->GetNumDumps(), 0u);
+
+        // Dumping writes the frames oldest first and empties the buffer
+        p_recorder->DumpFrames("test");
+        TS_ASSERT_EQUALS(p_recorder->GetNumDumps(), 1u);
+        TS_ASSERT_EQUALS(p_recorder->GetNumStoredFrames(), 0u);
+        double event_time = -1.0;
+        std::vector<double> times = ReadDump("dump_0.dat", cell_population, event_time);
+        TS_ASSERT_EQUALS(times.size(), 2u);
+        TS_ASSERT_DELTA(times[0], 0.0, 1e-12);
+        TS_ASSERT_DELTA(times[1], 2.0, 1e-12);
+        TS_ASSERT_DELTA(event_time, 3.0, 1e-12);
+
+        // Dumping an empty buffer does nothing
+        p_recorder->DumpFrames("test");
+        TS_ASSERT_EQUALS(p_recorder->GetNumDumps(), 1u);
+
+        /*
+         * The trigger first holds at time 5. The dump is written one frame later, and holds
+         * the frames from times 4 to 6 recorded since the last dump. The trigger holding at
+         * time 6 does not fire again.
+         */
+        p_recorder->SetTrigger(&EventTrigger);
+        p_recorder->SetRecordingInterval(1);
+        for (unsigned i=0; i<3; i++)
+        {
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            StampCells(cell_population);
+            p_recorder->UpdateAtEndOfTimeStep(cell_population);
+        }
+        TS_ASSERT_EQUALS(p_recorder->GetNumDumps(), 2u);
+        times = ReadDump("dump_1.dat", cell_population, event_time);
+        TS_ASSERT_EQUALS(times.size(), 3u);
+        for (unsigned f=0; f<times.size(); f++)
+        {
+            TS_ASSERT_DELTA(times[f], 4.0 + f, 1e-12);
+        }
+        TS_ASSERT_DELTA(event_time, 5.0, 1e-12);
+
+        // The trigger re-arms at time 7, and the buffer wraps around before it fires again
+        for (unsigned i=0; i<5; i++)
+        {
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            StampCells(cell_population);
+            p_recorder->UpdateAtEndOfTimeStep(cell_population);
+        }
+        TS_ASSERT_EQUALS(p_recorder->GetNumDumps(), 2u);
+        TS_ASSERT_EQUALS(p_recorder->GetNumStoredFrames(), 4u);
+
+        // The trigger holds from time 12 on but fires only once, and the dump brackets time 12
+        for (unsigned i=0; i<5; i++)
+        {
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            StampCells(cell_population);
+            p_recorder->UpdateAtEndOfTimeStep(cell_population);
+        }
+        TS_ASSERT_EQUALS(p_recorder->GetNumDumps(), 3u);
+        times = ReadDump("dump_2.dat", cell_population, event_time);
+        TS_ASSERT_EQUALS(times.size(), 4u);
+        for (unsigned f=0; f<times.size(); f++)
+        {
+            TS_ASSERT_DELTA(times[f], 10.0 + f, 1e-12);
+        }
+        TS_ASSERT_DELTA(event_time, 12.0, 1e-12);
+    }
+
+    void TestPendingDumpWrittenAtEndOfSolve() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_diff_type);
+        for (unsigned i=0; i<cells.size(); i++)
+        {
+            cells[i]->GetCellData()->SetItem("target area", 1.0);
+        }
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(6.0, 6);
+
+        MAKE_PTR(FlightRecorderModifier<2>, p_recorder);
+        p_recorder->SetNumFrames(10);
+        p_recorder->SetNumFramesAfterTrigger(5);
+        p_recorder->SetTrigger(&EventTrigger);
+        StampCells(cell_population);
+        p_recorder->SetupSolve(cell_population, "TestFlightRecorderModifier");
+
+        // The trigger fires at time 5, and the simulation ends before its five further frames are recorded
+        for (unsigned i=0; i<6; i++)
+        {
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            StampCells(cell_population);
+            p_recorder->UpdateAtEndOfTimeStep(cell_population);
+        }
+        TS_ASSERT_EQUALS(p_recorder->GetNumDumps(), 0u);
+
+        p_recorder->UpdateAtEndOfSolve(cell_population);
+        TS_ASSERT_EQUALS(p_recorder->GetNumDumps(), 1u);
+        double event_time = -1.0;
+        std::vector<double> times = ReadDump("dump_0.dat", cell_population, event_time);
+        TS_ASSERT_EQUALS(times.size(), 7u);
+        for (unsigned f=0; f<times.size(); f++)
+        {
+            TS_ASSERT_DELTA(times[f], (double)f, 1e-12);
+        }
+        TS_ASSERT_DELTA(event_time, 5.0, 1e-12);
+    }
+
+    void TestCellDataKeysGatheredFromEveryCell() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+
+        // The first cell carries no CellData, so cannot stand for the others
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_diff_type);
+        for (unsigned i=1; i<cells.size(); i++)
+        {
+            cells[i]->GetCellData()->SetItem("target area", 1.0);
+        }
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(2.0, 2);
+
+        MAKE_PTR(FlightRecorderModifier<2>, p_recorder);
+        p_recorder->SetNumFrames(4);
+        p_recorder->SetNumFramesAfterTrigger(1);
+        p_recorder->SetupSolve(cell_population, "TestFlightRecorderModifier");
+
+        // A key first set partway through is recorded from then on
+        SimulationTime::Instance()->IncrementTimeOneStep();
+        cell_population.GetCellUsingLocationIndex(4)->GetCellData()->SetItem("extra", 2.0);
+        p_recorder->UpdateAtEndOfTimeStep(cell_population);
+        p_recorder->DumpFrames("test");
+
+        FileFinder dump_file("TestFlightRecorderModifier/flight_recorder/dump_0.dat", RelativeTo::ChasteTestOutput);
+        std::ifstream file(dump_file.GetAbsolutePath().c_str());
+        std::vector<std::vector<std::string> > frames;
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.find("# cell_data:") == 0)
+            {
+                TS_ASSERT_EQUALS(line, "# cell_data: 'target area' 'extra'");
+            }
+            if (line.find("frame ") != 0)
+            {
+                continue;
+            }
+            for (unsigned node_index=0; node_index<cell_population.GetNumNodes(); node_index++)
+            {
+                std::getline(file, line);
+            }
+
+            // Keep the two CellData items of each element
+            frames.push_back(std::vector<std::string>());
+            for (unsigned elem_index=0; elem_index<cell_population.GetNumElements(); elem_index++)
+            {
+                std::getline(file, line);
+                std::stringstream element_line(line);
+                std::vector<std::string> fields;
+                std::string field;
+                while (element_line >> field)
+                {
+                    fields.push_back(field);
+                }
+                TS_ASSERT_EQUALS(fields.size(), 3u + cell_population.GetElement(elem_index)->GetNumNodes() + 2u);
+                frames.back().push_back(fields[fields.size() - 2] + " " + fields[fields.size() - 1]);
+            }
+        }
+        TS_ASSERT_EQUALS(frames.size(), 2u);
+
+        // Missing items, and keys not yet seen, are written as NaN
+        TS_ASSERT_EQUALS(frames[0][0], "nan nan");
+        TS_ASSERT_EQUALS(frames[0][4], "1 nan");
+        TS_ASSERT_EQUALS(frames[1][0], "nan nan");
+        TS_ASSERT_EQUALS(frames[1][1], "1 nan");
+        TS_ASSERT_EQUALS(frames[1][4], "1 2");
+    }
+};
+
+#endif /*TESTFLIGHTRECORDERMODIFIER_HPP_*/
@@ -0,0 +1,172 @@
+#ifndef TESTHETEROTYPICEDGESTATISTICSMODIFIER_HPP_
+#define TESTHETEROTYPICEDGESTATISTICSMODIFIER_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "MatteoMutableVertexMesh.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "HeterotypicEdgeStatisticsModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestHeterotypicEdgeStatisticsModifier : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestIncrementalUpdateOnTypeChange() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MatteoMutableVertexMesh<2> mesh(*generator.GetMesh());
+        MatteoMutableVertexMesh<2>* p_mesh = &mesh;
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        cells[4]->SetCellProliferativeType(p_diff_type);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        MAKE_PTR(HeterotypicEdgeStatisticsModifier<2>, p_modifier);
+        p_modifier->UpdateStatistics(cell_population);
+        p_modifier->UpdateEdgeLengths(cell_population);
+
+        // The single mutant cell is surrounded by six mixed edges
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdges(MIXED_EDGE), 6u);
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdges(DIFF_DIFF_EDGE), 0u);
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdges(DIFF_BOUNDARY_EDGE), 0u);
+        TS_ASSERT_DELTA(p_modifier->GetTotalLength(MIXED_EDGE), p_mesh->GetSurfaceAreaOfElement(4), 1e-9);
+        unsigned num_wild_wild = p_modifier->GetNumEdges(WILD_WILD_EDGE);
+        unsigned num_wild_boundary = p_modifier->GetNumEdges(WILD_BOUNDARY_EDGE);
+
+        // Nothing has changed, so nothing is reclassified
+        p_modifier->UpdateStatistics(cell_population);
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdgesReclassified(), 0u);
+
+        // Making the mutant wild type is seen from the cell itself, and only reclassifies the edges
+        // touching its six nodes: the six edges of the hexagon and the six edges leading away from it
+        cell_population.GetCellUsingLocationIndex(4)->SetCellProliferativeType(p_wild_type);
+        p_modifier->UpdateStatistics(cell_population);
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdgesReclassified(), 12u);
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdges(MIXED_EDGE), 0u);
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdges(WILD_WILD_EDGE), num_wild_wild + 6);
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdges(WILD_BOUNDARY_EDGE), num_wild_boundary);
+
+        // The incremental counts agree with classifying every edge from scratch
+        MAKE_PTR(HeterotypicEdgeStatisticsModifier<2>, p_fresh_modifier);
+        p_fresh_modifier->UpdateStatistics(cell_population);
+        for (unsigned type=0; type<NUM_EDGE_TYPES; type++)
+        {
+            TS_ASSERT_EQUALS(p_modifier->GetNumEdges((EdgeType)type), p_fresh_modifier->GetNumEdges((EdgeType)type));
+        }
+    }
+
+    void TestIncrementalUpdateOnT1SwapAndDivision() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(4, 4);
+        MatteoMutableVertexMesh<2> mesh(*generator.GetMesh());
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, mesh.GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        cells[5]->SetCellProliferativeType(p_diff_type);
+        cells[9]->SetCellProliferativeType(p_diff_type);
+        VertexBasedCellPopulation<2> cell_population(mesh, cells);
+
+        MAKE_PTR(HeterotypicEdgeStatisticsModifier<2>, p_modifier);
+        p_modifier->UpdateStatistics(cell_population);
+        unsigned num_edges = p_modifier->GetNumEdgesReclassified();
+
+        // Shrink the first edge of an interior element below the rearrangement threshold
+        VertexElement<2,2>* p_element = mesh.GetElement(5);
+        unsigned node_a = p_element->GetNodeGlobalIndex(0);
+        unsigned node_b = p_element->GetNodeGlobalIndex(1);
+        TS_ASSERT(!mesh.GetNode(node_a)->IsBoundaryNode());
+        TS_ASSERT(!mesh.GetNode(node_b)->IsBoundaryNode());
+        c_vector<double, 2> midpoint = 0.5*(mesh.GetNode(node_a)->rGetLocation() + mesh.GetNode(node_b)->rGetLocation());
+        c_vector<double, 2> direction = mesh.GetVectorFromAtoB(mesh.GetNode(node_a)->rGetLocation(), mesh.GetNode(node_b)->rGetLocation());
+        direction /= norm_2(direction);
+        mesh.SetNode(node_a, ChastePoint<2>(midpoint - 0.002*direction));
+        mesh.SetNode(node_b, ChastePoint<2>(midpoint + 0.002*direction));
+
+        // The T1 swap only reclassifies the five edges touching the two swapped nodes
+        cell_population.Update();
+        TS_ASSERT_EQUALS(mesh.GetNumT1Swaps(), 1u);
+        TS_ASSERT(!mesh.HasUnrecordedRearrangements());
+        p_modifier->UpdateStatistics(cell_population);
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdgesReclassified(), 5u);
+
+        MAKE_PTR(HeterotypicEdgeStatisticsModifier<2>, p_fresh_modifier);
+        p_fresh_modifier->UpdateStatistics(cell_population);
+        for (unsigned type=0; type<NUM_EDGE_TYPES; type++)
+        {
+            TS_ASSERT_EQUALS(p_modifier->GetNumEdges((EdgeType)type), p_fresh_modifier->GetNumEdges((EdgeType)type));
+        }
+
+        // A division of the mutant is recorded by the mesh too, rather than renumbering it
+        std::vector<CellPtr> new_cells;
+        cells_generator.GenerateBasic(new_cells, 1, std::vector<unsigned>(), p_diff_type);
+        cell_population.AddCell(new_cells[0], cell_population.GetCellUsingLocationIndex(9));
+        cell_population.Update();
+        TS_ASSERT(!mesh.HasUnrecordedRearrangements());
+        p_modifier->UpdateStatistics(cell_population);
+        TS_ASSERT_LESS_THAN(0u, p_modifier->GetNumEdgesReclassified());
+        TS_ASSERT_LESS_THAN(p_modifier->GetNumEdgesReclassified(), num_edges);
+
+        MAKE_PTR(HeterotypicEdgeStatisticsModifier<2>, p_divided_modifier);
+        p_divided_modifier->UpdateStatistics(cell_population);
+        TS_ASSERT_EQUALS(p_divided_modifier->GetNumEdgesReclassified(), num_edges + 3);
+        for (unsigned type=0; type<NUM_EDGE_TYPES; type++)
+        {
+            TS_ASSERT_EQUALS(p_modifier->GetNumEdges((EdgeType)type), p_divided_modifier->GetNumEdges((EdgeType)type));
+        }
+    }
+
+    void TestSinglePassWithoutEventLog() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        MatteoMutableVertexMesh<2> matteo_mesh(*p_mesh);
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        cells[4]->SetCellProliferativeType(p_diff_type);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        std::vector<CellPtr> matteo_cells;
+        cells_generator.GenerateBasic(matteo_cells, matteo_mesh.GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        matteo_cells[4]->SetCellProliferativeType(p_diff_type);
+        VertexBasedCellPopulation<2> matteo_cell_population(matteo_mesh, matteo_cells);
+
+        // A plain mesh records no events, so every edge is counted at every update
+        MAKE_PTR(HeterotypicEdgeStatisticsModifier<2>, p_modifier);
+        p_modifier->UpdateStatistics(cell_population);
+        unsigned num_edges = p_modifier->GetNumEdgesReclassified();
+        p_modifier->UpdateStatistics(cell_population);
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdgesReclassified(), num_edges);
+
+        // The counts and lengths agree with those kept for the same tissue on a MatteoMutableVertexMesh
+        MAKE_PTR(HeterotypicEdgeStatisticsModifier<2>, p_matteo_modifier);
+        p_matteo_modifier->UpdateStatistics(matteo_cell_population);
+        TS_ASSERT_EQUALS(p_matteo_modifier->GetNumEdgesReclassified(), num_edges);
+        p_modifier->UpdateEdgeLengths(cell_population);
+        p_matteo_modifier->UpdateEdgeLengths(matteo_cell_population);
+        for (unsigned type=0; type<NUM_EDGE_TYPES; type++)
+        {
+            TS_ASSERT_EQUALS(p_modifier->GetNumEdges((EdgeType)type), p_matteo_modifier->GetNumEdges((EdgeType)type));
+            TS_ASSERT_DELTA(p_modifier->GetTotalLength((EdgeType)type), p_matteo_modifier->GetTotalLength((EdgeType)type), 1e-9);
+        }
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdges(MIXED_EDGE), 6u);
+
+        // Changes of type are picked up
+        cell_population.GetCellUsingLocationIndex(4)->SetCellProliferativeType(p_wild_type);
+        p_modifier->UpdateStatistics(cell_population);
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdges(MIXED_EDGE), 0u);
+    }
+};
+
+#endif /*TESTHETEROTYPICEDGESTATISTICSMODIFIER_HPP_*/
@@ -0,0 +1,385 @@
+
+#ifndef TESTKERNELBENCHMARKS_HPP_
+#define TESTKERNELBENCHMARKS_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <set>
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "WildTypeCellMutationState.hpp"
+#include "CellLabel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "MatteoForce.hpp"
+#include "RandomMotionForce.hpp"
+#include "MatteoModifier.hpp"
+#include "ConstantTargetAreaModifier.hpp"
+#include "MatteoSrnModel.hpp"
+#include "MatteoMutableVertexMesh.hpp"
+#include "MatteoProfiler.hpp"
+#include "OutputFileHandler.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "Timer.hpp"
+#include "FakePetscSetup.hpp"
+
+/*
+ * Times the project's hot kernels in isolation on honeycomb meshes of increasing size.
+ * Not part of the continuous test pack; run it from the profile test pack, ideally
+ * in an optimised build. Each kernel is run for a number of repetitions of several
+ * calls each, and the median, minimum, mean and standard deviation over repetitions
+ * are reported per cell and per edge, both to stdout and to kernel_benchmarks.dat in
+ * the TestKernelBenchmarks output directory. Where the hardware performance counters
+ * are available, the instructions per cycle and the cache and branch misses per cell
+ * over all repetitions follow.
+ */
+
+/** Kernel timing the MatteoForce, optionally recomputing the geometry each call. */
+class MatteoForceKernel
+{
+    VertexBasedCellPopulation<2>& mrCellPopulation;
+    MatteoForce<2> mForce;
+    bool mRecomputeGeometry;
+public:
+    MatteoForceKernel(VertexBasedCellPopulation<2>& rCellPopulation, bool useStructureOfArrays, bool recomputeGeometry)
+        : mrCellPopulation(rCellPopulation),
+          mRecomputeGeometry(recomputeGeometry)
+    {
+        mForce.SetUseStructureOfArrays(useStructureOfArrays);
+    }
+    void operator()()
+    {
+        if (mRecomputeGeometry)
+        {
+            static_cast<MatteoMutableVertexMesh<2>&>(mrCellPopulation.rGetMesh()).MarkAsChanged();
+        }
+        mForce.AddForceContribution(mrCellPopulation);
+    }
+};
+
+/** Kernel timing MatteoForce::GetLineTensionParameter() over every edge of every element. */
+class LineTensionKernel
+{
+    VertexBasedCellPopulation<2>& mrCellPopulation;
+    MatteoForce<2> mForce;
+public:
+    double mSum;
+    LineTensionKernel(VertexBasedCellPopulation<2>& rCellPopulation)
+        : mrCellPopulation(rCellPopulation),
+          mSum(0.0)
+    {
+    }
+    void operator()()
+    {
+        MutableVertexMesh<2,2>& r_mesh = mrCellPopulation.rGetMesh();
+        for (unsigned elem_index=0; elem_index<r_mesh.GetNumElements(); elem_index++)
+        {
+            VertexElement<2,2>* p_element = r_mesh.GetElement(elem_index);
+            unsigned num_nodes = p_element->GetNumNodes();
+            for (unsigned local_index=0; local_index<num_nodes; local_index++)
+            {
+                mSum += mForce.GetLineTensionParameter(elem_index, p_element->GetNode(local_index),
+                                                       p_element->GetNode((local_index + 1)%num_nodes), mrCellPopulation);
+            }
+        }
+    }
+};
+
+/** Kernel timing RandomMotionForce::AddForceContribution(). */
+class RandomMotionKernel
+{
+    VertexBasedCellPopulation<2>& mrCellPopulation;
+    RandomMotionForce<2> mForce;
+public:
+    RandomMotionKernel(VertexBasedCellPopulation<2>& rCellPopulation)
+        : mrCellPopulation(rCellPopulation)
+    {
+    }
+    void operator()()
+    {
+        mForce.AddForceContribution(mrCellPopulation);
+    }
+};
+
+/** Kernel timing MatteoModifier's fitness update, with or without the selection that follows it. */
+class MatteoModifierKernel
+{
+    VertexBasedCellPopulation<2>& mrCellPopulation;
+    MatteoModifier<2> mModifier;
+    bool mIncludeSelection;
+public:
+    MatteoModifierKernel(VertexBasedCellPopulation<2>& rCellPopulation, bool includeSelection)
+        : mrCellPopulation(rCellPopulation),
+          mIncludeSelection(includeSelection)
+    {
+    }
+    void operator()()
+    {
+        if (mIncludeSelection)
+        {
+            // The selection runs when the time is a multiple of 10, as it is at the start
+            mModifier.UpdateAtEndOfTimeStep(mrCellPopulation);
+        }
+        else
+        {
+            mModifier.UpdateCellData(mrCellPopulation);
+        }
+    }
+};
+
+/** Kernel timing ConstantTargetAreaModifier::UpdateTargetAreas(). */
+class TargetAreaKernel
+{
+    VertexBasedCellPopulation<2>& mrCellPopulation;
+    ConstantTargetAreaModifier<2> mModifier;
+public:
+    TargetAreaKernel(VertexBasedCellPopulation<2>& rCellPopulation)
+        : mrCellPopulation(rCellPopulation)
+    {
+    }
+    void operator()()
+    {
+        mModifier.UpdateTargetAreas(mrCellPopulation);
+    }
+};
+
+/** Kernel timing one time step of every cell's MatteoSrnModel. */
+class SrnKernel
+{
+    VertexBasedCellPopulation<2>& mrCellPopulation;
+public:
+    SrnKernel(VertexBasedCellPopulation<2>& rCellPopulation)
+        : mrCellPopulation(rCellPopulation)
+    {
+    }
+    void operator()()
+    {
+        SimulationTime::Instance()->IncrementTimeOneStep();
+        for (AbstractCellPopulation<2>::Iterator cell_iter = mrCellPopulation.Begin();
+             cell_iter != mrCellPopulation.End();
+             ++cell_iter)
+        {
+            cell_iter->GetSrnModel()->SimulateToCurrentTime();
+        }
+    }
+};
+
+class TestKernelBenchmarks : public AbstractCellBasedTestSuite
+{
+private:
+
+    /** Number of timed repetitions of each kernel. */
+    static const unsigned NUM_REPETITIONS = 7;
+
+    /** Output file for the results. */
+    out_stream mpResultsFile;
+
+    /**
+     * Create a population on a MatteoMutableVertexMesh copied from an n by n honeycomb, so that
+     * its geometry is cached between calls, with a tenth of the cells differentiated and
+     * labelled, Delta-Notch SRN models and the cell data every kernel needs. The population
+     * owns the mesh.
+     */
+    VertexBasedCellPopulation<2>* MakePopulation(HoneycombVertexMeshGenerator& rGenerator)
+    {
+        MatteoMutableVertexMesh<2>* p_mesh = new MatteoMutableVertexMesh<2>(*rGenerator.GetMesh());
+        MAKE_PTR(WildTypeCellMutationState, p_state);
+        boost::shared_ptr<AbstractCellProperty> p_label(CellPropertyRegistry::Instance()->Get<CellLabel>());
+        RandomNumberGenerator* p_gen = RandomNumberGenerator::Instance();
+
+        std::vector<CellPtr> cells;
+        for (unsigned elem_index=0; elem_index<p_mesh->GetNumElements(); elem_index++)
+        {
+            NoCellCycleModel* p_cc_model = new NoCellCycleModel();
+            p_cc_model->SetDimension(2);
+
+            std::vector<double> initial_conditions;
+            initial_conditions.push_back(p_gen->ranf());
+            initial_conditions.push_back(p_gen->ranf());
+            MatteoSrnModel* p_srn_model = new MatteoSrnModel();
+            p_srn_model->SetInitialConditions(initial_conditions);
+
+            CellPtr p_cell(new Cell(p_state, p_cc_model, p_srn_model));
+            p_cell->InitialiseSrnModel();
+            p_cell->GetCellData()->SetItem("target area", 1.0);
+            p_cell->GetCellData()->SetItem("mean delta", 0.5);
+            p_cell->GetCellData()->SetItem("fitness", 1.0);
+            p_cell->GetCellData()->SetItem("divide", 0.0);
+            if (p_gen->ranf() < 0.1)
+            {
+                p_cell->SetCellProliferativeType(p_diff_type);
+                p_cell->AddCellProperty(p_label);
+            }
+            else
+            {
+                p_cell->SetCellProliferativeType(p_wild_type);
+            }
+            cells.push_back(p_cell);
+        }
+        return new VertexBasedCellPopulation<2>(*p_mesh, cells, true);
+    }
+
+    /**
+     * @return the number of distinct edges of the mesh
+     */
+    unsigned CountEdges(MutableVertexMesh<2,2>& rMesh)
+    {
+        std::set<std::pair<unsigned, unsigned> > edges;
+        for (unsigned elem_index=0; elem_index<rMesh.GetNumElements(); elem_index++)
+        {
+            VertexElement<2,2>* p_element = rMesh.GetElement(elem_index);
+            for (unsigned local_index=0; local_index<p_element->GetNumNodes(); local_index++)
+            {
+                unsigned a = p_element->GetNodeGlobalIndex(local_index);
+                unsigned b = p_element->GetNodeGlobalIndex((local_index + 1)%p_element->GetNumNodes());
+                edges.insert(std::make_pair(std::min(a, b), std::max(a, b)));
+            }
+        }
+        return edges.size();
+    }
+
+    /**
+     * Time a kernel and report the statistics over repetitions.
+     */
+    template<class KERNEL>
+    void Benchmark(const std::string& rName, KERNEL& rKernel, unsigned numCalls, unsigned numCells, unsigned numEdges)
+    {
+        // One untimed call, so that caches and lazily built data are warm
+        rKernel();
+
+        MatteoProfiler* p_profiler = MatteoProfiler::Instance();
+        bool counting = p_profiler->IsCountingHardwareEvents();
+        unsigned long long start_counts[MatteoProfiler::NUM_COUNTERS];
+        if (counting)
+        {
+            p_profiler->ReadHardwareCounters(start_counts);
+        }
+
+        std::vector<double> times;
+        for (unsigned repetition=0; repetition<NUM_REPETITIONS; repetition++)
+        {
+            Timer::Reset();
+            for (unsigned call=0; call<numCalls; call++)
+            {
+                rKernel();
+            }
+            times.push_back(Timer::GetElapsedTime()/numCalls);
+        }
+
+        unsigned long long counts[MatteoProfiler::NUM_COUNTERS];
+        if (counting)
+        {
+            p_profiler->ReadHardwareCounters(counts);
+            for (unsigned i=0; i<MatteoProfiler::NUM_COUNTERS; i++)
+            {
+                counts[i] -= start_counts[i];
+            }
+        }
+
+        std::vector<double> sorted_times(times);
+        std::sort(sorted_times.begin(), sorted_times.end());
+        double median = sorted_times[NUM_REPETITIONS/2];
+        double mean = 0.0;
+        for (unsigned i=0; i<NUM_REPETITIONS; i++)
+        {
+            mean += times[i]/NUM_REPETITIONS;
+        }
+        double variance = 0.0;
+        for (unsigned i=0; i<NUM_REPETITIONS; i++)
+        {
+            variance += (times[i] - mean)*(times[i] - mean)/(NUM_REPETITIONS - 1);
+        }
+
+        double ns_per_cell = 1e9/numCells;
+        std::stringstream line;
+        line << std::left << std::setw(32) << rName << std::right
+             << std::setw(8) << numCells << std::setw(8) << numEdges
+             << std::setw(12) << std::setprecision(4) << median*ns_per_cell
+             << std::setw(12) << median*1e9/numEdges
+             << std::setw(12) << sorted_times[0]*ns_per_cell
+             << std::setw(12) << mean*ns_per_cell
+             << std::setw(12) << sqrt(variance)*ns_per_cell;
+        if (counting && counts[MatteoProfiler::CYCLES] > 0)
+        {
+            double num_cell_calls = double(NUM_REPETITIONS)*numCalls*numCells;
+            line << std::setw(8) << double(counts[MatteoProfiler::INSTRUCTIONS])/counts[MatteoProfiler::CYCLES]
+                 << std::setw(12) << counts[MatteoProfiler::CACHE_MISSES]/num_cell_calls
+                 << std::setw(12) << counts[MatteoProfiler::BRANCH_MISSES]/num_cell_calls;
+        }
+        else
+        {
+            line << std::setw(8) << "-" << std::setw(12) << "-" << std::setw(12) << "-";
+        }
+        line << "\n";
+        std::cout << line.str() << std::flush;
+        *mpResultsFile << line.str();
+    }
+
+public:
+
+    void TestKernels() throw (Exception)
+    {
+        EXIT_IF_PARALLEL;
+
+        MatteoProfiler::Instance()->EnableHardwareCounters();
+
+        OutputFileHandler output_file_handler("TestKernelBenchmarks");
+        mpResultsFile = output_file_handler.OpenOutputFile("kernel_benchmarks.dat");
+        std::stringstream header;
+        header << "# kernel, cells, edges, then median ns/cell, median ns/edge, and min, mean and standard deviation"
+               << " of ns/cell over " << NUM_REPETITIONS << " repetitions,"
+               << " then instructions per cycle, cache misses/cell and branch misses/cell ('-' without hardware counters)\n";
+        std::cout << header.str();
+        *mpResultsFile << header.str();
+
+        unsigned sizes[] = {8, 16, 32, 64};
+        for (unsigned size_index=0; size_index<4; size_index++)
+        {
+            unsigned n = sizes[size_index];
+
+            // Restart the time, which the SRN kernel advances, so that the selection runs at every size
+            SimulationTime::Destroy();
+            SimulationTime::Instance()->SetStartTime(0.0);
+            SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1000.0, 200000);
+
+            HoneycombVertexMeshGenerator generator(n, n);
+            VertexBasedCellPopulation<2>* p_cell_population = MakePopulation(generator);
+            unsigned num_cells = p_cell_population->GetNumRealCells();
+            unsigned num_edges = CountEdges(p_cell_population->rGetMesh());
+
+            // Aim for roughly the same total work at every size
+            unsigned num_calls = std::max(1u, 20000u/num_cells);
+
+            MatteoForceKernel force_kernel(*p_cell_population, false, false);
+            Benchmark("MatteoForce", force_kernel, num_calls, num_cells, num_edges);
+            MatteoForceKernel force_geometry_kernel(*p_cell_population, false, true);
+            Benchmark("MatteoForce+geometry", force_geometry_kernel, num_calls, num_cells, num_edges);
+            MatteoForceKernel soa_kernel(*p_cell_population, true, false);
+            Benchmark("MatteoForce(soa)", soa_kernel, num_calls, num_cells, num_edges);
+            LineTensionKernel line_tension_kernel(*p_cell_population);
+            Benchmark("GetLineTensionParameter", line_tension_kernel, num_calls, num_cells, num_edges);
+            RandomMotionKernel random_motion_kernel(*p_cell_population);
+            Benchmark("RandomMotionForce", random_motion_kernel, num_calls, num_cells, num_edges);
+            MatteoModifierKernel fitness_kernel(*p_cell_population, false);
+            Benchmark("MatteoModifier::UpdateCellData", fitness_kernel, num_calls, num_cells, num_edges);
+            MatteoModifierKernel selection_kernel(*p_cell_population, true);
+            Benchmark("MatteoModifier(selection)", selection_kernel, num_calls, num_cells, num_edges);
+            TargetAreaKernel target_area_kernel(*p_cell_population);
+            Benchmark("ConstantTargetAreaModifier", target_area_kernel, num_calls, num_cells, num_edges);
+
+            // The SRN kernel advances the time, so it goes after the selection
+            SrnKernel srn_kernel(*p_cell_population);
+            Benchmark("MatteoSrnModel", srn_kernel, num_calls, num_cells, num_edges);
+
+            TS_ASSERT_LESS_THAN(0.0, line_tension_kernel.mSum);
+            delete p_cell_population;
+        }
+        mpResultsFile->close();
+        MatteoProfiler::Instance()->DisableHardwareCounters();
+    }
+};
+
+#endif /*TESTKERNELBENCHMARKS_HPP_*/
@@ -0,0 +1,169 @@
+
+#ifndef TESTMATTEOFORCE_HPP_
+#define TESTMATTEOFORCE_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "MatteoForce.hpp"
+#include "RandomMotionForce.hpp"
+#include "EdgeType.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestMatteoForce : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestEnergyComputedWithForces() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+
+        // Stretch the mesh so that the area terms do not vanish
+        p_mesh->Scale(1.1, 0.9);
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        cells[4]->SetCellProliferativeType(p_diff_type);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+        for (unsigned i=0; i<cells.size(); i++)
+        {
+            cells[i]->GetCellData()->SetItem("target area", 1.0);
+        }
+
+        MatteoForce<2> force;
+        force.AddForceContribution(cell_population);
+
+        // Evaluate the energy edge by edge, counting each internal edge once
+        double expected_energy = 0.0;
+        for (unsigned elem_index=0; elem_index<p_mesh->GetNumElements(); elem_index++)
+        {
+            double area = p_mesh->GetVolumeOfElement(elem_index);
+            double perimeter = p_mesh->GetSurfaceAreaOfElement(elem_index);
+            expected_energy += 0.5*force.GetAreaElasticityParameter()*(area - 1.0)*(area - 1.0)
+                               + 0.5*force.GetPerimeterContractilityParameter()*perimeter*perimeter;
+
+            VertexElement<2,2>* p_element = p_mesh->GetElement(elem_index);
+            unsigned num_nodes_elem = p_element->GetNumNodes();
+            for (unsigned local_index=0; local_index<num_nodes_elem; local_index++)
+            {
+                Node<2>* p_node_a = p_element->GetNode(local_index);
+                Node<2>* p_node_b = p_element->GetNode((local_index+1)%num_nodes_elem);
+                unsigned other_index;
+                EdgeType edge_type = GetEdgeType(elem_index, p_node_a, p_node_b, cell_population, &other_index);
+                if (other_index == UINT_MAX || other_index > elem_index)
+                {
+                    expected_energy += GetLineTensionOfEdgeType(edge_type)*norm_2(p_node_b->rGetLocation() - p_node_a->rGetLocation());
+                }
+            }
+        }
+        TS_ASSERT_DELTA(force.GetTotalEnergy(), expected_energy, 1e-9);
+
+        const std::vector<double>& r_element_energies = force.rGetElementEnergies();
+        TS_ASSERT_EQUALS(r_element_energies.size(), p_mesh->GetNumElements());
+        double sum = 0.0;
+        for (unsigned i=0; i<r_element_energies.size(); i++)
+        {
+            sum += r_element_energies[i];
+        }
+        TS_ASSERT_DELTA(sum, expected_energy, 1e-9);
+    }
+
+    void TestFusedNoiseMatchesRandomMotionForce() throw (Exception)
+    {
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 200);
+
+        HoneycombVertexMeshGenerator fused_generator(3, 3);
+        MutableVertexMesh<2,2>* p_fused_mesh = fused_generator.GetMesh();
+        HoneycombVertexMeshGenerator separate_generator(3, 3);
+        MutableVertexMesh<2,2>* p_separate_mesh = separate_generator.GetMesh();
+
+        std::vector<CellPtr> fused_cells;
+        std::vector<CellPtr> separate_cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(fused_cells, p_fused_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        cells_generator.GenerateBasic(separate_cells, p_separate_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        VertexBasedCellPopulation<2> fused_population(*p_fused_mesh, fused_cells);
+        VertexBasedCellPopulation<2> separate_population(*p_separate_mesh, separate_cells);
+        for (unsigned i=0; i<fused_cells.size(); i++)
+        {
+            fused_cells[i]->GetCellData()->SetItem("target area", 1.0);
+            separate_cells[i]->GetCellData()->SetItem("target area", 1.0);
+        }
+
+        MatteoForce<2> fused_force;
+        fused_force.SetMovementParameter(0.05);
+        RandomNumberGenerator::Instance()->Reseed(7);
+        fused_force.AddForceContribution(fused_population);
+
+        MatteoForce<2> force;
+        RandomMotionForce<2> random_force;
+        random_force.SetMovementParameter(0.05);
+        RandomNumberGenerator::Instance()->Reseed(7);
+        force.AddForceContribution(separate_population);
+        random_force.AddForceContribution(separate_population);
+
+        for (unsigned node_index=0; node_index<p_fused_mesh->GetNumNodes(); node_index++)
+        {
+            for (unsigned i=0; i<2; i++)
+            {
+                TS_ASSERT_DELTA(p_fused_mesh->GetNode(node_index)->rGetAppliedForce()[i],
+                                p_separate_mesh->GetNode(node_index)->rGetAppliedForce()[i], 1e-12);
+            }
+        }
+    }
+
+    void TestStructureOfArraysMatchesNodeLoop() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator node_generator(4, 4);
+        MutableVertexMesh<2,2>* p_node_mesh = node_generator.GetMesh();
+        p_node_mesh->Scale(1.1, 0.9);
+        HoneycombVertexMeshGenerator element_generator(4, 4);
+        MutableVertexMesh<2,2>* p_element_mesh = element_generator.GetMesh();
+        p_element_mesh->Scale(1.1, 0.9);
+
+        std::vector<CellPtr> node_cells;
+        std::vector<CellPtr> element_cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(node_cells, p_node_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        cells_generator.GenerateBasic(element_cells, p_element_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        for (unsigned i=0; i<node_cells.size(); i++)
+        {
+            if (i%3 == 0)
+            {
+                node_cells[i]->SetCellProliferativeType(p_diff_type);
+                element_cells[i]->SetCellProliferativeType(p_diff_type);
+            }
+            node_cells[i]->GetCellData()->SetItem("target area", 1.0);
+            element_cells[i]->GetCellData()->SetItem("target area", 1.0);
+        }
+        VertexBasedCellPopulation<2> node_population(*p_node_mesh, node_cells);
+        VertexBasedCellPopulation<2> element_population(*p_element_mesh, element_cells);
+
+        MatteoForce<2> node_force;
+        node_force.AddForceContribution(node_population);
+
+        MatteoForce<2> element_force;
+        element_force.SetUseStructureOfArrays(true);
+        element_force.AddForceContribution(element_population);
+
+        for (unsigned node_index=0; node_index<p_node_mesh->GetNumNodes(); node_index++)
+        {
+            for (unsigned i=0; i<2; i++)
+            {
+                TS_ASSERT_DELTA(p_element_mesh->GetNode(node_index)->rGetAppliedForce()[i],
+                                p_node_mesh->GetNode(node_index)->rGetAppliedForce()[i], 1e-10);
+            }
+        }
+        TS_ASSERT_DELTA(element_force.GetTotalEnergy(), node_force.GetTotalEnergy(), 1e-10);
+    }
+};
+
+#endif /*TESTMATTEOFORCE_HPP_*/
@@ -0,0 +1,261 @@
+#ifndef TESTMATTEOMUTABLEVERTEXMESH_HPP_
+#define TESTMATTEOMUTABLEVERTEXMESH_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <climits>
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "MatteoMutableVertexMesh.hpp"
+#include "HeterotypicEdgeStatisticsModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestMatteoMutableVertexMesh : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestCopyOfMesh() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(4, 4);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        p_mesh->SetCellRearrangementThreshold(0.05);
+        p_mesh->SetDistanceForT3SwapChecking(3.0);
+
+        MatteoMutableVertexMesh<2> mesh(*p_mesh);
+        TS_ASSERT_EQUALS(mesh.GetNumNodes(), p_mesh->GetNumNodes());
+        TS_ASSERT_EQUALS(mesh.GetNumElements(), p_mesh->GetNumElements());
+        TS_ASSERT_EQUALS(mesh.GetNumBoundaryNodes(), p_mesh->GetNumBoundaryNodes());
+        TS_ASSERT_DELTA(mesh.GetCellRearrangementThreshold(), 0.05, 1e-12);
+        TS_ASSERT_DELTA(mesh.GetDistanceForT3SwapChecking(), 3.0, 1e-12);
+        TS_ASSERT_EQUALS(mesh.GetNumRenumberings(), 0u);
+
+        for (unsigned elem_index=0; elem_index<mesh.GetNumElements(); elem_index++)
+        {
+            TS_ASSERT_DELTA(mesh.GetVolumeOfElement(elem_index), p_mesh->GetVolumeOfElement(elem_index), 1e-12);
+            TS_ASSERT_DELTA(mesh.GetSurfaceAreaOfElement(elem_index), p_mesh->GetSurfaceAreaOfElement(elem_index), 1e-12);
+        }
+    }
+
+    void TestRenumberingKeepsCellsWithTheirElements() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(6, 6);
+        MatteoMutableVertexMesh<2> mesh(*generator.GetMesh());
+        mesh.SetRenumberingInterval(2);
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, mesh.GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        cells[7]->SetCellProliferativeType(p_diff_type);
+        cells[20]->SetCellProliferativeType(p_diff_type);
+        VertexBasedCellPopulation<2> cell_population(mesh, cells);
+
+        MAKE_PTR(HeterotypicEdgeStatisticsModifier<2>, p_modifier);
+        p_modifier->UpdateStatistics(cell_population);
+
+        // Record where each cell is
+        std::map<CellPtr, c_vector<double, 2> > centroids;
+        std::map<CellPtr, double> areas;
+        for (unsigned elem_index=0; elem_index<mesh.GetNumElements(); elem_index++)
+        {
+            CellPtr p_cell = cell_population.GetCellUsingLocationIndex(elem_index);
+            centroids[p_cell] = mesh.GetCentroidOfElement(elem_index);
+            areas[p_cell] = mesh.GetVolumeOfElement(elem_index);
+        }
+
+        // The first ReMesh() is not due for renumbering
+        cell_population.Update();
+        TS_ASSERT_EQUALS(mesh.GetNumRenumberings(), 0u);
+
+        cell_population.Update();
+        TS_ASSERT_EQUALS(mesh.GetNumRenumberings(), 1u);
+
+        // The honeycomb is numbered row by row, which is not the order along a Hilbert curve
+        bool is_identity = true;
+        for (unsigned elem_index=0; elem_index<mesh.GetNumElements(); elem_index++)
+        {
+            CellPtr p_cell = cell_population.GetCellUsingLocationIndex(elem_index);
+            TS_ASSERT_EQUALS(cell_population.GetLocationIndexUsingCell(p_cell), elem_index);
+            TS_ASSERT_EQUALS(mesh.GetElement(elem_index)->GetIndex(), elem_index);
+
+            c_vector<double, 2> centroid = mesh.GetCentroidOfElement(elem_index);
+            TS_ASSERT_DELTA(centroid[0], centroids[p_cell][0], 1e-12);
+            TS_ASSERT_DELTA(centroid[1], centroids[p_cell][1], 1e-12);
+            TS_ASSERT_DELTA(mesh.GetVolumeOfElement(elem_index), areas[p_cell], 1e-12);
+
+            if (norm_2(centroid - generator.GetMesh()->GetCentroidOfElement(elem_index)) > 1e-12)
+            {
+                is_identity = false;
+            }
+        }
+        TS_ASSERT(!is_identity);
+
+        // Nodes and elements agree on the new numbering
+        for (unsigned node_index=0; node_index<mesh.GetNumNodes(); node_index++)
+        {
+            Node<2>* p_node = mesh.GetNode(node_index);
+            TS_ASSERT_EQUALS(p_node->GetIndex(), node_index);
+            for (std::set<unsigned>::iterator iter = p_node->rGetContainingElementIndices().begin();
+                 iter != p_node->rGetContainingElementIndices().end();
+                 ++iter)
+            {
+                TS_ASSERT_LESS_THAN(mesh.GetElement(*iter)->GetNodeLocalIndex(node_index), UINT_MAX);
+            }
+        }
+
+        // The edge statistics are rebuilt rather than patched up with stale indices
+        p_modifier->UpdateStatistics(cell_population);
+        MAKE_PTR(HeterotypicEdgeStatisticsModifier<2>, p_fresh_modifier);
+        p_fresh_modifier->UpdateStatistics(cell_population);
+        for (unsigned type=0; type<NUM_EDGE_TYPES; type++)
+        {
+            TS_ASSERT_EQUALS(p_modifier->GetNumEdges((EdgeType)type), p_fresh_modifier->GetNumEdges((EdgeType)type));
+        }
+        TS_ASSERT_EQUALS(p_modifier->GetNumEdges(MIXED_EDGE), 12u);
+    }
+
+    void TestCandidateFilteringSkipsQuietSteps() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(6, 6);
+        MatteoMutableVertexMesh<2> mesh(*generator.GetMesh());
+        mesh.SetCellRearrangementThreshold(0.1);
+        mesh.SetUseCandidateFiltering(true);
+        mesh.SetFullCheckInterval(10);
+
+        // The first call builds the index, after which an unchanged mesh needs no check
+        mesh.ReMesh();
+        TS_ASSERT_EQUALS(mesh.GetNumFullChecks(), 1u);
+        for (unsigned i=0; i<5; i++)
+        {
+            mesh.ReMesh();
+        }
+        TS_ASSERT_EQUALS(mesh.GetNumFullChecks(), 1u);
+        TS_ASSERT_EQUALS(mesh.GetNumSkippedChecks(), 5u);
+
+        // Nudging an interior node leaves all its edges well above the threshold
+        VertexElement<2,2>* p_element = mesh.GetElement(14);
+        unsigned node_a = p_element->GetNodeGlobalIndex(0);
+        unsigned node_b = p_element->GetNodeGlobalIndex(1);
+        c_vector<double, 2> edge = mesh.GetVectorFromAtoB(mesh.GetNode(node_b)->rGetLocation(), mesh.GetNode(node_a)->rGetLocation());
+        c_vector<double, 2> direction = edge/norm_2(edge);
+        mesh.GetNode(node_b)->rGetModifiableLocation() += 0.01*direction;
+        mesh.ReMesh();
+        TS_ASSERT_EQUALS(mesh.GetNumFullChecks(), 1u);
+        TS_ASSERT_EQUALS(mesh.GetNumSkippedChecks(), 6u);
+
+        // Shortening the edge below the threshold is found as a candidate and swapped
+        unsigned num_nodes = mesh.GetNumNodes();
+        mesh.GetNode(node_b)->rGetModifiableLocation() = mesh.GetNode(node_a)->rGetLocation() - 0.05*direction;
+        mesh.ReMesh();
+        TS_ASSERT_EQUALS(mesh.GetNumFullChecks(), 2u);
+        TS_ASSERT_EQUALS(mesh.GetLocationsOfT1Swaps().size(), 1u);
+        TS_ASSERT_EQUALS(mesh.GetNumT1Swaps(), 1u);
+        TS_ASSERT_EQUALS(mesh.GetNumNodes(), num_nodes);
+        TS_ASSERT_DELTA(mesh.GetDistanceBetweenNodes(node_a, node_b), 0.1*mesh.GetCellRearrangementRatio(), 1e-9);
+
+        // However quiet the mesh, the full check runs every ten calls
+        for (unsigned i=0; i<10; i++)
+        {
+            mesh.ReMesh();
+        }
+        TS_ASSERT_EQUALS(mesh.GetNumFullChecks(), 3u);
+        TS_ASSERT_EQUALS(mesh.GetNumSkippedChecks(), 15u);
+
+        // The count survives the swap locations being cleared, as the population writers do
+        mesh.ClearLocationsOfT1Swaps();
+        mesh.ReMesh();
+        TS_ASSERT_EQUALS(mesh.GetNumT1Swaps(), 1u);
+        TS_ASSERT_EQUALS(mesh.GetNumT2Swaps(), 0u);
+        TS_ASSERT_EQUALS(mesh.GetNumT3Swaps(), 0u);
+    }
+
+    void TestBoundaryNodesNearOtherElementsAreChecked() throw (Exception)
+    {
+        // Two unit squares separated by a gap of 0.05, less than the rearrangement threshold
+        std::vector<Node<2>*> nodes;
+        nodes.push_back(new Node<2>(0, true, 0.0, 0.0));
+        nodes.push_back(new Node<2>(1, true, 1.0, 0.0));
+        nodes.push_back(new Node<2>(2, true, 1.0, 1.0));
+        nodes.push_back(new Node<2>(3, true, 0.0, 1.0));
+        nodes.push_back(new Node<2>(4, true, 1.05, 0.0));
+        nodes.push_back(new Node<2>(5, true, 2.05, 0.0));
+        nodes.push_back(new Node<2>(6, true, 2.05, 1.0));
+        nodes.push_back(new Node<2>(7, true, 1.05, 1.0));
+        std::vector<VertexElement<2,2>*> elements;
+        for (unsigned elem_index=0; elem_index<2; elem_index++)
+        {
+            std::vector<Node<2>*> element_nodes(nodes.begin() + 4*elem_index, nodes.begin() + 4*elem_index + 4);
+            elements.push_back(new VertexElement<2,2>(elem_index, element_nodes));
+        }
+        MatteoMutableVertexMesh<2> mesh(nodes, elements);
+        mesh.SetCellRearrangementThreshold(0.1);
+        mesh.SetUseCandidateFiltering(true);
+
+        mesh.ReMesh();
+        mesh.ReMesh();
+        TS_ASSERT_EQUALS(mesh.GetNumFullChecks(), 1u);
+        TS_ASSERT_EQUALS(mesh.GetNumSkippedChecks(), 1u);
+
+        // A node far from the other square may move without a check
+        c_vector<double, 2> location = mesh.GetNode(0)->rGetLocation();
+        location[0] -= 0.03;
+        mesh.SetNode(0, ChastePoint<2>(location));
+        mesh.ReMesh();
+        TS_ASSERT_EQUALS(mesh.GetNumFullChecks(), 1u);
+        TS_ASSERT_EQUALS(mesh.GetNumSkippedChecks(), 2u);
+
+        // The same move, well short of the threshold, towards the other square could close the gap, so is checked
+        location = mesh.GetNode(1)->rGetLocation();
+        location[0] += 0.03;
+        mesh.SetNode(1, ChastePoint<2>(location));
+        mesh.ReMesh();
+        TS_ASSERT_EQUALS(mesh.GetNumFullChecks(), 2u);
+        TS_ASSERT_EQUALS(mesh.GetNumSkippedChecks(), 2u);
+        TS_ASSERT_EQUALS(mesh.GetNumT3Swaps(), 0u);
+    }
+
+    void TestT2SwapsAreCounted() throw (Exception)
+    {
+        // A small triangle in the middle of three quadrilaterals
+        std::vector<Node<2>*> nodes;
+        nodes.push_back(new Node<2>(0, true, 0.0, 0.0));
+        nodes.push_back(new Node<2>(1, true, 1.0, 0.0));
+        nodes.push_back(new Node<2>(2, true, 0.5, 1.0));
+        nodes.push_back(new Node<2>(3, false, 0.4, 0.25));
+        nodes.push_back(new Node<2>(4, false, 0.6, 0.25));
+        nodes.push_back(new Node<2>(5, false, 0.5, 0.3));
+
+        unsigned element_node_indices[4][4] = {{0, 1, 4, 3}, {1, 2, 5, 4}, {2, 0, 3, 5}, {3, 4, 5, UINT_MAX}};
+        std::vector<VertexElement<2,2>*> elements;
+        for (unsigned elem_index=0; elem_index<4; elem_index++)
+        {
+            std::vector<Node<2>*> element_nodes;
+            for (unsigned i=0; i<4 && element_node_indices[elem_index][i]!=UINT_MAX; i++)
+            {
+                element_nodes.push_back(nodes[element_node_indices[elem_index][i]]);
+            }
+            elements.push_back(new VertexElement<2,2>(elem_index, element_nodes));
+        }
+        MatteoMutableVertexMesh<2> mesh(nodes, elements);
+        mesh.SetT2Threshold(0.01);
+
+        // T2SwapCellKiller carries out the swap, and the mesh counts it once the triangle is removed
+        VertexElementMap element_map(mesh.GetNumAllElements());
+        TS_ASSERT(mesh.CheckForT2Swaps(element_map));
+        TS_ASSERT_EQUALS(mesh.GetNumT2Swaps(), 0u);
+        mesh.ReMesh();
+        TS_ASSERT_EQUALS(mesh.GetNumT2Swaps(), 1u);
+        TS_ASSERT_EQUALS(mesh.GetNumElements(), 3u);
+        TS_ASSERT_EQUALS(mesh.GetNumAllElements(), 3u);
+
+        mesh.ReMesh();
+        TS_ASSERT_EQUALS(mesh.GetNumT1Swaps(), 0u);
+        TS_ASSERT_EQUALS(mesh.GetNumT2Swaps(), 1u);
+        TS_ASSERT_EQUALS(mesh.GetNumT3Swaps(), 0u);
+    }
+};
+
+#endif /*TESTMATTEOMUTABLEVERTEXMESH_HPP_*/
@@ -0,0 +1,169 @@
+
+#ifndef TESTMATTEOPROFILER_HPP_
+#define TESTMATTEOPROFILER_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <cmath>
+#include <sstream>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "MatteoForce.hpp"
+#include "ConstantTargetAreaModifier.hpp"
+#include "MatteoProfiler.hpp"
+#include "ProfiledForce.hpp"
+#include "ProfiledSimulationModifier.hpp"
+#include "ProfileReportModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "FileFinder.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestMatteoProfiler : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestTimers() throw (Exception)
+    {
+        MatteoProfiler* p_profiler = MatteoProfiler::Instance();
+        p_profiler->Reset();
+
+        unsigned index = p_profiler->GetTimerIndex("test timer");
+        TS_ASSERT_EQUALS(p_profiler->GetTimerIndex("test timer"), index);
+        TS_ASSERT_EQUALS(p_profiler->GetNumCalls("test timer"), 0u);
+        TS_ASSERT_EQUALS(p_profiler->GetNumCalls("no such timer"), 0u);
+
+        p_profiler->AddTime(index, 0.5);
+        p_profiler->AddTime(index, 0.25);
+        TS_ASSERT_EQUALS(p_profiler->GetNumCalls("test timer"), 2u);
+        TS_ASSERT_DELTA(p_profiler->GetTotalTime("test timer"), 0.75, 1e-12);
+
+        // Scoped timers add one call each
+        {
+            MatteoScopedTimer timer(index);
+        }
+        TS_ASSERT_EQUALS(p_profiler->GetNumCalls("test timer"), 3u);
+        TS_ASSERT_LESS_THAN_EQUALS(0.75, p_profiler->GetTotalTime("test timer"));
+
+        std::stringstream report;
+        p_profiler->WriteReport(report);
+        TS_ASSERT_DIFFERS(report.str().find("test timer"), std::string::npos);
+
+        // Hardware event counts are accumulated alongside the times
+        unsigned long long counts[MatteoProfiler::NUM_COUNTERS] = {1000, 1500, 10, 20};
+        p_profiler->AddTime(index, 0.0, counts);
+        p_profiler->AddTime(index, 0.0, counts);
+        TS_ASSERT_EQUALS(p_profiler->GetCounterTotal("test timer", MatteoProfiler::INSTRUCTIONS), 3000u);
+        TS_ASSERT_EQUALS(p_profiler->GetCounterTotal("test timer", MatteoProfiler::BRANCH_MISSES), 40u);
+        std::stringstream counter_report;
+        p_profiler->WriteReport(counter_report);
+        TS_ASSERT_DIFFERS(counter_report.str().find("IPC"), std::string::npos);
+
+        // Resetting keeps the indices valid
+        p_profiler->Reset();
+        TS_ASSERT_EQUALS(p_profiler->GetNumCalls("test timer"), 0u);
+        TS_ASSERT_EQUALS(p_profiler->GetTimerIndex("test timer"), index);
+        TS_ASSERT_EQUALS(p_profiler->GetCounterTotal("test timer", MatteoProfiler::INSTRUCTIONS), 0u);
+    }
+
+    void TestHardwareCounters() throw (Exception)
+    {
+        // The counters may well be unavailable, e.g. in a virtual machine, in which case nothing is counted
+        MatteoProfiler* p_profiler = MatteoProfiler::Instance();
+        p_profiler->Reset();
+        bool enabled = p_profiler->EnableHardwareCounters();
+        TS_ASSERT_EQUALS(p_profiler->IsCountingHardwareEvents(), enabled);
+
+        unsigned index = p_profiler->GetTimerIndex("counted timer");
+        double sum = 0.0;
+        {
+            MatteoScopedTimer timer(index);
+            for (unsigned i=0; i<100000; i++)
+            {
+                sum += sqrt(double(i));
+            }
+        }
+        TS_ASSERT_LESS_THAN(0.0, sum);
+        TS_ASSERT_EQUALS(p_profiler->GetNumCalls("counted timer"), 1u);
+        if (enabled)
+        {
+            TS_ASSERT_LESS_THAN(0u, p_profiler->GetCounterTotal("counted timer", MatteoProfiler::INSTRUCTIONS));
+        }
+
+        p_profiler->DisableHardwareCounters();
+        TS_ASSERT(!p_profiler->IsCountingHardwareEvents());
+    }
+
+    void TestProfiledForceAndModifiers() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_diff_type);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 2);
+
+        MAKE_PTR(ProfileReportModifier<2>, p_report_modifier);
+        p_report_modifier->SetupSolve(cell_population, "TestMatteoProfiler");
+
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_target_area_modifier);
+        MAKE_PTR_ARGS(ProfiledSimulationModifier<2>, p_modifier, (p_target_area_modifier, "target areas"));
+        p_modifier->SetupSolve(cell_population, "TestMatteoProfiler");
+        TS_ASSERT_EQUALS(MatteoProfiler::Instance()->GetNumCalls("modifier: target areas (setup)"), 1u);
+
+        MAKE_PTR(MatteoForce<2>, p_matteo_force);
+        p_matteo_force->SetMovementParameter(0.0);
+        MAKE_PTR_ARGS(ProfiledForce<2>, p_force, (p_matteo_force, "MatteoForce"));
+
+        for (unsigned i=0; i<2; i++)
+        {
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            p_force->AddForceContribution(cell_population);
+            p_modifier->UpdateAtEndOfTimeStep(cell_population);
+            p_report_modifier->UpdateAtEndOfTimeStep(cell_population);
+        }
+        TS_ASSERT_EQUALS(MatteoProfiler::Instance()->GetNumCalls("force: MatteoForce"), 2u);
+        TS_ASSERT_EQUALS(MatteoProfiler::Instance()->GetNumCalls("modifier: target areas"), 2u);
+
+        // The wrapped force applies the same forces as the unwrapped one
+        for (unsigned node_index=0; node_index<p_mesh->GetNumNodes(); node_index++)
+        {
+            p_mesh->GetNode(node_index)->ClearAppliedForce();
+        }
+        p_force->AddForceContribution(cell_population);
+        std::vector<c_vector<double, 2> > profiled_forces;
+        for (unsigned node_index=0; node_index<p_mesh->GetNumNodes(); node_index++)
+        {
+            profiled_forces.push_back(p_mesh->GetNode(node_index)->rGetAppliedForce());
+            p_mesh->GetNode(node_index)->ClearAppliedForce();
+        }
+        p_matteo_force->AddForceContribution(cell_population);
+        for (unsigned node_index=0; node_index<p_mesh->GetNumNodes(); node_index++)
+        {
+            TS_ASSERT_DELTA(p_mesh->GetNode(node_index)->rGetAppliedForce()[0], profiled_forces[node_index][0], 1e-12);
+            TS_ASSERT_DELTA(p_mesh->GetNode(node_index)->rGetAppliedForce()[1], profiled_forces[node_index][1], 1e-12);
+        }
+
+        // The report is written to the output directory at the end of the solve
+        p_report_modifier->UpdateAtEndOfSolve(cell_population);
+        FileFinder profile_file("TestMatteoProfiler/profile.dat", RelativeTo::ChasteTestOutput);
+        TS_ASSERT(profile_file.IsFile());
+
+        // Lookups by class see through the wrappers, however deeply nested
+        MAKE_PTR_ARGS(ProfiledForce<2>, p_twice_profiled_force, (p_force, "outer"));
+        TS_ASSERT(ProfiledForce<2>::Unwrap(p_twice_profiled_force) == p_matteo_force);
+        TS_ASSERT(ProfiledForce<2>::Unwrap(p_matteo_force) == p_matteo_force);
+
+        // A wrapper with nothing to wrap cannot be used
+        ProfiledForce<2> empty_force;
+        TS_ASSERT_THROWS_THIS(empty_force.AddForceContribution(cell_population), "ProfiledForce has no force to apply");
+    }
+};
+
+#endif /*TESTMATTEOPROFILER_HPP_*/
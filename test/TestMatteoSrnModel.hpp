@@ -0,0 +1,63 @@
+
+#ifndef TESTMATTEOSRNMODEL_HPP_
+#define TESTMATTEOSRNMODEL_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "MatteoSrnModel.hpp"
+#include "NoCellCycleModel.hpp"
+#include "WildTypeCellMutationState.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestMatteoSrnModel : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestLazyInitialisation() throw (Exception)
+    {
+        std::vector<double> initial_conditions(2);
+        initial_conditions[0] = 0.8;
+        initial_conditions[1] = 0.2;
+        MatteoSrnModel* p_srn_model = new MatteoSrnModel();
+        p_srn_model->SetInitialConditions(initial_conditions);
+
+        // Copies of an uninitialised model do not allocate an ODE system
+        TS_ASSERT(p_srn_model->GetOdeSystem() == NULL);
+        AbstractSrnModel* p_prototype_copy = p_srn_model->CreateSrnModel();
+        TS_ASSERT(static_cast<MatteoSrnModel*>(p_prototype_copy)->GetOdeSystem() == NULL);
+        delete p_prototype_copy;
+
+        MAKE_PTR(WildTypeCellMutationState, p_state);
+        NoCellCycleModel* p_cc_model = new NoCellCycleModel();
+        p_cc_model->SetDimension(2);
+        CellPtr p_cell(new Cell(p_state, p_cc_model, p_srn_model));
+        p_cell->GetCellData()->SetItem("mean delta", 0.5);
+        p_cell->InitialiseSrnModel();
+        TS_ASSERT(p_srn_model->GetOdeSystem() != NULL);
+        TS_ASSERT_DELTA(p_srn_model->GetNotch(), 0.8, 1e-12);
+        TS_ASSERT_DELTA(p_srn_model->GetDelta(), 0.2, 1e-12);
+
+        // The solver is set up by the first integration
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(1.0, 10);
+        for (unsigned i=0; i<10; i++)
+        {
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            p_srn_model->SimulateToCurrentTime();
+        }
+        TS_ASSERT_DELTA(p_srn_model->GetMeanNeighbouringDelta(), 0.5, 1e-12);
+        TS_ASSERT_DIFFERS(p_srn_model->GetNotch(), 0.8);
+
+        // A daughter's model gets its own ODE system, starting from the parent's levels
+        AbstractSrnModel* p_daughter_model = p_srn_model->CreateSrnModel();
+        MatteoSrnModel* p_daughter_matteo_model = static_cast<MatteoSrnModel*>(p_daughter_model);
+        TS_ASSERT(p_daughter_matteo_model->GetOdeSystem() != NULL);
+        TS_ASSERT_DIFFERS(p_daughter_matteo_model->GetOdeSystem(), p_srn_model->GetOdeSystem());
+        TS_ASSERT_DELTA(p_daughter_matteo_model->GetNotch(), p_srn_model->GetNotch(), 1e-12);
+        TS_ASSERT_DELTA(p_daughter_matteo_model->GetDelta(), p_srn_model->GetDelta(), 1e-12);
+        delete p_daughter_model;
+    }
+};
+
+#endif /*TESTMATTEOSRNMODEL_HPP_*/
@@ -0,0 +1,141 @@
+
+#ifndef TESTMEMORYREPORTMODIFIER_HPP_
+#define TESTMEMORYREPORTMODIFIER_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <fstream>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "WildTypeCellMutationState.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "MatteoSrnModel.hpp"
+#include "MemoryReportModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "FileFinder.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestMemoryReportModifier : public AbstractCellBasedTestSuite
+{
+private:
+
+    /*
+     * Estimate the memory of a population on an n by n honeycomb, with or without SRN models.
+     */
+    double EstimateTotal(unsigned n, bool withSrnModels, std::vector<std::string>& rNames, std::vector<double>& rBytes)
+    {
+        HoneycombVertexMeshGenerator generator(n, n);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        MAKE_PTR(WildTypeCellMutationState, p_state);
+
+        std::vector<CellPtr> cells;
+        for (unsigned elem_index=0; elem_index<p_mesh->GetNumElements(); elem_index++)
+        {
+            NoCellCycleModel* p_cc_model = new NoCellCycleModel();
+            p_cc_model->SetDimension(2);
+            CellPtr p_cell;
+            if (withSrnModels)
+            {
+                std::vector<double> initial_conditions(2, 0.5);
+                MatteoSrnModel* p_srn_model = new MatteoSrnModel();
+                p_srn_model->SetInitialConditions(initial_conditions);
+                p_cell.reset(new Cell(p_state, p_cc_model, p_srn_model));
+                p_cell->InitialiseSrnModel();
+            }
+            else
+            {
+                p_cell.reset(new Cell(p_state, p_cc_model));
+            }
+            p_cell->SetCellProliferativeType(p_wild_type);
+            p_cell->GetCellData()->SetItem("target area", 1.0);
+            cells.push_back(p_cell);
+        }
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        MemoryReportModifier<2>::EstimateMemoryUsage(cell_population, rNames, rBytes);
+        double total = 0.0;
+        for (unsigned i=0; i<rBytes.size(); i++)
+        {
+            total += rBytes[i];
+        }
+        return total;
+    }
+
+public:
+
+    void TestEstimates() throw (Exception)
+    {
+        std::vector<std::string> names;
+        std::vector<double> bytes;
+        double small_total = EstimateTotal(4, true, names, bytes);
+        TS_ASSERT_EQUALS(names.size(), bytes.size());
+        TS_ASSERT_EQUALS(names[3], "SRN models and ODE systems");
+        double srn_bytes = bytes[3];
+        TS_ASSERT_EQUALS(names[0], "cells");
+        for (unsigned i=0; i<bytes.size(); i++)
+        {
+            if (names[i] != "geometry cache")
+            {
+                TS_ASSERT_LESS_THAN(0.0, bytes[i]);
+            }
+        }
+
+        // The estimate grows with the number of cells
+        double large_total = EstimateTotal(8, true, names, bytes);
+        TS_ASSERT_LESS_THAN(3.0*small_total, large_total);
+
+        // Cells without an SRN model get a NullSrnModel, with no ODE system
+        EstimateTotal(4, false, names, bytes);
+        TS_ASSERT_LESS_THAN(bytes[3], srn_bytes);
+    }
+
+    void TestReportFile() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_diff_type);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(4.0, 4);
+
+        MAKE_PTR(MemoryReportModifier<2>, p_modifier);
+        p_modifier->SetReportInterval(2);
+        TS_ASSERT_EQUALS(p_modifier->GetReportInterval(), 2u);
+        p_modifier->SetupSolve(cell_population, "TestMemoryReportModifier");
+        for (unsigned i=0; i<4; i++)
+        {
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            p_modifier->UpdateAtEndOfTimeStep(cell_population);
+        }
+        p_modifier->UpdateAtEndOfSolve(cell_population);
+        TS_ASSERT_LESS_THAN(0.0, p_modifier->GetPeakEstimatedBytes());
+
+        FileFinder report_file("TestMemoryReportModifier/memory.dat", RelativeTo::ChasteTestOutput);
+        TS_ASSERT(report_file.IsFile());
+
+        // Reports at setup, after steps 2 and 4, and at the end
+        std::ifstream report(report_file.GetAbsolutePath().c_str());
+        std::string line;
+        unsigned num_reports = 0;
+        while (std::getline(report, line))
+        {
+            if (line.compare(0, 6, "# time") == 0)
+            {
+                num_reports++;
+            }
+        }
+        TS_ASSERT_EQUALS(num_reports, 4u);
+
+#ifdef __linux__
+        TS_ASSERT_LESS_THAN(0.0, MemoryReportModifier<2>::ReadProcessMemory("VmHWM"));
+#endif
+        TS_ASSERT_DELTA(MemoryReportModifier<2>::ReadProcessMemory("NoSuchField"), 0.0, 1e-12);
+    }
+};
+
+#endif /*TESTMEMORYREPORTMODIFIER_HPP_*/
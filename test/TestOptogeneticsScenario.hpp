@@ -0,0 +1,57 @@
+
+#ifndef TESTOPTOGENETICSSCENARIO_HPP_
+#define TESTOPTOGENETICSSCENARIO_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <sstream>
+#include <boost/program_options.hpp>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "OptogeneticsScenario.hpp"
+#include "PopulationConstants.hpp"
+#include "FakePetscSetup.hpp"
+
+namespace po = boost::program_options;
+
+class TestOptogeneticsScenario : public AbstractCellBasedTestSuite
+{
+private:
+
+    /* Parse a config file given as a string, as OptogeneticsApp does for --config. */
+    po::variables_map Parse(const std::string& rConfig)
+    {
+        po::options_description description;
+        OptogeneticsScenario::AddOptions(description);
+        std::istringstream config(rConfig);
+        po::variables_map args;
+        po::store(po::parse_config_file(config, description), args);
+        po::notify(args);
+        return args;
+    }
+
+public:
+
+    void TestOptions() throw (Exception)
+    {
+        OptogeneticsScenario scenario(Parse("lambda = 0.2\ndiff = 0.3\nmixed = 0.4\nnoise = 0.1\n"));
+        TS_ASSERT_DELTA(wild_type_lambda, 0.2, 1e-12);
+        TS_ASSERT_DELTA(diff_type_lambda, 0.3, 1e-12);
+        TS_ASSERT_DELTA(mixed_type_lambda, 0.4, 1e-12);
+        TS_ASSERT_EQUALS(scenario.GetOutputDirectory(), "Optogenetics-l0.2-m0.3-x0.4-z0.1");
+
+        OptogeneticsScenario named_scenario(Parse("directory = TestOptogeneticsScenario\n"));
+        TS_ASSERT_EQUALS(named_scenario.GetOutputDirectory(), "TestOptogeneticsScenario");
+        TS_ASSERT_DELTA(wild_type_lambda, 0.12, 1e-12);
+    }
+
+    void TestRun() throw (Exception)
+    {
+        OptogeneticsScenario scenario(Parse("number = 4\ntime = 0.05\ndt = 0.005\nseed = 1\noutput = false\n"
+                                            "directory = TestOptogeneticsScenario\n"));
+        scenario.Run();
+        TS_ASSERT_EQUALS(scenario.GetNumCells(), 16u);
+        TS_ASSERT_EQUALS(scenario.GetNumTimeSteps(), 10u);
+    }
+};
+
+#endif /*TESTOPTOGENETICSSCENARIO_HPP_*/
@@ -0,0 +1,250 @@
+
+#ifndef TESTREPLICATEENSEMBLE_HPP_
+#define TESTREPLICATEENSEMBLE_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "MatteoSrnModel.hpp"
+#include "WildTypeCellMutationState.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "ConstantTargetAreaModifier.hpp"
+#include "ReplicateEnsemble.hpp"
+#include "DeltaNotchOdeSystem.hpp"
+#include "RungeKutta4IvpOdeSolver.hpp"
+#include "RandomNumberGenerator.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestReplicateEnsemble : public AbstractCellBasedTestSuite
+{
+private:
+
+    /**
+     * Create cells with Delta-Notch SRN models, every third one differentiated.
+     */
+    std::vector<CellPtr> MakeCells(unsigned numCells)
+    {
+        std::vector<CellPtr> cells;
+        MAKE_PTR(WildTypeCellMutationState, p_state);
+        for (unsigned i=0; i<numCells; i++)
+        {
+            NoCellCycleModel* p_cc_model = new NoCellCycleModel();
+            p_cc_model->SetDimension(2);
+
+            std::vector<double> initial_conditions(2, 0.5);
+            MatteoSrnModel* p_srn_model = new MatteoSrnModel();
+            p_srn_model->SetInitialConditions(initial_conditions);
+
+            CellPtr p_cell(new Cell(p_state, p_cc_model, p_srn_model));
+            p_cell->SetCellProliferativeType(i%3 == 0 ? p_diff_type : p_wild_type);
+            cells.push_back(p_cell);
+        }
+        return cells;
+    }
+
+public:
+
+    void TestReplicatesMatchMatteoForce() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(4, 4);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        p_mesh->SetCellRearrangementThreshold(0.1);
+        p_mesh->Scale(1.1, 0.9);
+
+        std::vector<CellPtr> cells = MakeCells(p_mesh->GetNumElements());
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        p_growth_modifier->UpdateTargetAreas(cell_population);
+        MAKE_PTR(MatteoForce<2>, p_force);
+
+        ReplicateEnsemble<2> ensemble(cell_population, p_force, 3);
+        TS_ASSERT_EQUALS(ensemble.GetNumReplicates(), 3u);
+
+        // Without noise every replicate follows the same path as the population moved by the force
+        double dt = 0.01;
+        unsigned num_steps = 20;
+        ensemble.Advance(dt, num_steps);
+        for (unsigned step=0; step<num_steps; step++)
+        {
+            for (unsigned node_index=0; node_index<p_mesh->GetNumNodes(); node_index++)
+            {
+                p_mesh->GetNode(node_index)->ClearAppliedForce();
+            }
+            p_force->AddForceContribution(cell_population);
+            for (unsigned node_index=0; node_index<p_mesh->GetNumNodes(); node_index++)
+            {
+                Node<2>* p_node = p_mesh->GetNode(node_index);
+                p_node->rGetModifiableLocation() += dt*p_node->rGetAppliedForce();
+            }
+        }
+
+        TS_ASSERT_EQUALS(ensemble.GetNumActiveReplicates(), 3u);
+        for (unsigned replicate=0; replicate<3; replicate++)
+        {
+            TS_ASSERT_EQUALS(ensemble.GetNumTimeSteps(replicate), num_steps);
+            for (unsigned node_index=0; node_index<p_mesh->GetNumNodes(); node_index++)
+            {
+                c_vector<double, 2> location = ensemble.GetNodeLocation(replicate, node_index);
+                TS_ASSERT_DELTA(location[0], p_mesh->GetNode(node_index)->rGetLocation()[0], 1e-10);
+                TS_ASSERT_DELTA(location[1], p_mesh->GetNode(node_index)->rGetLocation()[1], 1e-10);
+            }
+            for (unsigned elem_index=0; elem_index<p_mesh->GetNumElements(); elem_index++)
+            {
+                TS_ASSERT_DELTA(ensemble.GetNotch(replicate, elem_index), ensemble.GetNotch(0, elem_index), 1e-12);
+                TS_ASSERT_DELTA(ensemble.GetDelta(replicate, elem_index), ensemble.GetDelta(0, elem_index), 1e-12);
+            }
+        }
+    }
+
+    void TestRandomisedReplicatesDiverge() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(4, 4);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        p_mesh->SetCellRearrangementThreshold(0.1);
+
+        std::vector<CellPtr> cells = MakeCells(p_mesh->GetNumElements());
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        p_growth_modifier->UpdateTargetAreas(cell_population);
+        MAKE_PTR(MatteoForce<2>, p_force);
+        p_force->SetMovementParameter(0.001);
+
+        ReplicateEnsemble<2> ensemble(cell_population, p_force, 4);
+        ensemble.RandomiseSrnStates();
+        ensemble.Advance(0.01, 50);
+
+        TS_ASSERT_EQUALS(ensemble.GetNumActiveReplicates(), 4u);
+        TS_ASSERT_DIFFERS(ensemble.GetNodeLocation(0, 0)[0], ensemble.GetNodeLocation(1, 0)[0]);
+        TS_ASSERT_DIFFERS(ensemble.GetNotch(0, 5), ensemble.GetNotch(1, 5));
+        for (unsigned replicate=0; replicate<4; replicate++)
+        {
+            for (unsigned elem_index=0; elem_index<p_mesh->GetNumElements(); elem_index++)
+            {
+                TS_ASSERT_LESS_THAN(0.0, ensemble.GetNotch(replicate, elem_index));
+                TS_ASSERT_LESS_THAN(ensemble.GetNotch(replicate, elem_index), 1.0);
+            }
+        }
+
+        // A replicate can be written back to the population and continued on its own
+        ensemble.WriteReplicateToPopulation(2);
+        TS_ASSERT_DELTA(p_mesh->GetNode(0)->rGetLocation()[0], ensemble.GetNodeLocation(2, 0)[0], 1e-12);
+        TS_ASSERT_DELTA(cell_population.GetCellUsingLocationIndex(5)->GetCellData()->GetItem("notch"), ensemble.GetNotch(2, 5), 1e-12);
+    }
+
+    void TestSrnStatesFollowDeltaNotchOdeSystem() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(4, 4);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        p_mesh->SetCellRearrangementThreshold(0.1);
+
+        std::vector<CellPtr> cells = MakeCells(p_mesh->GetNumElements());
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        p_growth_modifier->UpdateTargetAreas(cell_population);
+        MAKE_PTR(MatteoForce<2>, p_force);
+
+        ReplicateEnsemble<2> ensemble(cell_population, p_force, 2);
+        ensemble.RandomiseSrnStates();
+        std::vector<double> initial_notch(p_mesh->GetNumElements());
+        std::vector<double> initial_delta(p_mesh->GetNumElements());
+        for (unsigned elem_index=0; elem_index<p_mesh->GetNumElements(); elem_index++)
+        {
+            initial_notch[elem_index] = ensemble.GetNotch(1, elem_index);
+            initial_delta[elem_index] = ensemble.GetDelta(1, elem_index);
+        }
+        double dt = 0.01;
+        ensemble.Advance(dt, 1);
+
+        // Each cell takes the step Chaste's own RK4 solver takes on the system MatteoSrnModel solves
+        RungeKutta4IvpOdeSolver solver;
+        DeltaNotchOdeSystem ode_system;
+        for (unsigned elem_index=0; elem_index<p_mesh->GetNumElements(); elem_index++)
+        {
+            std::set<unsigned> neighbours = cell_population.GetNeighbouringLocationIndices(cell_population.GetCellUsingLocationIndex(elem_index));
+            double mean_delta = 0.0;
+            for (std::set<unsigned>::iterator iter = neighbours.begin(); iter != neighbours.end(); ++iter)
+            {
+                mean_delta += initial_delta[*iter]/neighbours.size();
+            }
+            ode_system.SetParameter("Mean Delta", mean_delta);
+            std::vector<double> state(2);
+            state[0] = initial_notch[elem_index];
+            state[1] = initial_delta[elem_index];
+            solver.Solve(&ode_system, state, 0.0, dt, dt);
+
+            TS_ASSERT_DELTA(ensemble.GetNotch(1, elem_index), state[0], 1e-12);
+            TS_ASSERT_DELTA(ensemble.GetDelta(1, elem_index), state[1], 1e-12);
+        }
+    }
+
+    void TestReplicatesHaveTheirOwnStreams() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(4, 4);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        p_mesh->SetCellRearrangementThreshold(0.1);
+
+        std::vector<CellPtr> cells = MakeCells(p_mesh->GetNumElements());
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        p_growth_modifier->UpdateTargetAreas(cell_population);
+        MAKE_PTR(MatteoForce<2>, p_force);
+        p_force->SetMovementParameter(0.001);
+
+        RandomNumberGenerator::Instance()->Reseed(3);
+        ReplicateEnsemble<2> ensemble(cell_population, p_force, 4);
+        ensemble.RandomiseSrnStates();
+        ensemble.Advance(0.01, 20);
+
+        // With the same seed, a replicate follows the same path however many replicates run alongside it
+        RandomNumberGenerator::Instance()->Reseed(3);
+        ReplicateEnsemble<2> smaller_ensemble(cell_population, p_force, 2);
+        smaller_ensemble.RandomiseSrnStates();
+        smaller_ensemble.Advance(0.01, 20);
+
+        for (unsigned replicate=0; replicate<2; replicate++)
+        {
+            TS_ASSERT_EQUALS(smaller_ensemble.GetNumTimeSteps(replicate), 20u);
+            for (unsigned node_index=0; node_index<p_mesh->GetNumNodes(); node_index++)
+            {
+                TS_ASSERT_DELTA(smaller_ensemble.GetNodeLocation(replicate, node_index)[0], ensemble.GetNodeLocation(replicate, node_index)[0], 1e-12);
+                TS_ASSERT_DELTA(smaller_ensemble.GetNodeLocation(replicate, node_index)[1], ensemble.GetNodeLocation(replicate, node_index)[1], 1e-12);
+            }
+            for (unsigned elem_index=0; elem_index<p_mesh->GetNumElements(); elem_index++)
+            {
+                TS_ASSERT_DELTA(smaller_ensemble.GetNotch(replicate, elem_index), ensemble.GetNotch(replicate, elem_index), 1e-12);
+            }
+        }
+        TS_ASSERT_DIFFERS(ensemble.GetNodeLocation(2, 0)[0], ensemble.GetNodeLocation(3, 0)[0]);
+        TS_ASSERT_DIFFERS(ensemble.GetNotch(2, 5), ensemble.GetNotch(3, 5));
+    }
+
+    void TestReplicatesSplitOffBeforeRearranging() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+
+        // Every edge of the honeycomb is shorter than this threshold, so every replicate is due a T1 swap
+        p_mesh->SetCellRearrangementThreshold(0.6);
+
+        std::vector<CellPtr> cells = MakeCells(p_mesh->GetNumElements());
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        p_growth_modifier->UpdateTargetAreas(cell_population);
+        MAKE_PTR(MatteoForce<2>, p_force);
+
+        ReplicateEnsemble<2> ensemble(cell_population, p_force, 2);
+        c_vector<double, 2> initial_location = ensemble.GetNodeLocation(1, 4);
+        ensemble.Advance(0.01, 10);
+
+        TS_ASSERT_EQUALS(ensemble.GetNumActiveReplicates(), 0u);
+        TS_ASSERT(!ensemble.IsReplicateActive(1));
+        TS_ASSERT_EQUALS(ensemble.GetNumTimeSteps(1), 0u);
+        TS_ASSERT_DELTA(ensemble.GetNodeLocation(1, 4)[0], initial_location[0], 1e-12);
+        TS_ASSERT_DELTA(ensemble.GetNodeLocation(1, 4)[1], initial_location[1], 1e-12);
+    }
+};
+
+#endif /*TESTREPLICATEENSEMBLE_HPP_*/
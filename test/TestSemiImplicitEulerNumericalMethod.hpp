@@ -0,0 +1,67 @@
+
+#ifndef TESTSEMIIMPLICITEULERNUMERICALMETHOD_HPP_
+#define TESTSEMIIMPLICITEULERNUMERICALMETHOD_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "OffLatticeSimulation.hpp"
+#include "SemiImplicitEulerNumericalMethod.hpp"
+#include "MatteoForce.hpp"
+#include "ConstantTargetAreaModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "PetscSetupAndFinalize.hpp"
+
+class TestSemiImplicitEulerNumericalMethod : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestRelaxationWithLargeTimeStep() throw (Exception)
+    {
+        EXIT_IF_PARALLEL;
+
+        HoneycombVertexMeshGenerator generator(4, 4);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        p_mesh->SetCellRearrangementThreshold(0.1);
+        p_mesh->Scale(1.2, 0.8);
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        for (unsigned i=0; i<cells.size(); i+=3)
+        {
+            cells[i]->SetCellProliferativeType(p_diff_type);
+        }
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        p_growth_modifier->UpdateTargetAreas(cell_population);
+        MAKE_PTR(MatteoForce<2>, p_force);
+        p_force->AddForceContribution(cell_population);
+        double initial_energy = p_force->GetTotalEnergy();
+
+        // Ten times the time step TestOptogenetics uses with forward Euler
+        OffLatticeSimulation<2> simulator(cell_population);
+        simulator.SetOutputDirectory("TestSemiImplicitEulerNumericalMethod");
+        simulator.SetDt(0.05);
+        simulator.SetSamplingTimestepMultiple(20);
+        simulator.SetEndTime(2.0);
+
+        MAKE_PTR(SemiImplicitEulerNumericalMethod<2>, p_numerical_method);
+        simulator.SetNumericalMethod(p_numerical_method);
+        simulator.AddForce(p_force);
+        simulator.AddSimulationModifier(p_growth_modifier);
+
+        TS_ASSERT_THROWS_NOTHING(simulator.Solve());
+
+        // The energy seen by the last force evaluation has come down
+        TS_ASSERT_LESS_THAN(p_force->GetTotalEnergy(), initial_energy);
+    }
+};
+
+#endif /*TESTSEMIIMPLICITEULERNUMERICALMETHOD_HPP_*/
@@ -0,0 +1,139 @@
+
+#ifndef TESTSHAREDMEMORYEXPORTMODIFIER_HPP_
+#define TESTSHAREDMEMORYEXPORTMODIFIER_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <cmath>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "SharedMemoryExportModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestSharedMemoryExportModifier : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestExport() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_diff_type);
+        for (unsigned i=0; i<cells.size(); i++)
+        {
+            cells[i]->GetCellData()->SetItem("notch", 0.1*i);
+        }
+
+        // The first cell lacks an item the others carry, and only one cell carries another
+        for (unsigned i=1; i<cells.size(); i++)
+        {
+            cells[i]->GetCellData()->SetItem("delta", 1.0 - 0.1*i);
+        }
+        cells[4]->GetCellData()->SetItem("fitness", 0.5);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(4.0, 4);
+
+        MAKE_PTR(SharedMemoryExportModifier<2>, p_modifier);
+        p_modifier->SetSegmentName("TestSharedMemoryExportModifier");
+        p_modifier->SetExportInterval(2);
+        TS_ASSERT_THROWS_THIS(p_modifier->SetSegmentName("a/b"), "The shared memory segment name must not contain '/'");
+
+        p_modifier->SetupSolve(cell_population, "TestSharedMemoryExportModifier");
+        TS_ASSERT_EQUALS(p_modifier->rGetSegmentPath(), "/dev/shm/TestSharedMemoryExportModifier");
+
+        const SharedTissueHeader* p_header = p_modifier->GetHeader();
+        TS_ASSERT_EQUALS(std::string(p_header->mMagic, 8), "CHSTTISS");
+        TS_ASSERT_EQUALS(p_header->mVersion, SharedMemoryExportModifier<2>::LAYOUT_VERSION);
+        TS_ASSERT_EQUALS(p_header->mDimension, 2u);
+        TS_ASSERT_EQUALS(p_header->mSequence, 2u);
+        TS_ASSERT_EQUALS(p_header->mNumUpdates, 1u);
+        TS_ASSERT_EQUALS(p_header->mNumNodes, p_mesh->GetNumNodes());
+        TS_ASSERT_EQUALS(p_header->mNumElements, 9u);
+        TS_ASSERT_EQUALS(p_header->mFinished, 0u);
+
+        // Updated every second step, and at the end
+        for (unsigned i=0; i<4; i++)
+        {
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            p_modifier->UpdateAtEndOfTimeStep(cell_population);
+        }
+        p_modifier->UpdateAtEndOfSolve(cell_population);
+        p_header = p_modifier->GetHeader();
+        TS_ASSERT_EQUALS(p_header->mNumUpdates, 4u);
+        TS_ASSERT_EQUALS(p_header->mSequence%2, 0u);
+        TS_ASSERT_EQUALS(p_header->mFinished, 1u);
+        TS_ASSERT_DELTA(p_header->mTime, 4.0, 1e-12);
+
+        // Read the segment back through a separate mapping, as a viewer would
+        int fd = open("/dev/shm/TestSharedMemoryExportModifier", O_RDONLY);
+        TS_ASSERT_LESS_THAN_EQUALS(0, fd);
+        struct stat file_status;
+        fstat(fd, &file_status);
+        TS_ASSERT_EQUALS((uint64_t)file_status.st_size, p_header->mSegmentSize);
+        const char* p_segment = static_cast<const char*>(mmap(NULL, file_status.st_size, PROT_READ, MAP_SHARED, fd, 0));
+        const SharedTissueHeader* p_read_header = reinterpret_cast<const SharedTissueHeader*>(p_segment);
+
+        const double* p_locations = reinterpret_cast<const double*>(p_segment + p_read_header->mNodeLocationsOffset);
+        TS_ASSERT_DELTA(p_locations[2*5 + 0], p_mesh->GetNode(5)->rGetLocation()[0], 1e-12);
+        TS_ASSERT_DELTA(p_locations[2*5 + 1], p_mesh->GetNode(5)->rGetLocation()[1], 1e-12);
+
+        const uint32_t* p_offsets = reinterpret_cast<const uint32_t*>(p_segment + p_read_header->mElementOffsetsOffset);
+        const uint32_t* p_nodes = reinterpret_cast<const uint32_t*>(p_segment + p_read_header->mElementNodesOffset);
+        VertexElement<2,2>* p_element = p_mesh->GetElement(4);
+        TS_ASSERT_EQUALS(p_offsets[5] - p_offsets[4], p_element->GetNumNodes());
+        for (unsigned local_index=0; local_index<p_element->GetNumNodes(); local_index++)
+        {
+            TS_ASSERT_EQUALS(p_nodes[p_offsets[4] + local_index], p_element->GetNodeGlobalIndex(local_index));
+        }
+
+        const int32_t* p_types = reinterpret_cast<const int32_t*>(p_segment + p_read_header->mCellTypesOffset);
+        const double* p_notch = reinterpret_cast<const double*>(p_segment + p_read_header->mNotchOffset);
+        const double* p_delta = reinterpret_cast<const double*>(p_segment + p_read_header->mDeltaOffset);
+        const double* p_fitness = reinterpret_cast<const double*>(p_segment + p_read_header->mFitnessOffset);
+        CellPtr p_cell = cell_population.GetCellUsingLocationIndex(4);
+        TS_ASSERT_EQUALS(p_types[4], 1);
+        TS_ASSERT_DELTA(p_notch[4], p_cell->GetCellData()->GetItem("notch"), 1e-12);
+        TS_ASSERT_DELTA(p_delta[4], p_cell->GetCellData()->GetItem("delta"), 1e-12);
+        TS_ASSERT_DELTA(p_fitness[4], 0.5, 1e-12);
+
+        // Each cell's missing items are NaN, whatever the other cells carry
+        for (unsigned elem_index=0; elem_index<9; elem_index++)
+        {
+            p_cell = cell_population.GetCellUsingLocationIndex(elem_index);
+            TS_ASSERT_EQUALS(std::isnan(p_delta[elem_index]), !p_cell->GetCellData()->HasItem("delta"));
+            TS_ASSERT_EQUALS(std::isnan(p_fitness[elem_index]), !p_cell->GetCellData()->HasItem("fitness"));
+        }
+
+        munmap(const_cast<char*>(p_segment), file_status.st_size);
+        close(fd);
+
+        // A larger tissue grows the segment
+        uint64_t old_size = p_header->mSegmentSize;
+        HoneycombVertexMeshGenerator large_generator(30, 30);
+        MutableVertexMesh<2,2>* p_large_mesh = large_generator.GetMesh();
+        std::vector<CellPtr> large_cells;
+        cells_generator.GenerateBasic(large_cells, p_large_mesh->GetNumElements(), std::vector<unsigned>(), p_diff_type);
+        VertexBasedCellPopulation<2> large_population(*p_large_mesh, large_cells);
+        p_modifier->UpdateAtEndOfSolve(large_population);
+        TS_ASSERT_LESS_THAN(old_size, p_modifier->GetHeader()->mSegmentSize);
+        TS_ASSERT_EQUALS(p_modifier->GetHeader()->mNumElements, 900u);
+
+        // Destroying the modifier removes the segment
+        p_modifier.reset();
+        TS_ASSERT_DIFFERS(access("/dev/shm/TestSharedMemoryExportModifier", F_OK), 0);
+    }
+};
+
+#endif /*TESTSHAREDMEMORYEXPORTMODIFIER_HPP_*/
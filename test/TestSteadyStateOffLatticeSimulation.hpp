@@ -0,0 +1,81 @@
+
+#ifndef TESTSTEADYSTATEOFFLATTICESIMULATION_HPP_
+#define TESTSTEADYSTATEOFFLATTICESIMULATION_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "SteadyStateOffLatticeSimulation.hpp"
+#include "MatteoForce.hpp"
+#include "ConstantTargetAreaModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "FileFinder.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestSteadyStateOffLatticeSimulation : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestRelaxationStopsEarly() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(4, 4);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        // Without noise, cell division or SRNs a honeycomb relaxes to a static configuration
+        SteadyStateOffLatticeSimulation<2> simulator(cell_population);
+        simulator.SetOutputDirectory("TestSteadyStateOffLatticeSimulation");
+        simulator.SetDt(0.01);
+        simulator.SetSamplingTimestepMultiple(100);
+        simulator.SetEndTime(1000.0);
+        simulator.SetCheckInterval(20);
+        simulator.SetWindowSize(3);
+        simulator.SetDisplacementTolerance(1e-6);
+        simulator.SetEnergyTolerance(1e-6);
+
+        MAKE_PTR(MatteoForce<2>, p_force);
+        simulator.AddForce(p_force);
+        MAKE_PTR(ConstantTargetAreaModifier<2>, p_growth_modifier);
+        simulator.AddSimulationModifier(p_growth_modifier);
+
+        simulator.Solve();
+
+        TS_ASSERT(simulator.HasReachedSteadyState());
+        TS_ASSERT_LESS_THAN(simulator.GetStoppingTime(), 1000.0);
+        TS_ASSERT_DELTA(SimulationTime::Instance()->GetTime(), simulator.GetStoppingTime(), 1e-9);
+
+        FileFinder steady_state_file("TestSteadyStateOffLatticeSimulation/steady_state.dat", RelativeTo::ChasteTestOutput);
+        TS_ASSERT(steady_state_file.Exists());
+    }
+
+    void TestExceptions() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(2, 2);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        SteadyStateOffLatticeSimulation<2> simulator(cell_population);
+        simulator.SetOutputDirectory("TestSteadyStateOffLatticeSimulationExceptions");
+        simulator.SetEndTime(1.0);
+        TS_ASSERT_THROWS_THIS(simulator.SetWindowSize(0), "The window size must be positive");
+
+        // Without a MatteoForce there is no energy to check
+        TS_ASSERT_THROWS_THIS(simulator.Solve(),
+                              "SteadyStateOffLatticeSimulation needs a MatteoForce to compute the mechanical energy");
+    }
+};
+
+#endif /*TESTSTEADYSTATEOFFLATTICESIMULATION_HPP_*/
@@ -0,0 +1,103 @@
+
+#ifndef TESTTELEMETRYMODIFIER_HPP_
+#define TESTTELEMETRYMODIFIER_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <boost/bind.hpp>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "MatteoMutableVertexMesh.hpp"
+#include "TelemetryModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestTelemetryModifier : public AbstractCellBasedTestSuite
+{
+private:
+
+    /* Receive one message from a bound socket, or an empty string if none is waiting. */
+    std::string Receive(int listener)
+    {
+        char buffer[4096];
+        ssize_t length = recv(listener, buffer, sizeof(buffer) - 1, MSG_DONTWAIT);
+        return (length > 0) ? std::string(buffer, length) : std::string();
+    }
+
+public:
+
+    void TestMessages() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MatteoMutableVertexMesh<2> mesh(*generator.GetMesh());
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, mesh.GetNumElements(), std::vector<unsigned>(), p_diff_type);
+        for (unsigned i=0; i<cells.size(); i++)
+        {
+            cells[i]->GetCellData()->SetItem("target area", 1.0);
+        }
+        VertexBasedCellPopulation<2> cell_population(mesh, cells);
+
+        SimulationTime::Instance()->SetEndTimeAndNumberOfTimeSteps(4.0, 4);
+
+        // Listen where the modifier will publish, as scripts/telemetry_client.py does
+        std::string socket_path = "/tmp/TestTelemetryModifier.sock";
+        unlink(socket_path.c_str());
+        int listener = socket(AF_UNIX, SOCK_DGRAM, 0);
+        TS_ASSERT_LESS_THAN_EQUALS(0, listener);
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+        TS_ASSERT_EQUALS(bind(listener, (sockaddr*)&address, sizeof(address)), 0);
+
+        MAKE_PTR(TelemetryModifier<2>, p_modifier);
+        p_modifier->SetPublishInterval(2);
+        p_modifier->SetSocketPath(socket_path);
+        p_modifier->AddMetric("mean_target_area", boost::bind(&TelemetryModifier<2>::GetMeanCellDataItem, _1, "target area"));
+        TS_ASSERT_THROWS_THIS(p_modifier->AddMetric("bad name", boost::bind(&TelemetryModifier<2>::GetMeanCellDataItem, _1, "target area")),
+                              "Telemetry metric names must be non-empty and contain no spaces or '='");
+
+        p_modifier->SetupSolve(cell_population, "TestTelemetryModifier");
+        TS_ASSERT_EQUALS(p_modifier->rGetSocketPath(), socket_path);
+        std::string first_message = Receive(listener);
+        TS_ASSERT_EQUALS(first_message.substr(0, 14), "status=running");
+        TS_ASSERT_DIFFERS(first_message.find(" cells=9 "), std::string::npos);
+        TS_ASSERT_DIFFERS(first_message.find(" t1_swaps=0 t2_swaps=0 t3_swaps=0"), std::string::npos);
+        TS_ASSERT_DIFFERS(first_message.find(" mean_target_area=1"), std::string::npos);
+
+        // Messages are published every second step
+        for (unsigned i=0; i<4; i++)
+        {
+            SimulationTime::Instance()->IncrementTimeOneStep();
+            p_modifier->UpdateAtEndOfTimeStep(cell_population);
+        }
+        TS_ASSERT_DIFFERS(Receive(listener).find(" step=2 "), std::string::npos);
+        TS_ASSERT_DIFFERS(Receive(listener).find(" step=4 "), std::string::npos);
+        TS_ASSERT_EQUALS(Receive(listener), "");
+
+        p_modifier->UpdateAtEndOfSolve(cell_population);
+        TS_ASSERT_EQUALS(Receive(listener).substr(0, 15), "status=finished");
+        TS_ASSERT_EQUALS(p_modifier->GetNumMessagesSent(), 4u);
+        TS_ASSERT_EQUALS(p_modifier->GetNumMessagesDropped(), 0u);
+
+        // Without a listener the messages are dropped, and the simulation carries on
+        close(listener);
+        unlink(socket_path.c_str());
+        p_modifier->SetupSolve(cell_population, "TestTelemetryModifier");
+        p_modifier->UpdateAtEndOfSolve(cell_population);
+        TS_ASSERT_EQUALS(p_modifier->GetNumMessagesSent(), 0u);
+        TS_ASSERT_EQUALS(p_modifier->GetNumMessagesDropped(), 2u);
+    }
+};
+
+#endif /*TESTTELEMETRYMODIFIER_HPP_*/
@@ -0,0 +1,166 @@
+
+#ifndef TESTTISSUEFILE_HPP_
+#define TESTTISSUEFILE_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "MatteoSrnModel.hpp"
+#include "WildTypeCellMutationState.hpp"
+#include "CellLabel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "TissueFileReader.hpp"
+#include "TissueFileWriter.hpp"
+#include "OutputFileHandler.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestTissueFile : public AbstractCellBasedTestSuite
+{
+private:
+
+    /* Write a small labelled population with known SRN states to a tissue file in the given directory. */
+    std::string WriteTissue(OutputFileHandler& rHandler)
+    {
+        HoneycombVertexMeshGenerator generator(4, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        std::vector<CellPtr> cells;
+        CreateCells(p_mesh->GetNumElements(), cells);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+        cell_population.InitialiseCells();
+
+        std::string path = rHandler.GetOutputDirectoryFullPath() + "tissue.bin";
+        TissueFileWriter<2>::WriteTissueFile(cell_population, path);
+        return path;
+    }
+
+    /* Create cells with SRN states, birth times, types and labels depending on their index. */
+    void CreateCells(unsigned numCells, std::vector<CellPtr>& rCells)
+    {
+        MAKE_PTR(WildTypeCellMutationState, p_state);
+        boost::shared_ptr<AbstractCellProperty> p_label(CellPropertyRegistry::Instance()->Get<CellLabel>());
+        for (unsigned i=0; i<numCells; i++)
+        {
+            NoCellCycleModel* p_cc_model = new NoCellCycleModel();
+            p_cc_model->SetDimension(2);
+            std::vector<double> initial_conditions(2);
+            initial_conditions[0] = 0.1*i;
+            initial_conditions[1] = 1.0 - 0.05*i;
+            MatteoSrnModel* p_srn_model = new MatteoSrnModel();
+            p_srn_model->SetInitialConditions(initial_conditions);
+
+            CellPtr p_cell(new Cell(p_state, p_cc_model, p_srn_model));
+            p_cell->SetBirthTime(-0.5*i);
+            p_cell->SetCellProliferativeType(i%3 == 0 ? p_diff_type : p_wild_type);
+            if (i%2 == 0)
+            {
+                p_cell->AddCellProperty(p_label);
+            }
+            rCells.push_back(p_cell);
+        }
+    }
+
+public:
+
+    void TestRoundTrip() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(4, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        p_mesh->GetNode(5)->rGetModifiableLocation()[0] += 0.1;
+
+        std::vector<CellPtr> cells;
+        CreateCells(p_mesh->GetNumElements(), cells);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+        cell_population.InitialiseCells();
+
+        OutputFileHandler handler("TestTissueFile");
+        std::string path = handler.GetOutputDirectoryFullPath() + "tissue.bin";
+        TissueFileWriter<2>::WriteTissueFile(cell_population, path);
+
+        TissueFileReader<2> reader(path);
+        TS_ASSERT_EQUALS(reader.GetNumCells(), 12u);
+        MatteoMutableVertexMesh<2>* p_read_mesh = reader.GetMesh();
+        TS_ASSERT_EQUALS(p_read_mesh->GetNumNodes(), p_mesh->GetNumNodes());
+        TS_ASSERT_EQUALS(p_read_mesh->GetNumElements(), p_mesh->GetNumElements());
+        for (unsigned node_index=0; node_index<p_mesh->GetNumNodes(); node_index++)
+        {
+            Node<2>* p_node = p_mesh->GetNode(node_index);
+            Node<2>* p_read_node = p_read_mesh->GetNode(node_index);
+            TS_ASSERT_DELTA(p_read_node->rGetLocation()[0], p_node->rGetLocation()[0], 1e-15);
+            TS_ASSERT_DELTA(p_read_node->rGetLocation()[1], p_node->rGetLocation()[1], 1e-15);
+            TS_ASSERT_EQUALS(p_read_node->IsBoundaryNode(), p_node->IsBoundaryNode());
+            TS_ASSERT_EQUALS(p_read_node->rGetContainingElementIndices(), p_node->rGetContainingElementIndices());
+        }
+        for (unsigned elem_index=0; elem_index<p_mesh->GetNumElements(); elem_index++)
+        {
+            VertexElement<2,2>* p_element = p_mesh->GetElement(elem_index);
+            VertexElement<2,2>* p_read_element = p_read_mesh->GetElement(elem_index);
+            TS_ASSERT_EQUALS(p_read_element->GetNumNodes(), p_element->GetNumNodes());
+            for (unsigned local_index=0; local_index<p_element->GetNumNodes(); local_index++)
+            {
+                TS_ASSERT_EQUALS(p_read_element->GetNodeGlobalIndex(local_index), p_element->GetNodeGlobalIndex(local_index));
+            }
+        }
+
+        std::vector<CellPtr> read_cells;
+        reader.GenerateCells(read_cells);
+        VertexBasedCellPopulation<2> read_population(*p_read_mesh, read_cells);
+        read_population.InitialiseCells();
+        for (unsigned i=0; i<12; i++)
+        {
+            CellPtr p_cell = cell_population.GetCellUsingLocationIndex(i);
+            CellPtr p_read_cell = read_population.GetCellUsingLocationIndex(i);
+            TS_ASSERT_EQUALS(p_read_cell->GetCellProliferativeType() == p_wild_type, p_cell->GetCellProliferativeType() == p_wild_type);
+            TS_ASSERT_EQUALS(p_read_cell->HasCellProperty<CellLabel>(), p_cell->HasCellProperty<CellLabel>());
+            TS_ASSERT_DELTA(p_read_cell->GetBirthTime(), p_cell->GetBirthTime(), 1e-15);
+            MatteoSrnModel* p_read_srn_model = static_cast<MatteoSrnModel*>(p_read_cell->GetSrnModel());
+            TS_ASSERT_DELTA(p_read_srn_model->GetNotch(), 0.1*i, 1e-15);
+            TS_ASSERT_DELTA(p_read_srn_model->GetDelta(), 1.0 - 0.05*i, 1e-15);
+        }
+    }
+
+    void TestBadFiles() throw (Exception)
+    {
+        TS_ASSERT_THROWS_CONTAINS(TissueFileReader<2> reader("no-such-tissue.bin"), "Could not open the tissue file");
+
+        OutputFileHandler handler("TestTissueFileBadFiles");
+        std::string tissue_path = WriteTissue(handler);
+        std::string path = handler.GetOutputDirectoryFullPath() + "not-a-tissue.bin";
+        std::ofstream file(path.c_str(), std::ios::binary);
+        file << std::string(200, 'x');
+        file.close();
+        TS_ASSERT_THROWS_CONTAINS(TissueFileReader<2> reader(path), "is not a tissue file");
+
+        // A file cut short is rejected before anything is read from it
+        std::string truncated_path = handler.GetOutputDirectoryFullPath() + "truncated.bin";
+        std::ifstream tissue_file(tissue_path.c_str(), std::ios::binary);
+        std::string contents((std::istreambuf_iterator<char>(tissue_file)), std::istreambuf_iterator<char>());
+        std::ofstream truncated_file(truncated_path.c_str(), std::ios::binary);
+        truncated_file << contents.substr(0, contents.size() - 8);
+        truncated_file.close();
+        TS_ASSERT_THROWS_CONTAINS(TissueFileReader<2> reader(truncated_path), "is truncated");
+
+        // An offset near the top of its range must not wrap round the check on the element sizes
+        std::string wrapped_path = handler.GetOutputDirectoryFullPath() + "wrapped.bin";
+        TissueFileHeader header;
+        memcpy(&header, contents.data(), sizeof(TissueFileHeader));
+        uint32_t wrapped_offset = UINT_MAX - 1;
+        contents.replace(header.mElementOffsetsOffset + sizeof(uint32_t), sizeof(uint32_t),
+                         reinterpret_cast<const char*>(&wrapped_offset), sizeof(uint32_t));
+        std::ofstream wrapped_file(wrapped_path.c_str(), std::ios::binary);
+        wrapped_file << contents;
+        wrapped_file.close();
+        TS_ASSERT_THROWS_CONTAINS(TissueFileReader<2> reader(wrapped_path), "decrease at element 1");
+
+        TS_ASSERT_THROWS_THIS(TissueFileReader<3> reader(tissue_path), "TissueFileReader is only implemented in 2D");
+    }
+};
+
+#endif /*TESTTISSUEFILE_HPP_*/
@@ -0,0 +1,49 @@
+#ifndef TESTTISSUESORTINGMODIFIER_HPP_
+#define TESTTISSUESORTINGMODIFIER_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "CheckpointArchiveTypes.hpp"
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "CellsGenerator.hpp"
+#include "NoCellCycleModel.hpp"
+#include "VertexBasedCellPopulation.hpp"
+#include "TissueSortingModifier.hpp"
+#include "PopulationConstants.hpp"
+#include "SmartPointers.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestTissueSortingModifier : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestSortingMetricsOfSingleMutantCell() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+
+        std::vector<CellPtr> cells;
+        CellsGenerator<NoCellCycleModel, 2> cells_generator;
+        cells_generator.GenerateBasic(cells, p_mesh->GetNumElements(), std::vector<unsigned>(), p_wild_type);
+
+        // Element 4 is the only element of the 3 by 3 honeycomb surrounded on all sides
+        cells[4]->SetCellProliferativeType(p_diff_type);
+        VertexBasedCellPopulation<2> cell_population(*p_mesh, cells);
+
+        MAKE_PTR(TissueSortingModifier<2>, p_modifier);
+        p_modifier->ComputeSortingMetrics(cell_population);
+
+        // The heterotypic boundary is the perimeter of the mutant cell
+        TS_ASSERT_DELTA(p_modifier->GetHeterotypicBoundaryLength(), p_mesh->GetSurfaceAreaOfElement(4), 1e-9);
+
+        // The wild-type cells form a single ring-shaped cluster around a single mutant cell
+        TS_ASSERT_EQUALS(p_modifier->rGetClusterSizes(true).size(), 1u);
+        TS_ASSERT_EQUALS(p_modifier->rGetClusterSizes(true)[0], 8u);
+        TS_ASSERT_EQUALS(p_modifier->rGetClusterSizes(false).size(), 1u);
+        TS_ASSERT_EQUALS(p_modifier->rGetClusterSizes(false)[0], 1u);
+        TS_ASSERT_DELTA(p_modifier->GetMeanClusterRadius(false), 0.0, 1e-9);
+        TS_ASSERT_LESS_THAN(0.0, p_modifier->GetMeanClusterRadius(true));
+    }
+};
+
+#endif /*TESTTISSUESORTINGMODIFIER_HPP_*/
@@ -0,0 +1,123 @@
+
+#ifndef TESTVERTEXGEOMETRYCACHE_HPP_
+#define TESTVERTEXGEOMETRYCACHE_HPP_
+
+#include <cxxtest/TestSuite.h>
+#include "AbstractCellBasedTestSuite.hpp"
+#include "HoneycombVertexMeshGenerator.hpp"
+#include "MatteoMutableVertexMesh.hpp"
+#include "VertexGeometryCache.hpp"
+#include "FakePetscSetup.hpp"
+
+class TestVertexGeometryCache : public AbstractCellBasedTestSuite
+{
+public:
+
+    void TestGeometryMatchesMesh() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+        p_mesh->Scale(1.1, 0.9);
+
+        VertexGeometryCache<2> cache;
+        VertexGeometryCache<2>* p_geometry = &cache;
+        p_geometry->Update(*p_mesh);
+
+        for (unsigned elem_index=0; elem_index<p_mesh->GetNumElements(); elem_index++)
+        {
+            VertexElement<2,2>* p_element = p_mesh->GetElement(elem_index);
+            TS_ASSERT_DELTA(p_geometry->GetArea(elem_index), p_mesh->GetVolumeOfElement(elem_index), 1e-12);
+            TS_ASSERT_DELTA(p_geometry->GetPerimeter(elem_index), p_mesh->GetSurfaceAreaOfElement(elem_index), 1e-12);
+
+            c_vector<double, 2> centroid = p_mesh->GetCentroidOfElement(elem_index);
+            TS_ASSERT_DELTA(p_geometry->GetCentroid(elem_index)[0], centroid[0], 1e-12);
+            TS_ASSERT_DELTA(p_geometry->GetCentroid(elem_index)[1], centroid[1], 1e-12);
+
+            for (unsigned local_index=0; local_index<p_element->GetNumNodes(); local_index++)
+            {
+                c_vector<double, 2> edge_gradient = p_mesh->GetNextEdgeGradientOfElementAtNode(p_element, local_index);
+                c_vector<double, 2> area_gradient = p_mesh->GetAreaGradientOfElementAtNode(p_element, local_index);
+                for (unsigned i=0; i<2; i++)
+                {
+                    TS_ASSERT_DELTA(p_geometry->GetNextEdgeGradient(elem_index, local_index)[i], edge_gradient[i], 1e-12);
+                    TS_ASSERT_DELTA(p_geometry->GetAreaGradient(elem_index, local_index)[i], area_gradient[i], 1e-12);
+                }
+            }
+        }
+    }
+
+    void TestPlainMeshAlwaysRecomputed() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
+
+        // A mesh without a change stamp owns no cache, so the caller's own is used
+        VertexGeometryCache<2> cache;
+        VertexGeometryCache<2>* p_geometry = &VertexGeometryCache<2>::rGetCache(*p_mesh, cache);
+        TS_ASSERT_EQUALS(p_geometry, &cache);
+
+        // Nothing shows that such a mesh is unchanged, so every update recomputes
+        p_geometry->Update(*p_mesh);
+        p_geometry->Update(*p_mesh);
+        TS_ASSERT_EQUALS(p_geometry->GetNumRecomputations(), 2u);
+
+        p_mesh->GetNode(0)->rGetModifiableLocation()[0] += 0.01;
+        p_geometry->Update(*p_mesh);
+        TS_ASSERT_EQUALS(p_geometry->GetNumRecomputations(), 3u);
+        unsigned elem_index = *(p_mesh->GetNode(0)->rGetContainingElementIndices().begin());
+        TS_ASSERT_DELTA(p_geometry->GetArea(elem_index), p_mesh->GetVolumeOfElement(elem_index), 1e-12);
+    }
+
+    void TestValidatedByChangeStamp() throw (Exception)
+    {
+        HoneycombVertexMeshGenerator generator(3, 3);
+        MatteoMutableVertexMesh<2> mesh(*generator.GetMesh());
+
+        // The mesh's own cache is used in place of the caller's
+        VertexGeometryCache<2> cache;
+        VertexGeometryCache<2>* p_geometry = &VertexGeometryCache<2>::rGetCache(mesh, cache);
+        TS_ASSERT_EQUALS(p_geometry, &mesh.rGetGeometryCache());
+        p_geometry->Update(mesh);
+        TS_ASSERT_EQUALS(p_geometry->GetNumRecomputations(), 1u);
+
+        // A quiet ReMesh() leaves the stamp, and so the cache, alone
+        unsigned long change_stamp = mesh.GetChangeStamp();
+        mesh.ReMesh();
+        TS_ASSERT_EQUALS(mesh.GetChangeStamp(), change_stamp);
+        p_geometry->Update(mesh);
+        TS_ASSERT_EQUALS(p_geometry->GetNumRecomputations(), 1u);
+
+        // Moving a node through the mesh gives it a new stamp
+        c_vector<double, 2> location = mesh.GetNode(0)->rGetLocation();
+        location[0] += 0.01;
+        mesh.SetNode(0, ChastePoint<2>(location));
+        TS_ASSERT_DIFFERS(mesh.GetChangeStamp(), change_stamp);
+        p_geometry->Update(mesh);
+        TS_ASSERT_EQUALS(p_geometry->GetNumRecomputations(), 2u);
+        unsigned elem_index = *(mesh.GetNode(0)->rGetContainingElementIndices().begin());
+        TS_ASSERT_DELTA(p_geometry->GetArea(elem_index), mesh.GetVolumeOfElement(elem_index), 1e-12);
+
+        // Nodes moved directly are only seen once the mesh is marked as changed
+        mesh.GetNode(0)->rGetModifiableLocation()[0] -= 0.01;
+        p_geometry->Update(mesh);
+        TS_ASSERT_EQUALS(p_geometry->GetNumRecomputations(), 2u);
+        mesh.MarkAsChanged();
+        p_geometry->Update(mesh);
+        TS_ASSERT_EQUALS(p_geometry->GetNumRecomputations(), 3u);
+        TS_ASSERT_DELTA(p_geometry->GetArea(elem_index), mesh.GetVolumeOfElement(elem_index), 1e-12);
+
+        // Reset() forgets the geometry
+        p_geometry->Reset();
+        p_geometry->Update(mesh);
+        TS_ASSERT_EQUALS(p_geometry->GetNumRecomputations(), 4u);
+
+        // Another mesh has a stamp and a cache of its own, so is never mistaken for this one
+        MatteoMutableVertexMesh<2> other_mesh(*generator.GetMesh());
+        TS_ASSERT_DIFFERS(other_mesh.GetChangeStamp(), mesh.GetChangeStamp());
+        TS_ASSERT_DIFFERS(&VertexGeometryCache<2>::rGetCache(other_mesh, cache), p_geometry);
+        p_geometry->Update(other_mesh);
+        TS_ASSERT_EQUALS(p_geometry->GetNumRecomputations(), 5u);
+    }
+};
+
+#endif /*TESTVERTEXGEOMETRYCACHE_HPP_*/
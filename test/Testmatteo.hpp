@@ -2,6 +2,8 @@
 #define TESTRUNNINGDIFFERENTIALADHESIONSIMULATIONSTUTORIAL_HPP_
 
 #include <cxxtest/TestSuite.h>
+#include <climits>
+#include <boost/program_options.hpp>
 #include "CheckpointArchiveTypes.hpp"
 #include "AbstractCellBasedTestSuite.hpp"
 #include "HoneycombVertexMeshGenerator.hpp"
@@ -20,15 +22,46 @@
 #include "ConstantTargetAreaModifier.hpp"
 #include "MatteoModifier.hpp"
 #include "CellLabelWriter.hpp"
+#include "CommandLineArguments.hpp"
+
+namespace po = boost::program_options;
 
 class Testmatteo : public AbstractCellBasedTestSuite
 {
+protected:
+    po::variables_map args;
+
+    void ProcessCommandLineArguments() throw (Exception)
+    {
+        po::options_description description("Chaste Tissue Differential Adhesion Test Usage");
+        description.add_options()
+            ("help,h", "Display this help message")
+            ("number,n", po::value<unsigned>()->default_value(20), "sqrt(number of cells)")
+            ("dt,d", po::value<double>(), "Simulation time step (defaults to that of the cell population)")
+            ("sample,s", po::value<unsigned>()->default_value(10), "Sampling time step multiple")
+            ("output,o", po::value<bool>()->default_value(true), "Write results files; if false, only the initial state is written")
+            ("time,t", po::value<double>()->default_value(11.0), "Simulation end time");
+
+        int argc = *(CommandLineArguments::Instance()->p_argc);
+        char** argv = *(CommandLineArguments::Instance()->p_argv);
+        po::store(po::command_line_parser(argc, argv).options(description).run(), args);
+        po::notify(args);
+
+        if (args.count("help"))
+        {
+            std::cout << description;
+            exit(0);
+        }
+    }
+
 public:
 
     void TestVertexBasedDifferentialAdhesionSimulation() throw (Exception)
     {
+        ProcessCommandLineArguments();
+
         /* First we create a regular vertex mesh. Here we choose to set the value of the cell rearrangement threshold. */
-        HoneycombVertexMeshGenerator generator(20, 20);
+        HoneycombVertexMeshGenerator generator(args["number"].as<unsigned>(), args["number"].as<unsigned>());
         MutableVertexMesh<2,2>* p_mesh = generator.GetMesh();
         //ToroidalHoneycombVertexMeshGenerator generator(5, 5);
         //Toroidal2dVertexMesh* p_mesh = generator.GetToroidalMesh();
@@ -73,8 +106,18 @@ public:
          * We can make the simulation run for longer to see more cell sorting by increasing the end time. */
         OffLatticeSimulation<2> simulator(cell_population);
         simulator.SetOutputDirectory("TestMatteo");
-        simulator.SetSamplingTimestepMultiple(10);
-        simulator.SetEndTime(11.0);
+        simulator.SetSamplingTimestepMultiple(args["sample"].as<unsigned>());
+        simulator.SetEndTime(args["time"].as<double>());
+        if (args.count("dt"))
+        {
+            simulator.SetDt(args["dt"].as<double>());
+        }
+        if (!args["output"].as<bool>())
+        {
+            // Sample less often than once per run, for timing the simulation itself
+            simulator.SetSamplingTimestepMultiple(UINT_MAX);
+            cell_population.SetOutputResultsForChasteVisualizer(false);
+        }
 
         /* Next we create the differential adhesion force law. This builds upon the model of Nagai, Honda and co-workers
          * encounted in the TestRunningVertexBasedSimulationsTutorial by allowing different values of the adhesion